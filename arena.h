@@ -0,0 +1,259 @@
+/*
+Copyright (c) 2022, Dean Stephan
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of {{ project }} nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Provide cache-line aligned allocation for short-lived hypercomplex temporaries
+//      cache_line              64 bytes, the alignment of all of the below:
+//                              one cache line, and one AVX-512 register
+//      aligned_arena           a monotonic std::pmr::memory_resource.
+//                              Deallocation is free; everything goes back
+//                              at once with release(), or back to a mark()
+//                              with rewind()
+//      aligned_allocator<T>    an allocator over any memory_resource that
+//                              aligns every block to cache_line
+//      aligned_vector<T>       std::vector<T, aligned_allocator<T>>
+// so that the scratch buffers of one request come out of one arena, e.g.
+//      Stephan::aligned_arena arena;
+//      Stephan::aligned_vector<Stephan::quaternion<double>> poses(count, &arena);
+//      Stephan::quaternion_soa<double> batch(count, &arena);
+// and cost a pointer increment each. Like the std::pmr containers, a copy
+// of such a container uses the default resource, not the arena.
+//
+// Every thread also has a scratch arena of its own, used through
+//      scratch_scope           everything allocated from the calling
+//                              thread's arena while the scope lives is
+//                              given back when it ends
+// Scopes nest like a stack. Blocks are kept across scopes, so once a hot
+// loop has run through once its scratch needs no allocation at all. The
+// batch functions that need temporaries (parallel.h, quaternion_fft.h)
+// take them from here.
+//
+// An aligned_arena, the scratch arenas included, must only be used by one
+// thread at a time.
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory_resource>
+#include <new>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+namespace Stephan {
+
+inline constexpr std::size_t cache_line = 64;
+
+class aligned_arena : public std::pmr::memory_resource {
+private:
+	// Each block from upstream starts with its header, padded to a cache line
+	struct block {
+		block*		previous;
+		std::size_t	size;
+	};
+	static constexpr std::size_t header_size = (sizeof(block) + cache_line - 1) & ~(cache_line - 1);
+
+	std::pmr::memory_resource*	upstream;
+	block*		blocks = nullptr;
+	block*		spare = nullptr;
+	std::byte*	cursor = nullptr;
+	std::byte*	end = nullptr;
+	std::size_t	next_size;
+
+public:
+	// A position to rewind() to
+	struct marker {
+		block*		current;
+		std::byte*	cursor;
+	};
+
+	explicit aligned_arena(std::size_t initial_size = 64 * 1024, std::pmr::memory_resource* upstream = std::pmr::get_default_resource()) noexcept
+		: upstream(upstream)
+		, next_size(std::max(initial_size, cache_line))
+	{}
+	aligned_arena(const aligned_arena&) = delete;
+	aligned_arena& operator=(const aligned_arena&) = delete;
+	~aligned_arena() override { this->release(); }
+
+	// Give every block back to upstream
+	void release() noexcept {
+		this->rewind(marker{ nullptr, nullptr });
+		while (this->spare != nullptr) {
+			block* previous = this->spare->previous;
+			this->upstream->deallocate(this->spare, this->spare->size, cache_line);
+			this->spare = previous;
+		}
+	}
+
+	marker mark() const noexcept { return marker{ this->blocks, this->cursor }; }
+	// Free everything allocated since position was marked. The blocks taken
+	// from upstream since then are kept for the next allocations.
+	void rewind(marker position) noexcept {
+		while (this->blocks != position.current) {
+			block* previous = this->blocks->previous;
+			this->blocks->previous = this->spare;
+			this->spare = this->blocks;
+			this->blocks = previous;
+		}
+		this->cursor = position.cursor;
+		this->end = (this->blocks == nullptr) ? nullptr : reinterpret_cast<std::byte*>(this->blocks) + this->blocks->size;
+	}
+
+	// Bytes held from upstream, in use or spare
+	std::size_t capacity() const noexcept {
+		std::size_t total = 0;
+		for (block* list : { this->blocks, this->spare }) {
+			for (; list != nullptr; list = list->previous) {
+				total += list->size;
+			}
+		}
+		return total;
+	}
+
+	std::pmr::memory_resource* upstream_resource() const noexcept { return this->upstream; }
+
+protected:
+	void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+		alignment = std::max(alignment, cache_line);
+		std::byte* start = this->aligned(alignment);
+		if ((start == nullptr) || (std::size_t(this->end - start) < bytes)) {
+			this->grow(bytes + alignment);
+			start = this->aligned(alignment);
+		}
+		this->cursor = start + bytes;
+		return start;
+	}
+	void do_deallocate(void*, std::size_t, std::size_t) override {}
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+private:
+	std::byte* aligned(std::size_t alignment) const noexcept {
+		if (this->cursor == nullptr) {
+			return nullptr;
+		}
+		std::size_t address = reinterpret_cast<std::size_t>(this->cursor);
+		std::size_t offset = ((address + alignment - 1) & ~(alignment - 1)) - address;
+		return (offset > std::size_t(this->end - this->cursor)) ? nullptr : this->cursor + offset;
+	}
+
+	// Continue in a block of at least bytes, a spare one if one is big enough
+	void grow(std::size_t bytes) {
+		std::size_t size = header_size + bytes;
+		block** link = &this->spare;
+		while ((*link != nullptr) && ((*link)->size < size)) {
+			link = &(*link)->previous;
+		}
+		block* next = *link;
+		if (next != nullptr) {
+			*link = next->previous;
+		}
+		else {
+			size = std::max(size, this->next_size);
+			next = static_cast<block*>(this->upstream->allocate(size, cache_line));
+			next->size = size;
+			this->next_size = size * 2;
+		}
+		next->previous = this->blocks;
+		this->blocks = next;
+		this->cursor = reinterpret_cast<std::byte*>(next) + header_size;
+		this->end = reinterpret_cast<std::byte*>(next) + next->size;
+	}
+};
+
+// Allocates from a memory_resource, always on a cache line
+template <typename T>
+struct aligned_allocator {
+	typedef T value_type;
+	typedef std::false_type propagate_on_container_copy_assignment;
+	typedef std::false_type propagate_on_container_move_assignment;
+	typedef std::false_type propagate_on_container_swap;
+
+	std::pmr::memory_resource*	resource;
+
+	aligned_allocator() noexcept : resource(std::pmr::get_default_resource()) {}
+	aligned_allocator(std::pmr::memory_resource* resource) noexcept : resource(resource) {}
+	template <typename U>
+	aligned_allocator(const aligned_allocator<U>& other) noexcept : resource(other.resource) {}
+
+	T* allocate(std::size_t n) {
+		if (n > std::size_t(-1) / sizeof(T)) {
+			throw std::bad_array_new_length();
+		}
+		return static_cast<T*>(this->resource->allocate(n * sizeof(T), std::max(alignof(T), cache_line)));
+	}
+	void deallocate(T* pointer, std::size_t n) noexcept {
+		this->resource->deallocate(pointer, n * sizeof(T), std::max(alignof(T), cache_line));
+	}
+
+	aligned_allocator select_on_container_copy_construction() const noexcept { return aligned_allocator(); }
+
+	template <typename U>
+	bool operator==(const aligned_allocator<U>& other) const noexcept { return *this->resource == *other.resource; }
+};
+
+template <typename T>
+using aligned_vector = std::vector<T, aligned_allocator<T>>;
+
+namespace detail {
+inline aligned_arena& scratch_arena() {
+	thread_local aligned_arena arena;
+	return arena;
+}
+}
+
+class scratch_scope {
+private:
+	aligned_arena&		arena;
+	aligned_arena::marker	position;
+
+public:
+	scratch_scope() noexcept
+		: arena(detail::scratch_arena())
+		, position(arena.mark())
+	{}
+	scratch_scope(const scratch_scope&) = delete;
+	scratch_scope& operator=(const scratch_scope&) = delete;
+	~scratch_scope() { this->arena.rewind(this->position); }
+
+	std::pmr::memory_resource* resource() const noexcept { return &this->arena; }
+
+	// count value-initialised T, e.g. a scratch array of complex<T> zeros.
+	// They are not destroyed, so T must be trivially destructible.
+	template <typename T>
+	std::span<T> allocate(std::size_t count) {
+		static_assert(std::is_trivially_destructible<T>::value);
+		T* values = aligned_allocator<T>(&this->arena).allocate(count);
+		for (std::size_t n = 0; n < count; ++n) {
+			::new (static_cast<void*>(values + n)) T();
+		}
+		return { values, count };
+	}
+};
+
+}
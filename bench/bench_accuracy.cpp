@@ -0,0 +1,1596 @@
+/*
+Copyright (c) 2022, Dean Stephan
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of {{ project }} nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Accuracy next to throughput
+// Each operation here is timed like the ones in bench_batch.cpp, and before
+// it is timed its results on batch_size inputs are compared with a long
+// double reference of the same mathematical function, written out without
+// the library. Every result reports
+//      max_ulp, mean_ulp   the error, in units in the last place of T
+//      budget_ulp          the error the operation is allowed
+// and a run whose max_ulp is over budget fails with the two numbers, so
+//      cd_bench --benchmark_filter=accuracy/
+// is a regression check of every path listed here, fast modes included.
+// Names are
+//      accuracy/<op>/<type>[/<size>]/<form>[/<policy>]
+// with form loop for the scalar operator and the SIMD target for a batch
+// kernel, and size that of a transform, or the length of a product chain,
+// of a run of samples or of a product tree.
+//
+// The error of a result with several components is normwise: the largest
+// component error over the ulp of T at the norm of the reference. It is the
+// measure the kernels can promise, since a small component formed by
+// cancellation has no relative accuracy of its own. long double is the
+// 64-bit x87 format on x86, eleven bits past double, which is enough to
+// tell a half ulp of double from a whole one.
+//
+// A Fourier transform spreads its rounding over all of its outputs, and
+// is measured against the ulp at their root mean square norm instead.
+//
+// float16 and bfloat16 are computed in float and rounded once, so their
+// results are held to half an ulp of their own spacing.
+//
+// The fixed-point types of fixed_point.h have one spacing, 2^-Fraction,
+// over their whole range, and saturate at its ends: a reference outside
+// the range is clamped to the nearest representable value first.
+//
+// log has results near 0 around |z| = 1, where any method that forms |z|
+// first loses all relative accuracy, as the function itself is only well
+// conditioned there in absolute terms. Its error is measured against the
+// ulp at 1 or at the result, whichever is larger, and the same floor can
+// be given to any other operation.
+//
+// A NaN component of a reference is matched only by a NaN result, and
+// leaves the norm the other components are measured against.
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <deque>
+#include <limits>
+#include <numbers>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "bench_common.h"
+
+#include "../complex_batch.h"
+#include "../complex_math.h"
+#include "../expression.h"
+#include "../fft.h"
+#include "../fixed_batch.h"
+#include "../fixed_point.h"
+#include "../half_batch.h"
+#include "../imu.h"
+#include "../inplace.h"
+#include "../octonion_batch.h"
+#include "../quaternion_fft.h"
+#include "../quaternion_math.h"
+#include "../quaternion_soa.h"
+#include "../rotation.h"
+#include "../skinning.h"
+#include "../slerp.h"
+#include "../unit_quaternion.h"
+
+namespace cd_bench {
+namespace {
+
+typedef long double real;
+
+template <std::size_t N>
+using exact = std::array<real, N>;
+
+// Spacing of T at |x|, never below that of the smallest normal number;
+// for a fixed-point T, its one spacing
+template <typename T>
+real ulp(real x) {
+	if constexpr (Stephan::detail::is_fixed<T>::value) {
+		return std::ldexp(real(1), -T::fraction_bits);
+	}
+	else if constexpr (Stephan::detail::is_half<T>::value) {
+		real magnitude = std::max(std::abs(x), real(float(std::numeric_limits<T>::min())));
+		return std::ldexp(real(1), std::ilogb(magnitude) - (std::numeric_limits<T>::digits - 1));
+	}
+	else {
+		T magnitude = std::max(std::abs(static_cast<T>(x)), std::numeric_limits<T>::min());
+		return real(std::nextafter(magnitude, std::numeric_limits<T>::infinity())) - real(magnitude);
+	}
+}
+
+// A component of a result, exactly
+template <typename T>
+real to_real(T x) {
+	if constexpr (Stephan::detail::is_fixed<T>::value) {
+		return real(double(x));
+	}
+	else if constexpr (Stephan::detail::is_half<T>::value) {
+		return real(float(x));
+	}
+	else {
+		return real(x);
+	}
+}
+
+// The error a result may have: budget ulp of T at the norm of the
+// reference, or at floor when that is larger
+struct allowance {
+	double	budget;
+	real	floor;
+
+	allowance(double budget, real floor = 0) : budget(budget), floor(floor) {}
+};
+
+template <typename T, std::size_t N>
+double ulp_error(const std::array<T, N>& result, const exact<N>& reference, real floor) {
+	real norm2 = 0, worst = 0;
+	for (std::size_t n = 0; n < N; ++n) {
+		if (std::isnan(reference[n])) {
+			if (!std::isnan(to_real(result[n]))) {
+				return std::numeric_limits<double>::infinity();
+			}
+			continue;
+		}
+		norm2 += reference[n] * reference[n];
+		real difference = std::abs(to_real(result[n]) - reference[n]);
+		if (!(difference <= worst)) {
+			// NaN counts as an infinite error
+			worst = std::isnan(difference) ? std::numeric_limits<real>::infinity() : difference;
+		}
+	}
+	return double(worst / ulp<T>(std::max(std::sqrt(norm2), floor)));
+}
+
+// Time body after checking the output it leaves behind: result(n) gives the
+// components of output n, to be compared with expected[n]
+template <typename T, std::size_t N, typename Body, typename Result>
+void check_and_time(benchmark::State& state, allowance allowed, const std::vector<exact<N>>& expected, const Body& body, const Result& result) {
+	body();
+	double worst = 0, sum = 0;
+	for (std::size_t n = 0; n < expected.size(); ++n) {
+		double error = ulp_error<T, N>(result(n), expected[n], allowed.floor);
+		worst = std::max(worst, error);
+		sum += error;
+	}
+	state.counters["max_ulp"] = worst;
+	state.counters["mean_ulp"] = sum / double(expected.size());
+	state.counters["budget_ulp"] = allowed.budget;
+	if (!(worst <= allowed.budget)) {
+		state.SkipWithError(("max_ulp " + std::to_string(worst) + " over budget " + std::to_string(allowed.budget)).c_str());
+		return;
+	}
+	for (auto _ : state) {
+		body();
+		benchmark::ClobberMemory();
+	}
+	set_items(state, expected.size());
+}
+
+template <typename T, std::size_t N, typename Body, typename Result>
+void register_loop(const std::string& name, allowance allowed, const std::vector<exact<N>>& expected, Body body, Result result) {
+	benchmark::RegisterBenchmark((name + "/loop").c_str(), [=, &expected](benchmark::State& state) {
+		check_and_time<T, N>(state, allowed, expected, body, result);
+	});
+}
+
+template <typename T, std::size_t N, typename Body, typename Result>
+void register_targets(const std::string& name, allowance allowed, const std::vector<exact<N>>& expected, Body body, Result result) {
+	for (Stephan::simd::isa target : available_isas()) {
+		benchmark::RegisterBenchmark((name + "/" + isa_name(target)).c_str(), [=, &expected](benchmark::State& state) {
+			scoped_isa selection(target);
+			check_and_time<T, N>(state, allowed, expected, body, result);
+		});
+	}
+}
+
+template <typename T>
+std::array<T, 1> components(T value) { return { value }; }
+template <typename T>
+std::array<T, 2> components(const Stephan::complex<T>& value) { return { value.Re(), value.Im() }; }
+template <typename T>
+std::array<T, 4> components(const Stephan::quaternion<T>& value) { return { value.Re(), value.Im1(), value.Im2(), value.Im3() }; }
+template <typename T>
+std::array<T, 3> components(const Stephan::vec3<T>& value) { return { value.x, value.y, value.z }; }
+template <typename T>
+std::array<T, 8> components(const Stephan::octonion<T>& value) { return value.components(); }
+template <typename T>
+std::array<T, 8> components(const Stephan::dual_quaternion<T>& value) {
+	const Stephan::quaternion<T>& r = value.real();
+	const Stephan::quaternion<T>& d = value.dual();
+	return { r.Re(), r.Im1(), r.Im2(), r.Im3(), d.Re(), d.Im1(), d.Im2(), d.Im3() };
+}
+
+// The references, on the exact values of the inputs
+template <typename T>
+std::complex<real> widen(const Stephan::complex<T>& z) { return std::complex<real>(z.Re(), z.Im()); }
+inline exact<2> narrow(const std::complex<real>& z) { return { z.real(), z.imag() }; }
+
+template <typename T>
+exact<4> widen(const Stephan::quaternion<T>& q) { return { q.Re(), q.Im1(), q.Im2(), q.Im3() }; }
+template <typename T>
+exact<8> widen(const Stephan::octonion<T>& x) {
+	exact<8> result;
+	for (std::size_t c = 0; c < 8; ++c) {
+		result[c] = x[c];
+	}
+	return result;
+}
+
+inline exact<4> hamilton(const exact<4>& a, const exact<4>& b) {
+	return {
+		(a[0] * b[0]) - (a[1] * b[1]) - (a[2] * b[2]) - (a[3] * b[3]),
+		(a[0] * b[1]) + (a[1] * b[0]) + (a[2] * b[3]) - (a[3] * b[2]),
+		(a[0] * b[2]) - (a[1] * b[3]) + (a[2] * b[0]) + (a[3] * b[1]),
+		(a[0] * b[3]) + (a[1] * b[2]) - (a[2] * b[1]) + (a[3] * b[0]) };
+}
+template <std::size_t N>
+exact<N> conjugate(exact<N> a) {
+	for (std::size_t n = 1; n < N; ++n) {
+		a[n] = -a[n];
+	}
+	return a;
+}
+template <std::size_t N>
+real norm2(const exact<N>& a) {
+	real sum = 0;
+	for (real c : a) {
+		sum += c * c;
+	}
+	return sum;
+}
+template <std::size_t N>
+exact<N> scale(exact<N> a, real s) {
+	for (real& c : a) {
+		c *= s;
+	}
+	return a;
+}
+template <std::size_t N>
+exact<N> add(exact<N> a, const exact<N>& b) {
+	for (std::size_t n = 0; n < N; ++n) {
+		a[n] += b[n];
+	}
+	return a;
+}
+
+// (a, b) (c, d) = (a c - d* b, d a + b c*), on pairs of quaternions
+inline exact<8> cayley_dickson(const exact<8>& x, const exact<8>& y) {
+	exact<4> a{ x[0], x[1], x[2], x[3] }, b{ x[4], x[5], x[6], x[7] };
+	exact<4> c{ y[0], y[1], y[2], y[3] }, d{ y[4], y[5], y[6], y[7] };
+	exact<4> lower = add(hamilton(a, c), scale(hamilton(conjugate(d), b), -1));
+	exact<4> upper = add(hamilton(d, a), hamilton(b, conjugate(c)));
+	return { lower[0], lower[1], lower[2], lower[3], upper[0], upper[1], upper[2], upper[3] };
+}
+
+inline exact<3> rotate(const exact<4>& q, const exact<3>& v) {
+	exact<4> rotated = hamilton(hamilton(q, exact<4>{ 0, v[0], v[1], v[2] }), conjugate(q));
+	return { rotated[1], rotated[2], rotated[3] };
+}
+
+inline exact<4> quaternion_exp(const exact<4>& q) {
+	real angle = std::sqrt((q[1] * q[1]) + (q[2] * q[2]) + (q[3] * q[3]));
+	real s = std::exp(q[0]);
+	real v = (angle == 0) ? s : (s * std::sin(angle)) / angle;
+	return { s * std::cos(angle), q[1] * v, q[2] * v, q[3] * v };
+}
+inline exact<4> quaternion_log(const exact<4>& q) {
+	real angle = std::sqrt((q[1] * q[1]) + (q[2] * q[2]) + (q[3] * q[3]));
+	real v = (angle == 0) ? 0 : std::atan2(angle, q[0]) / angle;
+	if ((angle == 0) && (q[0] < 0)) {
+		// The branch quaternion_math.h takes for negative reals
+		return { std::log(-q[0]), std::numbers::pi_v<real>, 0, 0 };
+	}
+	return { std::log(std::sqrt(norm2(q))), q[1] * v, q[2] * v, q[3] * v };
+}
+inline exact<4> quaternion_slerp(const exact<4>& q0, exact<4> q1, real t) {
+	real cosine = (q0[0] * q1[0]) + (q0[1] * q1[1]) + (q0[2] * q1[2]) + (q0[3] * q1[3]);
+	if (cosine < 0) {
+		q1 = scale(q1, -1);
+	}
+	real theta = 2 * std::atan2(std::sqrt(norm2(add(q1, scale(q0, -1)))), std::sqrt(norm2(add(q1, q0))));
+	real sine = std::sin(theta);
+	if (sine == 0) {
+		return q0;
+	}
+	return add(scale(q0, std::sin((1 - t) * theta) / sine), scale(q1, std::sin(t * theta) / sine));
+}
+
+inline exact<4> quaternion_nlerp(const exact<4>& q0, const exact<4>& q1, real t) {
+	real cosine = (q0[0] * q1[0]) + (q0[1] * q1[1]) + (q0[2] * q1[2]) + (q0[3] * q1[3]);
+	exact<4> sum = add(scale(q0, 1 - t), scale(q1, (cosine < 0) ? -t : t));
+	return scale(sum, 1 / std::sqrt(norm2(sum)));
+}
+
+// Inputs spread over 2^-8 .. 2^8 in magnitude, so that division and the
+// functions with a scale see more than the unit sphere
+template <typename V>
+std::vector<V> spread_values(std::size_t count, unsigned seed) {
+	std::vector<V> values = random_values<V>(count, seed);
+	std::vector<typename ops<V>::scalar> exponents = random_scalars<typename ops<V>::scalar>(count, seed + 100, -8, 8);
+	for (std::size_t n = 0; n < count; ++n) {
+		values[n] = values[n] * std::exp2(std::round(exponents[n]));
+	}
+	return values;
+}
+
+// Every other value of values, one ulp off in one component, so that an
+// equality test sees both outcomes
+template <typename V>
+std::vector<V> nudged(std::vector<V> values) {
+	typedef typename ops<V>::scalar T;
+	for (std::size_t n = 1; n < values.size(); n += 2) {
+		std::array<T, ops<V>::dimension> c = components(values[n]);
+		T& moved = c[(n / 2) % ops<V>::dimension];
+		moved = std::nextafter(moved, std::numeric_limits<T>::infinity());
+		values[n] = ops<V>::make(c.data());
+	}
+	return values;
+}
+
+// Every other value with a NaN in one component, and every fourth with
+// the rest zeroed as well, so that NaN lanes sit next to finite ones
+template <typename V>
+std::vector<V> with_nans(std::vector<V> values) {
+	typedef typename ops<V>::scalar T;
+	for (std::size_t n = 1; n < values.size(); n += 2) {
+		std::array<T, ops<V>::dimension> c = components(values[n]);
+		if ((n % 4) == 1) {
+			c.fill(T(0));
+		}
+		c[(n / 4) % ops<V>::dimension] = std::numeric_limits<T>::quiet_NaN();
+		values[n] = ops<V>::make(c.data());
+	}
+	return values;
+}
+
+// 1 where the two inputs compare equal, 0 elsewhere, as the equality
+// result is stored
+template <typename V>
+std::vector<exact<1>> equal_cases(const std::vector<V>& a, const std::vector<V>& b) {
+	std::vector<exact<1>> result;
+	for (std::size_t n = 0; n < a.size(); ++n) {
+		result.push_back({ (components(a[n]) == components(b[n])) ? real(1) : real(0) });
+	}
+	return result;
+}
+
+// |v|, exactly
+template <typename V>
+real magnitude(const V& value) {
+	real sum = 0;
+	for (auto c : components(value)) {
+		sum += to_real(c) * to_real(c);
+	}
+	return std::sqrt(sum);
+}
+
+// The sum of |a[n]| |b[n]|, the scale an error in a dot product is
+// measured against
+template <typename V>
+real dot_scale(const std::vector<V>& a, const std::vector<V>& b) {
+	real sum = 0;
+	for (std::size_t n = 0; n < a.size(); ++n) {
+		sum += magnitude(a[n]) * magnitude(b[n]);
+	}
+	return sum;
+}
+
+// The values converted to another type, e.g. complex<float> to complex<float16>
+template <typename V, typename W>
+std::vector<V> narrowed(const std::vector<W>& values) {
+	return std::vector<V>(values.begin(), values.end());
+}
+
+// Each value scaled by a factor drawn from [low, high]
+template <typename V>
+std::vector<V> scaled_values(std::vector<V> values, unsigned seed, typename ops<V>::scalar low, typename ops<V>::scalar high) {
+	std::vector<typename ops<V>::scalar> factors = random_scalars(values.size(), seed, low, high);
+	for (std::size_t n = 0; n < values.size(); ++n) {
+		values[n] = values[n] * factors[n];
+	}
+	return values;
+}
+
+template <typename T>
+struct complex_cases {
+	typedef Stephan::complex<T> type;
+
+	std::vector<type>		a = spread_values<type>(batch_size, 31);
+	std::vector<type>		b = spread_values<type>(batch_size, 32);
+	std::vector<type>		twin = nudged(a);
+	std::vector<type>		nans = with_nans(a);
+	// Unit-norm operands and accumulators for cmla, whose sum may cancel
+	std::vector<type>		unit_a = random_values<type>(batch_size, 33);
+	std::vector<type>		unit_b = random_values<type>(batch_size, 34);
+	std::vector<type>		unit_c = random_values<type>(batch_size, 35);
+	// pow within the range it is documented for, |z|, |w| <= 4
+	std::vector<type>		base = scaled_values(random_values<type>(batch_size, 36), 37, T(0.25), T(4));
+	std::vector<type>		power = scaled_values(random_values<type>(batch_size, 38), 39, T(0), T(4));
+	static constexpr T		exponent = T(-4);
+	std::vector<T>			magnitudes = random_scalars<T>(batch_size, 41, T(0.25), T(4));
+	std::vector<T>			angles = random_scalars<T>(batch_size, 42, T(-8), T(8));
+	std::vector<type>		out = std::vector<type>(batch_size);
+	std::vector<T>			scalars = std::vector<T>(batch_size);
+	type				sum;
+	static constexpr T		factor = T(1.3);
+	std::vector<exact<2>>		add, sub, mul, conj_mul, cmla, div, reciprocal, sqrt, exp, log, polar, pow, pow_real;
+	// inplace.h, with unit_c[0] as the fixed factor
+	std::vector<exact<2>>		scaled, conjugated, normalized, left, right;
+	std::vector<exact<2>>		dot, dotc;
+	std::vector<exact<1>>		equal = equal_cases(a, twin), norm, arg;
+	// log and arg over nans, which propagate
+	std::vector<exact<2>>		log_nan;
+	std::vector<exact<1>>		arg_nan;
+
+	complex_cases() {
+		std::complex<real> dot_sum = 0, dotc_sum = 0;
+		for (std::size_t n = 0; n < batch_size; ++n) {
+			std::complex<real> x = widen(this->a[n]), y = widen(this->b[n]);
+			this->add.push_back(narrow(x + y));
+			this->sub.push_back(narrow(x - y));
+			this->mul.push_back(narrow(x * y));
+			this->conj_mul.push_back(narrow(std::conj(x) * y));
+			this->scaled.push_back(narrow(x * real(factor)));
+			this->conjugated.push_back(narrow(std::conj(x)));
+			this->normalized.push_back(narrow(x / std::abs(x)));
+			this->left.push_back(narrow(widen(this->unit_c[0]) * x));
+			this->right.push_back(narrow(x * widen(this->unit_c[0])));
+			this->cmla.push_back(narrow(widen(this->unit_c[n]) + (widen(this->unit_a[n]) * widen(this->unit_b[n]))));
+			dot_sum += x * y;
+			dotc_sum += std::conj(x) * y;
+			this->arg.push_back({ std::arg(x) });
+			this->polar.push_back(narrow(std::polar(real(this->magnitudes[n]), real(this->angles[n]))));
+			std::complex<real> z = widen(this->base[n]), logarithm = std::log(z);
+			this->pow.push_back(narrow(std::exp(widen(this->power[n]) * logarithm)));
+			this->pow_real.push_back(narrow(std::exp(logarithm * real(exponent))));
+			this->div.push_back(narrow(x / y));
+			this->reciprocal.push_back(narrow(real(1) / x));
+			this->sqrt.push_back(narrow(std::sqrt(x)));
+			this->norm.push_back({ std::abs(x) });
+			// exp on unit-norm arguments, where it stays in range
+			std::complex<real> unit = x / std::abs(x);
+			this->exp.push_back(narrow(std::exp(unit)));
+			this->log.push_back(narrow(std::log(x)));
+			std::complex<real> z_nan = widen(this->nans[n]);
+			this->log_nan.push_back(narrow(std::log(z_nan)));
+			this->arg_nan.push_back({ std::arg(z_nan) });
+		}
+		this->dot.push_back(narrow(dot_sum));
+		this->dotc.push_back(narrow(dotc_sum));
+	}
+	type unit(std::size_t n) const { return this->a[n] * (T(1) / this->a[n].norm()); }
+};
+
+template <typename T>
+void register_complex() {
+	typedef Stephan::complex<T> type;
+	static complex_cases<T> data;
+	static const std::vector<type> units = [] {
+		std::vector<type> values;
+		for (std::size_t n = 0; n < batch_size; ++n) {
+			values.push_back(data.unit(n));
+		}
+		return values;
+	}();
+	std::string name = "/" + ops<type>::name();
+	std::span<const type> a(data.a), b(data.b), exp_in(units), nans(data.nans);
+	std::span<type> out(data.out);
+	std::span<const type> unit_a(data.unit_a), unit_b(data.unit_b), base(data.base), power(data.power);
+	auto result = [](std::size_t n) { return components(data.out[n]); };
+	auto scalar = [](std::size_t n) { return components(data.scalars[n]); };
+	auto sum = [](std::size_t) { return components(data.sum); };
+	const real dot_scale = cd_bench::dot_scale(data.a, data.b);
+
+	register_loop<T>("accuracy/add" + name, 0.5, data.add, [] { for (std::size_t n = 0; n < batch_size; ++n) { data.out[n] = data.a[n] + data.b[n]; } }, result);
+	register_loop<T>("accuracy/sub" + name, 0.5, data.sub, [] { for (std::size_t n = 0; n < batch_size; ++n) { data.out[n] = data.a[n] - data.b[n]; } }, result);
+	register_loop<T>("accuracy/equal" + name, { 0, 1 }, data.equal, [] {
+		for (std::size_t n = 0; n < batch_size; ++n) {
+			data.scalars[n] = (data.a[n] == data.twin[n]) ? T(1) : T(0);
+		}
+	}, scalar);
+
+	register_loop<T>("accuracy/mul" + name, 2, data.mul, [] { for (std::size_t n = 0; n < batch_size; ++n) { data.out[n] = data.a[n] * data.b[n]; } }, result);
+	register_targets<T>("accuracy/mul" + name, 2, data.mul, [=] { Stephan::cmul<T>(a, b, out); }, result);
+
+	register_loop<T>("accuracy/conj_mul" + name, 2, data.conj_mul, [] { for (std::size_t n = 0; n < batch_size; ++n) { data.out[n] = data.a[n].conjugate() * data.b[n]; } }, result);
+	register_targets<T>("accuracy/conj_mul" + name, 2, data.conj_mul, [=] { Stephan::conj_mul<T>(a, b, out); }, result);
+
+	register_loop<T>("accuracy/cmla" + name, { 2, 2 }, data.cmla, [] {
+		for (std::size_t n = 0; n < batch_size; ++n) {
+			data.out[n] = data.unit_c[n] + (data.unit_a[n] * data.unit_b[n]);
+		}
+	}, result);
+	register_targets<T>("accuracy/cmla" + name, { 2, 2 }, data.cmla, [=] {
+		std::copy(data.unit_c.begin(), data.unit_c.end(), data.out.begin());
+		Stephan::cmla<T>(unit_a, unit_b, out);
+	}, result);
+
+	register_loop<T>("accuracy/dot" + name, { 4, dot_scale }, data.dot, [] {
+		type total;
+		for (std::size_t n = 0; n < batch_size; ++n) {
+			total += data.a[n] * data.b[n];
+		}
+		data.sum = total;
+	}, sum);
+	register_targets<T>("accuracy/dot" + name, { 4, dot_scale }, data.dot, [=] { data.sum = Stephan::dot<T>(a, b); }, sum);
+	register_targets<T>("accuracy/dotc" + name, { 4, dot_scale }, data.dotc, [=] { data.sum = Stephan::dotc<T>(a, b); }, sum);
+
+	register_loop<T>("accuracy/div" + name, 3, data.div, [] { for (std::size_t n = 0; n < batch_size; ++n) { data.out[n] = data.a[n] / data.b[n]; } }, result);
+	register_loop<T>("accuracy/div" + name + "/fast_reciprocal", 5, data.div, [] {
+		for (std::size_t n = 0; n < batch_size; ++n) {
+			data.out[n] = data.a[n].template divide<Stephan::fast_reciprocal>(data.b[n]);
+		}
+	}, result);
+	register_targets<T>("accuracy/div" + name, 3, data.div, [=] { Stephan::cdiv<T>(a, b, out); }, result);
+
+	register_loop<T>("accuracy/reciprocal" + name, 3, data.reciprocal, [] { for (std::size_t n = 0; n < batch_size; ++n) { data.out[n] = data.a[n].reciprocal(); } }, result);
+	register_loop<T>("accuracy/reciprocal" + name + "/fast_reciprocal", 4, data.reciprocal, [] {
+		for (std::size_t n = 0; n < batch_size; ++n) {
+			data.out[n] = data.a[n].template reciprocal<Stephan::fast_reciprocal>();
+		}
+	}, result);
+
+	register_loop<T>("accuracy/norm" + name, 1, data.norm, [] { for (std::size_t n = 0; n < batch_size; ++n) { data.scalars[n] = data.a[n].norm(); } }, scalar);
+	register_targets<T>("accuracy/norm" + name, 1, data.norm, [=] { Stephan::abs<T>(a, std::span<T>(data.scalars)); }, scalar);
+
+	register_loop<T>("accuracy/sqrt" + name, 2, data.sqrt, [] { for (std::size_t n = 0; n < batch_size; ++n) { data.out[n] = data.a[n].sqrt(); } }, result);
+	register_targets<T>("accuracy/sqrt" + name, 2, data.sqrt, [=] { Stephan::sqrt<T>(a, out); }, result);
+
+	register_loop<T>("accuracy/exp" + name, 3, data.exp, [] { for (std::size_t n = 0; n < batch_size; ++n) { data.out[n] = Stephan::exp(units[n]); } }, result);
+	register_targets<T>("accuracy/exp" + name, 4, data.exp, [=] { Stephan::exp<T>(exp_in, out); }, result);
+
+	register_loop<T>("accuracy/log" + name, { 2, 1 }, data.log, [] { for (std::size_t n = 0; n < batch_size; ++n) { data.out[n] = Stephan::log(data.a[n]); } }, result);
+	register_targets<T>("accuracy/log" + name, { 4, 1 }, data.log, [=] { Stephan::log<T>(a, out); }, result);
+
+	register_loop<T>("accuracy/arg" + name, 2.5, data.arg, [] { for (std::size_t n = 0; n < batch_size; ++n) { data.scalars[n] = Stephan::arg(data.a[n]); } }, scalar);
+	register_targets<T>("accuracy/arg" + name, 2.5, data.arg, [=] { Stephan::arg<T>(a, std::span<T>(data.scalars)); }, scalar);
+
+	register_loop<T>("accuracy/log_nan" + name, { 2, 1 }, data.log_nan, [] { for (std::size_t n = 0; n < batch_size; ++n) { data.out[n] = Stephan::log(data.nans[n]); } }, result);
+	register_targets<T>("accuracy/log_nan" + name, { 4, 1 }, data.log_nan, [=] { Stephan::log<T>(nans, out); }, result);
+	register_loop<T>("accuracy/arg_nan" + name, 2.5, data.arg_nan, [] { for (std::size_t n = 0; n < batch_size; ++n) { data.scalars[n] = Stephan::arg(data.nans[n]); } }, scalar);
+	register_targets<T>("accuracy/arg_nan" + name, 2.5, data.arg_nan, [=] { Stephan::arg<T>(nans, std::span<T>(data.scalars)); }, scalar);
+
+	register_loop<T>("accuracy/polar" + name, 3, data.polar, [] {
+		for (std::size_t n = 0; n < batch_size; ++n) {
+			data.out[n] = Stephan::polar(data.magnitudes[n], data.angles[n]);
+		}
+	}, result);
+	register_targets<T>("accuracy/polar" + name, 3, data.polar, [=] {
+		Stephan::polar<T>(std::span<const T>(data.magnitudes), std::span<const T>(data.angles), out);
+	}, result);
+
+	register_loop<T>("accuracy/pow" + name, 24, data.pow, [] { for (std::size_t n = 0; n < batch_size; ++n) { data.out[n] = Stephan::pow(data.base[n], data.power[n]); } }, result);
+	register_targets<T>("accuracy/pow" + name, 24, data.pow, [=] { Stephan::pow<T>(base, power, out); }, result);
+	register_loop<T>("accuracy/pow_real" + name, 16, data.pow_real, [] {
+		for (std::size_t n = 0; n < batch_size; ++n) {
+			data.out[n] = Stephan::pow(data.base[n], complex_cases<T>::exponent);
+		}
+	}, result);
+	register_targets<T>("accuracy/pow_real" + name, 16, data.pow_real, [=] { Stephan::pow<T>(base, complex_cases<T>::exponent, out); }, result);
+
+	auto reset = [] { std::copy(data.a.begin(), data.a.end(), data.out.begin()); };
+	const type w0 = data.unit_c[0];
+	register_targets<T>("accuracy/scale_inplace" + name, 0.5, data.scaled, [=] { reset(); Stephan::scale_inplace<T>(out, complex_cases<T>::factor); }, result);
+	register_targets<T>("accuracy/conjugate_inplace" + name, 0, data.conjugated, [=] { reset(); Stephan::conjugate_inplace<T>(out); }, result);
+	register_targets<T>("accuracy/normalize_inplace" + name, 3, data.normalized, [=] { reset(); Stephan::normalize_inplace<T>(out); }, result);
+	register_targets<T>("accuracy/left_multiply_inplace" + name, 2, data.left, [=] { reset(); Stephan::left_multiply_inplace<T>(w0, out); }, result);
+	register_targets<T>("accuracy/right_multiply_inplace" + name, 2, data.right, [=] { reset(); Stephan::right_multiply_inplace<T>(out, w0); }, result);
+}
+
+// Reals of either sign first, where the vector part has no direction
+template <typename T>
+std::vector<Stephan::quaternion<T>> with_reals(std::vector<Stephan::quaternion<T>> values) {
+	const T reals[] = { T(-2), T(-1), T(-0.5), T(-1e-3), T(-300), T(2), T(1), T(0.25) };
+	for (std::size_t n = 0; n < std::size(reals); ++n) {
+		values[n] = Stephan::quaternion<T>(reals[n]);
+	}
+	return values;
+}
+
+template <typename T>
+struct quaternion_cases {
+	typedef Stephan::quaternion<T> type;
+
+	std::vector<type>		a = with_reals(spread_values<type>(batch_size, 41));
+	std::vector<type>		b = spread_values<type>(batch_size, 42);
+	std::vector<type>		unit_a = random_values<type>(batch_size, 43);
+	std::vector<type>		unit_b = random_values<type>(batch_size, 44);
+	std::vector<type>		unit_c = random_values<type>(batch_size, 47);
+	std::vector<type>		twin = nudged(a);
+	std::vector<type>		nans = with_nans(a);
+	std::vector<T>			t = random_scalars<T>(batch_size, 45, T(0), T(1));
+	std::vector<Stephan::vec3<T>>	points;
+	std::vector<type>		out = std::vector<type>(batch_size);
+	std::vector<T>			scalars = std::vector<T>(batch_size);
+	std::vector<Stephan::vec3<T>>	rotated = std::vector<Stephan::vec3<T>>(batch_size);
+	Stephan::quaternion_soa<T>	soa_a = Stephan::quaternion_soa<T>(std::span<const type>(a));
+	Stephan::quaternion_soa<T>	soa_b = Stephan::quaternion_soa<T>(std::span<const type>(b));
+	Stephan::quaternion_soa<T>	soa_unit_a = Stephan::quaternion_soa<T>(std::span<const type>(unit_a));
+	Stephan::quaternion_soa<T>	soa_unit_b = Stephan::quaternion_soa<T>(std::span<const type>(unit_b));
+	Stephan::quaternion_soa<T>	soa_unit_c = Stephan::quaternion_soa<T>(std::span<const type>(unit_c));
+	Stephan::quaternion_soa<T>	soa_nans = Stephan::quaternion_soa<T>(std::span<const type>(nans));
+	Stephan::quaternion_soa<T>	soa_out = Stephan::quaternion_soa<T>(batch_size);
+	static constexpr T		factor = T(1.3);
+	std::vector<exact<4>>		add, sub, mul, div, reciprocal, normalize, exp, log, log_nan, slerp, nlerp;
+	// inplace.h, with unit_c[0] as the fixed factor
+	std::vector<exact<4>>		scaled, conjugated, left, right;
+	// expression.h: u v + w u - v on single values, and over containers
+	// u v + w and (u w0 - v*) / 2
+	std::vector<exact<4>>		lazy, fused, fused_conjugate;
+	std::vector<exact<1>>		equal = equal_cases(a, twin), norm;
+	std::vector<exact<3>>		rotate;
+
+	quaternion_cases() {
+		std::vector<type> positions = spread_values<type>(batch_size, 46);
+		for (std::size_t n = 0; n < batch_size; ++n) {
+			exact<4> x = widen(this->a[n]), y = widen(this->b[n]);
+			exact<4> u = widen(this->unit_a[n]), v = widen(this->unit_b[n]);
+			exact<4> w = widen(this->unit_c[n]), w0 = widen(this->unit_c[0]);
+			this->add.push_back(cd_bench::add(x, y));
+			this->sub.push_back(cd_bench::add(x, scale(y, -1)));
+			this->mul.push_back(hamilton(x, y));
+			this->div.push_back(scale(hamilton(x, conjugate(y)), 1 / norm2(y)));
+			this->reciprocal.push_back(scale(conjugate(x), 1 / norm2(x)));
+			this->norm.push_back({ std::sqrt(norm2(x)) });
+			this->normalize.push_back(scale(x, 1 / std::sqrt(norm2(x))));
+			this->exp.push_back(quaternion_exp(u));
+			this->log.push_back(quaternion_log(x));
+			this->log_nan.push_back(quaternion_log(widen(this->nans[n])));
+			this->slerp.push_back(quaternion_slerp(u, v, this->t[n]));
+			this->nlerp.push_back(quaternion_nlerp(u, v, this->t[n]));
+			this->scaled.push_back(scale(x, real(factor)));
+			this->conjugated.push_back(conjugate(x));
+			this->left.push_back(hamilton(w0, x));
+			this->right.push_back(hamilton(x, w0));
+			this->lazy.push_back(cd_bench::add(cd_bench::add(hamilton(u, v), hamilton(w, u)), scale(v, -1)));
+			this->fused.push_back(cd_bench::add(hamilton(u, v), w));
+			this->fused_conjugate.push_back(scale(cd_bench::add(hamilton(u, w0), scale(conjugate(v), -1)), real(0.5)));
+			this->points.push_back(Stephan::vec3<T>{ positions[n].Re(), positions[n].Im1(), positions[n].Im2() });
+			this->rotate.push_back(cd_bench::rotate(widen(this->unit_a[0]), exact<3>{ this->points[n].x, this->points[n].y, this->points[n].z }));
+		}
+	}
+};
+
+template <typename T>
+void register_quaternion() {
+	typedef Stephan::quaternion<T> type;
+	static quaternion_cases<T> data;
+	std::string name = "/" + ops<type>::name();
+	auto result = [](std::size_t n) { return components(data.out[n]); };
+	auto soa_result = [](std::size_t n) { return components(data.soa_out.get(n)); };
+	auto scalar = [](std::size_t n) { return components(data.scalars[n]); };
+	auto rotated = [](std::size_t n) { return components(data.rotated[n]); };
+	std::span<type> out(data.out);
+	const type w0 = data.unit_c[0];
+
+	register_loop<T>("accuracy/add" + name, 0.5, data.add, [] { for (std::size_t n = 0; n < batch_size; ++n) { data.out[n] = data.a[n] + data.b[n]; } }, result);
+	register_loop<T>("accuracy/sub" + name, 0.5, data.sub, [] { for (std::size_t n = 0; n < batch_size; ++n) { data.out[n] = data.a[n] - data.b[n]; } }, result);
+	register_loop<T>("accuracy/equal" + name, { 0, 1 }, data.equal, [] {
+		for (std::size_t n = 0; n < batch_size; ++n) {
+			data.scalars[n] = (data.a[n] == data.twin[n]) ? T(1) : T(0);
+		}
+	}, scalar);
+
+	register_loop<T>("accuracy/mul" + name, 3, data.mul, [] { for (std::size_t n = 0; n < batch_size; ++n) { data.out[n] = data.a[n] * data.b[n]; } }, result);
+	register_targets<T>("accuracy/mul" + name, 3, data.mul, [] { Stephan::multiply(data.soa_a, data.soa_b, data.soa_out); }, soa_result);
+
+	register_loop<T>("accuracy/div" + name, 4, data.div, [] { for (std::size_t n = 0; n < batch_size; ++n) { data.out[n] = data.a[n] / data.b[n]; } }, result);
+	register_loop<T>("accuracy/div" + name + "/fast_reciprocal", 6, data.div, [] {
+		for (std::size_t n = 0; n < batch_size; ++n) {
+			data.out[n] = data.a[n].template divide<Stephan::fast_reciprocal>(data.b[n]);
+		}
+	}, result);
+
+	register_loop<T>("accuracy/reciprocal" + name, 3, data.reciprocal, [] { for (std::size_t n = 0; n < batch_size; ++n) { data.out[n] = data.a[n].reciprocal(); } }, result);
+	register_loop<T>("accuracy/reciprocal" + name + "/fast_reciprocal", 4, data.reciprocal, [] {
+		for (std::size_t n = 0; n < batch_size; ++n) {
+			data.out[n] = data.a[n].template reciprocal<Stephan::fast_reciprocal>();
+		}
+	}, result);
+
+	register_loop<T>("accuracy/norm" + name, 2, data.norm, [] { for (std::size_t n = 0; n < batch_size; ++n) { data.scalars[n] = data.a[n].norm(); } }, scalar);
+	register_targets<T>("accuracy/norm" + name, 2, data.norm, [] { Stephan::norm(data.soa_a, std::span<T>(data.scalars)); }, scalar);
+
+	register_loop<T>("accuracy/normalize" + name, 3, data.normalize, [] {
+		for (std::size_t n = 0; n < batch_size; ++n) {
+			data.out[n] = data.a[n] * (T(1) / data.a[n].norm());
+		}
+	}, result);
+	register_targets<T>("accuracy/normalize" + name, 3, data.normalize, [] { Stephan::normalize(data.soa_a, data.soa_out); }, soa_result);
+
+	register_loop<T>("accuracy/rotate" + name, 5, data.rotate, [] {
+		for (std::size_t n = 0; n < batch_size; ++n) {
+			data.rotated[n] = data.unit_a[0].rotate(data.points[n]);
+		}
+	}, rotated);
+	register_targets<T>("accuracy/rotate" + name, 4, data.rotate, [] {
+		Stephan::rotate(data.unit_a[0], std::span<const Stephan::vec3<T>>(data.points), std::span<Stephan::vec3<T>>(data.rotated));
+	}, rotated);
+
+	register_loop<T>("accuracy/exp" + name, 3, data.exp, [] { for (std::size_t n = 0; n < batch_size; ++n) { data.out[n] = Stephan::exp(data.unit_a[n]); } }, result);
+	register_targets<T>("accuracy/exp" + name, 4, data.exp, [] { Stephan::exp(data.soa_unit_a, data.soa_out); }, soa_result);
+
+	register_loop<T>("accuracy/log" + name, { 3, 1 }, data.log, [] { for (std::size_t n = 0; n < batch_size; ++n) { data.out[n] = Stephan::log(data.a[n]); } }, result);
+	register_targets<T>("accuracy/log" + name, { 4, 1 }, data.log, [] { Stephan::log(data.soa_a, data.soa_out); }, soa_result);
+	register_loop<T>("accuracy/log_nan" + name, { 3, 1 }, data.log_nan, [] { for (std::size_t n = 0; n < batch_size; ++n) { data.out[n] = Stephan::log(data.nans[n]); } }, result);
+	register_targets<T>("accuracy/log_nan" + name, { 4, 1 }, data.log_nan, [] { Stephan::log(data.soa_nans, data.soa_out); }, soa_result);
+
+	register_loop<T>("accuracy/slerp" + name, 4, data.slerp, [] {
+		for (std::size_t n = 0; n < batch_size; ++n) {
+			data.out[n] = Stephan::slerp(data.unit_a[n], data.unit_b[n], data.t[n]);
+		}
+	}, result);
+	register_targets<T>("accuracy/slerp" + name, 4, data.slerp, [] {
+		Stephan::slerp_n(data.soa_unit_a, data.soa_unit_b, std::span<const T>(data.t), data.soa_out);
+	}, soa_result);
+
+	register_loop<T>("accuracy/nlerp" + name, 3, data.nlerp, [] {
+		for (std::size_t n = 0; n < batch_size; ++n) {
+			data.out[n] = Stephan::nlerp(data.unit_a[n], data.unit_b[n], data.t[n]);
+		}
+	}, result);
+
+	// inplace.h, on interleaved spans and on lanes
+	auto reset = [] { std::copy(data.a.begin(), data.a.end(), data.out.begin()); };
+	register_targets<T>("accuracy/scale_inplace" + name, 0.5, data.scaled, [=] { reset(); Stephan::scale_inplace<T>(out, quaternion_cases<T>::factor); }, result);
+	register_targets<T>("accuracy/conjugate_inplace" + name, 0, data.conjugated, [=] { reset(); Stephan::conjugate_inplace<T>(out); }, result);
+	register_targets<T>("accuracy/normalize_inplace" + name, 3, data.normalize, [=] { reset(); Stephan::normalize_inplace<T>(out); }, result);
+	register_targets<T>("accuracy/left_multiply_inplace" + name, 3, data.left, [=] { reset(); Stephan::left_multiply_inplace<T>(w0, out); }, result);
+	register_targets<T>("accuracy/right_multiply_inplace" + name, 3, data.right, [=] { reset(); Stephan::right_multiply_inplace<T>(out, w0); }, result);
+	register_targets<T>("accuracy/scale_inplace_soa" + name, 0.5, data.scaled, [] {
+		data.soa_out = data.soa_a;
+		Stephan::scale_inplace(data.soa_out, quaternion_cases<T>::factor);
+	}, soa_result);
+	register_targets<T>("accuracy/conjugate_inplace_soa" + name, 0, data.conjugated, [] {
+		data.soa_out = data.soa_a;
+		Stephan::conjugate_inplace(data.soa_out);
+	}, soa_result);
+	register_targets<T>("accuracy/normalize_inplace_soa" + name, 3, data.normalize, [] {
+		data.soa_out = data.soa_a;
+		Stephan::normalize_inplace(data.soa_out);
+	}, soa_result);
+	register_targets<T>("accuracy/left_multiply_inplace_soa" + name, 3, data.left, [w0] {
+		data.soa_out = data.soa_a;
+		Stephan::left_multiply_inplace(w0, data.soa_out);
+	}, soa_result);
+	register_targets<T>("accuracy/right_multiply_inplace_soa" + name, 3, data.right, [w0] {
+		data.soa_out = data.soa_a;
+		Stephan::right_multiply_inplace(data.soa_out, w0);
+	}, soa_result);
+
+	// expression.h, evaluated once per value and fused over the lanes. The
+	// sums may cancel, so they are measured at the scale of their terms.
+	register_loop<T>("accuracy/lazy" + name, { 3, 3 }, data.lazy, [] {
+		for (std::size_t n = 0; n < batch_size; ++n) {
+			data.out[n] = Stephan::lazy(data.unit_a[n]) * data.unit_b[n] + data.unit_c[n] * data.unit_a[n] - data.unit_b[n];
+		}
+	}, result);
+	register_targets<T>("accuracy/fused" + name, { 3, 2 }, data.fused, [] { data.soa_out = data.soa_unit_a * data.soa_unit_b + data.soa_unit_c; }, soa_result);
+	register_targets<T>("accuracy/fused_conjugate" + name, { 3, 1 }, data.fused_conjugate, [w0] {
+		data.soa_out = (data.soa_unit_a * w0 - Stephan::lazy(data.soa_unit_b).conjugate()) * T(0.5);
+	}, soa_result);
+}
+
+template <typename T>
+struct octonion_cases {
+	typedef Stephan::octonion<T> type;
+
+	std::vector<type>		a = spread_values<type>(batch_size, 51);
+	std::vector<type>		b = spread_values<type>(batch_size, 52);
+	std::vector<type>		out = std::vector<type>(batch_size);
+	std::vector<exact<8>>		mul, div, normalized, left, right;
+
+	octonion_cases() {
+		for (std::size_t n = 0; n < batch_size; ++n) {
+			exact<8> x = widen(this->a[n]), y = widen(this->b[n]);
+			this->mul.push_back(cayley_dickson(x, y));
+			this->div.push_back(scale(cayley_dickson(x, conjugate(y)), 1 / norm2(y)));
+			this->normalized.push_back(scale(x, 1 / std::sqrt(norm2(x))));
+			this->left.push_back(cayley_dickson(widen(this->b[0]), x));
+			this->right.push_back(cayley_dickson(x, widen(this->b[0])));
+		}
+	}
+};
+
+template <typename T>
+void register_octonion() {
+	typedef Stephan::octonion<T> type;
+	static octonion_cases<T> data;
+	std::string name = "/" + ops<type>::name();
+	auto result = [](std::size_t n) { return components(data.out[n]); };
+
+	register_loop<T>("accuracy/mul" + name, 4, data.mul, [] { for (std::size_t n = 0; n < batch_size; ++n) { data.out[n] = data.a[n] * data.b[n]; } }, result);
+	register_targets<T>("accuracy/mul" + name, 4, data.mul, [] {
+		Stephan::multiply<T>(std::span<const type>(data.a), std::span<const type>(data.b), std::span<type>(data.out));
+	}, result);
+	register_loop<T>("accuracy/div" + name, 6, data.div, [] { for (std::size_t n = 0; n < batch_size; ++n) { data.out[n] = data.a[n] / data.b[n]; } }, result);
+
+	auto reset = [] { std::copy(data.a.begin(), data.a.end(), data.out.begin()); };
+	register_loop<T>("accuracy/normalize_inplace" + name, 3, data.normalized, [=] { reset(); Stephan::normalize_inplace(std::span<type>(data.out)); }, result);
+	register_loop<T>("accuracy/left_multiply_inplace" + name, 4, data.left, [=] { reset(); Stephan::left_multiply_inplace(data.b[0], std::span<type>(data.out)); }, result);
+	register_loop<T>("accuracy/right_multiply_inplace" + name, 4, data.right, [=] { reset(); Stephan::right_multiply_inplace(std::span<type>(data.out), data.b[0]); }, result);
+}
+
+// Unit quaternions a few dozen eps off unit norm, as a product chain
+// leaves them, against their exact normalization, and running products of
+// unit_chain factors through unit_accumulator against the normalized
+// exact product
+inline constexpr std::size_t unit_chain = 64;
+
+template <typename T>
+struct unit_cases {
+	typedef Stephan::quaternion<T> type;
+
+	std::vector<type>		drifted = random_values<type>(batch_size, 71);
+	std::vector<type>		factors = random_values<type>(batch_size, 72);
+	std::vector<type>		out = std::vector<type>(batch_size);
+	std::vector<exact<4>>		renormalize, accumulate;
+
+	unit_cases() {
+		std::vector<T> drift = random_scalars<T>(batch_size, 73, T(-64), T(64));
+		for (std::size_t n = 0; n < batch_size; ++n) {
+			this->drifted[n] = this->drifted[n] * (T(1) + (drift[n] * std::numeric_limits<T>::epsilon()));
+			exact<4> x = widen(this->drifted[n]);
+			this->renormalize.push_back(scale(x, 1 / std::sqrt(norm2(x))));
+			exact<4> product = widen(this->factors[n]);
+			for (std::size_t k = 1; k <= unit_chain; ++k) {
+				product = hamilton(product, widen(this->factor(n, k)));
+			}
+			this->accumulate.push_back(scale(product, 1 / std::sqrt(norm2(product))));
+		}
+	}
+	const type& factor(std::size_t n, std::size_t k) const { return this->factors[((n * 7) + k) % batch_size]; }
+};
+
+template <typename T>
+void register_unit() {
+	typedef Stephan::unit_quaternion<T> unit;
+	static unit_cases<T> data;
+	std::string name = std::string("/unit_quaternion<") + type_name<T>::value + ">";
+	auto result = [](std::size_t n) { return components(data.out[n]); };
+
+	register_loop<T>("accuracy/renormalize" + name, 2, data.renormalize, [] {
+		for (std::size_t n = 0; n < batch_size; ++n) {
+			unit value = unit::from_normalized(data.drifted[n]);
+			value.renormalize();
+			data.out[n] = value;
+		}
+	}, result);
+	register_loop<T>("accuracy/accumulate" + name + "/" + std::to_string(unit_chain), 8, data.accumulate, [] {
+		for (std::size_t n = 0; n < batch_size; ++n) {
+			Stephan::unit_accumulator<T> product(unit::from_normalized(data.factors[n]));
+			for (std::size_t k = 1; k <= unit_chain; ++k) {
+				product *= unit::from_normalized(data.factor(n, k));
+			}
+			data.out[n] = product.value();
+		}
+	}, result);
+}
+
+// Products of octonion_tree_leaves factors in the three standard shapes of
+// octonion_batch.h, each against the same tree evaluated exactly
+inline constexpr std::size_t octonion_tree_leaves = 4;
+
+inline exact<8> evaluate_exact(const Stephan::octonion_tree& tree, std::span<const exact<8>> leaves) {
+	std::vector<exact<8>> values(leaves.begin(), leaves.end());
+	for (std::size_t n = 0; n < tree.size(); ++n) {
+		values.push_back(cayley_dickson(values[tree.lhs(n)], values[tree.rhs(n)]));
+	}
+	return values.back();
+}
+
+template <typename T>
+struct octonion_tree_cases {
+	typedef Stephan::octonion<T> type;
+
+	Stephan::octonion_tree		trees[3] = { Stephan::octonion_tree::left_fold(octonion_tree_leaves),
+		Stephan::octonion_tree::right_fold(octonion_tree_leaves), Stephan::octonion_tree::balanced(octonion_tree_leaves) };
+	std::vector<type>		factors = random_values<type>(octonion_tree_leaves * batch_size, 91);
+	std::vector<type>		out = std::vector<type>(batch_size);
+	std::vector<exact<8>>		expected[3];
+
+	octonion_tree_cases() {
+		for (std::size_t n = 0; n < batch_size; ++n) {
+			exact<8> leaves[octonion_tree_leaves];
+			for (std::size_t leaf = 0; leaf < octonion_tree_leaves; ++leaf) {
+				leaves[leaf] = widen(this->factors[(leaf * batch_size) + n]);
+			}
+			for (std::size_t shape = 0; shape < 3; ++shape) {
+				this->expected[shape].push_back(evaluate_exact(this->trees[shape], leaves));
+			}
+		}
+	}
+};
+
+template <typename T>
+void register_octonion_trees() {
+	typedef Stephan::octonion<T> type;
+	static octonion_tree_cases<T> data;
+	static const char* const shapes[3] = { "left_fold", "right_fold", "balanced" };
+	std::string name = "/" + ops<type>::name() + "/" + std::to_string(octonion_tree_leaves);
+	auto result = [](std::size_t n) { return components(data.out[n]); };
+
+	for (std::size_t shape = 0; shape < 3; ++shape) {
+		register_targets<T>(std::string("accuracy/") + shapes[shape] + name, 6, data.expected[shape], [shape] {
+			Stephan::evaluate<T>(data.trees[shape], std::span<const type>(data.factors), std::span<type>(data.out));
+		}, result);
+	}
+}
+
+// Dual quaternions as pairs of quaternions
+typedef std::array<exact<4>, 2> dual;
+
+template <typename T>
+dual widen(const Stephan::dual_quaternion<T>& value) { return { widen(value.real()), widen(value.dual()) }; }
+inline exact<8> flatten(const dual& value) {
+	return { value[0][0], value[0][1], value[0][2], value[0][3], value[1][0], value[1][1], value[1][2], value[1][3] };
+}
+inline exact<3> vector_part(const exact<4>& q) { return { q[1], q[2], q[3] }; }
+
+inline dual dual_product(const dual& a, const dual& b) {
+	return { hamilton(a[0], b[0]), add(hamilton(a[0], b[1]), hamilton(a[1], b[0])) };
+}
+// Rotation r, then translation t
+inline dual rigid(const exact<4>& r, const exact<3>& t) {
+	return { r, scale(hamilton(exact<4>{ 0, t[0], t[1], t[2] }, r), real(0.5)) };
+}
+// The translation of (r, d), 2 d r* / |r|^2
+inline exact<3> translation(const dual& value) {
+	return scale(vector_part(hamilton(value[1], conjugate(value[0]))), 2 / norm2(value[0]));
+}
+inline exact<3> cross(const exact<3>& a, const exact<3>& b) {
+	return { (a[1] * b[2]) - (a[2] * b[1]), (a[2] * b[0]) - (a[0] * b[2]), (a[0] * b[1]) - (a[1] * b[0]) };
+}
+inline real dot3(const exact<3>& a, const exact<3>& b) { return (a[0] * b[0]) + (a[1] * b[1]) + (a[2] * b[2]); }
+
+// (r, d) scaled to |r| = 1 with the part of d along r taken out
+inline dual dual_normalize(const dual& value) {
+	exact<4> r = scale(value[0], 1 / std::sqrt(norm2(value[0])));
+	exact<4> d = scale(value[1], 1 / std::sqrt(norm2(value[0])));
+	real along = (r[0] * d[0]) + (r[1] * d[1]) + (r[2] * d[2]) + (r[3] * d[3]);
+	return { r, add(d, scale(r, -along)) };
+}
+
+// The screw motion from a to b: the relative transform is a rotation by
+// angle about the line through c with direction l, where (I - R) c is the
+// part of the translation across l, followed by a slide along l. Taking the
+// rotation and the slide to t of their size gives the transform at t.
+inline dual dual_sclerp(const dual& a, const dual& b, real t) {
+	real cosine = (a[0][0] * b[0][0]) + (a[0][1] * b[0][1]) + (a[0][2] * b[0][2]) + (a[0][3] * b[0][3]);
+	dual target = (cosine < 0) ? dual{ scale(b[0], -1), scale(b[1], -1) } : b;
+	dual relative = dual_product({ conjugate(a[0]), conjugate(a[1]) }, target);
+	exact<3> shift = translation(relative);
+	exact<3> vector = vector_part(relative[0]);
+	real sine = std::sqrt(dot3(vector, vector));
+	real angle = 2 * std::atan2(sine, relative[0][0]);
+	exact<3> l = scale(vector, 1 / sine);
+	exact<3> slide = scale(l, dot3(l, shift));
+	exact<3> across = add(shift, scale(slide, -1));
+	exact<3> c = scale(add(across, scale(cross(l, across), 1 / std::tan(angle / 2))), real(0.5));
+	exact<4> turn = { std::cos(t * angle / 2), l[0] * std::sin(t * angle / 2), l[1] * std::sin(t * angle / 2), l[2] * std::sin(t * angle / 2) };
+	exact<3> moved = add(add(c, scale(cd_bench::rotate(turn, c), -1)), scale(slide, t));
+	return dual_product(a, rigid(turn, moved));
+}
+
+template <typename T>
+Stephan::vec3<T> point(const Stephan::quaternion<T>& q, T scale) { return Stephan::vec3<T>{ q.Im1() * scale, q.Im2() * scale, q.Im3() * scale }; }
+template <typename T>
+exact<3> widen(const Stephan::vec3<T>& v) { return { v.x, v.y, v.z }; }
+
+// Rigid transforms with translations up to 4, and points up to 4
+template <typename T>
+std::vector<Stephan::dual_quaternion<T>> rigid_values(std::size_t count, unsigned seed) {
+	std::vector<Stephan::quaternion<T>> rotations = random_values<Stephan::quaternion<T>>(count, seed);
+	std::vector<Stephan::quaternion<T>> offsets = random_values<Stephan::quaternion<T>>(count, seed + 1);
+	std::vector<Stephan::dual_quaternion<T>> values;
+	for (std::size_t n = 0; n < count; ++n) {
+		values.push_back(Stephan::dual_quaternion<T>::from_rotation_translation(rotations[n], point(offsets[n], T(4))));
+	}
+	return values;
+}
+
+template <typename T>
+struct dual_cases {
+	typedef Stephan::dual_quaternion<T> type;
+
+	std::vector<type>		a = rigid_values<T>(batch_size, 101);
+	std::vector<type>		b = rigid_values<T>(batch_size, 103);
+	std::vector<T>			t = random_scalars<T>(batch_size, 105, T(0), T(1));
+	std::vector<Stephan::vec3<T>>	points;
+	std::vector<type>		out = std::vector<type>(batch_size);
+	std::vector<Stephan::vec3<T>>	moved = std::vector<Stephan::vec3<T>>(batch_size);
+	std::vector<exact<8>>		mul, dlb, sclerp;
+	std::vector<exact<3>>		transform;
+
+	dual_cases() {
+		std::vector<Stephan::quaternion<T>> positions = random_values<Stephan::quaternion<T>>(batch_size, 106);
+		for (std::size_t n = 0; n < batch_size; ++n) {
+			dual x = widen(this->a[n]), y = widen(this->b[n]);
+			real s = this->t[n];
+			this->points.push_back(point(positions[n], T(4)));
+			this->mul.push_back(flatten(dual_product(x, y)));
+			this->transform.push_back(add(cd_bench::rotate(scale(x[0], 1 / std::sqrt(norm2(x[0]))), widen(this->points[n])), translation(x)));
+			real cosine = (x[0][0] * y[0][0]) + (x[0][1] * y[0][1]) + (x[0][2] * y[0][2]) + (x[0][3] * y[0][3]);
+			real weight = (cosine < 0) ? -s : s;
+			this->dlb.push_back(flatten(dual_normalize({ add(scale(x[0], 1 - s), scale(y[0], weight)), add(scale(x[1], 1 - s), scale(y[1], weight)) })));
+			this->sclerp.push_back(flatten(dual_sclerp(x, y, s)));
+		}
+	}
+};
+
+template <typename T>
+void register_dual() {
+	static dual_cases<T> data;
+	std::string name = std::string("/dual_quaternion<") + type_name<T>::value + ">";
+	auto result = [](std::size_t n) { return components(data.out[n]); };
+	auto moved = [](std::size_t n) { return components(data.moved[n]); };
+
+	register_loop<T>("accuracy/mul" + name, 4, data.mul, [] { for (std::size_t n = 0; n < batch_size; ++n) { data.out[n] = data.a[n] * data.b[n]; } }, result);
+	register_loop<T>("accuracy/transform" + name, { 6, 4 }, data.transform, [] {
+		for (std::size_t n = 0; n < batch_size; ++n) {
+			data.moved[n] = data.a[n].transform(data.points[n]);
+		}
+	}, moved);
+	register_loop<T>("accuracy/dlb" + name, 4, data.dlb, [] {
+		for (std::size_t n = 0; n < batch_size; ++n) {
+			data.out[n] = Stephan::dlb(data.a[n], data.b[n], data.t[n]);
+		}
+	}, result);
+	register_loop<T>("accuracy/sclerp" + name, 12, data.sclerp, [] {
+		for (std::size_t n = 0; n < batch_size; ++n) {
+			data.out[n] = Stephan::sclerp(data.a[n], data.b[n], data.t[n]);
+		}
+	}, result);
+}
+
+// Vertices of skin_influences bones each, with weights in [1/8, 1], moved by
+// the blend of Kavan et al. summed exactly: r p r* / |r|^2 plus the
+// translation of the sum
+inline constexpr std::size_t skin_bones = 16;
+inline constexpr std::size_t skin_influences = 4;
+
+template <typename T>
+struct skin_cases {
+	std::vector<Stephan::dual_quaternion<T>>	bones = rigid_values<T>(skin_bones, 111);
+	std::vector<Stephan::vec3<T>>			points, normals;
+	std::vector<std::uint32_t>			indices;
+	std::vector<T>					weights = random_scalars<T>(batch_size * skin_influences, 113, T(0.125), T(1));
+	std::vector<Stephan::vec3<T>>			out = std::vector<Stephan::vec3<T>>(batch_size);
+	std::vector<exact<3>>				skin, skin_normals;
+
+	skin_cases() {
+		std::vector<Stephan::quaternion<T>> positions = random_values<Stephan::quaternion<T>>(batch_size, 114);
+		std::vector<Stephan::quaternion<T>> directions = random_values<Stephan::quaternion<T>>(batch_size, 115);
+		std::vector<T> choices = random_scalars<T>(batch_size * skin_influences, 116, T(0), T(skin_bones));
+		for (std::size_t n = 0; n < batch_size; ++n) {
+			this->points.push_back(point(positions[n], T(4)));
+			this->normals.push_back(point(directions[n], T(1)));
+			dual sum{};
+			exact<4> first{};
+			for (std::size_t k = 0; k < skin_influences; ++k) {
+				std::uint32_t bone = std::min(std::uint32_t(choices[(n * skin_influences) + k]), std::uint32_t(skin_bones - 1));
+				this->indices.push_back(bone);
+				dual value = widen(this->bones[bone]);
+				first = (k == 0) ? value[0] : first;
+				real cosine = (first[0] * value[0][0]) + (first[1] * value[0][1]) + (first[2] * value[0][2]) + (first[3] * value[0][3]);
+				real weight = this->weights[(n * skin_influences) + k];
+				weight = (cosine < 0) ? -weight : weight;
+				sum = { add(sum[0], scale(value[0], weight)), add(sum[1], scale(value[1], weight)) };
+			}
+			exact<3> turned = scale(cd_bench::rotate(sum[0], widen(this->points[n])), 1 / norm2(sum[0]));
+			this->skin.push_back(add(turned, translation(sum)));
+			this->skin_normals.push_back(scale(cd_bench::rotate(sum[0], widen(this->normals[n])), 1 / norm2(sum[0])));
+		}
+	}
+};
+
+template <typename T>
+void register_skinning() {
+	static skin_cases<T> data;
+	std::string name = std::string("/dual_quaternion<") + type_name<T>::value + ">";
+	auto result = [](std::size_t n) { return components(data.out[n]); };
+
+	register_loop<T>("accuracy/skin" + name, { 6, 4 }, data.skin, [] {
+		Stephan::dual_quaternion<T> influences[skin_influences];
+		for (std::size_t n = 0; n < batch_size; ++n) {
+			for (std::size_t k = 0; k < skin_influences; ++k) {
+				influences[k] = data.bones[data.indices[(n * skin_influences) + k]];
+			}
+			Stephan::dual_quaternion<T> blend = Stephan::dlb<T>(influences, std::span<const T>(data.weights).subspan(n * skin_influences, skin_influences));
+			data.out[n] = blend.transform(data.points[n]);
+		}
+	}, result);
+	register_targets<T>("accuracy/skin" + name, { 6, 4 }, data.skin, [] {
+		Stephan::skin<T>(data.bones, data.points, data.indices, data.weights, data.out);
+	}, result);
+	register_targets<T>("accuracy/skin_normals" + name, 8, data.skin_normals, [] {
+		Stephan::skin_normals<T>(data.bones, data.normals, data.indices, data.weights, data.out);
+	}, result);
+}
+
+// imu_samples gyroscope samples of up to 10 rad/s on every axis at 100 Hz
+// for each sensor, against the exact product of the exact rotations, which
+// keeps its norm; the library keeps it with the Newton step, so the
+// reference is normalized once at the end
+inline constexpr std::size_t imu_samples = 16;
+
+template <typename T>
+struct imu_cases {
+	typedef Stephan::quaternion<T> type;
+	static constexpr T		dt = T(0.01);
+
+	std::vector<type>		start = random_values<type>(batch_size, 121);
+	std::vector<T>			x = random_scalars<T>(imu_samples * batch_size, 122, T(-10), T(10));
+	std::vector<T>			y = random_scalars<T>(imu_samples * batch_size, 123, T(-10), T(10));
+	std::vector<T>			z = random_scalars<T>(imu_samples * batch_size, 124, T(-10), T(10));
+	std::vector<type>		out = std::vector<type>(batch_size);
+	Stephan::quaternion_soa<T>	soa_start = Stephan::quaternion_soa<T>(std::span<const type>(start));
+	Stephan::quaternion_soa<T>	soa_out = Stephan::quaternion_soa<T>(batch_size);
+	std::vector<exact<4>>		integrate;
+
+	imu_cases() {
+		for (std::size_t n = 0; n < batch_size; ++n) {
+			exact<4> q = widen(this->start[n]);
+			for (std::size_t sample = 0; sample < imu_samples; ++sample) {
+				std::size_t at = (sample * batch_size) + n;
+				real half = real(dt) / 2;
+				q = hamilton(q, quaternion_exp({ 0, this->x[at] * half, this->y[at] * half, this->z[at] * half }));
+			}
+			this->integrate.push_back(scale(q, 1 / std::sqrt(norm2(q))));
+		}
+	}
+};
+
+template <typename T>
+void register_imu() {
+	static imu_cases<T> data;
+	std::string name = "/" + ops<Stephan::quaternion<T>>::name() + "/" + std::to_string(imu_samples);
+	auto result = [](std::size_t n) { return components(data.out[n]); };
+	auto soa_result = [](std::size_t n) { return components(data.soa_out.get(n)); };
+
+	register_loop<T>("accuracy/integrate" + name, 8, data.integrate, [] {
+		for (std::size_t n = 0; n < batch_size; ++n) {
+			Stephan::quaternion<T> q = data.start[n];
+			for (std::size_t sample = 0; sample < imu_samples; ++sample) {
+				std::size_t at = (sample * batch_size) + n;
+				q = Stephan::integrate_rate(q, Stephan::vec3<T>{ data.x[at], data.y[at], data.z[at] }, imu_cases<T>::dt);
+			}
+			data.out[n] = q;
+		}
+	}, result);
+	register_targets<T>("accuracy/integrate" + name, 8, data.integrate, [] {
+		data.soa_out = data.soa_start;
+		Stephan::integrate_rates(data.soa_out, std::span<const T>(data.x), std::span<const T>(data.y), std::span<const T>(data.z), imu_cases<T>::dt);
+	}, soa_result);
+}
+
+// 16-bit storage computed in float: the references are on the stored
+// values, and each result is rounded to H once
+template <typename H>
+struct half_cases {
+	typedef Stephan::complex<H> type;
+	typedef Stephan::quaternion<H> quaternion;
+
+	std::vector<type>		a = narrowed<type>(random_values<Stephan::complex<float>>(batch_size, 81));
+	std::vector<type>		b = narrowed<type>(random_values<Stephan::complex<float>>(batch_size, 82));
+	std::vector<type>		c = narrowed<type>(random_values<Stephan::complex<float>>(batch_size, 83));
+	std::vector<quaternion>		q = narrowed<quaternion>(random_values<Stephan::quaternion<float>>(batch_size, 84));
+	quaternion			rotation = quaternion(0.5f, 0.5f, 0.5f, 0.5f);
+	std::vector<type>		out = std::vector<type>(batch_size);
+	std::vector<quaternion>		quaternion_out = std::vector<quaternion>(batch_size);
+	std::vector<H>			scalars = std::vector<H>(batch_size);
+	type				sum;
+	std::vector<exact<2>>		mul, conj_mul, cmla, div, dot, dotc;
+	std::vector<exact<1>>		norm;
+	std::vector<exact<4>>		left, normalize;
+
+	half_cases() {
+		std::complex<real> dot_sum = 0, dotc_sum = 0;
+		for (std::size_t n = 0; n < batch_size; ++n) {
+			std::complex<real> x = widen(this->a[n]), y = widen(this->b[n]);
+			this->mul.push_back(narrow(x * y));
+			this->conj_mul.push_back(narrow(std::conj(x) * y));
+			this->cmla.push_back(narrow(widen(this->c[n]) + (x * y)));
+			this->div.push_back(narrow(x / y));
+			this->norm.push_back({ std::abs(x) });
+			dot_sum += x * y;
+			dotc_sum += std::conj(x) * y;
+			exact<4> v = widen(this->q[n]);
+			this->left.push_back(hamilton(widen(this->rotation), v));
+			this->normalize.push_back(scale(v, 1 / std::sqrt(norm2(v))));
+		}
+		this->dot.push_back(narrow(dot_sum));
+		this->dotc.push_back(narrow(dotc_sum));
+	}
+};
+
+template <typename H>
+void register_half(const std::string& type) {
+	static half_cases<H> data;
+	std::string name = "/complex<" + type + ">";
+	std::span<const Stephan::complex<H>> a(data.a), b(data.b);
+	std::span<Stephan::complex<H>> out(data.out);
+	auto result = [](std::size_t n) { return components(data.out[n]); };
+	auto quaternion_result = [](std::size_t n) { return components(data.quaternion_out[n]); };
+	auto scalar = [](std::size_t n) { return components(data.scalars[n]); };
+	auto sum = [](std::size_t) { return components(data.sum); };
+
+	register_targets<H>("accuracy/mul" + name, 0.5, data.mul, [=] { Stephan::cmul<H>(a, b, out); }, result);
+	register_targets<H>("accuracy/conj_mul" + name, 0.5, data.conj_mul, [=] { Stephan::conj_mul<H>(a, b, out); }, result);
+	register_targets<H>("accuracy/cmla" + name, { 0.5, 2 }, data.cmla, [=] {
+		std::copy(data.c.begin(), data.c.end(), data.out.begin());
+		Stephan::cmla<H>(a, b, out);
+	}, result);
+	register_targets<H>("accuracy/div" + name, 0.5, data.div, [=] { Stephan::cdiv<H>(a, b, out); }, result);
+	register_targets<H>("accuracy/norm" + name, 0.5, data.norm, [=] { Stephan::abs<H>(a, std::span<H>(data.scalars)); }, scalar);
+	// The sum is formed in float, so its one rounding to H is all there is
+	register_targets<H>("accuracy/dot" + name, 0.5, data.dot, [=] { data.sum = Stephan::dot<H>(a, b); }, sum);
+	register_targets<H>("accuracy/dotc" + name, 0.5, data.dotc, [=] { data.sum = Stephan::dotc<H>(a, b); }, sum);
+
+	name = "/quaternion<" + type + ">";
+	auto reset = [] { std::copy(data.q.begin(), data.q.end(), data.quaternion_out.begin()); };
+	register_targets<H>("accuracy/left_multiply_inplace" + name, 0.5, data.left, [=] {
+		reset();
+		Stephan::left_multiply_inplace<H>(data.rotation, std::span<Stephan::quaternion<H>>(data.quaternion_out));
+	}, quaternion_result);
+	register_targets<H>("accuracy/normalize_inplace" + name, 0.5, data.normalize, [=] {
+		reset();
+		Stephan::normalize_inplace<H>(std::span<Stephan::quaternion<H>>(data.quaternion_out));
+	}, quaternion_result);
+}
+
+// The discrete Fourier transform, summed directly, sign -1 forward and +1
+// backward, without the 1 / N
+inline std::vector<std::complex<real>> dft(const std::vector<std::complex<real>>& x, int sign) {
+	std::size_t size = x.size();
+	std::vector<std::complex<real>> roots(size), out(size);
+	for (std::size_t m = 0; m < size; ++m) {
+		roots[m] = std::polar(real(1), real(sign) * 2 * std::numbers::pi_v<real> * real(m) / real(size));
+	}
+	for (std::size_t k = 0; k < size; ++k) {
+		// Written out, as std::complex multiplies check for infinities
+		real re = 0, im = 0;
+		std::size_t m = 0;
+		for (std::size_t n = 0; n < size; ++n, m = (m + k < size) ? m + k : m + k - size) {
+			re += (x[n].real() * roots[m].real()) - (x[n].imag() * roots[m].imag());
+			im += (x[n].real() * roots[m].imag()) + (x[n].imag() * roots[m].real());
+		}
+		out[k] = std::complex<real>(re, im);
+	}
+	return out;
+}
+
+// The root mean square norm of a set of results. A transform spreads its
+// rounding over every output alike, so its errors are measured against
+// the ulp at this scale rather than at each output.
+template <std::size_t N>
+real rms(const std::vector<exact<N>>& values) {
+	real sum = 0;
+	for (const exact<N>& value : values) {
+		sum += norm2(value);
+	}
+	return std::sqrt(sum / real(values.size()));
+}
+
+// One transform size: complex input, real samples, and the spectrum of the
+// samples rounded to T for the way back
+template <typename T>
+struct fft_case {
+	typedef Stephan::complex<T> type;
+
+	std::size_t			size;
+	Stephan::fft_plan<T>		plan;
+	Stephan::real_fft_plan<T>	real_plan;
+	std::vector<type>		in, out;
+	std::vector<T>			samples, samples_out;
+	std::vector<type>		spectrum, spectrum_in;
+	std::vector<exact<2>>		forward, inverse, real_forward;
+	std::vector<exact<1>>		real_inverse;
+
+	explicit fft_case(std::size_t size)
+		: size(size)
+		, plan(size)
+		, real_plan(size)
+		, in(random_values<type>(size, 71))
+		, out(size)
+		, samples(random_scalars<T>(size, 72, T(-1), T(1)))
+		, samples_out(size)
+		, spectrum(real_plan.spectrum_size())
+	{
+		std::vector<std::complex<real>> x(size), s(size);
+		for (std::size_t n = 0; n < size; ++n) {
+			x[n] = widen(this->in[n]);
+			s[n] = this->samples[n];
+			this->real_inverse.push_back({ this->samples[n] });
+		}
+		std::vector<std::complex<real>> forward = dft(x, -1), backward = dft(x, 1), spectrum = dft(s, -1);
+		for (std::size_t n = 0; n < size; ++n) {
+			this->forward.push_back(narrow(forward[n]));
+			this->inverse.push_back(narrow(backward[n] / real(size)));
+		}
+		for (std::size_t k = 0; k < this->spectrum.size(); ++k) {
+			this->real_forward.push_back(narrow(spectrum[k]));
+			this->spectrum_in.push_back(type(T(spectrum[k].real()), T(spectrum[k].imag())));
+		}
+	}
+};
+
+// Powers of two, 2^3 5^3 on the radix 4, 2 and 5 butterflies, 3^7, and
+// 7 11 13, 3^3 37 and the prime 1009 on the direct prime stages; odd sizes
+// also take the complex path of the real transform. The budgets grow with
+// the number of stages, and a direct p-point stage sums p terms, whose
+// rounding grows as the square root of p.
+struct fft_size {
+	std::size_t	size;
+	double		budget;
+};
+inline constexpr fft_size fft_sizes[] = { { 64, 3 }, { 1000, 8 }, { 1001, 8 }, { 999, 10 }, { 1009, 40 }, { 2187, 9 }, { 4096, 8 } };
+
+template <typename T>
+void register_fft() {
+	typedef Stephan::complex<T> type;
+	static std::deque<fft_case<T>> cases;
+	std::string name = "/" + ops<type>::name() + "/";
+
+	for (auto [size, budget] : fft_sizes) {
+		fft_case<T>& data = cases.emplace_back(size);
+		fft_case<T>* c = &data;
+		std::string suffix = name + std::to_string(size);
+		auto result = [c](std::size_t n) { return components(c->out[n]); };
+		auto spectrum = [c](std::size_t n) { return components(c->spectrum[n]); };
+		auto samples = [c](std::size_t n) { return components(c->samples_out[n]); };
+
+		register_targets<T>("accuracy/fft" + suffix, { budget, rms(data.forward) }, data.forward, [c] { c->plan.forward(c->in, c->out); }, result);
+		register_targets<T>("accuracy/fft_inplace" + suffix, { budget, rms(data.forward) }, data.forward, [c] {
+			std::copy(c->in.begin(), c->in.end(), c->out.begin());
+			c->plan.forward(std::span<type>(c->out));
+		}, result);
+		register_targets<T>("accuracy/ifft" + suffix, { budget, rms(data.inverse) }, data.inverse, [c] { c->plan.inverse(c->in, c->out); }, result);
+		register_targets<T>("accuracy/rfft" + suffix, { budget, rms(data.real_forward) }, data.real_forward, [c] {
+			c->real_plan.forward(c->samples, c->spectrum);
+		}, spectrum);
+		register_targets<T>("accuracy/irfft" + suffix, { budget, rms(data.real_inverse) }, data.real_inverse, [c] {
+			c->real_plan.inverse(c->spectrum_in, c->samples_out);
+		}, samples);
+	}
+}
+
+// exp(mu angle) = cos(angle) + mu sin(angle), mu a unit pure quaternion
+inline exact<4> axis_exp(const exact<4>& mu, real angle) {
+	return add(exact<4>{ std::cos(angle), 0, 0, 0 }, scale(mu, std::sin(angle)));
+}
+
+// An image for the quaternion transforms, rows x columns, with the left
+// quaternion Fourier transform about the axis i and the grey axis, its
+// inverse about i, and the full and centred convolution with a kernel,
+// all summed directly. The grey axis splits every sample across all three
+// imaginary parts and the convolution goes through a padded transform,
+// so both are allowed more
+template <typename T>
+struct quaternion_fft_case {
+	typedef Stephan::quaternion<T> type;
+
+	static constexpr std::size_t rows = 12, columns = 10, kernel_rows = 5, kernel_columns = 3;
+	static constexpr std::size_t full_rows = rows + kernel_rows - 1, full_columns = columns + kernel_columns - 1;
+
+	Stephan::quaternion_fft_plan<T>	plan = Stephan::quaternion_fft_plan<T>(rows, columns);
+	Stephan::quaternion_fft_plan<T>	grey = Stephan::quaternion_fft_plan<T>(rows, columns, type(0, 1, 1, 1));
+	std::vector<type>		image = random_values<type>(rows * columns, 81);
+	std::vector<type>		kernel = random_values<type>(kernel_rows * kernel_columns, 82);
+	std::vector<type>		out = std::vector<type>(full_rows * full_columns);
+	std::vector<exact<4>>		forward, grey_forward, inverse, full, same;
+
+	static std::vector<exact<4>> transform(const std::vector<type>& in, const exact<4>& axis, int sign) {
+		real length = std::sqrt(norm2(axis));
+		exact<4> mu = scale(axis, 1 / length);
+		std::vector<exact<4>> result;
+		for (std::size_t u = 0; u < rows; ++u) {
+			for (std::size_t v = 0; v < columns; ++v) {
+				exact<4> sum{};
+				for (std::size_t x = 0; x < rows; ++x) {
+					for (std::size_t y = 0; y < columns; ++y) {
+						std::size_t turn = ((u * x * columns) + (v * y * rows)) % (rows * columns);
+						real angle = real(sign) * 2 * std::numbers::pi_v<real> * real(turn) / real(rows * columns);
+						sum = add(sum, hamilton(axis_exp(mu, angle), widen(in[(x * columns) + y])));
+					}
+				}
+				result.push_back((sign > 0) ? scale(sum, real(1) / real(rows * columns)) : sum);
+			}
+		}
+		return result;
+	}
+
+	quaternion_fft_case() {
+		this->forward = transform(this->image, widen(this->plan.axis()), -1);
+		this->grey_forward = transform(this->image, widen(this->grey.axis()), -1);
+		this->inverse = transform(this->image, widen(this->plan.axis()), 1);
+		for (std::size_t r = 0; r < full_rows; ++r) {
+			for (std::size_t c = 0; c < full_columns; ++c) {
+				exact<4> sum{};
+				for (std::size_t s = 0; s < kernel_rows; ++s) {
+					for (std::size_t t = 0; t < kernel_columns; ++t) {
+						if ((r >= s) && (r - s < rows) && (c >= t) && (c - t < columns)) {
+							sum = add(sum, hamilton(widen(this->kernel[(s * kernel_columns) + t]), widen(this->image[((r - s) * columns) + c - t])));
+						}
+					}
+				}
+				this->full.push_back(sum);
+			}
+		}
+		for (std::size_t r = 0; r < rows; ++r) {
+			for (std::size_t c = 0; c < columns; ++c) {
+				this->same.push_back(this->full[((r + (kernel_rows / 2)) * full_columns) + c + (kernel_columns / 2)]);
+			}
+		}
+	}
+};
+
+template <typename T>
+void register_quaternion_fft() {
+	typedef Stephan::quaternion<T> type;
+	typedef quaternion_fft_case<T> image;
+	static image data;
+	std::string name = "/" + ops<type>::name() + "/" + std::to_string(image::rows) + "x" + std::to_string(image::columns);
+	std::string kernel = "/" + std::to_string(image::kernel_rows) + "x" + std::to_string(image::kernel_columns);
+	auto result = [](std::size_t n) { return components(data.out[n]); };
+	std::span<type> out(data.out);
+	std::span<type> picture = out.first(image::rows * image::columns);
+
+	register_targets<T>("accuracy/qfft" + name, { 3, rms(data.forward) }, data.forward, [=] { data.plan.forward(data.image, picture); }, result);
+	register_targets<T>("accuracy/qfft_inplace" + name, { 3, rms(data.forward) }, data.forward, [=] {
+		std::copy(data.image.begin(), data.image.end(), picture.begin());
+		data.plan.forward(picture, picture);
+	}, result);
+	register_targets<T>("accuracy/qfft_grey" + name, { 6, rms(data.grey_forward) }, data.grey_forward, [=] { data.grey.forward(data.image, picture); }, result);
+	register_targets<T>("accuracy/iqfft" + name, { 4, rms(data.inverse) }, data.inverse, [=] { data.plan.inverse(data.image, picture); }, result);
+	register_targets<T>("accuracy/convolve_full" + name + kernel, { 5, rms(data.full) }, data.full, [=] {
+		Stephan::convolve<T>(data.kernel, image::kernel_rows, image::kernel_columns, data.image, image::rows, image::columns, out, Stephan::convolution_size::full);
+	}, result);
+	register_targets<T>("accuracy/convolve_same" + name + kernel, { 5, rms(data.same) }, data.same, [=] {
+		Stephan::convolve<T>(data.kernel, image::kernel_rows, image::kernel_columns, data.image, image::rows, image::columns, picture, Stephan::convolution_size::same);
+	}, result);
+}
+
+// Clamped to the range of the fixed-point T
+template <typename T>
+real saturate(real x) {
+	real top = real(std::numeric_limits<typename T::storage_type>::max()) * ulp<T>(0);
+	real bottom = real(std::numeric_limits<typename T::storage_type>::min()) * ulp<T>(0);
+	return std::clamp(x, bottom, top);
+}
+
+// Components uniform over [-1, 1), so that norms run up to 2 and saturate,
+// after the corners of the range, where the sums of squares are largest
+template <typename T>
+struct fixed_cases {
+	std::vector<Stephan::complex<T>>	complex_in;
+	std::vector<Stephan::quaternion<T>>	quaternion_in;
+	std::vector<T>				out = std::vector<T>(batch_size);
+	std::vector<exact<1>>			complex_norm, quaternion_norm;
+
+	fixed_cases() {
+		const T low = T(-1.0), high = T::from_bits(std::numeric_limits<typename T::storage_type>::max()), tiny = T::from_bits(1);
+		const T corners[][4] = {
+			{ low, low, low, low }, { high, high, high, high }, { low, high, low, high },
+			{ low, T(0.0), T(0.0), T(0.0) }, { tiny, tiny, tiny, tiny }, { T(0.0), T(0.0), T(0.0), T(0.0) } };
+		std::vector<double> c = random_scalars<double>(4 * batch_size, 61, -1.0, 1.0);
+		for (std::size_t n = 0; n < batch_size; ++n) {
+			const T* corner = (n < std::size(corners)) ? corners[n] : nullptr;
+			T w = corner ? corner[0] : T(c[4 * n]), x = corner ? corner[1] : T(c[(4 * n) + 1]);
+			T y = corner ? corner[2] : T(c[(4 * n) + 2]), z = corner ? corner[3] : T(c[(4 * n) + 3]);
+			this->complex_in.emplace_back(w, x);
+			this->quaternion_in.emplace_back(w, x, y, z);
+			real rw = to_real(w), rx = to_real(x), ry = to_real(y), rz = to_real(z);
+			this->complex_norm.push_back({ saturate<T>(std::sqrt((rw * rw) + (rx * rx))) });
+			this->quaternion_norm.push_back({ saturate<T>(std::sqrt((rw * rw) + (rx * rx) + (ry * ry) + (rz * rz))) });
+		}
+	}
+};
+
+// q31 sums drop the lowest 2 of the 62 bits of each square, which may
+// take up to 2^-58 off a sum of four; near 0 that moves the root by up to
+// its square root, 2^-29, or 4 units of q31
+template <typename T>
+void register_fixed(const std::string& type) {
+	static fixed_cases<T> data;
+	auto scalar = [](std::size_t n) { return components(data.out[n]); };
+	const double budget = (sizeof(typename T::storage_type) > 2) ? 4 : 1;
+
+	register_loop<T>("accuracy/norm/complex<" + type + ">", budget, data.complex_norm, [] {
+		for (std::size_t n = 0; n < batch_size; ++n) {
+			data.out[n] = data.complex_in[n].norm();
+		}
+	}, scalar);
+	register_loop<T>("accuracy/norm/quaternion<" + type + ">", budget, data.quaternion_norm, [] {
+		for (std::size_t n = 0; n < batch_size; ++n) {
+			data.out[n] = data.quaternion_in[n].norm();
+		}
+	}, scalar);
+}
+
+// complex<T> products of fixed_batch.h over the same inputs, with a
+// corner of -1 in every part first, whose exact products need a
+// saturation. Each component is rounded by the shift policy once: round
+// half up is off by at most half a unit, the truncating shift by less
+// than one.
+template <typename T>
+struct fixed_batch_cases {
+	typedef Stephan::complex<T> type;
+
+	std::vector<type>		a, b, c;
+	std::vector<type>		out = std::vector<type>(batch_size);
+	std::vector<exact<2>>		mul, conj_mul, cmla;
+
+	fixed_batch_cases() {
+		std::vector<double> parts = random_scalars<double>(6 * batch_size, 62, -1.0, 1.0);
+		for (std::size_t n = 0; n < batch_size; ++n) {
+			const double* p = parts.data() + (6 * n);
+			bool corner = (n == 0);
+			this->a.emplace_back(T(corner ? -1.0 : p[0]), T(corner ? -1.0 : p[1]));
+			this->b.emplace_back(T(corner ? -1.0 : p[2]), T(corner ? -1.0 : p[3]));
+			this->c.emplace_back(T(p[4]), T(p[5]));
+			real ar = to_real(this->a[n].Re()), ai = to_real(this->a[n].Im());
+			real br = to_real(this->b[n].Re()), bi = to_real(this->b[n].Im());
+			real mul_re = saturate<T>((ar * br) - (ai * bi)), mul_im = saturate<T>((ar * bi) + (ai * br));
+			this->mul.push_back({ mul_re, mul_im });
+			this->conj_mul.push_back({ saturate<T>((ar * br) + (ai * bi)), saturate<T>((ar * bi) - (ai * br)) });
+			this->cmla.push_back({ saturate<T>(to_real(this->c[n].Re()) + mul_re), saturate<T>(to_real(this->c[n].Im()) + mul_im) });
+		}
+	}
+};
+
+template <typename T>
+void register_fixed_batch(const std::string& type, double budget) {
+	static fixed_batch_cases<T> data;
+	std::string name = "/complex<" + type + ">";
+	std::span<const Stephan::complex<T>> a(data.a), b(data.b);
+	std::span<Stephan::complex<T>> out(data.out);
+	auto result = [](std::size_t n) { return components(data.out[n]); };
+
+	register_targets<T>("accuracy/mul" + name, budget, data.mul, [=] { Stephan::cmul<T>(a, b, out); }, result);
+	register_targets<T>("accuracy/conj_mul" + name, budget, data.conj_mul, [=] { Stephan::conj_mul<T>(a, b, out); }, result);
+	register_targets<T>("accuracy/cmla" + name, budget, data.cmla, [=] {
+		std::copy(data.c.begin(), data.c.end(), data.out.begin());
+		Stephan::cmla<T>(a, b, out);
+	}, result);
+}
+
+const bool registered = (register_complex<float>(), register_complex<double>(), register_quaternion<float>(), register_quaternion<double>(),
+	register_unit<float>(), register_unit<double>(), register_octonion<float>(), register_octonion<double>(),
+	register_octonion_trees<float>(), register_octonion_trees<double>(), register_dual<float>(), register_dual<double>(),
+	register_skinning<float>(), register_skinning<double>(), register_imu<float>(), register_imu<double>(),
+	register_half<Stephan::float16>("float16"), register_half<Stephan::bfloat16>("bfloat16"),
+	register_fft<float>(), register_fft<double>(), register_quaternion_fft<float>(), register_quaternion_fft<double>(),
+	register_fixed<Stephan::q15>("q15"), register_fixed<Stephan::q31>("q31"),
+	register_fixed_batch<Stephan::q15>("q15", 0.5), register_fixed_batch<Stephan::fixed<std::int16_t, 15, Stephan::truncate_shift>>("q15, truncate_shift", 1), true);
+
+}
+}
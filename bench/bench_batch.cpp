@@ -0,0 +1,413 @@
+// Batch kernels against loops over single values
+// Every batch operation over batch_size values is registered as
+//      batch/<op>/<type>/<layout>/<target>     the SIMD kernel on one target
+//      batch/<op>/<type>/<layout>/loop         a plain loop of the scalar operator
+// where layout is aos (arrays of values) or soa (quaternion_soa), and target
+// is each of simd::isa supported here. Loops over std::complex and
+// Eigen::Quaternion are listed under their own type names.
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "bench_common.h"
+
+#include "../complex_batch.h"
+#include "../complex_math.h"
+#include "../expression.h"
+#include "../fixed_batch.h"
+#include "../half_batch.h"
+#include "../inplace.h"
+#include "../octonion_batch.h"
+#include "../quaternion_soa.h"
+#include "../rotation.h"
+#include "../skinning.h"
+#include "../slerp.h"
+
+namespace cd_bench {
+namespace {
+
+template <typename Function>
+void register_loop(const std::string& name, Function body) {
+	benchmark::RegisterBenchmark(name.c_str(), [body](benchmark::State& state) {
+		for (auto _ : state) {
+			body();
+			benchmark::ClobberMemory();
+		}
+		set_items(state, batch_size);
+	});
+}
+
+template <typename Function>
+void register_targets(const std::string& name, Function body) {
+	for (Stephan::simd::isa target : available_isas()) {
+		benchmark::RegisterBenchmark((name + "/" + isa_name(target)).c_str(), [body, target](benchmark::State& state) {
+			scoped_isa selection(target);
+			for (auto _ : state) {
+				body();
+				benchmark::ClobberMemory();
+			}
+			set_items(state, batch_size);
+		});
+	}
+}
+
+// Data shared by the complex benchmarks of one precision. It lives for the
+// whole run, because the registered lambdas refer to it.
+template <typename T>
+struct complex_buffers {
+	std::vector<Stephan::complex<T>>	a = random_values<Stephan::complex<T>>(batch_size, 4);
+	std::vector<Stephan::complex<T>>	b = random_values<Stephan::complex<T>>(batch_size, 5);
+	std::vector<Stephan::complex<T>>	out = std::vector<Stephan::complex<T>>(batch_size);
+	std::vector<std::complex<T>>		std_a = random_values<std::complex<T>>(batch_size, 4);
+	std::vector<std::complex<T>>		std_b = random_values<std::complex<T>>(batch_size, 5);
+	std::vector<std::complex<T>>		std_out = std::vector<std::complex<T>>(batch_size);
+	std::vector<T>				scalars = std::vector<T>(batch_size);
+};
+
+template <typename T>
+void register_complex() {
+	typedef Stephan::complex<T> type;
+	static complex_buffers<T> data;
+	std::span<const type> a(data.a), b(data.b);
+	std::span<type> out(data.out);
+	std::span<T> scalars(data.scalars);
+	std::string stephan = "/" + ops<type>::name() + "/aos";
+	std::string standard = "/" + ops<std::complex<T>>::name() + "/aos/loop";
+
+	register_targets("batch/mul" + stephan, [=]() { Stephan::cmul<T>(a, b, out); });
+	register_loop("batch/mul" + stephan + "/loop", [=]() {
+		for (std::size_t n = 0; n < batch_size; ++n) {
+			out[n] = a[n] * b[n];
+		}
+	});
+	register_loop("batch/mul" + standard, []() {
+		for (std::size_t n = 0; n < batch_size; ++n) {
+			data.std_out[n] = data.std_a[n] * data.std_b[n];
+		}
+	});
+
+	register_targets("batch/div" + stephan, [=]() { Stephan::cdiv<T>(a, b, out); });
+	register_loop("batch/div" + stephan + "/loop", [=]() {
+		for (std::size_t n = 0; n < batch_size; ++n) {
+			out[n] = a[n] / b[n];
+		}
+	});
+	register_loop("batch/div" + standard, []() {
+		for (std::size_t n = 0; n < batch_size; ++n) {
+			data.std_out[n] = data.std_a[n] / data.std_b[n];
+		}
+	});
+
+	register_targets("batch/conj_mul" + stephan, [=]() { Stephan::conj_mul<T>(a, b, out); });
+	register_loop("batch/conj_mul" + stephan + "/loop", [=]() {
+		for (std::size_t n = 0; n < batch_size; ++n) {
+			out[n] = a[n].conjugate() * b[n];
+		}
+	});
+
+	register_targets("batch/norm" + stephan, [=]() { Stephan::abs<T>(a, scalars); });
+	register_loop("batch/norm" + stephan + "/loop", [=]() {
+		for (std::size_t n = 0; n < batch_size; ++n) {
+			scalars[n] = a[n].norm();
+		}
+	});
+	register_loop("batch/norm" + standard, []() {
+		for (std::size_t n = 0; n < batch_size; ++n) {
+			data.scalars[n] = std::abs(data.std_a[n]);
+		}
+	});
+
+	register_targets("batch/sqrt" + stephan, [=]() { Stephan::sqrt<T>(a, out); });
+	register_loop("batch/sqrt" + stephan + "/loop", [=]() {
+		for (std::size_t n = 0; n < batch_size; ++n) {
+			out[n] = a[n].sqrt();
+		}
+	});
+	register_loop("batch/sqrt" + standard, []() {
+		for (std::size_t n = 0; n < batch_size; ++n) {
+			data.std_out[n] = std::sqrt(data.std_a[n]);
+		}
+	});
+
+	register_targets("batch/exp" + stephan, [=]() { Stephan::exp<T>(a, out); });
+	register_loop("batch/exp" + stephan + "/loop", [=]() {
+		for (std::size_t n = 0; n < batch_size; ++n) {
+			out[n] = Stephan::exp(a[n]);
+		}
+	});
+	register_loop("batch/exp" + standard, []() {
+		for (std::size_t n = 0; n < batch_size; ++n) {
+			data.std_out[n] = std::exp(data.std_a[n]);
+		}
+	});
+}
+
+template <typename T>
+struct quaternion_buffers {
+	std::vector<Stephan::quaternion<T>>	a = random_values<Stephan::quaternion<T>>(batch_size, 6);
+	std::vector<Stephan::quaternion<T>>	b = random_values<Stephan::quaternion<T>>(batch_size, 7);
+	std::vector<Stephan::quaternion<T>>	c = random_values<Stephan::quaternion<T>>(batch_size, 9);
+	std::vector<Stephan::quaternion<T>>	out = std::vector<Stephan::quaternion<T>>(batch_size);
+	Stephan::quaternion_soa<T>		soa_a = Stephan::quaternion_soa<T>(std::span<const Stephan::quaternion<T>>(a));
+	Stephan::quaternion_soa<T>		soa_b = Stephan::quaternion_soa<T>(std::span<const Stephan::quaternion<T>>(b));
+	Stephan::quaternion_soa<T>		soa_c = Stephan::quaternion_soa<T>(std::span<const Stephan::quaternion<T>>(c));
+	Stephan::quaternion_soa<T>		soa_out = Stephan::quaternion_soa<T>(batch_size);
+	std::vector<T>				scalars = std::vector<T>(batch_size);
+	std::vector<T>				t = random_scalars<T>(batch_size, 8, T(0), T(1));
+	std::vector<Stephan::vec3<T>>		points = std::vector<Stephan::vec3<T>>(batch_size, Stephan::vec3<T>{ T(0.25), T(-0.5), T(1) });
+	std::vector<Stephan::vec3<T>>		rotated = std::vector<Stephan::vec3<T>>(batch_size);
+#if defined(CD_BENCH_HAVE_EIGEN)
+	std::vector<Eigen::Quaternion<T>>	eigen_a = random_values<Eigen::Quaternion<T>>(batch_size, 6);
+	std::vector<Eigen::Quaternion<T>>	eigen_b = random_values<Eigen::Quaternion<T>>(batch_size, 7);
+	std::vector<Eigen::Quaternion<T>>	eigen_out = std::vector<Eigen::Quaternion<T>>(batch_size);
+	std::vector<Eigen::Matrix<T, 3, 1>>	eigen_points = std::vector<Eigen::Matrix<T, 3, 1>>(batch_size, Eigen::Matrix<T, 3, 1>(T(0.25), T(-0.5), T(1)));
+	std::vector<Eigen::Matrix<T, 3, 1>>	eigen_rotated = std::vector<Eigen::Matrix<T, 3, 1>>(batch_size);
+#endif
+};
+
+template <typename T>
+void register_quaternion() {
+	typedef Stephan::quaternion<T> type;
+	static quaternion_buffers<T> data;
+	std::string name = "/" + ops<type>::name();
+#if defined(CD_BENCH_HAVE_EIGEN)
+	std::string eigen = "/" + ops<Eigen::Quaternion<T>>::name() + "/aos/loop";
+#endif
+
+	register_targets("batch/mul" + name + "/soa", []() { Stephan::multiply(data.soa_a, data.soa_b, data.soa_out); });
+	register_loop("batch/mul" + name + "/aos/loop", []() {
+		for (std::size_t n = 0; n < batch_size; ++n) {
+			data.out[n] = data.a[n] * data.b[n];
+		}
+	});
+#if defined(CD_BENCH_HAVE_EIGEN)
+	register_loop("batch/mul" + eigen, []() {
+		for (std::size_t n = 0; n < batch_size; ++n) {
+			data.eigen_out[n] = data.eigen_a[n] * data.eigen_b[n];
+		}
+	});
+#endif
+
+	// a * b + c, fused through expression.h
+	register_targets("batch/mul_add" + name + "/soa", []() { data.soa_out = data.soa_a * data.soa_b + data.soa_c; });
+	register_loop("batch/mul_add" + name + "/aos/loop", []() {
+		for (std::size_t n = 0; n < batch_size; ++n) {
+			data.out[n] = data.a[n] * data.b[n] + data.c[n];
+		}
+	});
+#if defined(CD_BENCH_HAVE_EIGEN)
+	register_loop("batch/mul_add" + eigen, []() {
+		for (std::size_t n = 0; n < batch_size; ++n) {
+			data.eigen_out[n] = ops<Eigen::Quaternion<T>>::add(data.eigen_a[n] * data.eigen_b[n], data.eigen_a[n]);
+		}
+	});
+#endif
+
+	register_targets("batch/conjugate" + name + "/soa", []() { Stephan::conjugate(data.soa_a, data.soa_out); });
+	register_loop("batch/conjugate" + name + "/aos/loop", []() {
+		for (std::size_t n = 0; n < batch_size; ++n) {
+			data.out[n] = data.a[n].conjugate();
+		}
+	});
+#if defined(CD_BENCH_HAVE_EIGEN)
+	register_loop("batch/conjugate" + eigen, []() {
+		for (std::size_t n = 0; n < batch_size; ++n) {
+			data.eigen_out[n] = data.eigen_a[n].conjugate();
+		}
+	});
+#endif
+
+	register_targets("batch/norm" + name + "/soa", []() { Stephan::norm(data.soa_a, std::span<T>(data.scalars)); });
+	register_loop("batch/norm" + name + "/aos/loop", []() {
+		for (std::size_t n = 0; n < batch_size; ++n) {
+			data.scalars[n] = data.a[n].norm();
+		}
+	});
+#if defined(CD_BENCH_HAVE_EIGEN)
+	register_loop("batch/norm" + eigen, []() {
+		for (std::size_t n = 0; n < batch_size; ++n) {
+			data.scalars[n] = data.eigen_a[n].norm();
+		}
+	});
+#endif
+
+	register_targets("batch/normalize" + name + "/soa", []() { Stephan::normalize(data.soa_a, data.soa_out); });
+	register_loop("batch/normalize" + name + "/aos/loop", []() {
+		for (std::size_t n = 0; n < batch_size; ++n) {
+			data.out[n] = data.a[n] * (T(1) / data.a[n].norm());
+		}
+	});
+#if defined(CD_BENCH_HAVE_EIGEN)
+	register_loop("batch/normalize" + eigen, []() {
+		for (std::size_t n = 0; n < batch_size; ++n) {
+			data.eigen_out[n] = data.eigen_a[n].normalized();
+		}
+	});
+#endif
+
+	// One unit quaternion composed onto many orientations, in place
+	register_targets("batch/left_multiply_inplace" + name + "/aos", []() {
+		Stephan::left_multiply_inplace<T>(data.a[0] * (T(1) / data.a[0].norm()), std::span<type>(data.out));
+	});
+	register_loop("batch/left_multiply_inplace" + name + "/aos/loop", []() {
+		type q = data.a[0] * (T(1) / data.a[0].norm());
+		for (std::size_t n = 0; n < batch_size; ++n) {
+			data.out[n] = q * data.out[n];
+		}
+	});
+
+	// One rotation applied to many points
+	register_targets("batch/rotate" + name + "/aos", []() {
+		Stephan::rotate(data.a[0], std::span<const Stephan::vec3<T>>(data.points), std::span<Stephan::vec3<T>>(data.rotated));
+	});
+	register_loop("batch/rotate" + name + "/aos/loop", []() {
+		for (std::size_t n = 0; n < batch_size; ++n) {
+			data.rotated[n] = data.a[0].rotate(data.points[n]);
+		}
+	});
+#if defined(CD_BENCH_HAVE_EIGEN)
+	register_loop("batch/rotate" + eigen, []() {
+		for (std::size_t n = 0; n < batch_size; ++n) {
+			data.eigen_rotated[n] = data.eigen_a[0] * data.eigen_points[n];
+		}
+	});
+#endif
+
+	// Interpolation between pairs of keyframes
+	register_targets("batch/slerp" + name + "/soa", []() {
+		Stephan::slerp_n(data.soa_a, data.soa_b, std::span<const T>(data.t), data.soa_out);
+	});
+	register_loop("batch/slerp" + name + "/aos/loop", []() {
+		for (std::size_t n = 0; n < batch_size; ++n) {
+			data.out[n] = Stephan::slerp(data.a[n], data.b[n], data.t[n]);
+		}
+	});
+#if defined(CD_BENCH_HAVE_EIGEN)
+	register_loop("batch/slerp" + eigen, []() {
+		for (std::size_t n = 0; n < batch_size; ++n) {
+			data.eigen_out[n] = data.eigen_a[n].slerp(data.t[n], data.eigen_b[n]);
+		}
+	});
+#endif
+}
+
+template <typename T>
+struct octonion_buffers {
+	std::vector<Stephan::octonion<T>>	a = random_values<Stephan::octonion<T>>(batch_size, 11);
+	std::vector<Stephan::octonion<T>>	b = random_values<Stephan::octonion<T>>(batch_size, 12);
+	std::vector<Stephan::octonion<T>>	out = std::vector<Stephan::octonion<T>>(batch_size);
+};
+
+template <typename T>
+void register_octonion() {
+	static octonion_buffers<T> data;
+	std::string name = "/" + ops<Stephan::octonion<T>>::name();
+
+	register_targets("batch/mul" + name + "/aos", []() { Stephan::multiply<T>(data.a, data.b, data.out); });
+	register_loop("batch/mul" + name + "/aos/loop", []() {
+		for (std::size_t n = 0; n < batch_size; ++n) {
+			data.out[n] = data.a[n] * data.b[n];
+		}
+	});
+}
+
+// The values converted to another type, e.g. complex<float> to complex<q15>
+template <typename V, typename W>
+std::vector<V> narrowed(const std::vector<W>& values) {
+	return std::vector<V>(values.begin(), values.end());
+}
+
+// 16-bit storage, computed in float
+template <typename H>
+struct half_buffers {
+	std::vector<Stephan::complex<H>>	a = narrowed<Stephan::complex<H>>(random_values<Stephan::complex<float>>(batch_size, 4));
+	std::vector<Stephan::complex<H>>	b = narrowed<Stephan::complex<H>>(random_values<Stephan::complex<float>>(batch_size, 5));
+	std::vector<Stephan::complex<H>>	out = std::vector<Stephan::complex<H>>(batch_size);
+	std::vector<Stephan::quaternion<H>>	q = narrowed<Stephan::quaternion<H>>(random_values<Stephan::quaternion<float>>(batch_size, 6));
+};
+
+template <typename H>
+void register_half(const std::string& type) {
+	static half_buffers<H> data;
+	register_targets("batch/mul/complex<" + type + ">/aos", []() { Stephan::cmul<H>(data.a, data.b, data.out); });
+	register_loop("batch/mul/complex<" + type + ">/aos/loop", []() {
+		for (std::size_t n = 0; n < batch_size; ++n) {
+			data.out[n] = data.a[n] * data.b[n];
+		}
+	});
+	Stephan::quaternion<H> rotation(0.5f, 0.5f, 0.5f, 0.5f);
+	register_targets("batch/left_mul/quaternion<" + type + ">/aos", [rotation]() { Stephan::left_multiply_inplace<H>(rotation, data.q); });
+}
+
+// Q15 fixed point, one rounding per component
+void register_fixed() {
+	typedef Stephan::complex<Stephan::q15> C;
+	static std::vector<C> a = narrowed<C>(random_values<Stephan::complex<float>>(batch_size, 4));
+	static std::vector<C> b = narrowed<C>(random_values<Stephan::complex<float>>(batch_size, 5));
+	static std::vector<C> out(batch_size);
+	register_targets("batch/mul/complex<q15>/aos", []() { Stephan::cmul<Stephan::q15>(a, b, out); });
+	register_loop("batch/mul/complex<q15>/aos/loop", []() {
+		for (std::size_t n = 0; n < batch_size; ++n) {
+			out[n] = a[n] * b[n];
+		}
+	});
+}
+
+// Dual quaternion skinning of batch_size vertices, four of skin_bones bones each
+inline constexpr std::size_t skin_bones = 64;
+inline constexpr std::size_t skin_influences = 4;
+
+template <typename T>
+struct skin_buffers {
+	std::vector<Stephan::dual_quaternion<T>>	bones;
+	std::vector<Stephan::vec3<T>>			points = std::vector<Stephan::vec3<T>>(batch_size);
+	std::vector<Stephan::vec3<T>>			out = std::vector<Stephan::vec3<T>>(batch_size);
+	std::vector<std::uint32_t>			indices = std::vector<std::uint32_t>(batch_size * skin_influences);
+	std::vector<T>					weights = std::vector<T>(batch_size * skin_influences);
+
+	skin_buffers() {
+		std::vector<Stephan::quaternion<T>> rotations = random_values<Stephan::quaternion<T>>(skin_bones, 21);
+		std::vector<Stephan::quaternion<T>> offsets = random_values<Stephan::quaternion<T>>(skin_bones, 22);
+		for (std::size_t n = 0; n < skin_bones; ++n) {
+			this->bones.push_back(Stephan::dual_quaternion<T>::from_rotation_translation(rotations[n],
+				Stephan::vec3<T>{ offsets[n].Im1(), offsets[n].Im2(), offsets[n].Im3() }));
+		}
+		std::vector<Stephan::quaternion<T>> positions = random_values<Stephan::quaternion<T>>(batch_size, 23);
+		for (std::size_t n = 0; n < batch_size; ++n) {
+			this->points[n] = Stephan::vec3<T>{ positions[n].Re(), positions[n].Im1(), positions[n].Im2() };
+			for (std::size_t k = 0; k < skin_influences; ++k) {
+				this->indices[(n * skin_influences) + k] = std::uint32_t(((n / 16) + (k * 7)) % skin_bones);
+				this->weights[(n * skin_influences) + k] = T(1) / T(k + 1);
+			}
+		}
+	}
+};
+
+template <typename T>
+void register_skinning() {
+	static skin_buffers<T> data;
+	std::string name = "/" + ops<Stephan::quaternion<T>>::name();
+	register_targets("batch/skin" + name + "/aos", []() {
+		Stephan::skin<T>(data.bones, data.points, data.indices, data.weights, data.out);
+	});
+	register_loop("batch/skin" + name + "/aos/loop", []() {
+		Stephan::dual_quaternion<T> influences[skin_influences];
+		for (std::size_t n = 0; n < batch_size; ++n) {
+			for (std::size_t k = 0; k < skin_influences; ++k) {
+				influences[k] = data.bones[data.indices[(n * skin_influences) + k]];
+			}
+			Stephan::dual_quaternion<T> blend = Stephan::dlb<T>(influences, std::span<const T>(data.weights).subspan(n * skin_influences, skin_influences));
+			data.out[n] = blend.transform(data.points[n]);
+		}
+	});
+}
+
+const bool registered = (register_complex<float>(), register_complex<double>(), register_quaternion<float>(), register_quaternion<double>(),
+	register_octonion<float>(), register_octonion<double>(), register_half<Stephan::float16>("float16"), register_half<Stephan::bfloat16>("bfloat16"),
+	register_fixed(), register_skinning<float>(), register_skinning<double>(), true);
+
+}
+}
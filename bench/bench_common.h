@@ -0,0 +1,222 @@
+// Provide the shared pieces of the cd_bench benchmark suite
+// Every number type under test is reached through ops<V>, a small adapter
+// with a common set of static functions:
+//      name            type name used in the benchmark names
+//      make(c)         value from its real components, real part first
+//      add, sub, mul, div, conjugate, norm, sqrt, reciprocal
+// An operation a type lacks (e.g. sqrt of Eigen::Quaternion) is simply not
+// provided, and is_available() then skips its benchmarks.
+//
+// Each operation is measured two ways:
+//      latency         x = op(x, y) in a dependent chain, one value at a time
+//      throughput      out[n] = op(a[n], b[n]) over independent arrays
+// Benchmark names have the form
+//      <mode>/<operation>/<type>[/<variant>]
+// and the suite reports items_per_second, so that cd_bench.json from two
+// versions can be compared name by name.
+#pragma once
+
+#include <array>
+#include <complex>
+#include <cstddef>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#if defined(CD_BENCH_HAVE_EIGEN)
+#include <Eigen/Geometry>
+#endif
+
+#include "../complex.h"
+#include "../octonions.h"
+#include "../quaternions.h"
+#include "../simd.h"
+
+namespace cd_bench {
+
+// Number of values per throughput run: large enough to hide the loop
+// overhead, small enough to stay in the L1/L2 caches
+inline constexpr std::size_t batch_size = 4096;
+
+template <typename T>
+struct type_name;
+template <>
+struct type_name<float> { static constexpr const char* value = "float"; };
+template <>
+struct type_name<double> { static constexpr const char* value = "double"; };
+
+template <typename V>
+struct ops;
+
+template <typename T>
+struct ops<Stephan::complex<T>> {
+	typedef Stephan::complex<T> type;
+	typedef T scalar;
+	static constexpr std::size_t dimension = 2;
+	static std::string name() { return std::string("complex<") + type_name<T>::value + ">"; }
+	static type make(const T* c) { return type(c[0], c[1]); }
+	static type add(type a, const type& b) { return a + b; }
+	static type sub(type a, const type& b) { return a - b; }
+	static type mul(const type& a, const type& b) { return a * b; }
+	static type div(const type& a, const type& b) { return a / b; }
+	static type conjugate(const type& a) { return a.conjugate(); }
+	static T norm(const type& a) { return a.norm(); }
+	static type sqrt(const type& a) { return a.sqrt(); }
+	static type reciprocal(const type& a) { return a.reciprocal(); }
+	static type offset(type a, T value) { return a + value; }
+};
+
+template <typename T>
+struct ops<std::complex<T>> {
+	typedef std::complex<T> type;
+	typedef T scalar;
+	static constexpr std::size_t dimension = 2;
+	static std::string name() { return std::string("std::complex<") + type_name<T>::value + ">"; }
+	static type make(const T* c) { return type(c[0], c[1]); }
+	static type add(const type& a, const type& b) { return a + b; }
+	static type sub(const type& a, const type& b) { return a - b; }
+	static type mul(const type& a, const type& b) { return a * b; }
+	static type div(const type& a, const type& b) { return a / b; }
+	static type conjugate(const type& a) { return std::conj(a); }
+	static T norm(const type& a) { return std::abs(a); }
+	static type sqrt(const type& a) { return std::sqrt(a); }
+	static type reciprocal(const type& a) { return T(1) / a; }
+	static type offset(const type& a, T value) { return a + value; }
+};
+
+template <typename T>
+struct ops<Stephan::quaternion<T>> {
+	typedef Stephan::quaternion<T> type;
+	typedef T scalar;
+	static constexpr std::size_t dimension = 4;
+	static std::string name() { return std::string("quaternion<") + type_name<T>::value + ">"; }
+	static type make(const T* c) { return type(c[0], c[1], c[2], c[3]); }
+	static type add(const type& a, const type& b) { return a + b; }
+	static type sub(const type& a, const type& b) { return a - b; }
+	static type mul(const type& a, const type& b) { return a * b; }
+	static type div(const type& a, const type& b) { return a / b; }
+	static type conjugate(const type& a) { return a.conjugate(); }
+	static T norm(const type& a) { return a.norm(); }
+	static type reciprocal(const type& a) { return a.reciprocal(); }
+	static type offset(const type& a, T value) { return a + type(value); }
+};
+
+template <typename T>
+struct ops<Stephan::octonion<T>> {
+	typedef Stephan::octonion<T> type;
+	typedef T scalar;
+	static constexpr std::size_t dimension = 8;
+	static std::string name() { return std::string("octonion<") + type_name<T>::value + ">"; }
+	static type make(const T* c) {
+		std::array<T, 8> values;
+		for (std::size_t n = 0; n < 8; ++n) {
+			values[n] = c[n];
+		}
+		return type::from_components(values);
+	}
+	static type add(const type& a, const type& b) { return a + b; }
+	static type sub(const type& a, const type& b) { return a - b; }
+	static type mul(const type& a, const type& b) { return a * b; }
+	static type div(const type& a, const type& b) { return a / b; }
+	static type conjugate(const type& a) { return a.conjugate(); }
+	static T norm(const type& a) { return a.norm(); }
+	static type sqrt(const type& a) { return a.sqrt(); }
+	static type reciprocal(const type& a) { return a.reciprocal(); }
+	static type offset(const type& a, T value) { return a + value; }
+};
+
+#if defined(CD_BENCH_HAVE_EIGEN)
+// Eigen::Quaternion has no + or - of its own, so those work on coeffs(),
+// and division is a product with inverse(). It has no square root.
+template <typename T>
+struct ops<Eigen::Quaternion<T>> {
+	typedef Eigen::Quaternion<T> type;
+	typedef T scalar;
+	static constexpr std::size_t dimension = 4;
+	static std::string name() { return std::string("Eigen::Quaternion<") + type_name<T>::value + ">"; }
+	static type make(const T* c) { return type(c[0], c[1], c[2], c[3]); }
+	static type add(const type& a, const type& b) { return type(a.coeffs() + b.coeffs()); }
+	static type sub(const type& a, const type& b) { return type(a.coeffs() - b.coeffs()); }
+	static type mul(const type& a, const type& b) { return a * b; }
+	static type div(const type& a, const type& b) { return a * b.inverse(); }
+	static type conjugate(const type& a) { return a.conjugate(); }
+	static T norm(const type& a) { return a.norm(); }
+	static type reciprocal(const type& a) { return a.inverse(); }
+	static type offset(const type& a, T value) { return type(a.w() + value, a.x(), a.y(), a.z()); }
+};
+#endif
+
+// Random values with every component in [-1, 1], scaled to unit norm so that
+// long dependent chains of products neither overflow nor underflow
+template <typename V>
+std::vector<V> random_values(std::size_t count, unsigned seed) {
+	typedef typename ops<V>::scalar T;
+	std::mt19937 engine(seed);
+	std::uniform_real_distribution<T> distribution(T(-1), T(1));
+	std::vector<V> values;
+	values.reserve(count);
+	T c[ops<V>::dimension];
+	for (std::size_t n = 0; n < count; ++n) {
+		T sum = T(0);
+		for (std::size_t d = 0; d < ops<V>::dimension; ++d) {
+			c[d] = distribution(engine);
+			sum += c[d] * c[d];
+		}
+		T scale = T(1) / std::sqrt(sum);
+		for (std::size_t d = 0; d < ops<V>::dimension; ++d) {
+			c[d] *= scale;
+		}
+		values.push_back(ops<V>::make(c));
+	}
+	return values;
+}
+
+template <typename T>
+std::vector<T> random_scalars(std::size_t count, unsigned seed, T low, T high) {
+	std::mt19937 engine(seed);
+	std::uniform_real_distribution<T> distribution(low, high);
+	std::vector<T> values(count);
+	for (T& value : values) {
+		value = distribution(engine);
+	}
+	return values;
+}
+
+// Runs a batch benchmark on one SIMD target and puts the default back
+// afterwards. Skipped with a message when the target is not supported.
+class scoped_isa {
+private:
+	Stephan::simd::isa	previous;
+	bool			ok;
+
+public:
+	explicit scoped_isa(Stephan::simd::isa target)
+		: previous(Stephan::simd::active_isa())
+		, ok(Stephan::simd::set_isa(target))
+	{}
+	~scoped_isa() { Stephan::simd::set_isa(previous); }
+	bool supported() const { return ok; }
+};
+
+inline std::string isa_name(Stephan::simd::isa target) {
+	return Stephan::simd::name(target);
+}
+
+// All targets compiled in and supported on this machine, widest last
+inline std::vector<Stephan::simd::isa> available_isas() {
+	std::vector<Stephan::simd::isa> targets;
+	for (Stephan::simd::isa target : { Stephan::simd::isa::scalar, Stephan::simd::isa::sse2, Stephan::simd::isa::neon, Stephan::simd::isa::avx2, Stephan::simd::isa::avx512 }) {
+		if (Stephan::simd::supported(target)) {
+			targets.push_back(target);
+		}
+	}
+	return targets;
+}
+
+inline void set_items(benchmark::State& state, std::size_t per_iteration) {
+	state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations()) * static_cast<std::int64_t>(per_iteration));
+}
+
+}
@@ -0,0 +1,151 @@
+/*
+Copyright (c) 2022, Dean Stephan
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of {{ project }} nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Fourier transforms of a range of sizes
+//      fft/forward/<type>/<N>              complex transform with a cached plan
+//      fft/forward/<type>/<N>/threads:<n>  the same on a thread_pool of n threads
+//      fft/real/<type>/<N>                 real input, N / 2 + 1 outputs
+//      fft/plan/<type>/<N>                 building the plan
+// Every size is a power of two except 1000 and 3^7 = 2187, which take
+// the radix 2, 3 and 5 paths. Items are transformed values.
+//      fft/convolve/<type>/<N>x<N>/<K>x<K>         quaternion image convolution
+//      fft/convolve/<type>/<N>x<N>/<K>x<K>/loop    the direct sum
+// where items are output pixels.
+#include <cstddef>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench_common.h"
+
+#include "../fft.h"
+#include "../parallel.h"
+#include "../quaternion_fft.h"
+
+namespace cd_bench {
+namespace {
+
+template <typename T>
+void register_fft() {
+	typedef Stephan::complex<T> type;
+	std::string name = "/" + ops<type>::name() + "/";
+
+	for (std::size_t size : { std::size_t(64), std::size_t(1000), std::size_t(1024), std::size_t(2187), std::size_t(4096), std::size_t(1) << 16, std::size_t(1) << 20 }) {
+		std::vector<type> values = random_values<type>(size, 17);
+		std::vector<T> samples(size);
+		for (std::size_t n = 0; n < size; ++n) {
+			samples[n] = values[n].Re();
+		}
+		std::string suffix = name + std::to_string(size);
+
+		std::vector<unsigned> counts = { 1 };
+		if ((size >= Stephan::fft_parallel_size) && (std::thread::hardware_concurrency() > 1)) {
+			counts.push_back(std::thread::hardware_concurrency());
+		}
+		for (unsigned threads : counts) {
+			std::string label = "fft/forward" + suffix + ((threads > 1) ? "/threads:" + std::to_string(threads) : std::string());
+			benchmark::RegisterBenchmark(label.c_str(), [values, size, threads](benchmark::State& state) {
+				Stephan::thread_pool pool(threads);
+				std::shared_ptr<const Stephan::fft_plan<T>> plan = Stephan::fft_planner<T>::shared().plan(size);
+				std::vector<type> out(size);
+				for (auto _ : state) {
+					plan->forward(values, out, pool);
+					benchmark::ClobberMemory();
+				}
+				set_items(state, size);
+			})->UseRealTime();
+		}
+
+		benchmark::RegisterBenchmark(("fft/real" + suffix).c_str(), [samples, size](benchmark::State& state) {
+			Stephan::thread_pool pool(1);
+			std::shared_ptr<const Stephan::real_fft_plan<T>> plan = Stephan::fft_planner<T>::shared().real_plan(size);
+			std::vector<type> out(plan->spectrum_size());
+			for (auto _ : state) {
+				plan->forward(samples, out, pool);
+				benchmark::ClobberMemory();
+			}
+			set_items(state, size);
+		});
+
+		benchmark::RegisterBenchmark(("fft/plan" + suffix).c_str(), [size](benchmark::State& state) {
+			for (auto _ : state) {
+				Stephan::fft_plan<T> plan(size);
+				benchmark::DoNotOptimize(plan);
+			}
+			set_items(state, size);
+		});
+	}
+}
+
+template <typename T>
+void register_convolution() {
+	typedef Stephan::quaternion<T> type;
+	constexpr std::size_t size = 256, kernel_size = 15;
+	static std::vector<type> image = random_values<type>(size * size, 19);
+	static std::vector<type> kernel = random_values<type>(kernel_size * kernel_size, 23);
+	static std::vector<type> out(size * size);
+	std::string name = "fft/convolve/" + ops<type>::name() + "/" + std::to_string(size) + "x" + std::to_string(size) + "/" + std::to_string(kernel_size) + "x" + std::to_string(kernel_size);
+
+	benchmark::RegisterBenchmark(name.c_str(), [](benchmark::State& state) {
+		Stephan::thread_pool pool(1);
+		for (auto _ : state) {
+			Stephan::convolve<T>(kernel, kernel_size, kernel_size, image, size, size, out, Stephan::convolution_size::same, pool);
+			benchmark::ClobberMemory();
+		}
+		set_items(state, size * size);
+	});
+	benchmark::RegisterBenchmark((name + "/loop").c_str(), [](benchmark::State& state) {
+		constexpr std::size_t half = kernel_size / 2;
+		for (auto _ : state) {
+			for (std::size_t x = 0; x < size; ++x) {
+				for (std::size_t y = 0; y < size; ++y) {
+					type sum;
+					for (std::size_t a = 0; a < kernel_size; ++a) {
+						for (std::size_t b = 0; b < kernel_size; ++b) {
+							std::size_t i = x + half - a, j = y + half - b;
+							if ((i < size) && (j < size)) {
+								sum += kernel[(a * kernel_size) + b] * image[(i * size) + j];
+							}
+						}
+					}
+					out[(x * size) + y] = sum;
+				}
+			}
+			benchmark::ClobberMemory();
+		}
+		set_items(state, size * size);
+	});
+}
+
+const bool registered = (register_fft<float>(), register_fft<double>(), register_convolution<float>(), register_convolution<double>(), true);
+
+}
+}
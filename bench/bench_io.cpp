@@ -0,0 +1,125 @@
+/*
+Copyright (c) 2022, Dean Stephan
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of {{ project }} nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Reading and writing arrays of quaternions
+//      io/format/<type>/<N>                format_values, shortest round trip text
+//      io/format/<type>/<N>/ostream        the same through std::ostringstream
+//      io/parse/<type>/<N>                 parse_values of that text
+//      io/binary/write/<type>/<N>          write_binary to a std::stringstream
+//      io/binary/read/<type>/<N>           read_binary back from it
+// Each of the text cases also runs on every core, /threads:<n>. Items are
+// values.
+#include <cstddef>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench_common.h"
+
+#include "../binary.h"
+#include "../parallel.h"
+#include "../text_format.h"
+
+namespace cd_bench {
+namespace {
+
+template <typename T>
+void register_io() {
+	typedef Stephan::quaternion<T> type;
+	constexpr std::size_t size = std::size_t(1) << 18;
+	static std::vector<type> values = random_values<type>(size, 29);
+	static std::vector<char> text(size * 4 * 32);
+	static std::size_t text_size = static_cast<std::size_t>(Stephan::format_values<T>(text.data(), text.data() + text.size(), values).ptr - text.data());
+	std::string suffix = "/" + ops<type>::name() + "/" + std::to_string(size);
+
+	std::vector<unsigned> counts = { 1 };
+	if (std::thread::hardware_concurrency() > 1) {
+		counts.push_back(std::thread::hardware_concurrency());
+	}
+	for (unsigned threads : counts) {
+		std::string label = (threads > 1) ? "/threads:" + std::to_string(threads) : std::string();
+		benchmark::RegisterBenchmark(("io/format" + suffix + label).c_str(), [threads](benchmark::State& state) {
+			Stephan::thread_pool pool(threads);
+			std::vector<char> out(text.size());
+			for (auto _ : state) {
+				benchmark::DoNotOptimize(Stephan::format_values<T>(out.data(), out.data() + out.size(), values, '\n', {}, pool));
+				benchmark::ClobberMemory();
+			}
+			set_items(state, size);
+		})->UseRealTime();
+		benchmark::RegisterBenchmark(("io/parse" + suffix + label).c_str(), [threads](benchmark::State& state) {
+			Stephan::thread_pool pool(threads);
+			std::vector<type> out(size);
+			for (auto _ : state) {
+				benchmark::DoNotOptimize(Stephan::parse_values<T>(text.data(), text.data() + text_size, out, '\n', pool));
+				benchmark::ClobberMemory();
+			}
+			set_items(state, size);
+		})->UseRealTime();
+	}
+
+	benchmark::RegisterBenchmark(("io/format" + suffix + "/ostream").c_str(), [](benchmark::State& state) {
+		for (auto _ : state) {
+			std::ostringstream out;
+			out.precision(std::numeric_limits<T>::max_digits10);
+			for (const type& q : values) {
+				out << q.Re() << '+' << q.Im1() << "i+" << q.Im2() << "j+" << q.Im3() << "k\n";
+			}
+			benchmark::DoNotOptimize(out.str().size());
+		}
+		set_items(state, size);
+	});
+
+	benchmark::RegisterBenchmark(("io/binary/write" + suffix).c_str(), [](benchmark::State& state) {
+		for (auto _ : state) {
+			std::stringstream out;
+			Stephan::write_binary<type>(out, values);
+			benchmark::DoNotOptimize(out.tellp());
+		}
+		set_items(state, size);
+	});
+	benchmark::RegisterBenchmark(("io/binary/read" + suffix).c_str(), [](benchmark::State& state) {
+		std::stringstream file;
+		Stephan::write_binary<type>(file, values);
+		std::string bytes = file.str();
+		for (auto _ : state) {
+			std::istringstream in(bytes);
+			benchmark::DoNotOptimize(Stephan::read_binary<type>(in).data());
+		}
+		set_items(state, size);
+	});
+}
+
+const bool registered = (register_io<float>(), register_io<double>(), true);
+
+}
+}
@@ -0,0 +1,162 @@
+// Per-operator latency and throughput of single values
+// For each number type and each operation:
+//      latency/<op>/<type>       dependent chain, time per operation
+//      throughput/<op>/<type>    independent values, operations per second
+// The latency of norm includes adding the result to the real part of the
+// next value, which is how the chain is kept dependent.
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "bench_common.h"
+
+namespace cd_bench {
+namespace {
+
+enum class operation {
+	add,
+	sub,
+	mul,
+	div,
+	conjugate,
+	norm,
+	sqrt,
+	reciprocal
+};
+
+const char* operation_name(operation op) {
+	switch (op) {
+	case operation::add: return "add";
+	case operation::sub: return "sub";
+	case operation::mul: return "mul";
+	case operation::div: return "div";
+	case operation::conjugate: return "conjugate";
+	case operation::norm: return "norm";
+	case operation::sqrt: return "sqrt";
+	default: return "reciprocal";
+	}
+}
+
+template <typename V, operation Op>
+constexpr bool is_available() {
+	typedef ops<V> traits;
+	if constexpr (Op == operation::sqrt) {
+		return requires(const V& value) { traits::sqrt(value); };
+	}
+	else if constexpr (Op == operation::reciprocal) {
+		return requires(const V& value) { traits::reciprocal(value); };
+	}
+	else {
+		return true;
+	}
+}
+
+// One step of the chain: the result feeds the next step
+template <typename V, operation Op>
+V chain_step(const V& x, const V& y) {
+	typedef ops<V> traits;
+	if constexpr (Op == operation::add) {
+		return traits::add(x, y);
+	}
+	else if constexpr (Op == operation::sub) {
+		return traits::sub(x, y);
+	}
+	else if constexpr (Op == operation::mul) {
+		return traits::mul(x, y);
+	}
+	else if constexpr (Op == operation::div) {
+		return traits::div(x, y);
+	}
+	else if constexpr (Op == operation::conjugate) {
+		return traits::conjugate(x);
+	}
+	else if constexpr (Op == operation::norm) {
+		return traits::offset(y, traits::norm(x));
+	}
+	else if constexpr (Op == operation::sqrt) {
+		return traits::sqrt(x);
+	}
+	else {
+		return traits::reciprocal(x);
+	}
+}
+
+template <typename V, operation Op>
+void latency(benchmark::State& state) {
+	std::vector<V> values = random_values<V>(2, 1);
+	V x = values[0];
+	const V y = values[1];
+	// With add and sub the chain drifts away from the unit sphere, so it is
+	// restarted every block to keep the values in range
+	constexpr int block = 64;
+	for (auto _ : state) {
+		V current = x;
+		for (int n = 0; n < block; ++n) {
+			current = chain_step<V, Op>(current, y);
+		}
+		benchmark::DoNotOptimize(current);
+	}
+	set_items(state, block);
+}
+
+template <typename V, operation Op>
+void throughput(benchmark::State& state) {
+	typedef ops<V> traits;
+	std::vector<V> a = random_values<V>(batch_size, 2);
+	std::vector<V> b = random_values<V>(batch_size, 3);
+	std::vector<V> out(batch_size);
+	std::vector<typename traits::scalar> scalars(batch_size);
+	for (auto _ : state) {
+		if constexpr (Op == operation::norm) {
+			for (std::size_t n = 0; n < batch_size; ++n) {
+				scalars[n] = traits::norm(a[n]);
+			}
+			benchmark::DoNotOptimize(scalars.data());
+		}
+		else {
+			for (std::size_t n = 0; n < batch_size; ++n) {
+				out[n] = chain_step<V, Op>(a[n], b[n]);
+			}
+			benchmark::DoNotOptimize(out.data());
+		}
+		benchmark::ClobberMemory();
+	}
+	set_items(state, batch_size);
+}
+
+template <typename V, operation Op>
+void register_operation() {
+	if constexpr (is_available<V, Op>()) {
+		std::string suffix = std::string(operation_name(Op)) + "/" + ops<V>::name();
+		benchmark::RegisterBenchmark(("latency/" + suffix).c_str(), latency<V, Op>);
+		benchmark::RegisterBenchmark(("throughput/" + suffix).c_str(), throughput<V, Op>);
+	}
+}
+
+template <typename V>
+void register_type() {
+	register_operation<V, operation::add>();
+	register_operation<V, operation::sub>();
+	register_operation<V, operation::mul>();
+	register_operation<V, operation::div>();
+	register_operation<V, operation::conjugate>();
+	register_operation<V, operation::norm>();
+	register_operation<V, operation::sqrt>();
+	register_operation<V, operation::reciprocal>();
+}
+
+template <typename T>
+void register_all() {
+	register_type<Stephan::complex<T>>();
+	register_type<std::complex<T>>();
+	register_type<Stephan::quaternion<T>>();
+#if defined(CD_BENCH_HAVE_EIGEN)
+	register_type<Eigen::Quaternion<T>>();
+#endif
+	register_type<Stephan::octonion<T>>();
+}
+
+const bool registered = (register_all<float>(), register_all<double>(), true);
+
+}
+}
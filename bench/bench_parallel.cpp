@@ -0,0 +1,291 @@
+/*
+Copyright (c) 2022, Dean Stephan
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of {{ project }} nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Multithreaded reductions against a sequential fold
+// Each reduction over parallel_size values (or octonion product tree over
+// as many factors, or gyroscope integration of imu_sensors sensors over
+// imu_samples samples each, or four-stage pipeline, fused per tile and as
+// one pass per stage, or orientation_index build and nearest-orientation
+// queries, against a scan of every orientation) is registered as
+//      parallel/<op>/<type>/threads:<n>    thread_pool of n threads
+//      parallel/<op>/<type>/loop           a plain loop on one thread
+// for one thread and for one thread per core. parallel_size is far beyond
+// the caches, as in the long trajectory logs the reductions are meant for.
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <random>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench_common.h"
+
+#include "../imu.h"
+#include "../octonion_batch.h"
+#include "../orientation_index.h"
+#include "../parallel.h"
+#include "../pipeline.h"
+#include "../quaternion_math.h"
+
+namespace cd_bench {
+namespace {
+
+inline constexpr std::size_t parallel_size = std::size_t(1) << 22;
+
+template <typename Function>
+void register_parallel(const std::string& name, Function body, std::size_t items = parallel_size) {
+	std::vector<unsigned> counts = { 1 };
+	if (std::thread::hardware_concurrency() > 1) {
+		counts.push_back(std::thread::hardware_concurrency());
+	}
+	for (unsigned threads : counts) {
+		benchmark::RegisterBenchmark((name + "/threads:" + std::to_string(threads)).c_str(), [body, threads, items](benchmark::State& state) {
+			Stephan::thread_pool pool(threads);
+			for (auto _ : state) {
+				body(pool);
+				benchmark::ClobberMemory();
+			}
+			set_items(state, items);
+		})->UseRealTime();
+	}
+}
+
+template <typename Function>
+void register_sequential(const std::string& name, Function body, std::size_t items = parallel_size) {
+	benchmark::RegisterBenchmark((name + "/loop").c_str(), [body, items](benchmark::State& state) {
+		for (auto _ : state) {
+			body();
+			benchmark::ClobberMemory();
+		}
+		set_items(state, items);
+	})->UseRealTime();
+}
+
+template <typename T>
+void register_quaternion() {
+	typedef Stephan::quaternion<T> type;
+	static std::vector<type> values = random_values<type>(parallel_size, 10);
+	static std::vector<type> out(parallel_size);
+	std::string name = "/" + ops<type>::name();
+
+	register_parallel("parallel/product" + name, [](Stephan::thread_pool& pool) {
+		benchmark::DoNotOptimize(Stephan::parallel_product<T>(values, pool));
+	});
+	register_sequential("parallel/product" + name, []() {
+		type result(1);
+		for (const type& value : values) {
+			result *= value;
+		}
+		benchmark::DoNotOptimize(result);
+	});
+
+	register_parallel("parallel/prefix_product" + name, [](Stephan::thread_pool& pool) {
+		Stephan::parallel_prefix_product<T>(values, out, pool);
+	});
+	register_sequential("parallel/prefix_product" + name, []() {
+		type result(1);
+		for (std::size_t n = 0; n < parallel_size; ++n) {
+			result *= values[n];
+			out[n] = result;
+		}
+	});
+
+	register_parallel("parallel/sum" + name, [](Stephan::thread_pool& pool) {
+		benchmark::DoNotOptimize(Stephan::parallel_sum<T>(values, Stephan::summation::plain, pool));
+	});
+	register_parallel("parallel/sum_compensated" + name, [](Stephan::thread_pool& pool) {
+		benchmark::DoNotOptimize(Stephan::parallel_sum<T>(values, Stephan::summation::compensated, pool));
+	});
+	register_sequential("parallel/sum" + name, []() {
+		type result;
+		for (const type& value : values) {
+			result += value;
+		}
+		benchmark::DoNotOptimize(result);
+	});
+}
+
+// Left folds of eight octonions, parallel_size / 8 of them
+template <typename T>
+void register_octonion() {
+	typedef Stephan::octonion<T> type;
+	static constexpr std::size_t chains = parallel_size / 8;
+	static std::vector<type> factors = random_values<type>(parallel_size, 13);
+	static std::vector<type> out(chains);
+	static Stephan::octonion_tree tree = Stephan::octonion_tree::left_fold(8);
+	std::string name = "/" + ops<type>::name();
+
+	register_parallel("parallel/left_fold" + name, [](Stephan::thread_pool& pool) {
+		Stephan::evaluate<T>(tree, factors, out, pool);
+	});
+	register_sequential("parallel/left_fold" + name, []() {
+		for (std::size_t n = 0; n < chains; ++n) {
+			type result = factors[n];
+			for (std::size_t leaf = 1; leaf < 8; ++leaf) {
+				result = result * factors[(leaf * chains) + n];
+			}
+			out[n] = result;
+		}
+	});
+}
+
+// One batch of samples for a node's worth of sensors, against the loop of
+// one q = q * exp(...) per sample and sensor it replaces; one item per sample
+inline constexpr std::size_t imu_sensors = 20000;
+inline constexpr std::size_t imu_samples = 16;
+
+// Angular rates in [-10, 10] rad/s
+template <typename T>
+std::vector<T> random_rates(std::size_t count, unsigned seed) {
+	std::mt19937 engine(seed);
+	std::uniform_real_distribution<T> distribution(T(-10), T(10));
+	std::vector<T> values(count);
+	for (T& value : values) {
+		value = distribution(engine);
+	}
+	return values;
+}
+
+template <typename T>
+void register_imu() {
+	typedef Stephan::quaternion<T> type;
+	static constexpr std::size_t count = imu_sensors * imu_samples;
+	static std::vector<type> start = random_values<type>(imu_sensors, 17);
+	static std::vector<T> x = random_rates<T>(count, 18), y = random_rates<T>(count, 19), z = random_rates<T>(count, 20);
+	static Stephan::quaternion_soa<T> orientations{ std::span<const type>(start) };
+	static std::vector<type> aos = start;
+	static constexpr T dt = T(0.005);
+	std::string name = "/" + ops<type>::name();
+
+	register_parallel("parallel/integrate_rates" + name, [](Stephan::thread_pool& pool) {
+		Stephan::integrate_rates<T>(orientations, x, y, z, dt, pool);
+	}, count);
+	register_sequential("parallel/integrate_rates" + name, []() {
+		for (std::size_t sample = 0; sample < imu_samples; ++sample) {
+			for (std::size_t n = 0; n < imu_sensors; ++n) {
+				std::size_t at = (sample * imu_sensors) + n;
+				type step = Stephan::exp(type(0, x[at] * (dt / 2), y[at] * (dt / 2), z[at] * (dt / 2)));
+				aos[n] = aos[n] * step;
+				aos[n] = aos[n] * (T(1) / aos[n].norm());
+			}
+		}
+	}, count);
+}
+
+// left_multiply, slerp towards keyframes, normalize, right_multiply
+template <typename T>
+void register_pipeline() {
+	typedef Stephan::quaternion<T> type;
+	static std::vector<type> values = random_values<type>(parallel_size, 24);
+	static std::vector<type> keys = random_values<type>(parallel_size, 25);
+	static const type correction = random_values<type>(1, 26)[0];
+	static const std::vector<typename Stephan::pipeline<type>::stage_function> stages = {
+		Stephan::stage::left_multiply(correction),
+		Stephan::stage::slerp<T>(keys, T(0.25)),
+		Stephan::stage::normalize<T>(),
+		Stephan::stage::right_multiply(correction.conjugate()) };
+	static const Stephan::pipeline<type> fused = [] {
+		Stephan::pipeline<type> chain;
+		for (const auto& stage : stages) {
+			chain.then(stage);
+		}
+		return chain;
+	}();
+	static const std::vector<Stephan::pipeline<type>> passes = [] {
+		std::vector<Stephan::pipeline<type>> chains(stages.size());
+		for (std::size_t n = 0; n < stages.size(); ++n) {
+			chains[n].then(stages[n]);
+		}
+		return chains;
+	}();
+	std::string name = "/" + ops<type>::name();
+
+	register_parallel("parallel/pipeline" + name, [](Stephan::thread_pool& pool) {
+		fused.run(std::span<type>(values), pool);
+	});
+	register_parallel("parallel/pipeline_passes" + name, [](Stephan::thread_pool& pool) {
+		for (const Stephan::pipeline<type>& pass : passes) {
+			pass.run(std::span<type>(values), pool);
+		}
+	});
+}
+
+// 8 nearest orientations out of parallel_size for each of orientation_queries
+// queries; the loop scans all of them, normalized, for orientation_scans
+// queries
+inline constexpr std::size_t orientation_queries = 4096;
+inline constexpr std::size_t orientation_scans = 16;
+inline constexpr std::size_t orientation_k = 8;
+
+template <typename T>
+void register_orientation_index() {
+	typedef Stephan::quaternion<T> type;
+	typedef Stephan::orientation_match<T> match;
+	static std::vector<type> stored = [] {
+		std::vector<type> values = random_values<type>(parallel_size, 27);
+		Stephan::normalize_inplace<T>(values);
+		return values;
+	}();
+	static std::vector<type> queries = random_values<type>(orientation_queries, 28);
+	static const Stephan::orientation_index<T> index(stored);
+	static std::vector<match> matches(orientation_queries * orientation_k);
+	std::string name = "/" + ops<type>::name();
+
+	register_parallel("parallel/orientation_build" + name, [](Stephan::thread_pool& pool) {
+		Stephan::orientation_index<T> built(stored, pool);
+		benchmark::DoNotOptimize(built.size());
+	});
+	register_parallel("parallel/orientation_nearest" + name, [](Stephan::thread_pool& pool) {
+		index.nearest(queries, matches, pool);
+	}, orientation_queries);
+	register_sequential("parallel/orientation_nearest" + name, []() {
+		for (std::size_t q = 0; q < orientation_scans; ++q) {
+			T best = T(0);
+			std::size_t at = 0;
+			for (std::size_t n = 0; n < stored.size(); ++n) {
+				T closeness = std::abs(dot(queries[q], stored[n]));
+				if (closeness > best) {
+					best = closeness;
+					at = n;
+				}
+			}
+			benchmark::DoNotOptimize(at);
+		}
+	}, orientation_scans);
+}
+
+const bool registered = (register_quaternion<float>(), register_quaternion<double>(), register_octonion<float>(), register_octonion<double>(),
+	register_imu<float>(), register_imu<double>(), register_pipeline<float>(), register_pipeline<double>(),
+	register_orientation_index<float>(), register_orientation_index<double>(), true);
+
+}
+}
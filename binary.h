@@ -0,0 +1,478 @@
+/*
+Copyright (c) 2022, Dean Stephan
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of {{ project }} nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Provide a binary file format for large arrays of complex numbers, quaternions and octonions
+// A file is a 32 byte header followed by the values, packed exactly as
+// they are in memory:
+//      offset  size
+//      0       4       "SCDB"
+//      4       1       format version, 1
+//      5       1       components per value: 1 (real), 2, 4 or 8
+//      6       1       bytes per component: 4 (float) or 8 (double)
+//      7       1       byte order of the values: 0 little, 1 big endian
+//      8       8       number of values, little endian, or all ones if the
+//                      writer could not seek back to fill it in
+//      16      16      reserved, zero
+// Values are always written in the byte order of the machine writing them,
+// and read back on any machine; the reader swaps bytes and converts float
+// to double or back as needed.
+//      write_binary<V>(stream, values)     header and values, one write call
+//      read_binary<V>(stream)              everything, into a std::vector<V>
+// For arrays that do not fit in memory, binary_writer<V> appends chunks and
+// fills in the count on close(), and binary_reader<V> reads chunks of any
+// size. On POSIX systems mapped_binary<V> maps a file into memory and hands
+// out its values as a span straight into the mapping, with no read at all;
+// that needs the file's layout to be that of V on this machine.
+// Errors, from the streams included, are thrown as binary_error.
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define STEPHAN_BINARY_MMAP 1
+#endif
+
+#include "cayley_dickson.h"
+#include "complex.h"
+#include "quaternions.h"
+
+namespace Stephan {
+
+class binary_error : public std::runtime_error {
+public:
+	using std::runtime_error::runtime_error;
+};
+
+struct binary_header {
+	static constexpr std::size_t size = 32;
+	static constexpr std::uint64_t unknown_count = ~std::uint64_t(0);
+
+	unsigned	dimension = 0;
+	unsigned	precision = 0;
+	std::endian	byte_order = std::endian::native;
+	std::uint64_t	count = 0;
+
+	void encode(unsigned char (&bytes)[size]) const noexcept {
+		std::memset(bytes, 0, size);
+		std::memcpy(bytes, "SCDB", 4);
+		bytes[4] = 1;
+		bytes[5] = static_cast<unsigned char>(this->dimension);
+		bytes[6] = static_cast<unsigned char>(this->precision);
+		bytes[7] = (this->byte_order == std::endian::big) ? 1 : 0;
+		for (int n = 0; n < 8; ++n) {
+			bytes[8 + n] = static_cast<unsigned char>(this->count >> (8 * n));
+		}
+	}
+
+	static binary_header decode(const unsigned char (&bytes)[size]) {
+		if (std::memcmp(bytes, "SCDB", 4) != 0) {
+			throw binary_error("not a hypercomplex binary file");
+		}
+		if (bytes[4] != 1) {
+			throw binary_error("unsupported binary format version " + std::to_string(bytes[4]));
+		}
+		binary_header header;
+		header.dimension = bytes[5];
+		header.precision = bytes[6];
+		header.byte_order = (bytes[7] != 0) ? std::endian::big : std::endian::little;
+		for (int n = 0; n < 8; ++n) {
+			header.count |= std::uint64_t(bytes[8 + n]) << (8 * n);
+		}
+		if (((header.dimension != 1) && (header.dimension != 2) && (header.dimension != 4) && (header.dimension != 8))
+			|| ((header.precision != 4) && (header.precision != 8)) || (bytes[7] > 1)) {
+			throw binary_error("corrupt binary file header");
+		}
+		return header;
+	}
+};
+
+namespace detail {
+
+// Component type and count of each value type
+template <typename V>
+struct binary_layout {
+	static_assert(std::is_floating_point<V>::value, "not a type the binary format holds");
+	typedef V scalar_type;
+	static constexpr unsigned dimension = 1;
+};
+template <typename T>
+struct binary_layout<complex<T>> {
+	typedef T scalar_type;
+	static constexpr unsigned dimension = 2;
+};
+template <typename T>
+struct binary_layout<quaternion<T>> {
+	typedef T scalar_type;
+	static constexpr unsigned dimension = 4;
+};
+template <typename Base>
+struct binary_layout<cayley_dickson<Base>> {
+	typedef typename cayley_dickson<Base>::value_type scalar_type;
+	static constexpr unsigned dimension = cayley_dickson<Base>::dimension;
+};
+
+template <typename V>
+binary_header binary_header_for(std::uint64_t count) noexcept {
+	typedef typename binary_layout<V>::scalar_type T;
+	static_assert(std::is_floating_point<T>::value && ((sizeof(T) == 4) || (sizeof(T) == 8)));
+	static_assert(sizeof(V) == binary_layout<V>::dimension * sizeof(T));
+	binary_header header;
+	header.dimension = binary_layout<V>::dimension;
+	header.precision = sizeof(T);
+	header.count = count;
+	return header;
+}
+
+inline void binary_swap_bytes(unsigned char* data, std::size_t components, unsigned precision) noexcept {
+	for (std::size_t n = 0; n < components; ++n, data += precision) {
+		std::reverse(data, data + precision);
+	}
+}
+
+// components values of the given precision, in native byte order, to T
+template <typename T>
+void binary_convert(const unsigned char* source, std::size_t components, unsigned precision, T* out) noexcept {
+	if (precision == 4) {
+		for (std::size_t n = 0; n < components; ++n) {
+			float value;
+			std::memcpy(&value, source + (4 * n), 4);
+			out[n] = static_cast<T>(value);
+		}
+	}
+	else {
+		for (std::size_t n = 0; n < components; ++n) {
+			double value;
+			std::memcpy(&value, source + (8 * n), 8);
+			out[n] = static_cast<T>(value);
+		}
+	}
+}
+
+inline void binary_write_header(std::ostream& out, const binary_header& header) {
+	unsigned char bytes[binary_header::size];
+	header.encode(bytes);
+	if (!out.write(reinterpret_cast<const char*>(bytes), binary_header::size)) {
+		throw binary_error("writing a binary header failed");
+	}
+}
+
+}
+
+template <typename V>
+void write_binary(std::ostream& out, std::span<const V> values) {
+	detail::binary_write_header(out, detail::binary_header_for<V>(values.size()));
+	if (!out.write(reinterpret_cast<const char*>(values.data()), static_cast<std::streamsize>(values.size_bytes()))) {
+		throw binary_error("writing binary values failed");
+	}
+}
+
+// Appends values chunk by chunk. The count in the header is filled in by
+// close(), or by the destructor, if the stream can seek; otherwise it is
+// left unknown and readers take everything up to the end of the file.
+template <typename V>
+class binary_writer {
+private:
+	std::ostream*		out;
+	std::streampos		start;
+	std::uint64_t		written = 0;
+	bool			open = true;
+
+public:
+	explicit binary_writer(std::ostream& stream)
+		: out(&stream)
+		, start(stream.tellp())
+	{
+		detail::binary_write_header(stream, detail::binary_header_for<V>(binary_header::unknown_count));
+	}
+	binary_writer(const binary_writer&) = delete;
+	binary_writer& operator=(const binary_writer&) = delete;
+	~binary_writer() {
+		try {
+			this->close();
+		}
+		catch (...) {
+		}
+	}
+
+	std::uint64_t count() const noexcept { return this->written; }
+
+	void write(std::span<const V> values) {
+		if (!this->out->write(reinterpret_cast<const char*>(values.data()), static_cast<std::streamsize>(values.size_bytes()))) {
+			throw binary_error("writing binary values failed");
+		}
+		this->written += values.size();
+	}
+
+	void close() {
+		if (!this->open) {
+			return;
+		}
+		this->open = false;
+		if (this->start != std::streampos(-1)) {
+			std::streampos end = this->out->tellp();
+			this->out->seekp(this->start);
+			detail::binary_write_header(*this->out, detail::binary_header_for<V>(this->written));
+			this->out->seekp(end);
+		}
+		if (!this->out->flush()) {
+			throw binary_error("writing binary values failed");
+		}
+	}
+};
+
+// Reads values chunk by chunk, from a file of any precision and byte order
+// holding values of V's dimension
+template <typename V>
+class binary_reader {
+private:
+	typedef typename detail::binary_layout<V>::scalar_type T;
+	static constexpr unsigned dimension = detail::binary_layout<V>::dimension;
+
+	std::istream*			in;
+	binary_header			info;
+	std::uint64_t			remaining;
+	std::vector<unsigned char>	staging;
+
+	// Reads up to bytes, returning how many arrived; only the end of the
+	// stream may cut a read short
+	std::size_t read_bytes(void* destination, std::size_t bytes) {
+		this->in->read(static_cast<char*>(destination), static_cast<std::streamsize>(bytes));
+		std::size_t got = static_cast<std::size_t>(this->in->gcount());
+		if ((got < bytes) && !this->in->eof()) {
+			throw binary_error("reading binary values failed");
+		}
+		return got;
+	}
+
+public:
+	explicit binary_reader(std::istream& stream)
+		: in(&stream)
+	{
+		unsigned char bytes[binary_header::size];
+		if (!stream.read(reinterpret_cast<char*>(bytes), binary_header::size)) {
+			throw binary_error("reading a binary header failed");
+		}
+		this->info = binary_header::decode(bytes);
+		if (this->info.dimension != dimension) {
+			throw binary_error("binary file holds values of " + std::to_string(this->info.dimension) + " components, not " + std::to_string(dimension));
+		}
+		this->remaining = this->info.count;
+	}
+
+	const binary_header& header() const noexcept { return this->info; }
+
+	// Reads up to values.size() values and returns how many were read, 0 at
+	// the end of the file
+	std::size_t read(std::span<V> values) {
+		std::size_t wanted = static_cast<std::size_t>(std::min<std::uint64_t>(values.size(), this->remaining));
+		std::size_t value_bytes = dimension * this->info.precision;
+		std::size_t done = 0;
+		if ((this->info.precision == sizeof(T)) && (this->info.byte_order == std::endian::native)) {
+			std::size_t got = this->read_bytes(values.data(), wanted * sizeof(V));
+			if ((got % sizeof(V)) != 0) {
+				throw binary_error("binary file ends inside a value");
+			}
+			done = got / sizeof(V);
+		}
+		else {
+			constexpr std::size_t chunk = 4096;
+			this->staging.resize(chunk * value_bytes);
+			while (done < wanted) {
+				std::size_t requested = std::min(chunk, wanted - done) * value_bytes;
+				std::size_t got = this->read_bytes(this->staging.data(), requested);
+				if ((got % value_bytes) != 0) {
+					throw binary_error("binary file ends inside a value");
+				}
+				std::size_t count = got / value_bytes;
+				if (this->info.byte_order != std::endian::native) {
+					detail::binary_swap_bytes(this->staging.data(), count * dimension, this->info.precision);
+				}
+				detail::binary_convert(this->staging.data(), count * dimension, this->info.precision, reinterpret_cast<T*>(values.data() + done));
+				done += count;
+				if (got < requested) {
+					break;
+				}
+			}
+		}
+		if ((this->info.count != binary_header::unknown_count) && (done < wanted)) {
+			throw binary_error("binary file is shorter than its header says");
+		}
+		if (this->info.count != binary_header::unknown_count) {
+			this->remaining -= done;
+		}
+		return done;
+	}
+};
+
+namespace detail {
+
+// Whether the rest of a seekable stream holds at least count values of
+// value_bytes each; false too if the stream cannot tell
+inline bool binary_stream_holds(std::istream& in, std::uint64_t count, std::size_t value_bytes) {
+	std::streampos here = in.tellg();
+	if (here == std::streampos(-1)) {
+		return false;
+	}
+	std::streampos end = in.seekg(0, std::ios::end).tellg();
+	in.clear();
+	in.seekg(here);
+	if ((end == std::streampos(-1)) || (end < here)) {
+		return false;
+	}
+	return (std::uint64_t(end - here) / value_bytes) >= count;
+}
+
+}
+
+// The count in the header is only trusted with an allocation once the
+// stream is known to hold that many values. Otherwise the values are read
+// in bounded chunks, and a file shorter than its header says throws
+// binary_error before much memory is spent on it.
+template <typename V>
+std::vector<V> read_binary(std::istream& in) {
+	binary_reader<V> reader(in);
+	std::vector<V> values;
+	std::uint64_t count = reader.header().count;
+	if ((count != binary_header::unknown_count) && (count <= std::uint64_t(values.max_size()))
+		&& detail::binary_stream_holds(in, count, reader.header().dimension * reader.header().precision)) {
+		values.resize(static_cast<std::size_t>(count));
+		reader.read(values);
+		return values;
+	}
+	constexpr std::size_t chunk = std::size_t(1) << 16;
+	for (;;) {
+		std::size_t size = values.size();
+		values.resize(size + chunk);
+		std::size_t got = reader.read(std::span<V>(values).subspan(size));
+		values.resize(size + got);
+		if (got == 0) {
+			return values;
+		}
+	}
+}
+
+#if defined(STEPHAN_BINARY_MMAP)
+// A read-only memory map of a whole file. values() points into the mapped
+// pages, which the operating system reads in as they are first touched.
+template <typename V>
+class mapped_binary {
+private:
+	void*		address = nullptr;
+	std::size_t	length = 0;
+	binary_header	info;
+	std::size_t	count = 0;
+
+public:
+	explicit mapped_binary(const std::string& path) {
+		int descriptor = ::open(path.c_str(), O_RDONLY);
+		if (descriptor < 0) {
+			throw binary_error("cannot open " + path);
+		}
+		struct stat status;
+		if ((::fstat(descriptor, &status) != 0) || (static_cast<std::size_t>(status.st_size) < binary_header::size)) {
+			::close(descriptor);
+			throw binary_error(path + " is not a hypercomplex binary file");
+		}
+		this->length = static_cast<std::size_t>(status.st_size);
+		this->address = ::mmap(nullptr, this->length, PROT_READ, MAP_PRIVATE, descriptor, 0);
+		::close(descriptor);
+		if (this->address == MAP_FAILED) {
+			this->address = nullptr;
+			throw binary_error("cannot map " + path);
+		}
+		try {
+			unsigned char bytes[binary_header::size];
+			std::memcpy(bytes, this->address, binary_header::size);
+			this->info = binary_header::decode(bytes);
+			binary_header expected = detail::binary_header_for<V>(0);
+			if ((this->info.dimension != expected.dimension) || (this->info.precision != expected.precision) || (this->info.byte_order != std::endian::native)) {
+				throw binary_error(path + " does not hold values of this type in this machine's byte order; read it with binary_reader");
+			}
+			std::size_t available = (this->length - binary_header::size) / sizeof(V);
+			if (this->info.count == binary_header::unknown_count) {
+				this->count = available;
+			}
+			else if (this->info.count > available) {
+				throw binary_error(path + " is shorter than its header says");
+			}
+			else {
+				this->count = static_cast<std::size_t>(this->info.count);
+			}
+		}
+		catch (...) {
+			::munmap(this->address, this->length);
+			throw;
+		}
+	}
+	mapped_binary(const mapped_binary&) = delete;
+	mapped_binary& operator=(const mapped_binary&) = delete;
+	mapped_binary(mapped_binary&& other) noexcept
+		: address(std::exchange(other.address, nullptr))
+		, length(std::exchange(other.length, 0))
+		, info(other.info)
+		, count(std::exchange(other.count, 0))
+	{}
+	mapped_binary& operator=(mapped_binary&& other) noexcept {
+		std::swap(this->address, other.address);
+		std::swap(this->length, other.length);
+		std::swap(this->info, other.info);
+		std::swap(this->count, other.count);
+		return *this;
+	}
+	~mapped_binary() {
+		if (this->address != nullptr) {
+			::munmap(this->address, this->length);
+		}
+	}
+
+	const binary_header& header() const noexcept { return this->info; }
+	std::span<const V> values() const noexcept {
+		return std::span<const V>(reinterpret_cast<const V*>(static_cast<const unsigned char*>(this->address) + binary_header::size), this->count);
+	}
+};
+#endif
+
+}
@@ -0,0 +1,337 @@
+/*
+Copyright (c) 2022, Dean Stephan
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of {{ project }} nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Provide a generic templated class for the Cayley-Dickson construction
+// See https://en.wikipedia.org/wiki/Cayley%E2%80%93Dickson_construction for mathematical explanation.
+// Each algebra is represented as an ordered pair (a, b) of elements of the
+// previous algebra, with
+//      (a, b)* = (a*, -b)
+//      (a, b) + (c, d) = (a + c, b + d)
+//      (a, b) * (c, d) = (a*c - d* * b, d*a + b*c*)
+// Starting from the reals this yields the complex numbers, the quaternions,
+// the octonions, the sedenions and so on, each doubling the dimension.
+//
+// The recursion happens entirely at compile time. Every operation is
+// constexpr and force-inlined, so an octonion product compiles down to the
+// same straight-line 64 multiplies that a hand expansion would contain.
+//
+// Components are stored in order, lower half first, so that
+//      cd_quaternion<T>  has components (1, i, j, k)
+// matching the layout of Stephan::quaternion<T>.
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <type_traits>
+
+#include "config.h"
+#include "instrumentation.h"
+
+namespace Stephan {
+
+template <typename Base>
+class cayley_dickson;
+
+namespace detail {
+
+// Walk down the nesting to find the underlying real type and dimension
+template <typename T>
+struct cd_traits {
+	using scalar_type = T;
+	static constexpr std::size_t dimension = 1;
+};
+template <typename Base>
+struct cd_traits<cayley_dickson<Base>> {
+	using scalar_type = typename cd_traits<Base>::scalar_type;
+	static constexpr std::size_t dimension = 2 * cd_traits<Base>::dimension;
+};
+
+// The real numbers terminate the recursion: they are self-conjugate and
+// their squared norm is just the square.
+template <typename T>
+STEPHAN_HOST_DEVICE STEPHAN_FORCE_INLINE constexpr T cd_conjugate(const T& value) noexcept { return value; }
+template <typename Base>
+STEPHAN_HOST_DEVICE STEPHAN_FORCE_INLINE constexpr cayley_dickson<Base> cd_conjugate(const cayley_dickson<Base>& value) noexcept {
+	return value.conjugate();
+}
+
+template <typename T>
+STEPHAN_HOST_DEVICE STEPHAN_FORCE_INLINE constexpr T cd_norm2(const T& value) noexcept { return value * value; }
+template <typename Base>
+STEPHAN_HOST_DEVICE STEPHAN_FORCE_INLINE constexpr typename cayley_dickson<Base>::value_type cd_norm2(const cayley_dickson<Base>& value) noexcept {
+	return value.norm2();
+}
+
+// Division by a real, component by component. The operators go through
+// this rather than the operator/ of the halves, so that instrumentation
+// counts one division however deep the nesting.
+template <typename T>
+STEPHAN_HOST_DEVICE STEPHAN_FORCE_INLINE constexpr T cd_divide(const T& value, const T& divisor) noexcept { return value / divisor; }
+template <typename Base>
+STEPHAN_HOST_DEVICE STEPHAN_FORCE_INLINE constexpr cayley_dickson<Base> cd_divide(const cayley_dickson<Base>& value, const typename cayley_dickson<Base>::value_type& divisor) noexcept {
+	return cayley_dickson<Base>(cd_divide(value.lower(), divisor), cd_divide(value.upper(), divisor));
+}
+
+template <typename T>
+STEPHAN_HOST_DEVICE STEPHAN_FORCE_INLINE constexpr T& cd_component(T& value, std::size_t) noexcept { return value; }
+template <typename T>
+STEPHAN_HOST_DEVICE STEPHAN_FORCE_INLINE constexpr const T& cd_component(const T& value, std::size_t) noexcept { return value; }
+template <typename Base>
+STEPHAN_HOST_DEVICE STEPHAN_FORCE_INLINE constexpr typename cayley_dickson<Base>::value_type& cd_component(cayley_dickson<Base>& value, std::size_t n) noexcept {
+	return value[n];
+}
+template <typename Base>
+STEPHAN_HOST_DEVICE STEPHAN_FORCE_INLINE constexpr const typename cayley_dickson<Base>::value_type& cd_component(const cayley_dickson<Base>& value, std::size_t n) noexcept {
+	return value[n];
+}
+
+}
+
+template <typename Base>
+class cayley_dickson {
+public:
+	using base_type = Base;
+	using value_type = typename detail::cd_traits<Base>::scalar_type;
+	static constexpr std::size_t dimension = 2 * detail::cd_traits<Base>::dimension;
+
+private:
+	static constexpr std::size_t half = dimension / 2;
+
+	Base	lower_part;
+	Base	upper_part;
+
+public:
+	STEPHAN_HOST_DEVICE constexpr cayley_dickson(Base _lower_part = Base(), Base _upper_part = Base()) noexcept
+		: lower_part(_lower_part)
+		, upper_part(_upper_part)
+	{}
+
+	// A real number embeds as the real part of every algebra above it.
+	template <typename U = value_type, typename = std::enable_if_t<!std::is_same<U, Base>::value>>
+	STEPHAN_HOST_DEVICE constexpr cayley_dickson(const value_type& real_part) noexcept
+		: lower_part(real_part)
+		, upper_part()
+	{}
+
+	// Build from and flatten to the full list of real components
+	static STEPHAN_HOST_DEVICE constexpr cayley_dickson from_components(const std::array<value_type, dimension>& values) noexcept {
+		cayley_dickson result;
+		for (std::size_t n = 0; n < dimension; ++n) {
+			result[n] = values[n];
+		}
+		return result;
+	}
+	STEPHAN_HOST_DEVICE constexpr std::array<value_type, dimension> components() const noexcept {
+		std::array<value_type, dimension> values{};
+		for (std::size_t n = 0; n < dimension; ++n) {
+			values[n] = (*this)[n];
+		}
+		return values;
+	}
+
+	// Provide real-part and half access routines
+	STEPHAN_HOST_DEVICE constexpr value_type Re() const noexcept { return (*this)[0]; }
+	STEPHAN_HOST_DEVICE constexpr const Base& lower() const noexcept { return lower_part; }
+	STEPHAN_HOST_DEVICE constexpr const Base& upper() const noexcept { return upper_part; }
+
+	// Component n, where component 0 is the real part
+	STEPHAN_HOST_DEVICE STEPHAN_FORCE_INLINE constexpr value_type& operator[](std::size_t n) noexcept {
+		return (n < half) ? detail::cd_component(lower_part, n) : detail::cd_component(upper_part, n - half);
+	}
+	STEPHAN_HOST_DEVICE STEPHAN_FORCE_INLINE constexpr const value_type& operator[](std::size_t n) const noexcept {
+		return (n < half) ? detail::cd_component(lower_part, n) : detail::cd_component(upper_part, n - half);
+	}
+
+	// Boolean relationships
+	// Note that only equality is defined. There is no ordering, so the concept
+	// of greater than and less than has no meaning.
+	STEPHAN_HOST_DEVICE constexpr bool operator==(const cayley_dickson& rhs) const noexcept {
+		return (this->lower_part == rhs.lower_part) && (this->upper_part == rhs.upper_part);
+	}
+	STEPHAN_HOST_DEVICE constexpr bool operator!=(const cayley_dickson& rhs) const noexcept {
+		return !(*this == rhs);
+	}
+
+	// Conjugate operation.
+	// For a pair (a, b), the conjugate is (a*, -b)
+	STEPHAN_HOST_DEVICE STEPHAN_FORCE_INLINE constexpr cayley_dickson conjugate() const noexcept {
+		return cayley_dickson(detail::cd_conjugate(this->lower_part), -this->upper_part);
+	}
+	STEPHAN_HOST_DEVICE STEPHAN_FORCE_INLINE constexpr cayley_dickson operator-() const noexcept {
+		return cayley_dickson(-this->lower_part, -this->upper_part);
+	}
+
+	// Addition + Subtraction
+	STEPHAN_HOST_DEVICE STEPHAN_FORCE_INLINE constexpr cayley_dickson operator+(const cayley_dickson& rhs) const noexcept {
+		return cayley_dickson(this->lower_part + rhs.lower_part, this->upper_part + rhs.upper_part);
+	}
+	STEPHAN_HOST_DEVICE STEPHAN_FORCE_INLINE constexpr cayley_dickson operator+(const value_type& value) const noexcept {
+		return cayley_dickson(this->lower_part + value, this->upper_part);
+	}
+	STEPHAN_HOST_DEVICE STEPHAN_FORCE_INLINE constexpr cayley_dickson operator-(const cayley_dickson& rhs) const noexcept {
+		return cayley_dickson(this->lower_part - rhs.lower_part, this->upper_part - rhs.upper_part);
+	}
+	STEPHAN_HOST_DEVICE STEPHAN_FORCE_INLINE constexpr cayley_dickson operator-(const value_type& value) const noexcept {
+		return cayley_dickson(this->lower_part - value, this->upper_part);
+	}
+
+	// Multiplication
+	// (a, b) * (c, d) = (a*c - d* * b, d*a + b*c*)
+	// Note that multiplication is not commutative from the quaternions on, and
+	// not associative from the octonions on.
+	STEPHAN_HOST_DEVICE STEPHAN_FORCE_INLINE constexpr cayley_dickson operator*(const cayley_dickson& rhs) const noexcept {
+		return cayley_dickson(
+			(this->lower_part * rhs.lower_part) - (detail::cd_conjugate(rhs.upper_part) * this->upper_part),
+			(rhs.upper_part * this->lower_part) + (this->upper_part * detail::cd_conjugate(rhs.lower_part)));
+	}
+	STEPHAN_HOST_DEVICE STEPHAN_FORCE_INLINE constexpr cayley_dickson operator*(const value_type& value) const noexcept {
+		return cayley_dickson(this->lower_part * value, this->upper_part * value);
+	}
+
+	// Division
+	// NOTE: As with quaternions, p / q is defined as p * (q^-1).
+	STEPHAN_HOST_DEVICE STEPHAN_FORCE_INLINE constexpr value_type norm2() const noexcept {
+		return detail::cd_norm2(this->lower_part) + detail::cd_norm2(this->upper_part);
+	}
+	STEPHAN_HOST_DEVICE value_type norm() const noexcept {
+		value_type result = std::sqrt(this->norm2());
+		STEPHAN_INSTRUMENT(cayley_dickson, norm, result);
+		return result;
+	}
+	STEPHAN_HOST_DEVICE STEPHAN_FORCE_INLINE constexpr cayley_dickson reciprocal() const noexcept {
+		cayley_dickson result = detail::cd_divide(this->conjugate(), this->norm2());
+		STEPHAN_INSTRUMENT(cayley_dickson, reciprocal, result);
+		return result;
+	}
+	STEPHAN_HOST_DEVICE STEPHAN_FORCE_INLINE constexpr cayley_dickson operator/(const cayley_dickson& rhs) const noexcept {
+		cayley_dickson result = (*this) * detail::cd_divide(rhs.conjugate(), rhs.norm2());
+		STEPHAN_INSTRUMENT(cayley_dickson, divide, result);
+		return result;
+	}
+	STEPHAN_HOST_DEVICE STEPHAN_FORCE_INLINE constexpr cayley_dickson operator/(const value_type& value) const noexcept {
+		cayley_dickson result = detail::cd_divide(*this, value);
+		STEPHAN_INSTRUMENT(cayley_dickson, divide, result);
+		return result;
+	}
+
+	// Compound assignment, in place. x *= y is x = x * y.
+	STEPHAN_HOST_DEVICE STEPHAN_FORCE_INLINE constexpr cayley_dickson& operator+=(const cayley_dickson& rhs) noexcept {
+		this->lower_part += rhs.lower_part;
+		this->upper_part += rhs.upper_part;
+		return *this;
+	}
+	STEPHAN_HOST_DEVICE STEPHAN_FORCE_INLINE constexpr cayley_dickson& operator+=(const value_type& value) noexcept {
+		this->lower_part += value;
+		return *this;
+	}
+	STEPHAN_HOST_DEVICE STEPHAN_FORCE_INLINE constexpr cayley_dickson& operator-=(const cayley_dickson& rhs) noexcept {
+		this->lower_part -= rhs.lower_part;
+		this->upper_part -= rhs.upper_part;
+		return *this;
+	}
+	STEPHAN_HOST_DEVICE STEPHAN_FORCE_INLINE constexpr cayley_dickson& operator-=(const value_type& value) noexcept {
+		this->lower_part -= value;
+		return *this;
+	}
+	STEPHAN_HOST_DEVICE STEPHAN_FORCE_INLINE constexpr cayley_dickson& operator*=(const cayley_dickson& rhs) noexcept {
+		return (*this) = (*this) * rhs;
+	}
+	STEPHAN_HOST_DEVICE STEPHAN_FORCE_INLINE constexpr cayley_dickson& operator*=(const value_type& value) noexcept {
+		this->lower_part *= value;
+		this->upper_part *= value;
+		return *this;
+	}
+	STEPHAN_HOST_DEVICE STEPHAN_FORCE_INLINE constexpr cayley_dickson& operator/=(const cayley_dickson& rhs) noexcept {
+		return (*this) = (*this) / rhs;
+	}
+	STEPHAN_HOST_DEVICE STEPHAN_FORCE_INLINE constexpr cayley_dickson& operator/=(const value_type& value) noexcept {
+		return (*this) = (*this) / value;
+	}
+
+	// This returns the principal square root.
+	// Every element is r + v with v purely imaginary, and r + v behaves like a
+	// complex number whose imaginary unit is v/|v|, so the complex formula
+	// applies along that axis.
+	STEPHAN_HOST_DEVICE cayley_dickson sqrt() const noexcept {
+		value_type real = this->Re();
+		value_type modulus = std::sqrt(this->norm2());
+		value_type gamma = std::sqrt((modulus + real) / 2);
+		value_type delta = std::sqrt((modulus - real) / 2);
+		cayley_dickson imaginary = *this - real;
+		value_type imaginary_norm = std::sqrt(imaginary.norm2());
+		cayley_dickson result(gamma);
+		if (imaginary_norm == 0) {
+			// A negative real has its root on the first imaginary axis
+			result[1] = delta;
+		}
+		else {
+			result = imaginary * (delta / imaginary_norm) + gamma;
+		}
+		STEPHAN_INSTRUMENT(cayley_dickson, sqrt, result);
+		return result;
+	}
+};
+
+// Scalar on the left-hand side
+template <typename Base>
+STEPHAN_HOST_DEVICE STEPHAN_FORCE_INLINE constexpr cayley_dickson<Base> operator+(const typename cayley_dickson<Base>::value_type& value, const cayley_dickson<Base>& rhs) noexcept {
+	return rhs + value;
+}
+template <typename Base>
+STEPHAN_HOST_DEVICE STEPHAN_FORCE_INLINE constexpr cayley_dickson<Base> operator-(const typename cayley_dickson<Base>::value_type& value, const cayley_dickson<Base>& rhs) noexcept {
+	return (-rhs) + value;
+}
+template <typename Base>
+STEPHAN_HOST_DEVICE STEPHAN_FORCE_INLINE constexpr cayley_dickson<Base> operator*(const typename cayley_dickson<Base>::value_type& value, const cayley_dickson<Base>& rhs) noexcept {
+	return rhs * value;
+}
+
+// The standard tower of algebras
+template <typename T>
+using cd_complex = cayley_dickson<T>;
+template <typename T>
+using cd_quaternion = cayley_dickson<cd_complex<T>>;
+template <typename T>
+using cd_octonion = cayley_dickson<cd_quaternion<T>>;
+template <typename T>
+using sedenion = cayley_dickson<cd_octonion<T>>;
+
+// Layout guarantees.
+// Every level must stay a dense array of its real components.
+static_assert(std::is_trivially_copyable<sedenion<double>>::value);
+static_assert(std::is_standard_layout<sedenion<double>>::value);
+static_assert(sizeof(cd_complex<float>) == 2 * sizeof(float));
+static_assert(sizeof(cd_quaternion<float>) == 4 * sizeof(float));
+static_assert(sizeof(cd_octonion<float>) == 8 * sizeof(float));
+static_assert(sizeof(cd_octonion<double>) == 8 * sizeof(double));
+static_assert(sizeof(sedenion<double>) == 16 * sizeof(double));
+
+}
@@ -30,123 +30,229 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 // Provide templated class definition for complex numbers
 // See https://en.wikipedia.org/wiki/Complex_number for mathematical explanation
+// Stream output lives in complex_io.h, which is included at the end of
+// this header unless STEPHAN_NO_IOSTREAM is defined, e.g. for device code
+// or embedded builds that cannot afford <ostream>.
 #pragma once
 
-#include <iostream>
+#include <cmath>
 #include <type_traits>
 
+#include "config.h"
+#include "instrumentation.h"
+#include "reciprocal.h"
+
 namespace Stephan {
 
+// The type arithmetic on T is carried out in: T itself, or float for the
+// 16-bit storage types of half.h. Squared norms and the intermediate
+// results of division and square roots are held in it.
+template <typename T>
+struct compute_type {
+	typedef T type;
+};
+template <typename T>
+using compute_type_t = typename compute_type<T>::type;
+
 template <typename T>
 class complex {
 private:
 	T	real_part;
 	T	imaginary_part;
-	bool use_electric_syntax; // Output will use j instead of i
 
 public:
-	complex(T _real_part = 0, T _imaginary_part = 0, bool _use_electric_syntax = false)
+	STEPHAN_HOST_DEVICE constexpr complex(T _real_part = 0, T _imaginary_part = 0) noexcept
 		: real_part(_real_part)
 		, imaginary_part(_imaginary_part)
-		, use_electric_syntax(_use_electric_syntax)
 	{}
-	complex()
-		: complex(0,0)
+	// Between precisions, e.g. complex<float>(complex<double>)
+	template <typename U>
+	STEPHAN_HOST_DEVICE explicit constexpr complex(const complex<U>& other) noexcept
+		: real_part(T(other.Re()))
+		, imaginary_part(T(other.Im()))
 	{}
 
 	// Provide real-part and imaginary-part routines
-	T Re() { return real_part; }
-	T Im() { return imaginary_part; }
-
-	// Provide a way to set the output format to use j instead of i
-	void UseJInOutput(bool flag = true) { this->use_electric_syntax = flag; }
+	STEPHAN_HOST_DEVICE constexpr T Re() const noexcept { return real_part; }
+	STEPHAN_HOST_DEVICE constexpr T Im() const noexcept { return imaginary_part; }
 
 	// Boolean relationships
 	// Note that only equality is defined. There is no ordering, so the concept
 	// of greater than and less than has no meaning.
-	bool operator==(const complex<T>& rhs) {
+	STEPHAN_HOST_DEVICE constexpr bool operator==(const complex<T>& rhs) const noexcept {
 		return (this->real_part == rhs.real_part) && (this->imaginary_part == rhs.imaginary_part);
 	}
+	STEPHAN_HOST_DEVICE constexpr bool operator!=(const complex<T>& rhs) const noexcept {
+		return !(*this == rhs);
+	}
 
 	// Conjugate operation.
 	// For a complex number a+bi, the conjugate is a-bi
-	complex<T> conjugate() { return complex(this->real_part, -(this->imaginary_part)); }
+	STEPHAN_HOST_DEVICE constexpr complex<T> conjugate() const noexcept { return complex(this->real_part, -(this->imaginary_part)); }
+	STEPHAN_HOST_DEVICE constexpr complex<T> operator-() const noexcept { return complex(-(this->real_part), -(this->imaginary_part)); }
 
 	// Addition + Subtraction
-	complex<T> operator+(const complex<T>& rhs) {
+	STEPHAN_HOST_DEVICE constexpr complex<T> operator+(const complex<T>& rhs) const noexcept {
 		return complex(this->real_part + rhs.real_part, this->imaginary_part + rhs.imaginary_part);
 	}
-	complex<T> operator+(const T& value) {
+	STEPHAN_HOST_DEVICE constexpr complex<T> operator+(const T& value) const noexcept {
 		return complex(this->real_part + value, this->imaginary_part);
 	}
-	complex<T> operator-(const complex<T>& rhs) {
+	STEPHAN_HOST_DEVICE constexpr complex<T> operator-(const complex<T>& rhs) const noexcept {
 		return complex(this->real_part - rhs.real_part, this->imaginary_part - rhs.imaginary_part);
 	}
-	complex<T> operator-(const T& value) {
+	STEPHAN_HOST_DEVICE constexpr complex<T> operator-(const T& value) const noexcept {
 		return complex(this->real_part - value, this->imaginary_part);
 	}
 
 	// Multiplication
-	complex<T> operator*(const complex<T>& rhs) {
+	STEPHAN_HOST_DEVICE constexpr complex<T> operator*(const complex<T>& rhs) const noexcept {
 		return complex((this->real_part * rhs.real_part) - (this->imaginary_part * rhs.imaginary_part),
 			(this->real_part * rhs.imaginary_part) + (this->imaginary_part * rhs.real_part));
 	}
-	complex<T> operator*(const T& value) {
+	STEPHAN_HOST_DEVICE constexpr complex<T> operator*(const T& value) const noexcept {
 		return complex(this->real_part * value, this->imaginary_part * value);
 	}
 
 	// Division
-	complex<T> operator/(const complex<T>& rhs) {
-		static_assert(is_floating_point<T>::value);
-		T divisor = (rhs.real_part * rhs.real_part) + (rhs.imaginary_part * rhs.imaginary_part);
-		T real_numerator = (this->real_part * rhs.real_part) + (this->imaginary_part * rhs.imaginary_part);
-		T imaginary_numerator = (this->imaginary_part * rhs.real_part) - (this->real_part * rhs.imaginary_part);
-		return complex(T(real_numerator/divisor), T(imaginary_numerator/divisor));
-	}
-	complex<T> operator/(const T& value) {
-		return complex(this->real_part / value, this->imaginary_part / value);
-	}
-
-	// This returns the principal square root. 
-	complex<T> sqrt() {
-		T common = std::sqrt(this->real_part*this->real_part + this->imaginary_part*this->imaginary_part);
-		T gamma = std::sqrt((this->real_part + common) / 2);
-		int sign_bit = std::signbit(this->imaginary_part) ? -1 : 1;
-		T delta = sign_bit * std::sqrt((-this->real_part + common) / 2);
-		return complex(T(gamma), T(delta));
-	}
-	T norm() {
-		return std::sqrt((this->real_part * this->real_part) + (this->imaginary_part * this->imaginary_part));
-	}
-
-	friend std::ostream& operator<<(std::ostream& out, const complex<T> &rhs);
-	friend complex<T> T::operator+(const complex<T>& value);
-	friend complex<T> T::operator-(const complex<T>& value);
-	friend complex<T> T::operator*(const complex<T>& value);
-	friend complex<T> T::operator/(const complex<T>& value);
+	// Every division goes through one reciprocal of the squared norm,
+	// computed by the given policy (see reciprocal.h), and multiplies.
+	STEPHAN_HOST_DEVICE constexpr compute_type_t<T> norm2() const noexcept {
+		return (this->real_part * this->real_part) + (this->imaginary_part * this->imaginary_part);
+	}
+	template <typename Policy = exact_reciprocal>
+	STEPHAN_HOST_DEVICE constexpr complex<T> reciprocal() const noexcept {
+		static_assert(std::is_floating_point<compute_type_t<T>>::value);
+		compute_type_t<T> scale = Policy::apply(this->norm2());
+		complex result(this->real_part * scale, -(this->imaginary_part * scale));
+		STEPHAN_INSTRUMENT(complex<T>, reciprocal, result);
+		return result;
+	}
+	template <typename Policy = exact_reciprocal>
+	STEPHAN_HOST_DEVICE constexpr complex<T> divide(const complex<T>& rhs) const noexcept {
+		static_assert(std::is_floating_point<compute_type_t<T>>::value);
+		compute_type_t<T> scale = Policy::apply(rhs.norm2());
+		compute_type_t<T> real_numerator = (this->real_part * rhs.real_part) + (this->imaginary_part * rhs.imaginary_part);
+		compute_type_t<T> imaginary_numerator = (this->imaginary_part * rhs.real_part) - (this->real_part * rhs.imaginary_part);
+		complex result(real_numerator * scale, imaginary_numerator * scale);
+		STEPHAN_INSTRUMENT(complex<T>, divide, result);
+		return result;
+	}
+	STEPHAN_HOST_DEVICE constexpr complex<T> operator/(const complex<T>& rhs) const noexcept {
+		return this->divide(rhs);
+	}
+	STEPHAN_HOST_DEVICE constexpr complex<T> operator/(const T& value) const noexcept {
+		compute_type_t<T> scale = compute_type_t<T>(1) / value;
+		complex result(this->real_part * scale, this->imaginary_part * scale);
+		STEPHAN_INSTRUMENT(complex<T>, divide, result);
+		return result;
+	}
+
+	// Compound assignment, in place
+	STEPHAN_HOST_DEVICE constexpr complex<T>& operator+=(const complex<T>& rhs) noexcept {
+		this->real_part += rhs.real_part;
+		this->imaginary_part += rhs.imaginary_part;
+		return *this;
+	}
+	STEPHAN_HOST_DEVICE constexpr complex<T>& operator+=(const T& value) noexcept {
+		this->real_part += value;
+		return *this;
+	}
+	STEPHAN_HOST_DEVICE constexpr complex<T>& operator-=(const complex<T>& rhs) noexcept {
+		this->real_part -= rhs.real_part;
+		this->imaginary_part -= rhs.imaginary_part;
+		return *this;
+	}
+	STEPHAN_HOST_DEVICE constexpr complex<T>& operator-=(const T& value) noexcept {
+		this->real_part -= value;
+		return *this;
+	}
+	STEPHAN_HOST_DEVICE constexpr complex<T>& operator*=(const complex<T>& rhs) noexcept {
+		return (*this) = (*this) * rhs;
+	}
+	STEPHAN_HOST_DEVICE constexpr complex<T>& operator*=(const T& value) noexcept {
+		this->real_part *= value;
+		this->imaginary_part *= value;
+		return *this;
+	}
+	STEPHAN_HOST_DEVICE constexpr complex<T>& operator/=(const complex<T>& rhs) noexcept {
+		return (*this) = this->divide(rhs);
+	}
+	STEPHAN_HOST_DEVICE constexpr complex<T>& operator/=(const T& value) noexcept {
+		return (*this) = (*this) / value;
+	}
+
+	// This returns the principal square root.
+	// With s = sqrt((|z| + |Re z|) / 2) and t = |Im z| / (2 s), the root is
+	// (s, t) for Re z >= 0 and (t, s) otherwise, with the sign of Im z on the
+	// imaginary part. Both cases are computed and one is selected, so the
+	// cost is two square roots and one division with no branches.
+	STEPHAN_HOST_DEVICE complex<T> sqrt() const noexcept {
+		typedef compute_type_t<T> A;
+		A magnitude = std::sqrt(this->norm2());
+		A s = std::sqrt((magnitude + std::abs(A(this->real_part))) / 2);
+		A t = (s == A(0)) ? A(0) : (std::abs(A(this->imaginary_part)) / 2) / s;
+		bool negative = std::signbit(this->real_part);
+		complex result(negative ? t : s, std::copysign(negative ? s : t, A(this->imaginary_part)));
+		STEPHAN_INSTRUMENT(complex<T>, sqrt, result);
+		return result;
+	}
+	STEPHAN_HOST_DEVICE T norm() const noexcept {
+		T result = std::sqrt(this->norm2());
+		STEPHAN_INSTRUMENT(complex<T>, norm, result);
+		return result;
+	}
 };
 
-std::ostream& operator<<(std::ostream& out, const complex<T> &rhs) {
-	const char complex_tag = (rhs.use_electric_syntax) ? 'j' : 'i';
-	return out << rhs.Re() << (rhs->Im()>=0)?"+":"" << rhs->Im() << complex_tag;
+// Free-function forms of the reciprocal: inverse(z) is z^-1, and
+// multiply_inverse(a, b) is a * b^-1 computed as a single fused division.
+template <typename Policy = exact_reciprocal, typename T>
+STEPHAN_HOST_DEVICE constexpr complex<T> inverse(const complex<T>& value) noexcept {
+	return value.template reciprocal<Policy>();
+}
+template <typename Policy = exact_reciprocal, typename T>
+STEPHAN_HOST_DEVICE constexpr complex<T> multiply_inverse(const complex<T>& lhs, const complex<T>& rhs) noexcept {
+	return lhs.template divide<Policy>(rhs);
 }
 
+// Scalar on the left-hand side
+template <typename T>
+STEPHAN_HOST_DEVICE constexpr complex<T> operator+(const T& value, const complex<T>& rhs) noexcept {
+	return complex<T>(value + rhs.Re(), rhs.Im());
+}
 template <typename T>
-complex<T> T::operator+(const complex<T>& value) {
-	return complex(value.Re() + *this, value.Im());
+STEPHAN_HOST_DEVICE constexpr complex<T> operator-(const T& value, const complex<T>& rhs) noexcept {
+	return complex<T>(value - rhs.Re(), -rhs.Im());
 }
 template <typename T>
-complex<T> T::operator-(const complex<T>& value) {
-	return complex(*this - value.Re(), -value.Im());
+STEPHAN_HOST_DEVICE constexpr complex<T> operator*(const T& value, const complex<T>& rhs) noexcept {
+	return complex<T>(value * rhs.Re(), value * rhs.Im());
 }
 template <typename T>
-complex<T> T::operator*(const complex<T>& value) {
-	return complex(*this * value.Re(), *this * value.Im());
+STEPHAN_HOST_DEVICE constexpr complex<T> operator/(const T& value, const complex<T>& rhs) noexcept {
+	static_assert(std::is_floating_point<compute_type_t<T>>::value);
+	return rhs.reciprocal() * value;
 }
+
+// The imaginary unit as a compile-time constant, e.g.
+//      constexpr auto z = 3.0 + 2.0 * Stephan::complex_basis::i<double>;
+namespace complex_basis {
 template <typename T>
-complex<T> T::operator/(const complex<T>& value) {
-	static_assert(is_floating_point<T>::value);
-	return complex<T>(*this, 0)/value;
+inline constexpr complex<T> i = complex<T>(0, 1);
+}
+
+// Layout guarantees.
+// complex<T> must stay a dense pair of T so that arrays of it can be handed
+// to code expecting interleaved real/imaginary storage (BLAS, FFTW, ...).
+static_assert(std::is_trivially_copyable<complex<float>>::value);
+static_assert(std::is_trivially_copyable<complex<double>>::value);
+static_assert(std::is_standard_layout<complex<float>>::value);
+static_assert(std::is_standard_layout<complex<double>>::value);
+static_assert(sizeof(complex<float>) == 2 * sizeof(float));
+static_assert(sizeof(complex<double>) == 2 * sizeof(double));
+
 }
 
-}
\ No newline at end of file
+#if !defined(STEPHAN_NO_IOSTREAM)
+#include "complex_io.h"
+#endif
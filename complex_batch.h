@@ -0,0 +1,127 @@
+/*
+Copyright (c) 2022, Dean Stephan
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of {{ project }} nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Provide batch kernels over arrays of complex numbers
+// These work directly on spans of complex<T>, which are laid out as
+// interleaved (re, im) pairs, and are vectorised for every SIMD target
+// (see simd.h). Output spans may be the same as input spans.
+//      cmul(a, b, out)         out[n] = a[n] * b[n]
+//      conj_mul(a, b, out)     out[n] = a[n].conjugate() * b[n]
+//      cmla(a, b, acc)         acc[n] += a[n] * b[n]
+//      cdiv(a, b, out)         out[n] = a[n] / b[n]
+//      dot(a, b)               sum of a[n] * b[n]
+//      dotc(a, b)              sum of a[n].conjugate() * b[n]
+//      abs(z, out)             out[n] = z[n].norm()
+//      norm2(z, out)           out[n] = z[n].norm() squared
+// The dot products accumulate in lanes<T> independent partial sums, so
+// their rounding differs slightly from a sequential loop.
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <span>
+#include <type_traits>
+
+#include "complex.h"
+#include "simd.h"
+
+#define STEPHAN_SIMD_KERNELS "complex_batch_kernels.h"
+#include "simd_foreach.h"
+
+namespace Stephan {
+
+namespace detail {
+template <typename T>
+const T* complex_data(std::span<const complex<T>> values) { return reinterpret_cast<const T*>(values.data()); }
+template <typename T>
+T* complex_data(std::span<complex<T>> values) { return reinterpret_cast<T*>(values.data()); }
+}
+
+template <typename T>
+void cmul(std::span<const complex<T>> a, std::span<const complex<T>> b, std::span<complex<T>> out) {
+	static_assert(std::is_floating_point<T>::value);
+	assert((a.size() == b.size()) && (a.size() == out.size()));
+	STEPHAN_SIMD_DISPATCH(complex_multiply<false, T>(a.size(), detail::complex_data(a), detail::complex_data(b), detail::complex_data(out)));
+}
+
+template <typename T>
+void conj_mul(std::span<const complex<T>> a, std::span<const complex<T>> b, std::span<complex<T>> out) {
+	static_assert(std::is_floating_point<T>::value);
+	assert((a.size() == b.size()) && (a.size() == out.size()));
+	STEPHAN_SIMD_DISPATCH(complex_multiply<true, T>(a.size(), detail::complex_data(a), detail::complex_data(b), detail::complex_data(out)));
+}
+
+template <typename T>
+void cmla(std::span<const complex<T>> a, std::span<const complex<T>> b, std::span<complex<T>> accumulator) {
+	static_assert(std::is_floating_point<T>::value);
+	assert((a.size() == b.size()) && (a.size() == accumulator.size()));
+	STEPHAN_SIMD_DISPATCH(complex_multiply_add<T>(a.size(), detail::complex_data(a), detail::complex_data(b), detail::complex_data(accumulator)));
+}
+
+template <typename T>
+void cdiv(std::span<const complex<T>> a, std::span<const complex<T>> b, std::span<complex<T>> out) {
+	static_assert(std::is_floating_point<T>::value);
+	assert((a.size() == b.size()) && (a.size() == out.size()));
+	STEPHAN_SIMD_DISPATCH(complex_divide<T>(a.size(), detail::complex_data(a), detail::complex_data(b), detail::complex_data(out)));
+}
+
+template <typename T>
+complex<T> dot(std::span<const complex<T>> a, std::span<const complex<T>> b) {
+	static_assert(std::is_floating_point<T>::value);
+	assert(a.size() == b.size());
+	T result[2];
+	STEPHAN_SIMD_DISPATCH(complex_dot<false, T>(a.size(), detail::complex_data(a), detail::complex_data(b), result));
+	return complex<T>(result[0], result[1]);
+}
+
+template <typename T>
+complex<T> dotc(std::span<const complex<T>> a, std::span<const complex<T>> b) {
+	static_assert(std::is_floating_point<T>::value);
+	assert(a.size() == b.size());
+	T result[2];
+	STEPHAN_SIMD_DISPATCH(complex_dot<true, T>(a.size(), detail::complex_data(a), detail::complex_data(b), result));
+	return complex<T>(result[0], result[1]);
+}
+
+template <typename T>
+void abs(std::span<const complex<T>> z, std::span<std::type_identity_t<T>> out) {
+	static_assert(std::is_floating_point<T>::value);
+	assert(z.size() == out.size());
+	STEPHAN_SIMD_DISPATCH(complex_magnitude<false, T>(z.size(), detail::complex_data(z), out.data()));
+}
+
+template <typename T>
+void norm2(std::span<const complex<T>> z, std::span<std::type_identity_t<T>> out) {
+	static_assert(std::is_floating_point<T>::value);
+	assert(z.size() == out.size());
+	STEPHAN_SIMD_DISPATCH(complex_magnitude<true, T>(z.size(), detail::complex_data(z), out.data()));
+}
+
+}
@@ -0,0 +1,144 @@
+/*
+Copyright (c) 2022, Dean Stephan
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of {{ project }} nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Provide the batch kernels behind complex_batch.h
+// This file is included once per SIMD target through simd_foreach.h and
+// must not be included directly. Complex arrays are interleaved
+// (re, im, re, im, ...); each block is split into a register of real parts
+// and one of imaginary parts, computed on, and merged back.
+
+template <typename T>
+STEPHAN_FORCE_INLINE void load_complex(const T* source, vec<T>& re, vec<T>& im) {
+	vec<T> parts[2];
+	load_interleaved<2>(source, parts);
+	re = parts[0];
+	im = parts[1];
+}
+template <typename T>
+STEPHAN_FORCE_INLINE void store_complex(T* destination, const vec<T>& re, const vec<T>& im) {
+	const vec<T> parts[2] = { re, im };
+	store_interleaved<2>(destination, parts);
+}
+
+// out = a * b, or conj(a) * b
+template <bool ConjugateLhs, typename T>
+void complex_multiply(std::size_t n, const T* a, const T* b, T* out) {
+	const T* const in[2] = { a, b };
+	T* const result[1] = { out };
+	for_each_block<2, 2>(n, in, result, [](const T* const* x, T* const* r, std::size_t offset) {
+		vec<T> ar, ai, br, bi;
+		load_complex(x[0] + 2 * offset, ar, ai);
+		load_complex(x[1] + 2 * offset, br, bi);
+		if constexpr (ConjugateLhs) {
+			store_complex(r[0] + 2 * offset, (ar * br) + (ai * bi), (ar * bi) - (ai * br));
+		}
+		else {
+			store_complex(r[0] + 2 * offset, (ar * br) - (ai * bi), (ar * bi) + (ai * br));
+		}
+	});
+}
+
+// accumulator += a * b
+template <typename T>
+void complex_multiply_add(std::size_t n, const T* a, const T* b, T* accumulator) {
+	const T* const in[3] = { a, b, accumulator };
+	T* const result[1] = { accumulator };
+	for_each_block<2, 2>(n, in, result, [](const T* const* x, T* const* r, std::size_t offset) {
+		vec<T> ar, ai, br, bi, cr, ci;
+		load_complex(x[0] + 2 * offset, ar, ai);
+		load_complex(x[1] + 2 * offset, br, bi);
+		load_complex(x[2] + 2 * offset, cr, ci);
+		store_complex(r[0] + 2 * offset, cr + (ar * br) - (ai * bi), ci + (ar * bi) + (ai * br));
+	});
+}
+
+// out = a / b
+template <typename T>
+void complex_divide(std::size_t n, const T* a, const T* b, T* out) {
+	const T* const in[2] = { a, b };
+	T* const result[1] = { out };
+	for_each_block<2, 2>(n, in, result, [](const T* const* x, T* const* r, std::size_t offset) {
+		vec<T> ar, ai, br, bi;
+		load_complex(x[0] + 2 * offset, ar, ai);
+		load_complex(x[1] + 2 * offset, br, bi);
+		vec<T> scale = broadcast(T(1)) / ((br * br) + (bi * bi));
+		store_complex(r[0] + 2 * offset, ((ar * br) + (ai * bi)) * scale, ((ai * br) - (ar * bi)) * scale);
+	});
+}
+
+// out = |z|, or |z|^2
+template <bool Squared, typename T>
+void complex_magnitude(std::size_t n, const T* in, T* out) {
+	const T* const source[1] = { in };
+	T* const result[1] = { out };
+	for_each_block<2, 1>(n, source, result, [](const T* const* x, T* const* r, std::size_t offset) {
+		vec<T> re, im;
+		load_complex(x[0] + 2 * offset, re, im);
+		if constexpr (Squared) {
+			store(r[0] + offset, (re * re) + (im * im));
+		}
+		else {
+			store(r[0] + offset, sqrt((re * re) + (im * im)));
+		}
+	});
+}
+
+// sum of a * b, or conj(a) * b; result is (re, im)
+template <bool ConjugateLhs, typename T>
+void complex_dot(std::size_t n, const T* a, const T* b, T* result) {
+	constexpr std::size_t width = lanes<T>;
+	vec<T> sum_re = broadcast(T(0)), sum_im = broadcast(T(0));
+	auto accumulate = [&](const T* lhs, const T* rhs) {
+		vec<T> ar, ai, br, bi;
+		load_complex(lhs, ar, ai);
+		load_complex(rhs, br, bi);
+		if constexpr (ConjugateLhs) {
+			sum_re += (ar * br) + (ai * bi);
+			sum_im += (ar * bi) - (ai * br);
+		}
+		else {
+			sum_re += (ar * br) - (ai * bi);
+			sum_im += (ar * bi) + (ai * br);
+		}
+	};
+	std::size_t offset = 0;
+	for (; offset + width <= n; offset += width) {
+		accumulate(a + 2 * offset, b + 2 * offset);
+	}
+	std::size_t remaining = n - offset;
+	if (remaining != 0) {
+		T tail_a[2 * width] = {}, tail_b[2 * width] = {};
+		std::memcpy(tail_a, a + 2 * offset, 2 * remaining * sizeof(T));
+		std::memcpy(tail_b, b + 2 * offset, 2 * remaining * sizeof(T));
+		accumulate(tail_a, tail_b);
+	}
+	result[0] = reduce_add<T>(sum_re);
+	result[1] = reduce_add<T>(sum_im);
+}
@@ -0,0 +1,76 @@
+/*
+Copyright (c) 2022, Dean Stephan
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of {{ project }} nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Provide stream output for complex numbers
+// complex.h includes this header unless STEPHAN_NO_IOSTREAM is defined;
+// it can also be included on its own, after complex.h or instead of it.
+#pragma once
+
+#include <cmath>
+#include <ios>
+#include <ostream>
+
+#include "complex.h"
+
+namespace Stephan {
+
+// Output format selection.
+// The choice between i and j is a property of the stream rather than of
+// each value, so it is kept in the stream's iword storage. This keeps
+// complex<T> down to just its two components.
+//      std::cout << Stephan::electric_syntax << z;   // prints a+bj
+//      std::cout << Stephan::standard_syntax << z;   // prints a+bi
+inline int electric_syntax_index() {
+	static const int index = std::ios_base::xalloc();
+	return index;
+}
+inline std::ios_base& electric_syntax(std::ios_base& stream) {
+	stream.iword(electric_syntax_index()) = 1;
+	return stream;
+}
+inline std::ios_base& standard_syntax(std::ios_base& stream) {
+	stream.iword(electric_syntax_index()) = 0;
+	return stream;
+}
+inline bool uses_electric_syntax(std::ios_base& stream) {
+	return stream.iword(electric_syntax_index()) != 0;
+}
+
+template <typename T>
+std::ostream& operator<<(std::ostream& out, const complex<T>& rhs) {
+	const char complex_tag = uses_electric_syntax(out) ? 'j' : 'i';
+	out << rhs.Re();
+	if (!std::signbit(rhs.Im())) {
+		out << '+';
+	}
+	return out << rhs.Im() << complex_tag;
+}
+
+}
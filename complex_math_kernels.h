@@ -0,0 +1,139 @@
+/*
+Copyright (c) 2022, Dean Stephan
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of {{ project }} nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Provide the batch kernels behind complex_math.h
+// This file is included once per SIMD target through simd_foreach.h and
+// must not be included directly. It builds on load_complex/store_complex
+// from complex_batch_kernels.h and the lane functions of simd_math.h.
+
+template <typename T>
+STEPHAN_FORCE_INLINE void complex_sqrt_lanes(const vec<T>& a, const vec<T>& b, vec<T>& re, vec<T>& im) {
+	vec<T> magnitude = sqrt((a * a) + (b * b));
+	vec<T> s = sqrt((magnitude + abs_lanes<T>(a)) * broadcast(T(0.5)));
+	vec<T> t = (s == broadcast(T(0))) ? broadcast(T(0)) : (abs_lanes<T>(b) * broadcast(T(0.5))) / s;
+	auto negative = as_bits<T>(a) < broadcast_bits<T>(0);
+	re = negative ? t : s;
+	im = copysign_lanes<T>(negative ? s : t, b);
+}
+
+template <typename T>
+STEPHAN_FORCE_INLINE void complex_exp_lanes(const vec<T>& a, const vec<T>& b, vec<T>& re, vec<T>& im) {
+	vec<T> scale = exp_lanes<T>(a);
+	vec<T> s, c;
+	sincos_lanes<T>(b, s, c);
+	re = scale * c;
+	im = scale * s;
+}
+
+template <typename T>
+STEPHAN_FORCE_INLINE void complex_log_lanes(const vec<T>& a, const vec<T>& b, vec<T>& re, vec<T>& im) {
+	re = log_lanes<T>((a * a) + (b * b)) * broadcast(T(0.5));
+	im = atan2_lanes<T>(b, a);
+}
+
+// z^w = exp(w log z), and 0^w = 0
+template <typename T>
+STEPHAN_FORCE_INLINE void complex_pow_lanes(const vec<T>& a, const vec<T>& b, const vec<T>& wr, const vec<T>& wi, vec<T>& re, vec<T>& im) {
+	vec<T> lr, li;
+	complex_log_lanes<T>(a, b, lr, li);
+	complex_exp_lanes<T>((wr * lr) - (wi * li), (wr * li) + (wi * lr), re, im);
+	auto zero = (a == broadcast(T(0))) & (b == broadcast(T(0)));
+	re = zero ? broadcast(T(0)) : re;
+	im = zero ? broadcast(T(0)) : im;
+}
+
+template <::Stephan::detail::complex_function Function, typename T>
+void complex_elementwise(std::size_t n, const T* z, T* out) {
+	const T* const in[1] = { z };
+	T* const result[1] = { out };
+	for_each_block<2, 2>(n, in, result, [](const T* const* x, T* const* r, std::size_t offset) {
+		vec<T> a, b, re, im;
+		load_complex(x[0] + 2 * offset, a, b);
+		if constexpr (Function == ::Stephan::detail::complex_function::sqrt) {
+			complex_sqrt_lanes<T>(a, b, re, im);
+		}
+		else if constexpr (Function == ::Stephan::detail::complex_function::exp) {
+			complex_exp_lanes<T>(a, b, re, im);
+		}
+		else {
+			complex_log_lanes<T>(a, b, re, im);
+		}
+		store_complex(r[0] + 2 * offset, re, im);
+	});
+}
+
+template <typename T>
+void complex_arg(std::size_t n, const T* z, T* out) {
+	const T* const in[1] = { z };
+	T* const result[1] = { out };
+	for_each_block<2, 1>(n, in, result, [](const T* const* x, T* const* r, std::size_t offset) {
+		vec<T> a, b;
+		load_complex(x[0] + 2 * offset, a, b);
+		store(r[0] + offset, atan2_lanes<T>(b, a));
+	});
+}
+
+template <typename T>
+void complex_polar(std::size_t n, const T* magnitude, const T* angle, T* out) {
+	const T* const in[2] = { magnitude, angle };
+	T* const result[1] = { out };
+	for_each_block<1, 2>(n, in, result, [](const T* const* x, T* const* r, std::size_t offset) {
+		vec<T> m = load(x[0] + offset);
+		vec<T> s, c;
+		sincos_lanes<T>(load(x[1] + offset), s, c);
+		store_complex(r[0] + 2 * offset, m * c, m * s);
+	});
+}
+
+template <typename T>
+void complex_pow(std::size_t n, const T* z, const T* w, T* out) {
+	const T* const in[2] = { z, w };
+	T* const result[1] = { out };
+	for_each_block<2, 2>(n, in, result, [](const T* const* x, T* const* r, std::size_t offset) {
+		vec<T> a, b, wr, wi, re, im;
+		load_complex(x[0] + 2 * offset, a, b);
+		load_complex(x[1] + 2 * offset, wr, wi);
+		complex_pow_lanes<T>(a, b, wr, wi, re, im);
+		store_complex(r[0] + 2 * offset, re, im);
+	});
+}
+
+template <typename T>
+void complex_pow_real(std::size_t n, const T* z, T exponent, T* out) {
+	const T* const in[1] = { z };
+	T* const result[1] = { out };
+	vec<T> p = broadcast(exponent);
+	for_each_block<2, 2>(n, in, result, [p](const T* const* x, T* const* r, std::size_t offset) {
+		vec<T> a, b, re, im;
+		load_complex(x[0] + 2 * offset, a, b);
+		complex_pow_lanes<T>(a, b, p, broadcast(T(0)), re, im);
+		store_complex(r[0] + 2 * offset, re, im);
+	});
+}
@@ -0,0 +1,53 @@
+/*
+Copyright (c) 2022, Dean Stephan
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of {{ project }} nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Compiler configuration shared by the Cayley-Dickson headers
+#pragma once
+
+// Force inlining of the small arithmetic routines. The Cayley-Dickson
+// template builds higher algebras by recursion on the pair type; forcing
+// the recursion to inline is what turns e.g. an octonion product into a
+// flat sequence of multiply/adds.
+#if defined(_MSC_VER) && !defined(__clang__)
+#define STEPHAN_FORCE_INLINE __forceinline
+#elif defined(__GNUC__) || defined(__clang__)
+#define STEPHAN_FORCE_INLINE inline __attribute__((always_inline))
+#else
+#define STEPHAN_FORCE_INLINE inline
+#endif
+
+// Mark the value types' operations as callable from GPU kernels when the
+// header is compiled by nvcc or hipcc, so the same complex<T> and
+// quaternion<T> are used on the host and on the device (see gpu.h).
+#if defined(__CUDACC__) || defined(__HIPCC__)
+#define STEPHAN_HOST_DEVICE __host__ __device__
+#else
+#define STEPHAN_HOST_DEVICE
+#endif
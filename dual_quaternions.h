@@ -0,0 +1,262 @@
+/*
+Copyright (c) 2022, Dean Stephan
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of {{ project }} nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Provide templated class definition for dual quaternions
+// See https://en.wikipedia.org/wiki/Dual_quaternion for mathematical explanation.
+// A dual quaternion is a pair of quaternions written
+//      r + e d,    e*e = 0
+// so that products follow from the quaternion product with the e^2 term
+// dropped:
+//      (a + e b) * (c + e d) = a c + e (a d + b c)
+// A unit dual quaternion (|r| = 1 and r . d = 0) is a rigid transform: the
+// rotation r followed by the translation t, with
+//      d = (0, t) r / 2
+// and its product with another one is the composition of the two, the
+// right-hand transform applied first, as for quaternion rotations.
+//
+// Of the three conjugates,
+//      conjugate()         (r*, d*)    the inverse of a unit dual quaternion
+//      dual_conjugate()    (r, -d)
+//      full_conjugate()    (r*, -d*)   used to transform a point
+// and transform(p) applies the rotation and translation to a point.
+//
+// Blending between rigid transforms:
+//      sclerp(a, b, t)     screw linear interpolation: the constant-speed
+//                          screw motion from a to b, the rigid analogue of
+//                          slerp
+//      dlb(a, b, t)        dual quaternion linear blending: the normalized
+//      dlb(values, weights)    weighted sum, cheaper than sclerp and for
+//                          any number of transforms, which skinning.h
+//                          runs over vertices in batches
+// Both go the shorter way round: a transform given with the opposite sign
+// of its rotation (the same rigid transform) is flipped to the hemisphere
+// of the first one, and t is expected in [0, 1].
+#pragma once
+
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <span>
+#include <type_traits>
+
+#include "config.h"
+#include "quaternions.h"
+#include "vec3.h"
+
+namespace Stephan {
+
+template <typename T>
+class dual_quaternion {
+private:
+	quaternion<T>	real_part;
+	quaternion<T>	dual_part;
+
+public:
+	STEPHAN_HOST_DEVICE constexpr dual_quaternion(quaternion<T> _real_part = quaternion<T>(), quaternion<T> _dual_part = quaternion<T>()) noexcept
+		: real_part(_real_part)
+		, dual_part(_dual_part)
+	{}
+
+	// The identity transform
+	static STEPHAN_HOST_DEVICE constexpr dual_quaternion<T> identity() noexcept {
+		return dual_quaternion(quaternion<T>(1));
+	}
+	// Rotation by the unit quaternion rotation, then translation by translation
+	static STEPHAN_HOST_DEVICE constexpr dual_quaternion<T> from_rotation_translation(const quaternion<T>& rotation, const vec3<T>& translation) noexcept {
+		return dual_quaternion(rotation, quaternion<T>(0, translation.x, translation.y, translation.z) * rotation * T(0.5));
+	}
+	static STEPHAN_HOST_DEVICE constexpr dual_quaternion<T> from_translation(const vec3<T>& translation) noexcept {
+		return dual_quaternion(quaternion<T>(1), quaternion<T>(0, translation.x * T(0.5), translation.y * T(0.5), translation.z * T(0.5)));
+	}
+
+	// Provide real-part and dual-part routines
+	STEPHAN_HOST_DEVICE constexpr const quaternion<T>& real() const noexcept { return real_part; }
+	STEPHAN_HOST_DEVICE constexpr const quaternion<T>& dual() const noexcept { return dual_part; }
+
+	// The rotation and translation of a unit dual quaternion
+	STEPHAN_HOST_DEVICE constexpr const quaternion<T>& rotation() const noexcept { return real_part; }
+	STEPHAN_HOST_DEVICE constexpr vec3<T> translation() const noexcept {
+		quaternion<T> t = (this->dual_part * this->real_part.conjugate()) * T(2);
+		return vec3<T>{ t.Im1(), t.Im2(), t.Im3() };
+	}
+
+	// Boolean relationships
+	STEPHAN_HOST_DEVICE constexpr bool operator==(const dual_quaternion<T>& rhs) const noexcept {
+		return (this->real_part == rhs.real_part) && (this->dual_part == rhs.dual_part);
+	}
+	STEPHAN_HOST_DEVICE constexpr bool operator!=(const dual_quaternion<T>& rhs) const noexcept {
+		return !(*this == rhs);
+	}
+
+	// Conjugate operations, see the note at the top
+	STEPHAN_HOST_DEVICE constexpr dual_quaternion<T> conjugate() const noexcept {
+		return dual_quaternion(this->real_part.conjugate(), this->dual_part.conjugate());
+	}
+	STEPHAN_HOST_DEVICE constexpr dual_quaternion<T> dual_conjugate() const noexcept {
+		return dual_quaternion(this->real_part, -this->dual_part);
+	}
+	STEPHAN_HOST_DEVICE constexpr dual_quaternion<T> full_conjugate() const noexcept {
+		return dual_quaternion(this->real_part.conjugate(), -this->dual_part.conjugate());
+	}
+	STEPHAN_HOST_DEVICE constexpr dual_quaternion<T> operator-() const noexcept {
+		return dual_quaternion(-this->real_part, -this->dual_part);
+	}
+
+	// Addition + Subtraction
+	STEPHAN_HOST_DEVICE constexpr dual_quaternion<T> operator+(const dual_quaternion<T>& rhs) const noexcept {
+		return dual_quaternion(this->real_part + rhs.real_part, this->dual_part + rhs.dual_part);
+	}
+	STEPHAN_HOST_DEVICE constexpr dual_quaternion<T> operator-(const dual_quaternion<T>& rhs) const noexcept {
+		return dual_quaternion(this->real_part - rhs.real_part, this->dual_part - rhs.dual_part);
+	}
+
+	// Multiplication
+	STEPHAN_HOST_DEVICE constexpr dual_quaternion<T> operator*(const dual_quaternion<T>& rhs) const noexcept {
+		return dual_quaternion(this->real_part * rhs.real_part, (this->real_part * rhs.dual_part) + (this->dual_part * rhs.real_part));
+	}
+	STEPHAN_HOST_DEVICE constexpr dual_quaternion<T> operator*(const T& value) const noexcept {
+		return dual_quaternion(this->real_part * value, this->dual_part * value);
+	}
+
+	// Compound assignment, in place. q *= p is q = q * p.
+	STEPHAN_HOST_DEVICE constexpr dual_quaternion<T>& operator+=(const dual_quaternion<T>& rhs) noexcept {
+		this->real_part += rhs.real_part;
+		this->dual_part += rhs.dual_part;
+		return *this;
+	}
+	STEPHAN_HOST_DEVICE constexpr dual_quaternion<T>& operator-=(const dual_quaternion<T>& rhs) noexcept {
+		this->real_part -= rhs.real_part;
+		this->dual_part -= rhs.dual_part;
+		return *this;
+	}
+	STEPHAN_HOST_DEVICE constexpr dual_quaternion<T>& operator*=(const dual_quaternion<T>& rhs) noexcept {
+		return (*this) = (*this) * rhs;
+	}
+	STEPHAN_HOST_DEVICE constexpr dual_quaternion<T>& operator*=(const T& value) noexcept {
+		this->real_part *= value;
+		this->dual_part *= value;
+		return *this;
+	}
+
+	// The nearest unit dual quaternion: the real part scaled to unit norm and
+	// the part of the dual part along it removed, so that r . d = 0
+	STEPHAN_HOST_DEVICE dual_quaternion<T> normalize() const noexcept {
+		T scale = T(1) / this->real_part.norm();
+		quaternion<T> real = this->real_part * scale;
+		quaternion<T> dual = this->dual_part * scale;
+		dual_quaternion result(real, dual - (real * dot(real, dual)));
+		STEPHAN_INSTRUMENT(dual_quaternion, normalize, result);
+		return result;
+	}
+
+	// Rigid transform of a point, the rotation first: for a unit dual
+	// quaternion this is q * (1 + e p) * q.full_conjugate()
+	STEPHAN_HOST_DEVICE constexpr vec3<T> transform(const vec3<T>& p) const noexcept {
+		return this->real_part.rotate(p) + this->translation();
+	}
+	// Rotation only, for directions such as normals
+	STEPHAN_HOST_DEVICE constexpr vec3<T> rotate(const vec3<T>& v) const noexcept {
+		return this->real_part.rotate(v);
+	}
+};
+
+template <typename T>
+STEPHAN_HOST_DEVICE constexpr dual_quaternion<T> operator*(const T& value, const dual_quaternion<T>& rhs) noexcept {
+	return rhs * value;
+}
+
+// Inverse of a unit dual quaternion, the inverse transform
+template <typename T>
+STEPHAN_HOST_DEVICE constexpr dual_quaternion<T> inverse(const dual_quaternion<T>& value) noexcept {
+	return value.conjugate();
+}
+
+template <typename T>
+dual_quaternion<T> dlb(const dual_quaternion<T>& a, const dual_quaternion<T>& b, T t) {
+	static_assert(std::is_floating_point<T>::value);
+	T sign = (dot(a.real(), b.real()) < T(0)) ? T(-1) : T(1);
+	return ((a * (T(1) - t)) + (b * (sign * t))).normalize();
+}
+
+// The normalized sum of weights[n] * values[n]
+template <typename T>
+dual_quaternion<T> dlb(std::span<const dual_quaternion<T>> values, std::span<const std::type_identity_t<T>> weights) {
+	static_assert(std::is_floating_point<T>::value);
+	assert((values.size() == weights.size()) && !values.empty());
+	dual_quaternion<T> sum;
+	for (std::size_t n = 0; n < values.size(); ++n) {
+		T sign = (dot(values[0].real(), values[n].real()) < T(0)) ? T(-1) : T(1);
+		sum += values[n] * (sign * weights[n]);
+	}
+	return sum.normalize();
+}
+
+// a * (a^-1 b)^t. The relative transform is a rotation by 2h about an axis l
+// together with a translation. Along the screw, the rotation is taken to t
+// of its angle and the translation along l to t of its length, while the
+// part of the translation across l, which comes from the rotation about an
+// axis off the origin, turns with the rotation and scales by
+// sin(t h) / sin(h). Written that way there is no division by sin(h), and
+// the pure translation (h = 0) is not a special case.
+template <typename T>
+dual_quaternion<T> sclerp(const dual_quaternion<T>& a, const dual_quaternion<T>& b, T t) {
+	static_assert(std::is_floating_point<T>::value);
+	dual_quaternion<T> target = (dot(a.real(), b.real()) < T(0)) ? -b : b;
+	dual_quaternion<T> relative = a.conjugate() * target;
+	quaternion<T> rotation = relative.real();
+	vec3<T> translation = relative.translation();
+
+	vec3<T> vector{ rotation.Im1(), rotation.Im2(), rotation.Im3() };
+	T sine = std::sqrt(dot(vector, vector));
+	T angle = std::atan2(sine, rotation.Re());
+	if (sine == T(0)) {
+		return a * dual_quaternion<T>::from_translation(translation * t);
+	}
+	vec3<T> axis = vector * (T(1) / sine);
+	vec3<T> along = axis * dot(axis, translation);
+	vec3<T> across = translation - along;
+	T turn = (t - T(1)) * angle * T(0.5);
+	quaternion<T> correction(std::cos(turn), axis.x * std::sin(turn), axis.y * std::sin(turn), axis.z * std::sin(turn));
+	vec3<T> moved = (along * t) + (correction.rotate(across) * (std::sin(t * angle) / sine));
+	quaternion<T> turned(std::cos(t * angle), axis.x * std::sin(t * angle), axis.y * std::sin(t * angle), axis.z * std::sin(t * angle));
+	return a * dual_quaternion<T>::from_rotation_translation(turned, moved);
+}
+
+// Layout guarantees.
+// dual_quaternion<T> is the real quaternion followed by the dual one, eight
+// densely packed T, so that arrays of it can be seen as T[8] records.
+static_assert(std::is_trivially_copyable<dual_quaternion<float>>::value);
+static_assert(std::is_trivially_copyable<dual_quaternion<double>>::value);
+static_assert(std::is_standard_layout<dual_quaternion<float>>::value);
+static_assert(std::is_standard_layout<dual_quaternion<double>>::value);
+static_assert(sizeof(dual_quaternion<float>) == 8 * sizeof(float));
+static_assert(sizeof(dual_quaternion<double>) == 8 * sizeof(double));
+
+}
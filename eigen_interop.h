@@ -0,0 +1,71 @@
+/*
+Copyright (c) 2022, Dean Stephan
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of {{ project }} nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Provide views of Eigen::Quaternion arrays as quaternion<T>
+// Eigen::Quaternion stores its coefficients real part last, (x, y, z, w),
+// so an array of them is seen through a quaternion_view (see interop.h)
+// that reorders the components on each access rather than by copying:
+//      std::vector<Eigen::Quaternionf> poses = ...;
+//      auto view = Stephan::as_quaternions(std::span(poses));
+//      view[n] = correction * view[n];
+// This header includes <Eigen/Geometry> and is only for code that already
+// depends on Eigen; the rest of the library does not.
+#pragma once
+
+#include <span>
+
+#include <Eigen/Geometry>
+
+#include "interop.h"
+#include "quaternions.h"
+
+namespace Stephan {
+
+template <typename T, int Options>
+quaternion_view<T, component_order::xyzw> as_quaternions(std::span<Eigen::Quaternion<T, Options>> values) noexcept {
+	static_assert(sizeof(Eigen::Quaternion<T, Options>) == 4 * sizeof(T));
+	return quaternion_view<T, component_order::xyzw>(values.empty() ? nullptr : values.data()->coeffs().data(), values.size());
+}
+template <typename T, int Options>
+quaternion_view<const T, component_order::xyzw> as_quaternions(std::span<const Eigen::Quaternion<T, Options>> values) noexcept {
+	static_assert(sizeof(Eigen::Quaternion<T, Options>) == 4 * sizeof(T));
+	return quaternion_view<const T, component_order::xyzw>(values.empty() ? nullptr : values.data()->coeffs().data(), values.size());
+}
+
+template <typename T>
+quaternion<T> from_eigen(const Eigen::Quaternion<T>& value) noexcept {
+	return quaternion<T>(value.w(), value.x(), value.y(), value.z());
+}
+template <typename T>
+Eigen::Quaternion<T> to_eigen(const quaternion<T>& value) noexcept {
+	return Eigen::Quaternion<T>(value.Re(), value.Im1(), value.Im2(), value.Im3());
+}
+
+}
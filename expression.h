@@ -0,0 +1,367 @@
+/*
+Copyright (c) 2022, Dean Stephan
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of {{ project }} nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Provide lazy evaluation of chained complex and quaternion arithmetic
+// The operators of complex<T> and quaternion<T> evaluate at once, so
+//      a * b + c * d - e
+// builds every intermediate value. Wrapping the first operand in lazy()
+// builds an expression tree instead, which is evaluated in one go when it
+// is assigned:
+//      quaternion<T> r = lazy(a) * b + c * d - e;
+// Over quaternion_soa<T> containers the operators are always lazy, and
+// assigning the expression to a container runs a single fused loop on the
+// batch kernels (see simd.h), without storing any intermediate lanes:
+//      out = qa * qb + qc;
+//      out = (qa * q - lazy(qb).conjugate()) * T(0.5);
+// Operands may be expressions, quaternion_soa<T> containers, single
+// complex<T> or quaternion<T> values (used for every element) and real
+// scalars. The operations are
+//      + - *           between two operands of the same algebra
+//      + - * /         with a real scalar (/ only with the scalar on the right)
+//      -e, e.conjugate()
+//
+// An expression refers to the containers it was built from, so they must
+// outlive it; single values and scalars are copied into it. out may be one
+// of the containers of the expression, since every element is read before
+// it is written.
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <type_traits>
+
+#include "complex.h"
+#include "quaternion_soa.h"
+#include "quaternions.h"
+#include "simd.h"
+
+namespace Stephan {
+namespace detail {
+
+enum class lazy_operation {
+	add,
+	subtract,
+	multiply,
+	negate,
+	conjugate
+};
+
+// Leaf: one value of the algebra, the same for every element
+template <typename T, std::size_t N>
+struct lazy_constant {
+	typedef T scalar_type;
+	static constexpr std::size_t dimension = N;
+	static constexpr std::size_t inputs = 0;
+
+	T		value[N];
+
+	std::size_t size() const { return 0; }
+	void collect(const T**) const {}
+};
+
+// Leaf: N component lanes of count elements
+template <typename T, std::size_t N>
+struct lazy_lanes {
+	typedef T scalar_type;
+	static constexpr std::size_t dimension = N;
+	static constexpr std::size_t inputs = N;
+
+	const T*	lane[N];
+	std::size_t	count;
+
+	std::size_t size() const { return count; }
+	void collect(const T** in) const {
+		for (std::size_t k = 0; k < N; ++k) {
+			in[k] = lane[k];
+		}
+	}
+};
+
+template <lazy_operation Operation, typename L, typename R>
+struct lazy_binary {
+	static_assert(std::is_same<typename L::scalar_type, typename R::scalar_type>::value, "operands of different scalar types");
+	static_assert(L::dimension == R::dimension, "operands of different algebras");
+	typedef typename L::scalar_type scalar_type;
+	static constexpr std::size_t dimension = L::dimension;
+	static constexpr std::size_t inputs = L::inputs + R::inputs;
+
+	L		lhs;
+	R		rhs;
+
+	std::size_t size() const {
+		assert((lhs.size() == 0) || (rhs.size() == 0) || (lhs.size() == rhs.size()));
+		return (lhs.size() != 0) ? lhs.size() : rhs.size();
+	}
+	void collect(const scalar_type** in) const {
+		lhs.collect(in);
+		rhs.collect(in + L::inputs);
+	}
+};
+
+template <lazy_operation Operation, typename E>
+struct lazy_unary {
+	typedef typename E::scalar_type scalar_type;
+	static constexpr std::size_t dimension = E::dimension;
+	static constexpr std::size_t inputs = E::inputs;
+
+	E		operand;
+
+	std::size_t size() const { return operand.size(); }
+	void collect(const scalar_type** in) const { operand.collect(in); }
+};
+
+// operand * factor + shift, where shift only touches the real part
+template <typename E>
+struct lazy_affine {
+	typedef typename E::scalar_type scalar_type;
+	static constexpr std::size_t dimension = E::dimension;
+	static constexpr std::size_t inputs = E::inputs;
+
+	E		operand;
+	scalar_type	factor;
+	scalar_type	shift;
+
+	std::size_t size() const { return operand.size(); }
+	void collect(const scalar_type** in) const { operand.collect(in); }
+};
+
+}
+}
+
+#define STEPHAN_SIMD_KERNELS "expression_kernels.h"
+#include "simd_foreach.h"
+
+namespace Stephan {
+
+template <typename Node>
+class expression;
+
+namespace detail {
+
+template <typename T, std::size_t N>
+struct lazy_result;
+template <typename T>
+struct lazy_result<T, 2> { typedef complex<T> type; };
+template <typename T>
+struct lazy_result<T, 4> { typedef quaternion<T> type; };
+
+// How each kind of operand enters an expression tree
+template <typename X>
+struct lazy_node;
+template <typename Node>
+struct lazy_node<expression<Node>> {
+	typedef Node type;
+	static const Node& make(const expression<Node>& value) { return value.node(); }
+};
+template <typename T>
+struct lazy_node<complex<T>> {
+	typedef lazy_constant<T, 2> type;
+	static type make(const complex<T>& value) { return type{ { value.Re(), value.Im() } }; }
+};
+template <typename T>
+struct lazy_node<quaternion<T>> {
+	typedef lazy_constant<T, 4> type;
+	static type make(const quaternion<T>& value) { return type{ { value.Re(), value.Im1(), value.Im2(), value.Im3() } }; }
+};
+template <typename T>
+struct lazy_node<quaternion_soa<T>> {
+	typedef lazy_lanes<T, 4> type;
+	static type make(const quaternion_soa<T>& values) {
+		return type{ { values.Re().data(), values.Im1().data(), values.Im2().data(), values.Im3().data() }, values.size() };
+	}
+};
+
+template <typename X>
+concept lazy_operand = requires { typename lazy_node<X>::type; };
+
+// The operators below are only picked up when at least one side is already
+// lazy, so that the eager operators of complex<T> and quaternion<T> stay
+// as they are
+template <typename X>
+inline constexpr bool is_lazy = false;
+template <typename Node>
+inline constexpr bool is_lazy<expression<Node>> = true;
+template <typename T>
+inline constexpr bool is_lazy<quaternion_soa<T>> = true;
+
+template <typename L, typename R>
+concept lazy_operands = lazy_operand<L> && lazy_operand<R> && (is_lazy<L> || is_lazy<R>);
+
+template <lazy_operation Operation, typename L, typename R>
+expression<lazy_binary<Operation, typename lazy_node<L>::type, typename lazy_node<R>::type>> make_binary(const L& lhs, const R& rhs) {
+	typedef lazy_binary<Operation, typename lazy_node<L>::type, typename lazy_node<R>::type> node_type;
+	return expression<node_type>(node_type{ lazy_node<L>::make(lhs), lazy_node<R>::make(rhs) });
+}
+template <typename X>
+expression<lazy_affine<typename lazy_node<X>::type>> make_affine(const X& operand, typename lazy_node<X>::type::scalar_type factor, typename lazy_node<X>::type::scalar_type shift) {
+	typedef lazy_affine<typename lazy_node<X>::type> node_type;
+	return expression<node_type>(node_type{ lazy_node<X>::make(operand), factor, shift });
+}
+
+}
+
+template <typename Node>
+class expression {
+public:
+	typedef typename Node::scalar_type scalar_type;
+	static constexpr std::size_t dimension = Node::dimension;
+	typedef typename detail::lazy_result<scalar_type, dimension>::type value_type;
+
+private:
+	Node	node_part;
+
+public:
+	explicit expression(const Node& _node_part)
+		: node_part(_node_part)
+	{}
+
+	const Node& node() const { return node_part; }
+
+	// Number of elements, or 0 when the expression only holds single values
+	std::size_t size() const { return this->node_part.size(); }
+
+	// Evaluate an expression of single values
+	value_type evaluate() const {
+		static_assert(Node::inputs == 0, "an expression over containers has no single value, assign it to a container");
+		scalar_type result[dimension];
+		simd::scalar::lazy_evaluate_value<scalar_type>(this->node_part, result);
+		if constexpr (dimension == 2) {
+			return value_type(result[0], result[1]);
+		}
+		else {
+			return value_type(result[0], result[1], result[2], result[3]);
+		}
+	}
+	operator value_type() const requires (Node::inputs == 0) { return this->evaluate(); }
+
+	expression<detail::lazy_unary<detail::lazy_operation::conjugate, Node>> conjugate() const {
+		typedef detail::lazy_unary<detail::lazy_operation::conjugate, Node> node_type;
+		return expression<node_type>(node_type{ this->node_part });
+	}
+	expression<detail::lazy_unary<detail::lazy_operation::negate, Node>> operator-() const {
+		typedef detail::lazy_unary<detail::lazy_operation::negate, Node> node_type;
+		return expression<node_type>(node_type{ this->node_part });
+	}
+};
+
+// Start a lazy expression from a single value or a container
+template <typename T>
+expression<detail::lazy_constant<T, 2>> lazy(const complex<T>& value) {
+	return expression<detail::lazy_constant<T, 2>>(detail::lazy_node<complex<T>>::make(value));
+}
+template <typename T>
+expression<detail::lazy_constant<T, 4>> lazy(const quaternion<T>& value) {
+	return expression<detail::lazy_constant<T, 4>>(detail::lazy_node<quaternion<T>>::make(value));
+}
+template <typename T>
+expression<detail::lazy_lanes<T, 4>> lazy(const quaternion_soa<T>& values) {
+	return expression<detail::lazy_lanes<T, 4>>(detail::lazy_node<quaternion_soa<T>>::make(values));
+}
+
+template <typename T>
+auto operator-(const quaternion_soa<T>& values) {
+	return -lazy(values);
+}
+
+template <typename L, typename R>
+	requires detail::lazy_operands<L, R>
+auto operator+(const L& lhs, const R& rhs) {
+	return detail::make_binary<detail::lazy_operation::add>(lhs, rhs);
+}
+template <typename L, typename R>
+	requires detail::lazy_operands<L, R>
+auto operator-(const L& lhs, const R& rhs) {
+	return detail::make_binary<detail::lazy_operation::subtract>(lhs, rhs);
+}
+template <typename L, typename R>
+	requires detail::lazy_operands<L, R>
+auto operator*(const L& lhs, const R& rhs) {
+	return detail::make_binary<detail::lazy_operation::multiply>(lhs, rhs);
+}
+
+// With a real scalar
+template <typename X>
+	requires detail::is_lazy<X>
+auto operator*(const X& lhs, typename detail::lazy_node<X>::type::scalar_type value) {
+	return detail::make_affine(lhs, value, 0);
+}
+template <typename X>
+	requires detail::is_lazy<X>
+auto operator*(typename detail::lazy_node<X>::type::scalar_type value, const X& rhs) {
+	return detail::make_affine(rhs, value, 0);
+}
+template <typename X>
+	requires detail::is_lazy<X>
+auto operator/(const X& lhs, typename detail::lazy_node<X>::type::scalar_type value) {
+	return detail::make_affine(lhs, 1 / value, 0);
+}
+template <typename X>
+	requires detail::is_lazy<X>
+auto operator+(const X& lhs, typename detail::lazy_node<X>::type::scalar_type value) {
+	return detail::make_affine(lhs, 1, value);
+}
+template <typename X>
+	requires detail::is_lazy<X>
+auto operator+(typename detail::lazy_node<X>::type::scalar_type value, const X& rhs) {
+	return detail::make_affine(rhs, 1, value);
+}
+template <typename X>
+	requires detail::is_lazy<X>
+auto operator-(const X& lhs, typename detail::lazy_node<X>::type::scalar_type value) {
+	return detail::make_affine(lhs, 1, -value);
+}
+template <typename X>
+	requires detail::is_lazy<X>
+auto operator-(typename detail::lazy_node<X>::type::scalar_type value, const X& rhs) {
+	return detail::make_affine(rhs, -1, value);
+}
+
+// Evaluate an expression over containers into out in one pass. out is
+// resized to the size of the expression.
+template <typename T, typename Node>
+void evaluate(const expression<Node>& value, quaternion_soa<T>& out) {
+	static_assert(std::is_same<T, typename Node::scalar_type>::value);
+	static_assert(Node::dimension == 4, "only quaternion expressions can be stored in a quaternion_soa");
+	static_assert(Node::inputs > 0, "the expression holds no container, so its size is unknown");
+	std::size_t count = value.size();
+	const T* in[Node::inputs];
+	value.node().collect(in);
+	detail::quaternion_output_lanes<T> result(out, count);
+	STEPHAN_SIMD_DISPATCH(lazy_assign<T>(count, value.node(), in, result.out));
+}
+
+template <typename T>
+template <typename Node>
+quaternion_soa<T>& quaternion_soa<T>::operator=(const expression<Node>& value) {
+	evaluate(value, *this);
+	return *this;
+}
+
+}
@@ -0,0 +1,142 @@
+/*
+Copyright (c) 2022, Dean Stephan
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of {{ project }} nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Provide the evaluation kernels behind expression.h
+// This file is included once per SIMD target through simd_foreach.h and
+// must not be included directly. lazy_evaluator<Node, Base> evaluates one
+// node of the expression tree on vec<T> lanes; Base is the index of the
+// node's first container lane among the inputs of the whole tree.
+
+template <typename T, std::size_t N>
+struct lazy_value {
+	vec<T>	c[N];
+};
+
+template <typename T, std::size_t N>
+STEPHAN_FORCE_INLINE lazy_value<T, N> lazy_product(const lazy_value<T, N>& a, const lazy_value<T, N>& b) {
+	lazy_value<T, N> r;
+	product_lanes<T, N>(a.c, b.c, r.c);
+	return r;
+}
+
+template <typename Node, std::size_t Base>
+struct lazy_evaluator;
+
+template <typename T, std::size_t N, std::size_t Base>
+struct lazy_evaluator<::Stephan::detail::lazy_constant<T, N>, Base> {
+	static STEPHAN_FORCE_INLINE lazy_value<T, N> evaluate(const ::Stephan::detail::lazy_constant<T, N>& node, const T* const*, std::size_t) {
+		lazy_value<T, N> r;
+		for (std::size_t k = 0; k < N; ++k) {
+			r.c[k] = broadcast(node.value[k]);
+		}
+		return r;
+	}
+};
+
+template <typename T, std::size_t N, std::size_t Base>
+struct lazy_evaluator<::Stephan::detail::lazy_lanes<T, N>, Base> {
+	static STEPHAN_FORCE_INLINE lazy_value<T, N> evaluate(const ::Stephan::detail::lazy_lanes<T, N>&, const T* const* x, std::size_t offset) {
+		lazy_value<T, N> r;
+		for (std::size_t k = 0; k < N; ++k) {
+			r.c[k] = load(x[Base + k] + offset);
+		}
+		return r;
+	}
+};
+
+template <::Stephan::detail::lazy_operation Operation, typename L, typename R, std::size_t Base>
+struct lazy_evaluator<::Stephan::detail::lazy_binary<Operation, L, R>, Base> {
+	typedef typename L::scalar_type T;
+	static constexpr std::size_t N = L::dimension;
+
+	static STEPHAN_FORCE_INLINE lazy_value<T, N> evaluate(const ::Stephan::detail::lazy_binary<Operation, L, R>& node, const T* const* x, std::size_t offset) {
+		lazy_value<T, N> a = lazy_evaluator<L, Base>::evaluate(node.lhs, x, offset);
+		lazy_value<T, N> b = lazy_evaluator<R, Base + L::inputs>::evaluate(node.rhs, x, offset);
+		if constexpr (Operation == ::Stephan::detail::lazy_operation::multiply) {
+			return lazy_product<T, N>(a, b);
+		}
+		else {
+			for (std::size_t k = 0; k < N; ++k) {
+				a.c[k] = (Operation == ::Stephan::detail::lazy_operation::add) ? a.c[k] + b.c[k] : a.c[k] - b.c[k];
+			}
+			return a;
+		}
+	}
+};
+
+template <::Stephan::detail::lazy_operation Operation, typename E, std::size_t Base>
+struct lazy_evaluator<::Stephan::detail::lazy_unary<Operation, E>, Base> {
+	typedef typename E::scalar_type T;
+	static constexpr std::size_t N = E::dimension;
+
+	static STEPHAN_FORCE_INLINE lazy_value<T, N> evaluate(const ::Stephan::detail::lazy_unary<Operation, E>& node, const T* const* x, std::size_t offset) {
+		lazy_value<T, N> a = lazy_evaluator<E, Base>::evaluate(node.operand, x, offset);
+		std::size_t first = (Operation == ::Stephan::detail::lazy_operation::negate) ? 0 : 1;
+		for (std::size_t k = first; k < N; ++k) {
+			a.c[k] = -a.c[k];
+		}
+		return a;
+	}
+};
+
+template <typename E, std::size_t Base>
+struct lazy_evaluator<::Stephan::detail::lazy_affine<E>, Base> {
+	typedef typename E::scalar_type T;
+	static constexpr std::size_t N = E::dimension;
+
+	static STEPHAN_FORCE_INLINE lazy_value<T, N> evaluate(const ::Stephan::detail::lazy_affine<E>& node, const T* const* x, std::size_t offset) {
+		lazy_value<T, N> a = lazy_evaluator<E, Base>::evaluate(node.operand, x, offset);
+		vec<T> factor = broadcast(node.factor);
+		a.c[0] = (a.c[0] * factor) + broadcast(node.shift);
+		for (std::size_t k = 1; k < N; ++k) {
+			a.c[k] = a.c[k] * factor;
+		}
+		return a;
+	}
+};
+
+// Expression of single values (only instantiated for the scalar target)
+template <typename T, typename Node>
+STEPHAN_FORCE_INLINE void lazy_evaluate_value(const Node& node, T* result) {
+	lazy_value<T, Node::dimension> r = lazy_evaluator<Node, 0>::evaluate(node, nullptr, 0);
+	for (std::size_t k = 0; k < Node::dimension; ++k) {
+		result[k] = r.c[k];
+	}
+}
+
+template <typename T, typename Node>
+void lazy_assign(std::size_t n, const Node& node, const T* const (&in)[Node::inputs], T* const (&out)[Node::dimension]) {
+	for_each_block(n, in, out, [&node](const T* const* x, T* const* result, std::size_t offset) {
+		lazy_value<T, Node::dimension> r = lazy_evaluator<Node, 0>::evaluate(node, x, offset);
+		for (std::size_t k = 0; k < Node::dimension; ++k) {
+			store(result[k] + offset, r.c[k]);
+		}
+	});
+}
@@ -0,0 +1,597 @@
+/*
+Copyright (c) 2022, Dean Stephan
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of {{ project }} nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Provide fast Fourier transforms over arrays of complex numbers
+// A plan holds everything about a transform size that can be computed in
+// advance, the factorisation and every twiddle factor, so a transform is
+// only the butterfly passes:
+//      fft_plan<float> plan(1024);
+//      plan.forward(in, out);              out[k] = sum_n in[n] exp(-2 pi i k n / N)
+//      plan.inverse(out, in);              in[n] = 1/N sum_k out[k] exp(2 pi i k n / N)
+//      plan.forward(data);                 the same, in place
+// so inverse(forward(x)) gives back x. Any size is accepted: N is split
+// into stages of radix 4, 2, 3 and 5, in that order, and any other prime
+// factor p becomes a stage of direct p-point transforms, which costs p
+// operations per value rather than log p. The stages are Stockham passes,
+// which sort the output as they go, so there is no bit reversal step; the
+// radix 2, 3, 4 and 5 butterflies run on the SIMD kernels (see simd.h).
+// out may be the same span as in, but not otherwise overlap it.
+//
+// For real input of size N the spectrum is Hermitian, and only its first
+// N / 2 + 1 values are computed:
+//      real_fft_plan<float> plan(1024);
+//      plan.forward(samples, spectrum);    spectrum.size() == 513
+//      plan.inverse(spectrum, samples);
+// For even N this packs the samples in pairs into a complex transform of
+// half the size, which takes a third to a half less time than
+// transforming them as complex values. The imaginary parts of spectrum[0] and, for even N,
+// spectrum[N / 2] are zero on the way out and ignored on the way in.
+//
+// Transforms of fft_parallel_size values or more spread every stage over
+// a thread_pool (see parallel.h). Each value is computed the same way
+// whatever the number of threads, so the results do not depend on it.
+//
+// Building a plan is much slower than using it. An fft_planner keeps the
+// plans it has built, by size, for as long as it lives, and hands the same
+// plan to every caller; the free functions use fft_planner<T>::shared():
+//      fft<float>(in, out);                ifft<float>(in, out);
+//      rfft<float>(samples, spectrum);     irfft<float>(spectrum, samples);
+// Plans are immutable once built, so one plan may be used from any number
+// of threads at once.
+//
+// fft2_plan<T> transforms a row-major image of rows x columns values, as
+// 1-D transforms of every row and then of every column, with the rows
+// (and columns) spread over the thread_pool. fft_fast_size(n) is the
+// smallest size from n up with no prime factor above 5, the sizes the
+// SIMD butterflies cover, for padding data that can be padded.
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <numbers>
+#include <span>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include "complex.h"
+#include "inplace.h"
+#include "parallel.h"
+#include "simd.h"
+
+#define STEPHAN_SIMD_KERNELS "fft_kernels.h"
+#include "simd_foreach.h"
+
+namespace Stephan {
+
+// Transforms from this size up run their stages on a thread_pool
+inline constexpr std::size_t fft_parallel_size = std::size_t(1) << 16;
+
+namespace detail {
+
+// Values per thread task within a stage
+inline constexpr std::size_t fft_task_size = std::size_t(1) << 13;
+
+// Stages of a shorter stride than this, the widest vector of float, also
+// keep their twiddles spread out for the kernels
+inline constexpr std::size_t fft_spread_stride = 16;
+
+// exp(sign 2 pi i numerator / denominator), computed in long double so
+// that the rounding of the angle does not grow with the size
+template <typename T>
+complex<T> fft_root(std::size_t numerator, std::size_t denominator, bool inverse) {
+	long double angle = (2 * std::numbers::pi_v<long double> * static_cast<long double>(numerator % denominator)) / static_cast<long double>(denominator);
+	if (!inverse) {
+		angle = -angle;
+	}
+	return complex<T>(static_cast<T>(std::cos(angle)), static_cast<T>(std::sin(angle)));
+}
+
+inline std::vector<std::size_t> fft_factors(std::size_t n) {
+	std::vector<std::size_t> factors;
+	for (std::size_t radix : { 4, 2, 3, 5 }) {
+		while ((n % radix) == 0) {
+			factors.push_back(radix);
+			n /= radix;
+		}
+	}
+	for (std::size_t p = 7; n > 1; p += 2) {
+		while ((n % p) == 0) {
+			factors.push_back(p);
+			n /= p;
+		}
+		if (p * p > n) {
+			if (n > 1) {
+				factors.push_back(n);
+			}
+			break;
+		}
+	}
+	return factors;
+}
+
+template <typename T>
+const T* fft_data(const complex<T>* values) { return reinterpret_cast<const T*>(values); }
+template <typename T>
+T* fft_data(complex<T>* values) { return reinterpret_cast<T*>(values); }
+
+}
+
+template <typename T>
+class fft_plan {
+private:
+	static_assert(std::is_floating_point<T>::value);
+
+	// A pass of radix P over m groups of stride s, P m s == N
+	struct stage {
+		std::size_t			radix;
+		std::size_t			m;
+		std::size_t			s;
+		// [inverse][(q - 1) m + j] = root of P m raised to q j
+		std::vector<complex<T>>		twiddles[2];
+		// [inverse][(q - 1) m s + t] = twiddles[inverse][(q - 1) m + t / s],
+		// for strides shorter than a vector
+		std::vector<complex<T>>		spread[2];
+		// [inverse][r] = root of P raised to r
+		std::vector<complex<T>>		roots[2];
+	};
+
+	std::size_t		length;
+	std::vector<stage>	stages;
+
+	template <bool Inverse>
+	void run_stage(const stage& pass, std::size_t j_first, std::size_t j_last, std::size_t k_first, std::size_t k_last, const complex<T>* x, complex<T>* y) const {
+		const T* twiddles = detail::fft_data(pass.twiddles[Inverse].data());
+		const T* spread = pass.spread[Inverse].empty() ? nullptr : detail::fft_data(pass.spread[Inverse].data());
+		const T* roots = detail::fft_data(pass.roots[Inverse].data());
+		const T* in = detail::fft_data(x);
+		T* out = detail::fft_data(y);
+		switch (pass.radix) {
+		case 2:
+			STEPHAN_SIMD_DISPATCH(fft_stage<T, 2, Inverse>(pass.m, pass.s, j_first, j_last, k_first, k_last, in, out, twiddles, spread, roots));
+			break;
+		case 3:
+			STEPHAN_SIMD_DISPATCH(fft_stage<T, 3, Inverse>(pass.m, pass.s, j_first, j_last, k_first, k_last, in, out, twiddles, spread, roots));
+			break;
+		case 4:
+			STEPHAN_SIMD_DISPATCH(fft_stage<T, 4, Inverse>(pass.m, pass.s, j_first, j_last, k_first, k_last, in, out, twiddles, spread, roots));
+			break;
+		case 5:
+			STEPHAN_SIMD_DISPATCH(fft_stage<T, 5, Inverse>(pass.m, pass.s, j_first, j_last, k_first, k_last, in, out, twiddles, spread, roots));
+			break;
+		default:
+			this->run_direct<Inverse>(pass, j_first, j_last, k_first, k_last, x, y);
+			break;
+		}
+	}
+
+	// A stage of any prime radix, as direct P-point transforms
+	template <bool Inverse>
+	void run_direct(const stage& pass, std::size_t j_first, std::size_t j_last, std::size_t k_first, std::size_t k_last, const complex<T>* x, complex<T>* y) const {
+		std::size_t P = pass.radix, m = pass.m, s = pass.s;
+		const std::vector<complex<T>>& roots = pass.roots[Inverse];
+		const std::vector<complex<T>>& twiddles = pass.twiddles[Inverse];
+		for (std::size_t j = j_first; j < j_last; ++j) {
+			for (std::size_t k = k_first; k < k_last; ++k) {
+				for (std::size_t q = 0; q < P; ++q) {
+					complex<T> sum = x[k + (s * j)];
+					for (std::size_t r = 1; r < P; ++r) {
+						sum += x[k + (s * (j + (r * m)))] * roots[(r * q) % P];
+					}
+					if (q > 0) {
+						sum *= twiddles[((q - 1) * m) + j];
+					}
+					y[k + (s * ((P * j) + q))] = sum;
+				}
+			}
+		}
+	}
+
+	template <bool Inverse>
+	void execute(const complex<T>* in, complex<T>* out, thread_pool& pool) const {
+		if (this->length == 1) {
+			out[0] = in[0];
+			return;
+		}
+		thread_local std::vector<complex<T>> scratch;
+		scratch.resize(this->length);
+
+		// The passes alternate between out and scratch so that the last one
+		// writes out; in place, the first pass would then read and write out,
+		// so the input is moved to scratch first
+		std::size_t count = this->stages.size();
+		const complex<T>* source = in;
+		if ((in == out) && (((count - 1) % 2) == 0)) {
+			std::copy(in, in + this->length, scratch.data());
+			source = scratch.data();
+		}
+		bool threaded = (this->length >= fft_parallel_size) && (pool.size() > 1);
+		for (std::size_t n = 0; n < count; ++n) {
+			const stage& pass = this->stages[n];
+			complex<T>* destination = (((count - 1 - n) % 2) == 0) ? out : scratch.data();
+			if (!threaded) {
+				this->run_stage<Inverse>(pass, 0, pass.m, 0, pass.s, source, destination);
+			}
+			else if (pass.m >= pass.s) {
+				std::size_t chunk = std::max<std::size_t>(1, detail::fft_task_size / (pass.s * pass.radix));
+				pool.run((pass.m + chunk - 1) / chunk, [&](std::size_t task) {
+					std::size_t first = task * chunk;
+					this->run_stage<Inverse>(pass, first, std::min(pass.m, first + chunk), 0, pass.s, source, destination);
+				});
+			}
+			else {
+				// Few groups of long strides: split the strides instead, in
+				// whole cache lines
+				std::size_t chunk = std::max<std::size_t>(64, ((detail::fft_task_size / (pass.m * pass.radix)) / 64) * 64);
+				pool.run((pass.s + chunk - 1) / chunk, [&](std::size_t task) {
+					std::size_t first = task * chunk;
+					this->run_stage<Inverse>(pass, 0, pass.m, first, std::min(pass.s, first + chunk), source, destination);
+				});
+			}
+			source = destination;
+		}
+
+		if constexpr (Inverse) {
+			std::span<complex<T>> result(out, this->length);
+			T scale = T(1) / static_cast<T>(this->length);
+			pool.run(threaded ? detail::parallel_blocks(this->length) : 1, [&](std::size_t block) {
+				scale_inplace<T>(threaded ? detail::parallel_block(result, block) : result, scale);
+			});
+		}
+	}
+
+public:
+	explicit fft_plan(std::size_t size)
+		: length(size)
+	{
+		assert(size > 0);
+		std::size_t s = 1;
+		for (std::size_t radix : detail::fft_factors(size)) {
+			stage pass;
+			pass.radix = radix;
+			pass.m = size / (s * radix);
+			pass.s = s;
+			std::size_t span = radix * pass.m;
+			for (bool inverse : { false, true }) {
+				pass.roots[inverse].resize(radix);
+				for (std::size_t r = 0; r < radix; ++r) {
+					pass.roots[inverse][r] = detail::fft_root<T>(r, radix, inverse);
+				}
+				pass.twiddles[inverse].resize((radix - 1) * pass.m);
+				for (std::size_t q = 1; q < radix; ++q) {
+					for (std::size_t j = 0; j < pass.m; ++j) {
+						pass.twiddles[inverse][((q - 1) * pass.m) + j] = detail::fft_root<T>(q * j, span, inverse);
+					}
+				}
+				if ((s > 1) && (s < detail::fft_spread_stride)) {
+					pass.spread[inverse].resize((radix - 1) * pass.m * s);
+					for (std::size_t n = 0; n < pass.spread[inverse].size(); ++n) {
+						std::size_t q = n / (pass.m * s), t = n % (pass.m * s);
+						pass.spread[inverse][n] = pass.twiddles[inverse][(q * pass.m) + (t / s)];
+					}
+				}
+			}
+			this->stages.push_back(std::move(pass));
+			s *= radix;
+		}
+	}
+
+	std::size_t size() const noexcept { return this->length; }
+
+	void forward(std::span<const complex<T>> in, std::span<complex<T>> out, thread_pool& pool = thread_pool::shared()) const {
+		assert((in.size() == this->length) && (out.size() == this->length));
+		this->execute<false>(in.data(), out.data(), pool);
+	}
+	void forward(std::span<complex<T>> data, thread_pool& pool = thread_pool::shared()) const {
+		assert(data.size() == this->length);
+		this->execute<false>(data.data(), data.data(), pool);
+	}
+	void inverse(std::span<const complex<T>> in, std::span<complex<T>> out, thread_pool& pool = thread_pool::shared()) const {
+		assert((in.size() == this->length) && (out.size() == this->length));
+		this->execute<true>(in.data(), out.data(), pool);
+	}
+	void inverse(std::span<complex<T>> data, thread_pool& pool = thread_pool::shared()) const {
+		assert(data.size() == this->length);
+		this->execute<true>(data.data(), data.data(), pool);
+	}
+};
+
+template <typename T>
+class real_fft_plan {
+private:
+	static_assert(std::is_floating_point<T>::value);
+
+	std::size_t		length;
+	// N / 2 points for even N, N for odd N
+	fft_plan<T>		transform;
+	// exp(-2 pi i k / N), k = 0 .. N / 2, for even N
+	std::vector<complex<T>>	twiddles;
+
+public:
+	explicit real_fft_plan(std::size_t size)
+		: length(size)
+		, transform(((size % 2) == 0) ? size / 2 : size)
+	{
+		assert(size > 0);
+		if ((size % 2) == 0) {
+			this->twiddles.resize((size / 2) + 1);
+			for (std::size_t k = 0; k <= size / 2; ++k) {
+				this->twiddles[k] = detail::fft_root<T>(k, size, false);
+			}
+		}
+	}
+
+	std::size_t size() const noexcept { return this->length; }
+	std::size_t spectrum_size() const noexcept { return (this->length / 2) + 1; }
+
+	void forward(std::span<const std::type_identity_t<T>> in, std::span<complex<T>> out, thread_pool& pool = thread_pool::shared()) const {
+		assert((in.size() == this->length) && (out.size() == this->spectrum_size()));
+		if ((this->length % 2) != 0) {
+			thread_local std::vector<complex<T>> values;
+			values.resize(this->length);
+			for (std::size_t n = 0; n < this->length; ++n) {
+				values[n] = complex<T>(in[n]);
+			}
+			this->transform.forward(values, pool);
+			std::copy(values.begin(), values.begin() + out.size(), out.begin());
+			return;
+		}
+
+		// With z[n] = in[2n] + i in[2n + 1] and Z its transform, the
+		// transforms of the even and odd samples are
+		//      E[k] = (Z[k] + conj(Z[h - k])) / 2
+		//      O[k] = (Z[k] - conj(Z[h - k])) / 2i
+		// and out[k] = E[k] + W^k O[k], out[h - k] = conj(E[k]) + W^(h - k) conj(O[k]).
+		std::size_t h = this->length / 2;
+		std::span<const complex<T>> pairs(reinterpret_cast<const complex<T>*>(in.data()), h);
+		this->transform.forward(pairs, out.first(h), pool);
+		complex<T> first = out[0];
+		out[0] = complex<T>(first.Re() + first.Im());
+		out[h] = complex<T>(first.Re() - first.Im());
+		for (std::size_t k = 1; k <= h - k; ++k) {
+			complex<T> z = out[k], mirror = out[h - k].conjugate();
+			complex<T> even = (z + mirror) * T(0.5);
+			complex<T> odd = (z - mirror) * complex<T>(0, T(-0.5));
+			out[k] = even + (this->twiddles[k] * odd);
+			if (k != h - k) {
+				out[h - k] = even.conjugate() + (this->twiddles[h - k] * odd.conjugate());
+			}
+		}
+	}
+
+	void inverse(std::span<const complex<T>> in, std::span<std::type_identity_t<T>> out, thread_pool& pool = thread_pool::shared()) const {
+		assert((in.size() == this->spectrum_size()) && (out.size() == this->length));
+		if ((this->length % 2) != 0) {
+			thread_local std::vector<complex<T>> values;
+			values.resize(this->length);
+			values[0] = complex<T>(in[0].Re());
+			for (std::size_t k = 1; k < in.size(); ++k) {
+				values[k] = in[k];
+				values[this->length - k] = in[k].conjugate();
+			}
+			this->transform.inverse(values, pool);
+			for (std::size_t n = 0; n < this->length; ++n) {
+				out[n] = values[n].Re();
+			}
+			return;
+		}
+
+		// The forward steps run backwards: Z[k] = E[k] + i O[k] with
+		//      E[k] = (in[k] + conj(in[h - k])) / 2
+		//      O[k] = (in[k] - conj(in[h - k])) W^-k / 2
+		// and the half size inverse of Z interleaves the even and odd samples
+		std::size_t h = this->length / 2;
+		std::span<complex<T>> pairs(reinterpret_cast<complex<T>*>(out.data()), h);
+		for (std::size_t k = 0; k < h; ++k) {
+			complex<T> x = in[k], mirror = in[h - k].conjugate();
+			if (k == 0) {
+				x = complex<T>(x.Re());
+				mirror = complex<T>(mirror.Re());
+			}
+			complex<T> even = (x + mirror) * T(0.5);
+			complex<T> odd = (x - mirror) * this->twiddles[k].conjugate() * T(0.5);
+			pairs[k] = even + (odd * complex<T>(0, 1));
+		}
+		this->transform.inverse(pairs, pool);
+	}
+};
+
+template <typename T>
+class fft_planner {
+private:
+	std::mutex						mutex;
+	std::unordered_map<std::size_t, std::shared_ptr<const fft_plan<T>>>	complex_plans;
+	std::unordered_map<std::size_t, std::shared_ptr<const real_fft_plan<T>>>	real_plans;
+
+	template <typename Plan>
+	std::shared_ptr<const Plan> find(std::unordered_map<std::size_t, std::shared_ptr<const Plan>>& plans, std::size_t size) {
+		std::scoped_lock lock(this->mutex);
+		std::shared_ptr<const Plan>& plan = plans[size];
+		if (!plan) {
+			plan = std::make_shared<const Plan>(size);
+		}
+		return plan;
+	}
+
+public:
+	std::shared_ptr<const fft_plan<T>> plan(std::size_t size) { return this->find(this->complex_plans, size); }
+	std::shared_ptr<const real_fft_plan<T>> real_plan(std::size_t size) { return this->find(this->real_plans, size); }
+
+	// Forget every plan; those still held by a caller stay valid
+	void clear() {
+		std::scoped_lock lock(this->mutex);
+		this->complex_plans.clear();
+		this->real_plans.clear();
+	}
+
+	static fft_planner& shared() {
+		static fft_planner planner;
+		return planner;
+	}
+};
+
+// Smallest 2^a 3^b 5^c >= n
+inline std::size_t fft_fast_size(std::size_t n) {
+	for (std::size_t size = std::max<std::size_t>(n, 1);; ++size) {
+		std::size_t rest = size;
+		for (std::size_t radix : { 2, 3, 5 }) {
+			while ((rest % radix) == 0) {
+				rest /= radix;
+			}
+		}
+		if (rest == 1) {
+			return size;
+		}
+	}
+}
+
+namespace detail {
+
+// out[c * rows + r] = in[r * columns + c], in tiles that stay in the cache
+template <typename T>
+void fft_transpose(const complex<T>* in, std::size_t rows, std::size_t columns, complex<T>* out, thread_pool& pool) {
+	constexpr std::size_t tile = 32;
+	pool.run((rows + tile - 1) / tile, [&](std::size_t task) {
+		std::size_t first = task * tile, last = std::min(rows, first + tile);
+		for (std::size_t c0 = 0; c0 < columns; c0 += tile) {
+			std::size_t c1 = std::min(columns, c0 + tile);
+			for (std::size_t r = first; r < last; ++r) {
+				for (std::size_t c = c0; c < c1; ++c) {
+					out[(c * rows) + r] = in[(r * columns) + c];
+				}
+			}
+		}
+	});
+}
+
+}
+
+template <typename T>
+class fft2_plan {
+private:
+	std::size_t				row_count;
+	std::size_t				column_count;
+	// Transforms along a row (columns values) and along a column
+	std::shared_ptr<const fft_plan<T>>	row_plan;
+	std::shared_ptr<const fft_plan<T>>	column_plan;
+
+	// count consecutive transforms of plan.size() values from in to out,
+	// which may be the same
+	template <bool Inverse>
+	static void transform_lines(const fft_plan<T>& plan, const complex<T>* in, complex<T>* out, std::size_t count, thread_pool& pool) {
+		std::size_t length = plan.size();
+		std::size_t group = std::max<std::size_t>(1, detail::fft_task_size / length);
+		pool.run((count + group - 1) / group, [&](std::size_t task) {
+			std::size_t last = std::min(count, (task + 1) * group);
+			for (std::size_t line = task * group; line < last; ++line) {
+				std::span<const complex<T>> source(in + (line * length), length);
+				std::span<complex<T>> destination(out + (line * length), length);
+				if constexpr (Inverse) {
+					plan.inverse(source, destination, pool);
+				}
+				else {
+					plan.forward(source, destination, pool);
+				}
+			}
+		});
+	}
+
+	template <bool Inverse>
+	void execute(const complex<T>* in, complex<T>* out, thread_pool& pool) const {
+		transform_lines<Inverse>(*this->row_plan, in, out, this->row_count, pool);
+		if (this->row_count == 1) {
+			return;
+		}
+		thread_local std::vector<complex<T>> transposed;
+		transposed.resize(this->row_count * this->column_count);
+		detail::fft_transpose(out, this->row_count, this->column_count, transposed.data(), pool);
+		transform_lines<Inverse>(*this->column_plan, transposed.data(), transposed.data(), this->column_count, pool);
+		detail::fft_transpose(transposed.data(), this->column_count, this->row_count, out, pool);
+	}
+
+public:
+	fft2_plan(std::size_t rows, std::size_t columns, fft_planner<T>& planner = fft_planner<T>::shared())
+		: row_count(rows)
+		, column_count(columns)
+		, row_plan(planner.plan(columns))
+		, column_plan(planner.plan(rows))
+	{
+		assert((rows > 0) && (columns > 0));
+	}
+
+	std::size_t rows() const noexcept { return this->row_count; }
+	std::size_t columns() const noexcept { return this->column_count; }
+	std::size_t size() const noexcept { return this->row_count * this->column_count; }
+
+	void forward(std::span<const complex<T>> in, std::span<complex<T>> out, thread_pool& pool = thread_pool::shared()) const {
+		assert((in.size() == this->size()) && (out.size() == this->size()));
+		this->execute<false>(in.data(), out.data(), pool);
+	}
+	void forward(std::span<complex<T>> data, thread_pool& pool = thread_pool::shared()) const {
+		assert(data.size() == this->size());
+		this->execute<false>(data.data(), data.data(), pool);
+	}
+	void inverse(std::span<const complex<T>> in, std::span<complex<T>> out, thread_pool& pool = thread_pool::shared()) const {
+		assert((in.size() == this->size()) && (out.size() == this->size()));
+		this->execute<true>(in.data(), out.data(), pool);
+	}
+	void inverse(std::span<complex<T>> data, thread_pool& pool = thread_pool::shared()) const {
+		assert(data.size() == this->size());
+		this->execute<true>(data.data(), data.data(), pool);
+	}
+};
+
+template <typename T>
+void fft(std::span<const complex<T>> in, std::span<complex<T>> out, thread_pool& pool = thread_pool::shared()) {
+	fft_planner<T>::shared().plan(in.size())->forward(in, out, pool);
+}
+
+template <typename T>
+void ifft(std::span<const complex<T>> in, std::span<complex<T>> out, thread_pool& pool = thread_pool::shared()) {
+	fft_planner<T>::shared().plan(in.size())->inverse(in, out, pool);
+}
+
+// out.size() == in.size() / 2 + 1
+template <typename T>
+void rfft(std::span<const std::type_identity_t<T>> in, std::span<complex<T>> out, thread_pool& pool = thread_pool::shared()) {
+	fft_planner<T>::shared().real_plan(in.size())->forward(in, out, pool);
+}
+
+// The size of the transform is out.size(), in.size() == out.size() / 2 + 1
+template <typename T>
+void irfft(std::span<const complex<T>> in, std::span<std::type_identity_t<T>> out, thread_pool& pool = thread_pool::shared()) {
+	fft_planner<T>::shared().real_plan(out.size())->inverse(in, out, pool);
+}
+
+}
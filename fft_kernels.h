@@ -0,0 +1,239 @@
+/*
+Copyright (c) 2022, Dean Stephan
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of {{ project }} nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Provide the butterfly kernels behind fft.h
+// This file is included once per SIMD target through simd_foreach.h and
+// must not be included directly. A stage of radix P reads the n = P m s
+// interleaved complex values of x as P sub-sequences
+//      a[r] = x[k + s (j + r m)]                 r = 0 .. P - 1
+// and writes the P-point DFT of each, times the stage twiddles, to
+//      y[k + s (P j + q)] = w[q][j] sum_r a[r] root[r q mod P]
+// for every j in [0, m) and k in [0, s). root[r] = exp(-+ 2 pi i r / P) for
+// the forward (-) or inverse (+) transform, w[q][j] = root of the stage
+// length raised to q j, and w[0][j] = 1 is not stored.
+//
+// When s = 1 the k loop is empty and the kernel vectorises over j, reading
+// each a[r] and twiddle contiguously and interleaving the P results on the
+// way out (P = 2 and 4 only); when s holds whole vectors it vectorises over
+// k with broadcast twiddles. A stride between the two, dividing the vector
+// width, is vectorised over t = k + s j, along which every a[r] is
+// contiguous; the twiddles then come from a table spread out to one per t,
+// [(q - 1) m s + t], and each vector of results is written back in runs of
+// s values. Anything else runs one element at a time.
+
+// DFT of P points held as separate real and imaginary parts, in place
+template <int P, bool Inverse, typename V>
+STEPHAN_FORCE_INLINE void fft_butterfly(V (&re)[P], V (&im)[P], const V (&root_re)[P], const V (&root_im)[P]) {
+	if constexpr (P == 2) {
+		V r0 = re[0] + re[1], i0 = im[0] + im[1];
+		re[1] = re[0] - re[1];
+		im[1] = im[0] - im[1];
+		re[0] = r0;
+		im[0] = i0;
+	}
+	else if constexpr (P == 4) {
+		V t0r = re[0] + re[2], t0i = im[0] + im[2];
+		V t1r = re[0] - re[2], t1i = im[0] - im[2];
+		V t2r = re[1] + re[3], t2i = im[1] + im[3];
+		V t3r = re[1] - re[3], t3i = im[1] - im[3];
+		// t3 times -i (forward) or +i (inverse)
+		V ur = Inverse ? -t3i : t3i, ui = Inverse ? t3r : -t3r;
+		re[0] = t0r + t2r;
+		im[0] = t0i + t2i;
+		re[1] = t1r + ur;
+		im[1] = t1i + ui;
+		re[2] = t0r - t2r;
+		im[2] = t0i - t2i;
+		re[3] = t1r - ur;
+		im[3] = t1i - ui;
+	}
+	else {
+		V out_re[P], out_im[P];
+		for (int q = 0; q < P; ++q) {
+			out_re[q] = re[0];
+			out_im[q] = im[0];
+			for (int r = 1; r < P; ++r) {
+				int e = (r * q) % P;
+				out_re[q] = out_re[q] + (re[r] * root_re[e]) - (im[r] * root_im[e]);
+				out_im[q] = out_im[q] + (re[r] * root_im[e]) + (im[r] * root_re[e]);
+			}
+		}
+		for (int q = 0; q < P; ++q) {
+			re[q] = out_re[q];
+			im[q] = out_im[q];
+		}
+	}
+}
+
+// value *= w
+template <typename V>
+STEPHAN_FORCE_INLINE void fft_twiddle(V& re, V& im, const V& w_re, const V& w_im) {
+	V r = (re * w_re) - (im * w_im);
+	im = (re * w_im) + (im * w_re);
+	re = r;
+}
+
+// One stage over j in [j_first, j_last) and k in [k_first, k_last).
+// twiddles holds the complex w[q][j] at [(q - 1) m + j], roots the P
+// complex root[r], and spread, if not null, the same twiddles by t.
+template <typename T, int P, bool Inverse>
+void fft_stage(std::size_t m, std::size_t s, std::size_t j_first, std::size_t j_last, std::size_t k_first, std::size_t k_last,
+	const T* x, T* y, const T* twiddles, const T* spread, const T* roots) {
+	vec<T> root_re[P], root_im[P];
+	for (int r = 0; r < P; ++r) {
+		root_re[r] = broadcast(roots[2 * r]);
+		root_im[r] = broadcast(roots[(2 * r) + 1]);
+	}
+
+	if constexpr ((P == 2) || (P == 4)) {
+		if ((s == 1) && (lanes<T> > 1)) {
+			const T* in[(2 * P) - 1];
+			for (int r = 0; r < P; ++r) {
+				in[r] = x + (2 * (j_first + (r * m)));
+			}
+			for (int q = 1; q < P; ++q) {
+				in[P + q - 1] = twiddles + (2 * (((q - 1) * m) + j_first));
+			}
+			T* const out[1] = { y + (2 * P * j_first) };
+			for_each_block<2, 2 * P>(j_last - j_first, in, out, [&](const T* const* a, T* const* result, std::size_t offset) {
+				vec<T> re[P], im[P];
+				for (int r = 0; r < P; ++r) {
+					vec<T> parts[2];
+					load_interleaved<2>(a[r] + (2 * offset), parts);
+					re[r] = parts[0];
+					im[r] = parts[1];
+				}
+				fft_butterfly<P, Inverse>(re, im, root_re, root_im);
+				vec<T> merged[2 * P];
+				merged[0] = re[0];
+				merged[1] = im[0];
+				for (int q = 1; q < P; ++q) {
+					vec<T> w[2];
+					load_interleaved<2>(a[P + q - 1] + (2 * offset), w);
+					fft_twiddle(re[q], im[q], w[0], w[1]);
+					merged[2 * q] = re[q];
+					merged[(2 * q) + 1] = im[q];
+				}
+				store_interleaved<2 * P>(result[0] + (2 * P * offset), merged);
+			});
+			return;
+		}
+	}
+
+	constexpr std::size_t width = lanes<T>;
+	if ((spread != nullptr) && (s < width) && ((width % s) == 0) && (k_first == 0) && (k_last == s)
+		&& (((j_first * s) % width) == 0) && (((j_last * s) % width) == 0)) {
+		for (std::size_t t = j_first * s; t < j_last * s; t += width) {
+			vec<T> re[P], im[P];
+			for (int r = 0; r < P; ++r) {
+				vec<T> parts[2];
+				load_interleaved<2>(x + (2 * ((r * m * s) + t)), parts);
+				re[r] = parts[0];
+				im[r] = parts[1];
+			}
+			fft_butterfly<P, Inverse>(re, im, root_re, root_im);
+			for (int q = 0; q < P; ++q) {
+				if (q > 0) {
+					vec<T> w[2];
+					load_interleaved<2>(spread + (2 * (((q - 1) * m * s) + t)), w);
+					fft_twiddle(re[q], im[q], w[0], w[1]);
+				}
+				T values[2 * width];
+				const vec<T> parts[2] = { re[q], im[q] };
+				store_interleaved<2>(values, parts);
+				for (std::size_t run = 0; run < width / s; ++run) {
+					std::size_t j = (t / s) + run;
+					std::memcpy(y + (2 * s * ((P * j) + q)), values + (2 * s * run), 2 * s * sizeof(T));
+				}
+			}
+		}
+		return;
+	}
+
+	if (s >= width) {
+		for (std::size_t j = j_first; j < j_last; ++j) {
+			vec<T> w_re[P], w_im[P];
+			for (int q = 1; q < P; ++q) {
+				w_re[q] = broadcast(twiddles[2 * (((q - 1) * m) + j)]);
+				w_im[q] = broadcast(twiddles[(2 * (((q - 1) * m) + j)) + 1]);
+			}
+			const T* in[P];
+			T* out[P];
+			for (int r = 0; r < P; ++r) {
+				in[r] = x + (2 * (k_first + (s * (j + (r * m)))));
+				out[r] = y + (2 * (k_first + (s * ((P * j) + r))));
+			}
+			for_each_block<2, 2>(k_last - k_first, in, out, [&](const T* const* a, T* const* result, std::size_t offset) {
+				vec<T> re[P], im[P];
+				for (int r = 0; r < P; ++r) {
+					vec<T> parts[2];
+					load_interleaved<2>(a[r] + (2 * offset), parts);
+					re[r] = parts[0];
+					im[r] = parts[1];
+				}
+				fft_butterfly<P, Inverse>(re, im, root_re, root_im);
+				for (int q = 0; q < P; ++q) {
+					if (q > 0) {
+						fft_twiddle(re[q], im[q], w_re[q], w_im[q]);
+					}
+					const vec<T> parts[2] = { re[q], im[q] };
+					store_interleaved<2>(result[q] + (2 * offset), parts);
+				}
+			});
+		}
+		return;
+	}
+
+	T scalar_re[P], scalar_im[P];
+	for (int r = 0; r < P; ++r) {
+		scalar_re[r] = roots[2 * r];
+		scalar_im[r] = roots[(2 * r) + 1];
+	}
+	for (std::size_t j = j_first; j < j_last; ++j) {
+		for (std::size_t k = k_first; k < k_last; ++k) {
+			T re[P], im[P];
+			for (int r = 0; r < P; ++r) {
+				const T* a = x + (2 * (k + (s * (j + (r * m)))));
+				re[r] = a[0];
+				im[r] = a[1];
+			}
+			fft_butterfly<P, Inverse>(re, im, scalar_re, scalar_im);
+			for (int q = 0; q < P; ++q) {
+				if (q > 0) {
+					const T* w = twiddles + (2 * (((q - 1) * m) + j));
+					fft_twiddle(re[q], im[q], w[0], w[1]);
+				}
+				T* result = y + (2 * (k + (s * ((P * j) + q))));
+				result[0] = re[q];
+				result[1] = im[q];
+			}
+		}
+	}
+}
@@ -0,0 +1,103 @@
+/*
+Copyright (c) 2022, Dean Stephan
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of {{ project }} nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Provide batch kernels over arrays of 16-bit fixed-point complex numbers
+// With this header included, the complex multiplies of complex_batch.h
+// also take spans of complex<T>, T a fixed<std::int16_t, F, Shift> such as
+// q15 with either shift policy of fixed_point.h:
+//      cmul(a, b, out)         out[n] = a[n] * b[n]
+//      conj_mul(a, b, out)     out[n] = a[n].conjugate() * b[n]
+//      cmla(a, b, acc)         acc[n] += a[n] * b[n]
+// e.g.
+//      Stephan::cmul<Stephan::q15>(samples, twiddles, out);
+// The results are the same bits as the scalar complex<T> operators: one
+// rounding and saturation per component, and for cmla a saturating add.
+// conj_mul forms the exact conjugate product (ac + bd, ad - bc), so unlike
+// a[n].conjugate() * b[n] it does not first saturate the conjugate of an
+// imaginary part of -1.
+// These are vectorised with pmaddwd on SSE2 and AVX2 (see fixed_kernels.h),
+// and with vmull and the saturating narrows on NEON.
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <type_traits>
+
+#include "complex.h"
+#include "complex_batch.h"
+#include "fixed_point.h"
+#include "simd.h"
+
+#define STEPHAN_SIMD_KERNELS "fixed_kernels.h"
+#include "simd_foreach.h"
+
+namespace Stephan {
+
+namespace detail {
+
+// The fixed-point types the 16-bit kernels are built for
+template <typename T>
+struct is_fixed16 : std::false_type {};
+template <int Fraction>
+struct is_fixed16<fixed<std::int16_t, Fraction, round_shift>> : std::true_type {};
+template <int Fraction>
+struct is_fixed16<fixed<std::int16_t, Fraction, truncate_shift>> : std::true_type {};
+
+template <bool ConjugateLhs, bool Accumulate, typename T>
+void fixed16_multiply(std::span<const complex<T>> a, std::span<const complex<T>> b, std::span<complex<T>> out) {
+	constexpr bool round = std::is_same<typename T::shift_policy, round_shift>::value;
+	STEPHAN_SIMD_DISPATCH(fixed16_complex_multiply<ConjugateLhs, Accumulate, round, T::fraction_bits>(a.size(),
+		reinterpret_cast<const std::int16_t*>(a.data()), reinterpret_cast<const std::int16_t*>(b.data()), reinterpret_cast<std::int16_t*>(out.data())));
+}
+
+}
+
+template <typename T> requires detail::is_fixed16<T>::value
+void cmul(std::span<const complex<T>> a, std::span<const complex<T>> b, std::span<complex<T>> out) {
+	assert((a.size() == b.size()) && (a.size() == out.size()));
+	detail::fixed16_multiply<false, false>(a, b, out);
+}
+
+template <typename T> requires detail::is_fixed16<T>::value
+void conj_mul(std::span<const complex<T>> a, std::span<const complex<T>> b, std::span<complex<T>> out) {
+	assert((a.size() == b.size()) && (a.size() == out.size()));
+	detail::fixed16_multiply<true, false>(a, b, out);
+}
+
+template <typename T> requires detail::is_fixed16<T>::value
+void cmla(std::span<const complex<T>> a, std::span<const complex<T>> b, std::span<complex<T>> accumulator) {
+	assert((a.size() == b.size()) && (a.size() == accumulator.size()));
+	detail::fixed16_multiply<false, true>(a, b, accumulator);
+}
+
+}
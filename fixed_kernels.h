@@ -0,0 +1,191 @@
+/*
+Copyright (c) 2022, Dean Stephan
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of {{ project }} nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Provide the Q15 complex multiply kernels behind fixed_batch.h
+// This file is included once per SIMD target through simd_foreach.h and
+// must not be included directly. Arrays are interleaved 16-bit
+// (re, im) pairs with Fraction fraction bits. Every result is the exact
+// 32-bit sum of two products, shifted once (rounding half up, or
+// truncating) and saturated, the same bits as complex<fixed<...>>.
+//
+// On x86 each 32-bit lane holds one pair, so pmaddwd forms
+// a*c + b*d in one instruction. A difference a*c - b*d is taken as
+// a*c + (~b)*d + d, as -b overflows for b = -1 and ~b does not; the sum
+// wraps only for (-1)(-1) + (-1)(-1) = 2^31, which is put back at
+// INT32_MAX before the shift. The AVX-512 target uses the 256-bit AVX2
+// forms, as the 16-bit AVX-512 instructions need AVX-512BW. NEON splits
+// the pairs with vld2 and narrows with the saturating vq(r)shrn.
+
+#if defined(STEPHAN_SIMD_TARGET_SSE2)
+typedef __m128i fixed16_vector;
+STEPHAN_FORCE_INLINE fixed16_vector fixed16_load(const std::int16_t* source) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(source)); }
+STEPHAN_FORCE_INLINE void fixed16_store(std::int16_t* destination, fixed16_vector value) { _mm_storeu_si128(reinterpret_cast<__m128i*>(destination), value); }
+STEPHAN_FORCE_INLINE fixed16_vector fixed16_broadcast(std::int32_t value) { return _mm_set1_epi32(value); }
+STEPHAN_FORCE_INLINE fixed16_vector fixed16_madd(fixed16_vector a, fixed16_vector b) { return _mm_madd_epi16(a, b); }
+STEPHAN_FORCE_INLINE fixed16_vector fixed16_add(fixed16_vector a, fixed16_vector b) { return _mm_add_epi32(a, b); }
+STEPHAN_FORCE_INLINE fixed16_vector fixed16_equal(fixed16_vector a, fixed16_vector b) { return _mm_cmpeq_epi32(a, b); }
+STEPHAN_FORCE_INLINE fixed16_vector fixed16_xor(fixed16_vector a, fixed16_vector b) { return _mm_xor_si128(a, b); }
+STEPHAN_FORCE_INLINE fixed16_vector fixed16_swap(fixed16_vector a) { return _mm_or_si128(_mm_slli_epi32(a, 16), _mm_srli_epi32(a, 16)); }
+template <int Shift>
+STEPHAN_FORCE_INLINE fixed16_vector fixed16_shift(fixed16_vector a) { return _mm_srai_epi32(a, Shift); }
+STEPHAN_FORCE_INLINE fixed16_vector fixed16_merge(fixed16_vector re, fixed16_vector im) { return _mm_unpacklo_epi16(_mm_packs_epi32(re, re), _mm_packs_epi32(im, im)); }
+STEPHAN_FORCE_INLINE fixed16_vector fixed16_adds(fixed16_vector a, fixed16_vector b) { return _mm_adds_epi16(a, b); }
+#define STEPHAN_FIXED16_X86 1
+#elif defined(STEPHAN_SIMD_TARGET_AVX2) || defined(STEPHAN_SIMD_TARGET_AVX512)
+typedef __m256i fixed16_vector;
+STEPHAN_FORCE_INLINE fixed16_vector fixed16_load(const std::int16_t* source) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source)); }
+STEPHAN_FORCE_INLINE void fixed16_store(std::int16_t* destination, fixed16_vector value) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination), value); }
+STEPHAN_FORCE_INLINE fixed16_vector fixed16_broadcast(std::int32_t value) { return _mm256_set1_epi32(value); }
+STEPHAN_FORCE_INLINE fixed16_vector fixed16_madd(fixed16_vector a, fixed16_vector b) { return _mm256_madd_epi16(a, b); }
+STEPHAN_FORCE_INLINE fixed16_vector fixed16_add(fixed16_vector a, fixed16_vector b) { return _mm256_add_epi32(a, b); }
+STEPHAN_FORCE_INLINE fixed16_vector fixed16_equal(fixed16_vector a, fixed16_vector b) { return _mm256_cmpeq_epi32(a, b); }
+STEPHAN_FORCE_INLINE fixed16_vector fixed16_xor(fixed16_vector a, fixed16_vector b) { return _mm256_xor_si256(a, b); }
+STEPHAN_FORCE_INLINE fixed16_vector fixed16_swap(fixed16_vector a) { return _mm256_or_si256(_mm256_slli_epi32(a, 16), _mm256_srli_epi32(a, 16)); }
+template <int Shift>
+STEPHAN_FORCE_INLINE fixed16_vector fixed16_shift(fixed16_vector a) { return _mm256_srai_epi32(a, Shift); }
+// packs and unpack work within each 128-bit half, which keeps the pairs in order
+STEPHAN_FORCE_INLINE fixed16_vector fixed16_merge(fixed16_vector re, fixed16_vector im) { return _mm256_unpacklo_epi16(_mm256_packs_epi32(re, re), _mm256_packs_epi32(im, im)); }
+STEPHAN_FORCE_INLINE fixed16_vector fixed16_adds(fixed16_vector a, fixed16_vector b) { return _mm256_adds_epi16(a, b); }
+#define STEPHAN_FIXED16_X86 1
+#endif
+
+#if defined(STEPHAN_FIXED16_X86)
+// a*c + b*d per pair, saturated to INT32_MAX where it wraps
+STEPHAN_FORCE_INLINE fixed16_vector fixed16_sum(fixed16_vector x, fixed16_vector y) {
+	fixed16_vector sum = fixed16_madd(x, y);
+	return fixed16_xor(sum, fixed16_equal(sum, fixed16_broadcast(std::numeric_limits<std::int32_t>::min())));
+}
+// a*c - b*d per pair, as a*c + (~b)*d + d, which cannot overflow
+STEPHAN_FORCE_INLINE fixed16_vector fixed16_difference(fixed16_vector x, fixed16_vector y) {
+	return fixed16_add(fixed16_madd(fixed16_xor(x, fixed16_broadcast(std::int32_t(0xFFFF0000u))), y), fixed16_shift<16>(y));
+}
+template <bool Round, int Fraction>
+STEPHAN_FORCE_INLINE fixed16_vector fixed16_narrow(fixed16_vector value) {
+	if constexpr (Round) {
+		return fixed16_shift<1>(fixed16_add(fixed16_shift<Fraction - 1>(value), fixed16_broadcast(1)));
+	}
+	else {
+		return fixed16_shift<Fraction>(value);
+	}
+}
+template <bool ConjugateLhs, bool Round, int Fraction>
+STEPHAN_FORCE_INLINE fixed16_vector fixed16_product(fixed16_vector x, fixed16_vector y) {
+	fixed16_vector re, im;
+	if constexpr (ConjugateLhs) {
+		re = fixed16_sum(x, y);
+		im = fixed16_difference(x, fixed16_swap(y));
+	}
+	else {
+		re = fixed16_difference(x, y);
+		im = fixed16_sum(x, fixed16_swap(y));
+	}
+	return fixed16_merge(fixed16_narrow<Round, Fraction>(re), fixed16_narrow<Round, Fraction>(im));
+}
+#undef STEPHAN_FIXED16_X86
+#define STEPHAN_FIXED16_VECTOR 1
+#elif defined(STEPHAN_SIMD_TARGET_NEON)
+template <bool Round, int Fraction>
+STEPHAN_FORCE_INLINE int16x4_t fixed16_narrow(int32x4_t value) {
+	if constexpr (Round) {
+		return vqrshrn_n_s32(value, Fraction);
+	}
+	else {
+		return vqshrn_n_s32(value, Fraction);
+	}
+}
+// The sums wrap only at 2^31, which is put back at INT32_MAX
+STEPHAN_FORCE_INLINE int32x4_t fixed16_saturate(int32x4_t sum) {
+	return veorq_s32(sum, vreinterpretq_s32_u32(vceqq_s32(sum, vdupq_n_s32(std::numeric_limits<std::int32_t>::min()))));
+}
+template <bool ConjugateLhs, bool Round, int Fraction>
+STEPHAN_FORCE_INLINE void fixed16_product(int16x4_t a, int16x4_t b, int16x4_t c, int16x4_t d, int16x4_t& re, int16x4_t& im) {
+	if constexpr (ConjugateLhs) {
+		re = fixed16_narrow<Round, Fraction>(fixed16_saturate(vmlal_s16(vmull_s16(a, c), b, d)));
+		im = fixed16_narrow<Round, Fraction>(vmlsl_s16(vmull_s16(a, d), b, c));
+	}
+	else {
+		re = fixed16_narrow<Round, Fraction>(vmlsl_s16(vmull_s16(a, c), b, d));
+		im = fixed16_narrow<Round, Fraction>(fixed16_saturate(vmlal_s16(vmull_s16(a, d), b, c)));
+	}
+}
+template <bool ConjugateLhs, bool Round, int Fraction>
+STEPHAN_FORCE_INLINE int16x8x2_t fixed16_product(int16x8x2_t x, int16x8x2_t y) {
+	int16x4_t re_low, im_low, re_high, im_high;
+	fixed16_product<ConjugateLhs, Round, Fraction>(vget_low_s16(x.val[0]), vget_low_s16(x.val[1]), vget_low_s16(y.val[0]), vget_low_s16(y.val[1]), re_low, im_low);
+	fixed16_product<ConjugateLhs, Round, Fraction>(vget_high_s16(x.val[0]), vget_high_s16(x.val[1]), vget_high_s16(y.val[0]), vget_high_s16(y.val[1]), re_high, im_high);
+	int16x8x2_t result;
+	result.val[0] = vcombine_s16(re_low, re_high);
+	result.val[1] = vcombine_s16(im_low, im_high);
+	return result;
+}
+#endif
+
+// The scalar form, for the tails and the scalar target
+template <bool ConjugateLhs, bool Round, int Fraction>
+STEPHAN_FORCE_INLINE void fixed16_product(const std::int16_t* a, const std::int16_t* b, std::int16_t* out, bool accumulate) {
+	typedef ::Stephan::fixed<std::int16_t, Fraction, std::conditional_t<Round, ::Stephan::round_shift, ::Stephan::truncate_shift>> T;
+	typedef ::Stephan::complex<T> C;
+	C result = ::Stephan::detail::fixed_complex_multiply<ConjugateLhs>(C(T::from_bits(a[0]), T::from_bits(a[1])), C(T::from_bits(b[0]), T::from_bits(b[1])));
+	if (accumulate) {
+		result += C(T::from_bits(out[0]), T::from_bits(out[1]));
+	}
+	out[0] = result.Re().bits();
+	out[1] = result.Im().bits();
+}
+
+// out = a * b or conj(a) * b, or with Accumulate out += a * b, over n pairs
+template <bool ConjugateLhs, bool Accumulate, bool Round, int Fraction>
+void fixed16_complex_multiply(std::size_t n, const std::int16_t* a, const std::int16_t* b, std::int16_t* out) {
+	std::size_t k = 0;
+#if defined(STEPHAN_FIXED16_VECTOR)
+	constexpr std::size_t step = sizeof(fixed16_vector) / 4;
+	for (; k + step <= n; k += step) {
+		fixed16_vector result = fixed16_product<ConjugateLhs, Round, Fraction>(fixed16_load(a + 2 * k), fixed16_load(b + 2 * k));
+		if constexpr (Accumulate) {
+			result = fixed16_adds(fixed16_load(out + 2 * k), result);
+		}
+		fixed16_store(out + 2 * k, result);
+	}
+#undef STEPHAN_FIXED16_VECTOR
+#elif defined(STEPHAN_SIMD_TARGET_NEON)
+	for (; k + 8 <= n; k += 8) {
+		int16x8x2_t result = fixed16_product<ConjugateLhs, Round, Fraction>(vld2q_s16(a + 2 * k), vld2q_s16(b + 2 * k));
+		if constexpr (Accumulate) {
+			int16x8x2_t sum = vld2q_s16(out + 2 * k);
+			result.val[0] = vqaddq_s16(sum.val[0], result.val[0]);
+			result.val[1] = vqaddq_s16(sum.val[1], result.val[1]);
+		}
+		vst2q_s16(out + 2 * k, result);
+	}
+#endif
+	for (; k < n; ++k) {
+		fixed16_product<ConjugateLhs, Round, Fraction>(a + 2 * k, b + 2 * k, out + 2 * k, Accumulate);
+	}
+}
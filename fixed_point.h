@@ -0,0 +1,712 @@
+/*
+Copyright (c) 2022, Dean Stephan
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of {{ project }} nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Provide Q-format fixed-point types for integer-only pipelines
+//      fixed<Storage, Fraction, Shift>     a signed integer Storage read as
+//                                          bits / 2^Fraction
+//      q15     fixed<std::int16_t, 15>, [-1, 1) in steps of 2^-15
+//      q31     fixed<std::int32_t, 31>, [-1, 1) in steps of 2^-31
+// All arithmetic saturates at the ends of the range instead of wrapping,
+// -(-1) included, as DSP instruction sets do. A product is formed exactly
+// in a double-width integer and brought back to Fraction bits by the shift
+// policy, which is also used by operator>> and by conversions between
+// formats:
+//      round_shift         round half up, i.e. add half a unit first, as
+//                          the rounding multiplies do (pmulhrsw, sqrdmulh)
+//      truncate_shift      drop the bits, i.e. round toward minus infinity
+//
+// complex<fixed<...>> and quaternion<fixed<...>> are specialised below.
+// Each component of a product is one sum of exact products, shifted and
+// saturated once, so complex<q15> * complex<q15> rounds each part once.
+// q31 sums keep 2 guard bits of headroom and drop the lowest 2 bits of
+// each 62-bit product first. norm2() returns the double-width
+// compute_type_t<T>, which holds up to 4 with 2*Fraction - 2 bits.
+// Division, reciprocals and norms use integer arithmetic only:
+//      exact_reciprocal    a 64-bit integer division per component,
+//                          rounded by the shift policy
+//      fast_reciprocal     one division-free Newton-Raphson reciprocal
+//                          shared by all components, to about 2^-28
+//                          relative, for cores without a hardware divide
+//      norm()              an integer square root, rounded to nearest
+// Quotients round their magnitude, so truncate_shift divides toward zero.
+// Transcendental functions, rotate() and stream output are only provided
+// for the floating-point types; convert with complex<double>(z) first.
+//
+// The batch kernels on arrays of complex<q15> are in fixed_batch.h.
+#pragma once
+
+#include <bit>
+#include <compare>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+#include "complex.h"
+#include "config.h"
+#include "quaternions.h"
+#include "reciprocal.h"
+
+namespace Stephan {
+
+struct round_shift {
+	template <typename W>
+	static STEPHAN_HOST_DEVICE constexpr W apply(W value, int shift) noexcept {
+		return (shift <= 0) ? value : W(((value >> (shift - 1)) + 1) >> 1);
+	}
+};
+
+struct truncate_shift {
+	template <typename W>
+	static STEPHAN_HOST_DEVICE constexpr W apply(W value, int shift) noexcept {
+		return (shift <= 0) ? value : W(value >> shift);
+	}
+};
+
+namespace detail {
+
+// The exact product of two Storage values
+template <typename Storage>
+struct fixed_product;
+template <>
+struct fixed_product<std::int16_t> {
+	typedef std::int32_t type;
+};
+template <>
+struct fixed_product<std::int32_t> {
+	typedef std::int64_t type;
+};
+
+template <typename Storage>
+STEPHAN_HOST_DEVICE constexpr Storage fixed_saturate(std::int64_t value) noexcept {
+	if (value > std::int64_t(std::numeric_limits<Storage>::max())) {
+		return std::numeric_limits<Storage>::max();
+	}
+	if (value < std::int64_t(std::numeric_limits<Storage>::min())) {
+		return std::numeric_limits<Storage>::min();
+	}
+	return Storage(value);
+}
+
+// bits with From fraction bits as Storage with To fraction bits
+template <typename Storage, int To, typename Shift>
+STEPHAN_HOST_DEVICE constexpr Storage fixed_rescale(std::int64_t bits, int from) noexcept {
+	if (To <= from) {
+		return fixed_saturate<Storage>(Shift::apply(bits, from - To));
+	}
+	const int shift = To - from;
+	if ((shift >= 63) || (bits > (std::numeric_limits<std::int64_t>::max() >> shift))
+		|| (bits < (std::numeric_limits<std::int64_t>::min() >> shift))) {
+		return (bits == 0) ? Storage(0) : ((bits > 0) ? std::numeric_limits<Storage>::max() : std::numeric_limits<Storage>::min());
+	}
+	return fixed_saturate<Storage>(bits << shift);
+}
+
+template <int Fraction>
+inline constexpr double fixed_scale = double(std::uint64_t(1) << Fraction);
+
+// A real number rounded to nearest, half away from zero, and saturated
+template <typename Storage, int Fraction>
+STEPHAN_HOST_DEVICE constexpr Storage fixed_from_real(double value) noexcept {
+	double scaled = value * fixed_scale<Fraction>;
+	if (!(scaled == scaled)) {
+		return Storage(0);
+	}
+	if (scaled >= double(std::numeric_limits<Storage>::max())) {
+		return std::numeric_limits<Storage>::max();
+	}
+	if (scaled <= double(std::numeric_limits<Storage>::min())) {
+		return std::numeric_limits<Storage>::min();
+	}
+	return Storage((scaled < 0) ? (scaled - 0.5) : (scaled + 0.5));
+}
+
+// floor(sqrt(value)) digit by digit, then rounded to nearest
+STEPHAN_HOST_DEVICE constexpr std::uint64_t fixed_sqrt(std::uint64_t value) noexcept {
+	std::uint64_t root = 0;
+	std::uint64_t bit = std::uint64_t(1) << 62;
+	while (bit > value) {
+		bit >>= 2;
+	}
+	while (bit != 0) {
+		if (value >= root + bit) {
+			value -= root + bit;
+			root = (root >> 1) + bit;
+		}
+		else {
+			root >>= 1;
+		}
+		bit >>= 2;
+	}
+	return (value > root) ? root + 1 : root;
+}
+
+// Quotients n / d for one divisor d. Both are raw integers with their
+// own fraction bits. d is normalised to 32 significant bits; the exact
+// form divides by it, the fast form multiplies by a Newton-Raphson
+// reciprocal computed once, in Q30, from the linear estimate
+// 48/17 - 32/17 d, good to 4 bits and doubled by each of 3 steps.
+template <bool Fast>
+class fixed_divider {
+private:
+	std::uint64_t	divisor;
+	std::uint64_t	reciprocal;
+	int	divisor_fraction;
+	bool	negative;
+
+public:
+	STEPHAN_HOST_DEVICE constexpr fixed_divider(std::int64_t bits, int fraction) noexcept
+		: divisor(0)
+		, reciprocal(0)
+		, divisor_fraction(fraction)
+		, negative(bits < 0)
+	{
+		std::uint64_t magnitude = this->negative ? (std::uint64_t(0) - std::uint64_t(bits)) : std::uint64_t(bits);
+		if (magnitude == 0) {
+			return;
+		}
+		int zeros = std::countl_zero(magnitude);
+		this->divisor = (zeros >= 32) ? (magnitude << (zeros - 32)) : (magnitude >> (32 - zeros));
+		this->divisor_fraction += zeros - 32;
+		if constexpr (Fast) {
+			std::uint64_t y = 3031741621u - ((2021161081u * this->divisor) >> 32);
+			for (int step = 0; step < 3; ++step) {
+				std::uint64_t error = (std::uint64_t(1) << 31) - ((this->divisor * y) >> 32);
+				y = (y * error) >> 30;
+			}
+			this->reciprocal = y;
+		}
+	}
+
+	template <typename Storage, int Fraction, typename Shift>
+	STEPHAN_HOST_DEVICE constexpr Storage quotient(std::int64_t bits, int fraction) const noexcept {
+		if (bits == 0) {
+			return Storage(0);
+		}
+		bool negative = (bits < 0) != this->negative;
+		if (this->divisor == 0) {
+			return negative ? std::numeric_limits<Storage>::min() : std::numeric_limits<Storage>::max();
+		}
+		std::uint64_t magnitude = (bits < 0) ? (std::uint64_t(0) - std::uint64_t(bits)) : std::uint64_t(bits);
+		int zeros = std::countl_zero(magnitude);
+		magnitude <<= zeros;
+		std::int64_t result = 0;
+		int shift = 0;
+		if constexpr (Fast) {
+			result = std::int64_t((magnitude >> 32) * this->reciprocal);
+			shift = 62 + zeros + fraction - Fraction - (this->divisor_fraction + 32);
+		}
+		else {
+			result = std::int64_t(magnitude / this->divisor);
+			shift = zeros + fraction - Fraction - this->divisor_fraction;
+		}
+		if (shift > 62) {
+			result >>= (shift - 62 > 63) ? 63 : (shift - 62);
+			shift = 62;
+		}
+		std::int64_t value = fixed_rescale<std::int64_t, Fraction, Shift>(result, Fraction + shift);
+		return fixed_saturate<Storage>(negative ? -value : value);
+	}
+};
+
+template <typename Policy>
+struct fixed_fast_division : std::is_same<Policy, fast_reciprocal> {};
+
+}
+
+template <typename Storage, int Fraction, typename Shift = round_shift>
+class fixed {
+	static_assert(std::is_integral<Storage>::value && std::is_signed<Storage>::value);
+	static_assert((Fraction >= 1) && (Fraction <= std::numeric_limits<Storage>::digits) && (sizeof(Storage) <= 8));
+
+private:
+	Storage	storage;
+
+	struct raw {};
+	STEPHAN_HOST_DEVICE constexpr fixed(Storage bits, raw) noexcept : storage(bits) {}
+
+public:
+	typedef Storage storage_type;
+	typedef Shift shift_policy;
+	static constexpr int fraction_bits = Fraction;
+
+	fixed() noexcept = default;
+	// From a real number, rounded to nearest and saturated
+	STEPHAN_HOST_DEVICE constexpr fixed(double value) noexcept
+		: storage(detail::fixed_from_real<Storage, Fraction>(value))
+	{}
+	// Between formats, e.g. q15(q31), shifted by this type's policy and saturated
+	template <typename S, int F, typename P>
+	STEPHAN_HOST_DEVICE explicit constexpr fixed(const fixed<S, F, P>& other) noexcept
+		: storage(detail::fixed_rescale<Storage, Fraction, Shift>(other.bits(), F))
+	{}
+
+	STEPHAN_HOST_DEVICE explicit constexpr operator double() const noexcept { return double(this->storage) / detail::fixed_scale<Fraction>; }
+	STEPHAN_HOST_DEVICE explicit constexpr operator float() const noexcept { return float(double(*this)); }
+
+	static STEPHAN_HOST_DEVICE constexpr fixed from_bits(Storage bits) noexcept { return fixed(bits, raw()); }
+	STEPHAN_HOST_DEVICE constexpr Storage bits() const noexcept { return this->storage; }
+
+	// Fixed-point numbers are ordered, unlike the algebras over them
+	friend constexpr bool operator==(const fixed&, const fixed&) noexcept = default;
+	friend constexpr auto operator<=>(const fixed&, const fixed&) noexcept = default;
+
+	STEPHAN_HOST_DEVICE constexpr fixed operator-() const noexcept {
+		return from_bits(detail::fixed_saturate<Storage>(-std::int64_t(this->storage)));
+	}
+	STEPHAN_HOST_DEVICE friend constexpr fixed operator+(const fixed& lhs, const fixed& rhs) noexcept {
+		return from_bits(detail::fixed_saturate<Storage>(std::int64_t(lhs.storage) + rhs.storage));
+	}
+	STEPHAN_HOST_DEVICE friend constexpr fixed operator-(const fixed& lhs, const fixed& rhs) noexcept {
+		return from_bits(detail::fixed_saturate<Storage>(std::int64_t(lhs.storage) - rhs.storage));
+	}
+	STEPHAN_HOST_DEVICE friend constexpr fixed operator*(const fixed& lhs, const fixed& rhs) noexcept {
+		typedef typename detail::fixed_product<Storage>::type P;
+		P product = P(lhs.storage) * P(rhs.storage);
+		return from_bits(detail::fixed_rescale<Storage, Fraction, Shift>(product, 2 * Fraction));
+	}
+	STEPHAN_HOST_DEVICE friend constexpr fixed operator/(const fixed& lhs, const fixed& rhs) noexcept {
+		return from_bits(detail::fixed_divider<false>(rhs.storage, Fraction).template quotient<Storage, Fraction, Shift>(lhs.storage, Fraction));
+	}
+
+	// Scaling by powers of two: x << n saturates, x >> n rounds by the policy
+	STEPHAN_HOST_DEVICE friend constexpr fixed operator<<(const fixed& value, int shift) noexcept {
+		return from_bits(detail::fixed_rescale<Storage, Fraction, Shift>(value.storage, Fraction - shift));
+	}
+	STEPHAN_HOST_DEVICE friend constexpr fixed operator>>(const fixed& value, int shift) noexcept {
+		return from_bits(detail::fixed_rescale<Storage, Fraction, Shift>(value.storage, Fraction + shift));
+	}
+
+	STEPHAN_HOST_DEVICE constexpr fixed& operator+=(const fixed& rhs) noexcept { return *this = *this + rhs; }
+	STEPHAN_HOST_DEVICE constexpr fixed& operator-=(const fixed& rhs) noexcept { return *this = *this - rhs; }
+	STEPHAN_HOST_DEVICE constexpr fixed& operator*=(const fixed& rhs) noexcept { return *this = *this * rhs; }
+	STEPHAN_HOST_DEVICE constexpr fixed& operator/=(const fixed& rhs) noexcept { return *this = *this / rhs; }
+	STEPHAN_HOST_DEVICE constexpr fixed& operator<<=(int shift) noexcept { return *this = *this << shift; }
+	STEPHAN_HOST_DEVICE constexpr fixed& operator>>=(int shift) noexcept { return *this = *this >> shift; }
+};
+
+typedef fixed<std::int16_t, 15> q15;
+typedef fixed<std::int32_t, 31> q31;
+
+// The squared norms: sums of up to four squares, in double width with
+// two integer bits
+template <typename Storage, int Fraction, typename Shift>
+struct compute_type<fixed<Storage, Fraction, Shift>> {
+	typedef fixed<typename detail::fixed_product<Storage>::type, 2 * Fraction - 2, Shift> type;
+};
+
+namespace detail {
+
+template <typename T>
+struct is_fixed : std::false_type {};
+template <typename Storage, int Fraction, typename Shift>
+struct is_fixed<fixed<Storage, Fraction, Shift>> : std::true_type {};
+
+// A sum of exact products of the raw values of T. 16-bit products are
+// summed exactly; 32-bit products drop 2 bits first so that four of them
+// cannot overflow.
+template <typename T>
+class fixed_accumulator {
+private:
+	typedef typename T::storage_type Storage;
+	typedef typename T::shift_policy Shift;
+	static constexpr int guard = (sizeof(Storage) > 2) ? 2 : 0;
+
+	std::int64_t	total = 0;
+
+public:
+	static constexpr int fraction_bits = 2 * T::fraction_bits - guard;
+
+	STEPHAN_HOST_DEVICE constexpr fixed_accumulator& add(std::int64_t a, std::int64_t b) noexcept {
+		this->total += (a * b) >> guard;
+		return *this;
+	}
+	STEPHAN_HOST_DEVICE constexpr fixed_accumulator& subtract(std::int64_t a, std::int64_t b) noexcept {
+		this->total -= (a * b) >> guard;
+		return *this;
+	}
+	STEPHAN_HOST_DEVICE constexpr std::int64_t bits() const noexcept { return this->total; }
+
+	STEPHAN_HOST_DEVICE constexpr T result() const noexcept {
+		return T::from_bits(fixed_rescale<Storage, T::fraction_bits, Shift>(this->total, fraction_bits));
+	}
+	STEPHAN_HOST_DEVICE constexpr compute_type_t<T> wide() const noexcept {
+		typedef compute_type_t<T> W;
+		return W::from_bits(fixed_rescale<typename W::storage_type, W::fraction_bits, Shift>(this->total, fraction_bits));
+	}
+	// The square root of a non-negative sum, with T's fraction bits
+	// Sums too large to take the guard bits back before the root (four Q31
+	// components of -1 make 2^62) shift the root by half of them instead.
+	STEPHAN_HOST_DEVICE constexpr T root() const noexcept {
+		static_assert((guard % 2) == 0);
+		std::uint64_t value = (this->total > 0) ? std::uint64_t(this->total) : 0;
+		std::uint64_t root = (value < (std::uint64_t(1) << (64 - guard - 1))) ? fixed_sqrt(value << guard) : (fixed_sqrt(value) << (guard / 2));
+		return T::from_bits((root > std::uint64_t(std::numeric_limits<Storage>::max())) ? std::numeric_limits<Storage>::max() : Storage(root));
+	}
+};
+
+template <bool ConjugateLhs, typename T>
+STEPHAN_HOST_DEVICE constexpr complex<T> fixed_complex_multiply(const complex<T>& lhs, const complex<T>& rhs) noexcept {
+	typedef fixed_accumulator<T> sum;
+	std::int64_t a = lhs.Re().bits(), b = lhs.Im().bits(), c = rhs.Re().bits(), d = rhs.Im().bits();
+	if constexpr (ConjugateLhs) {
+		b = -b;
+	}
+	return complex<T>(sum().add(a, c).subtract(b, d).result(), sum().add(a, d).add(b, c).result());
+}
+
+// The four sums of the Hamilton product, either operand optionally conjugated
+template <bool ConjugateLhs, bool ConjugateRhs, typename T>
+STEPHAN_HOST_DEVICE constexpr void fixed_hamilton(const quaternion<T>& lhs, const quaternion<T>& rhs, fixed_accumulator<T> (&out)[4]) noexcept {
+	const std::int64_t sign_a = ConjugateLhs ? -1 : 1, sign_b = ConjugateRhs ? -1 : 1;
+	std::int64_t a0 = lhs.Re().bits(), a1 = sign_a * lhs.Im1().bits(), a2 = sign_a * lhs.Im2().bits(), a3 = sign_a * lhs.Im3().bits();
+	std::int64_t b0 = rhs.Re().bits(), b1 = sign_b * rhs.Im1().bits(), b2 = sign_b * rhs.Im2().bits(), b3 = sign_b * rhs.Im3().bits();
+	out[0].add(a0, b0).subtract(a1, b1).subtract(a2, b2).subtract(a3, b3);
+	out[1].add(a0, b1).add(a1, b0).add(a2, b3).subtract(a3, b2);
+	out[2].add(a0, b2).add(a2, b0).add(a3, b1).subtract(a1, b3);
+	out[3].add(a0, b3).add(a3, b0).add(a1, b2).subtract(a2, b1);
+}
+
+}
+
+template <typename Storage, int Fraction, typename Shift>
+class complex<fixed<Storage, Fraction, Shift>> {
+private:
+	typedef fixed<Storage, Fraction, Shift> T;
+	typedef detail::fixed_accumulator<T> sum;
+
+	T	real_part;
+	T	imaginary_part;
+
+public:
+	STEPHAN_HOST_DEVICE constexpr complex(T _real_part = 0, T _imaginary_part = 0) noexcept
+		: real_part(_real_part)
+		, imaginary_part(_imaginary_part)
+	{}
+	// From other formats and from floating point, e.g. complex<q15>(complex<double>)
+	template <typename U>
+	STEPHAN_HOST_DEVICE explicit constexpr complex(const complex<U>& other) noexcept
+		: real_part(T(other.Re()))
+		, imaginary_part(T(other.Im()))
+	{}
+
+	STEPHAN_HOST_DEVICE constexpr T Re() const noexcept { return real_part; }
+	STEPHAN_HOST_DEVICE constexpr T Im() const noexcept { return imaginary_part; }
+
+	STEPHAN_HOST_DEVICE constexpr bool operator==(const complex<T>& rhs) const noexcept {
+		return (this->real_part == rhs.real_part) && (this->imaginary_part == rhs.imaginary_part);
+	}
+	STEPHAN_HOST_DEVICE constexpr bool operator!=(const complex<T>& rhs) const noexcept {
+		return !(*this == rhs);
+	}
+
+	STEPHAN_HOST_DEVICE constexpr complex<T> conjugate() const noexcept { return complex(this->real_part, -(this->imaginary_part)); }
+	STEPHAN_HOST_DEVICE constexpr complex<T> operator-() const noexcept { return complex(-(this->real_part), -(this->imaginary_part)); }
+
+	STEPHAN_HOST_DEVICE constexpr complex<T> operator+(const complex<T>& rhs) const noexcept {
+		return complex(this->real_part + rhs.real_part, this->imaginary_part + rhs.imaginary_part);
+	}
+	STEPHAN_HOST_DEVICE constexpr complex<T> operator+(const T& value) const noexcept {
+		return complex(this->real_part + value, this->imaginary_part);
+	}
+	STEPHAN_HOST_DEVICE constexpr complex<T> operator-(const complex<T>& rhs) const noexcept {
+		return complex(this->real_part - rhs.real_part, this->imaginary_part - rhs.imaginary_part);
+	}
+	STEPHAN_HOST_DEVICE constexpr complex<T> operator-(const T& value) const noexcept {
+		return complex(this->real_part - value, this->imaginary_part);
+	}
+
+	STEPHAN_HOST_DEVICE constexpr complex<T> operator*(const complex<T>& rhs) const noexcept {
+		return detail::fixed_complex_multiply<false>(*this, rhs);
+	}
+	STEPHAN_HOST_DEVICE constexpr complex<T> operator*(const T& value) const noexcept {
+		return complex(this->real_part * value, this->imaginary_part * value);
+	}
+
+	// Division: the numerators and the squared norm are exact sums, and
+	// each quotient is rounded once
+	STEPHAN_HOST_DEVICE constexpr compute_type_t<T> norm2() const noexcept {
+		return this->squares().wide();
+	}
+	STEPHAN_HOST_DEVICE constexpr T norm() const noexcept {
+		return this->squares().root();
+	}
+	template <typename Policy = exact_reciprocal>
+	STEPHAN_HOST_DEVICE constexpr complex<T> reciprocal() const noexcept {
+		detail::fixed_divider<detail::fixed_fast_division<Policy>::value> scale(this->squares().bits(), sum::fraction_bits);
+		return complex(T::from_bits(scale.template quotient<Storage, Fraction, Shift>(this->real_part.bits(), Fraction)),
+			T::from_bits(scale.template quotient<Storage, Fraction, Shift>(-std::int64_t(this->imaginary_part.bits()), Fraction)));
+	}
+	template <typename Policy = exact_reciprocal>
+	STEPHAN_HOST_DEVICE constexpr complex<T> divide(const complex<T>& rhs) const noexcept {
+		detail::fixed_divider<detail::fixed_fast_division<Policy>::value> scale(rhs.squares().bits(), sum::fraction_bits);
+		std::int64_t a = this->real_part.bits(), b = this->imaginary_part.bits(), c = rhs.real_part.bits(), d = rhs.imaginary_part.bits();
+		return complex(T::from_bits(scale.template quotient<Storage, Fraction, Shift>(sum().add(a, c).add(b, d).bits(), sum::fraction_bits)),
+			T::from_bits(scale.template quotient<Storage, Fraction, Shift>(sum().add(b, c).subtract(a, d).bits(), sum::fraction_bits)));
+	}
+	STEPHAN_HOST_DEVICE constexpr complex<T> operator/(const complex<T>& rhs) const noexcept {
+		return this->divide(rhs);
+	}
+	STEPHAN_HOST_DEVICE constexpr complex<T> operator/(const T& value) const noexcept {
+		detail::fixed_divider<false> scale(value.bits(), Fraction);
+		return complex(T::from_bits(scale.template quotient<Storage, Fraction, Shift>(this->real_part.bits(), Fraction)),
+			T::from_bits(scale.template quotient<Storage, Fraction, Shift>(this->imaginary_part.bits(), Fraction)));
+	}
+
+	STEPHAN_HOST_DEVICE constexpr complex<T>& operator+=(const complex<T>& rhs) noexcept { return (*this) = (*this) + rhs; }
+	STEPHAN_HOST_DEVICE constexpr complex<T>& operator+=(const T& value) noexcept { return (*this) = (*this) + value; }
+	STEPHAN_HOST_DEVICE constexpr complex<T>& operator-=(const complex<T>& rhs) noexcept { return (*this) = (*this) - rhs; }
+	STEPHAN_HOST_DEVICE constexpr complex<T>& operator-=(const T& value) noexcept { return (*this) = (*this) - value; }
+	STEPHAN_HOST_DEVICE constexpr complex<T>& operator*=(const complex<T>& rhs) noexcept { return (*this) = (*this) * rhs; }
+	STEPHAN_HOST_DEVICE constexpr complex<T>& operator*=(const T& value) noexcept { return (*this) = (*this) * value; }
+	STEPHAN_HOST_DEVICE constexpr complex<T>& operator/=(const complex<T>& rhs) noexcept { return (*this) = this->divide(rhs); }
+	STEPHAN_HOST_DEVICE constexpr complex<T>& operator/=(const T& value) noexcept { return (*this) = (*this) / value; }
+
+private:
+	STEPHAN_HOST_DEVICE constexpr sum squares() const noexcept {
+		std::int64_t a = this->real_part.bits(), b = this->imaginary_part.bits();
+		return sum().add(a, a).add(b, b);
+	}
+};
+
+template <typename Storage, int Fraction, typename Shift>
+class quaternion<fixed<Storage, Fraction, Shift>> {
+private:
+	typedef fixed<Storage, Fraction, Shift> T;
+	typedef detail::fixed_accumulator<T> sum;
+
+	T	real_part;
+	T	i_part;
+	T	j_part;
+	T	k_part;
+
+public:
+	STEPHAN_HOST_DEVICE constexpr quaternion(T _real_part = 0, T i = 0, T j = 0, T k = 0) noexcept
+		: real_part(_real_part)
+		, i_part(i)
+		, j_part(j)
+		, k_part(k)
+	{}
+	// From other formats and from floating point, e.g. quaternion<q31>(quaternion<float>)
+	template <typename U>
+	STEPHAN_HOST_DEVICE explicit constexpr quaternion(const quaternion<U>& other) noexcept
+		: real_part(T(other.Re()))
+		, i_part(T(other.Im1()))
+		, j_part(T(other.Im2()))
+		, k_part(T(other.Im3()))
+	{}
+
+	STEPHAN_HOST_DEVICE constexpr T Re() const noexcept { return real_part; }
+	STEPHAN_HOST_DEVICE constexpr T Im1() const noexcept { return i_part; }
+	STEPHAN_HOST_DEVICE constexpr T Im2() const noexcept { return j_part; }
+	STEPHAN_HOST_DEVICE constexpr T Im3() const noexcept { return k_part; }
+
+	STEPHAN_HOST_DEVICE constexpr bool operator==(const quaternion<T>& rhs) const noexcept {
+		return (this->real_part == rhs.real_part) && (this->i_part == rhs.i_part)
+			&& (this->j_part == rhs.j_part) && (this->k_part == rhs.k_part);
+	}
+	STEPHAN_HOST_DEVICE constexpr bool operator!=(const quaternion<T>& rhs) const noexcept {
+		return !(*this == rhs);
+	}
+
+	STEPHAN_HOST_DEVICE constexpr quaternion<T> conjugate() const noexcept { return quaternion(this->real_part, -(this->i_part), -(this->j_part), -(this->k_part)); }
+	STEPHAN_HOST_DEVICE constexpr quaternion<T> operator-() const noexcept { return quaternion(-(this->real_part), -(this->i_part), -(this->j_part), -(this->k_part)); }
+
+	STEPHAN_HOST_DEVICE constexpr quaternion<T> operator+(const quaternion<T>& rhs) const noexcept {
+		return quaternion(this->real_part + rhs.real_part, this->i_part + rhs.i_part,
+			this->j_part + rhs.j_part, this->k_part + rhs.k_part);
+	}
+	STEPHAN_HOST_DEVICE constexpr quaternion<T> operator+(const T& value) const noexcept {
+		return quaternion(this->real_part + value, this->i_part, this->j_part, this->k_part);
+	}
+	STEPHAN_HOST_DEVICE constexpr quaternion<T> operator-(const quaternion<T>& rhs) const noexcept {
+		return quaternion(this->real_part - rhs.real_part, this->i_part - rhs.i_part,
+			this->j_part - rhs.j_part, this->k_part - rhs.k_part);
+	}
+	STEPHAN_HOST_DEVICE constexpr quaternion<T> operator-(const T& value) const noexcept {
+		return quaternion(this->real_part - value, this->i_part, this->j_part, this->k_part);
+	}
+
+	STEPHAN_HOST_DEVICE constexpr quaternion<T> operator*(const quaternion<T>& rhs) const noexcept {
+		sum parts[4];
+		detail::fixed_hamilton<false, false>(*this, rhs, parts);
+		return quaternion(parts[0].result(), parts[1].result(), parts[2].result(), parts[3].result());
+	}
+	STEPHAN_HOST_DEVICE constexpr quaternion<T> operator*(const T& value) const noexcept {
+		return quaternion(this->real_part * value, this->i_part * value,
+			this->j_part * value, this->k_part * value);
+	}
+
+	// Division, as for complex<fixed>: p * q^-1 is p * q.conjugate() / norm2(q)
+	// with the product summed exactly
+	STEPHAN_HOST_DEVICE constexpr compute_type_t<T> norm2() const noexcept {
+		return this->squares().wide();
+	}
+	STEPHAN_HOST_DEVICE constexpr T norm() const noexcept {
+		return this->squares().root();
+	}
+	template <typename Policy = exact_reciprocal>
+	STEPHAN_HOST_DEVICE constexpr quaternion<T> reciprocal() const noexcept {
+		detail::fixed_divider<detail::fixed_fast_division<Policy>::value> scale(this->squares().bits(), sum::fraction_bits);
+		return quaternion(T::from_bits(scale.template quotient<Storage, Fraction, Shift>(this->real_part.bits(), Fraction)),
+			T::from_bits(scale.template quotient<Storage, Fraction, Shift>(-std::int64_t(this->i_part.bits()), Fraction)),
+			T::from_bits(scale.template quotient<Storage, Fraction, Shift>(-std::int64_t(this->j_part.bits()), Fraction)),
+			T::from_bits(scale.template quotient<Storage, Fraction, Shift>(-std::int64_t(this->k_part.bits()), Fraction)));
+	}
+	template <typename Policy = exact_reciprocal>
+	STEPHAN_HOST_DEVICE constexpr quaternion<T> divide(const quaternion<T>& rhs) const noexcept {
+		sum parts[4];
+		detail::fixed_hamilton<false, true>(*this, rhs, parts);
+		return quaternion::quotient<Policy>(parts, rhs);
+	}
+	STEPHAN_HOST_DEVICE constexpr quaternion<T> operator/(const quaternion<T>& rhs) const noexcept {
+		return this->divide(rhs);
+	}
+	STEPHAN_HOST_DEVICE constexpr quaternion<T> operator/(const T& value) const noexcept {
+		detail::fixed_divider<false> scale(value.bits(), Fraction);
+		return quaternion(T::from_bits(scale.template quotient<Storage, Fraction, Shift>(this->real_part.bits(), Fraction)),
+			T::from_bits(scale.template quotient<Storage, Fraction, Shift>(this->i_part.bits(), Fraction)),
+			T::from_bits(scale.template quotient<Storage, Fraction, Shift>(this->j_part.bits(), Fraction)),
+			T::from_bits(scale.template quotient<Storage, Fraction, Shift>(this->k_part.bits(), Fraction)));
+	}
+
+	STEPHAN_HOST_DEVICE constexpr quaternion<T>& operator+=(const quaternion<T>& rhs) noexcept { return (*this) = (*this) + rhs; }
+	STEPHAN_HOST_DEVICE constexpr quaternion<T>& operator+=(const T& value) noexcept { return (*this) = (*this) + value; }
+	STEPHAN_HOST_DEVICE constexpr quaternion<T>& operator-=(const quaternion<T>& rhs) noexcept { return (*this) = (*this) - rhs; }
+	STEPHAN_HOST_DEVICE constexpr quaternion<T>& operator-=(const T& value) noexcept { return (*this) = (*this) - value; }
+	STEPHAN_HOST_DEVICE constexpr quaternion<T>& operator*=(const quaternion<T>& rhs) noexcept { return (*this) = (*this) * rhs; }
+	STEPHAN_HOST_DEVICE constexpr quaternion<T>& operator*=(const T& value) noexcept { return (*this) = (*this) * value; }
+	STEPHAN_HOST_DEVICE constexpr quaternion<T>& operator/=(const quaternion<T>& rhs) noexcept { return (*this) = this->divide(rhs); }
+	STEPHAN_HOST_DEVICE constexpr quaternion<T>& operator/=(const T& value) noexcept { return (*this) = (*this) / value; }
+
+	// The exactly summed numerators of a division by divisor, each divided
+	// by norm2(divisor) and rounded once
+	template <typename Policy>
+	static STEPHAN_HOST_DEVICE constexpr quaternion<T> quotient(const sum (&numerators)[4], const quaternion<T>& divisor) noexcept {
+		detail::fixed_divider<detail::fixed_fast_division<Policy>::value> scale(divisor.squares().bits(), sum::fraction_bits);
+		return quaternion(T::from_bits(scale.template quotient<Storage, Fraction, Shift>(numerators[0].bits(), sum::fraction_bits)),
+			T::from_bits(scale.template quotient<Storage, Fraction, Shift>(numerators[1].bits(), sum::fraction_bits)),
+			T::from_bits(scale.template quotient<Storage, Fraction, Shift>(numerators[2].bits(), sum::fraction_bits)),
+			T::from_bits(scale.template quotient<Storage, Fraction, Shift>(numerators[3].bits(), sum::fraction_bits)));
+	}
+
+private:
+	STEPHAN_HOST_DEVICE constexpr sum squares() const noexcept {
+		std::int64_t a = this->real_part.bits(), b = this->i_part.bits(), c = this->j_part.bits(), d = this->k_part.bits();
+		return sum().add(a, a).add(b, b).add(c, c).add(d, d);
+	}
+};
+
+// The free functions of complex.h and quaternions.h that are not written
+// in terms of the members above
+template <typename Storage, int Fraction, typename Shift>
+STEPHAN_HOST_DEVICE constexpr complex<fixed<Storage, Fraction, Shift>> operator/(const fixed<Storage, Fraction, Shift>& value, const complex<fixed<Storage, Fraction, Shift>>& rhs) noexcept {
+	return complex<fixed<Storage, Fraction, Shift>>(value).divide(rhs);
+}
+
+template <typename Storage, int Fraction, typename Shift>
+STEPHAN_HOST_DEVICE constexpr fixed<Storage, Fraction, Shift> dot(const quaternion<fixed<Storage, Fraction, Shift>>& lhs, const quaternion<fixed<Storage, Fraction, Shift>>& rhs) noexcept {
+	return detail::fixed_accumulator<fixed<Storage, Fraction, Shift>>().add(lhs.Re().bits(), rhs.Re().bits()).add(lhs.Im1().bits(), rhs.Im1().bits())
+		.add(lhs.Im2().bits(), rhs.Im2().bits()).add(lhs.Im3().bits(), rhs.Im3().bits()).result();
+}
+
+template <typename Policy = exact_reciprocal, typename Storage, int Fraction, typename Shift>
+STEPHAN_HOST_DEVICE constexpr quaternion<fixed<Storage, Fraction, Shift>> inverse_multiply(const quaternion<fixed<Storage, Fraction, Shift>>& lhs, const quaternion<fixed<Storage, Fraction, Shift>>& rhs) noexcept {
+	typedef quaternion<fixed<Storage, Fraction, Shift>> Q;
+	detail::fixed_accumulator<fixed<Storage, Fraction, Shift>> parts[4];
+	detail::fixed_hamilton<true, false>(lhs, rhs, parts);
+	return Q::template quotient<Policy>(parts, lhs);
+}
+
+// Layout guarantees: arrays of complex<q15> are interleaved int16_t pairs,
+// the layout of CMSIS-DSP and the like
+static_assert(std::is_trivially_copyable<q15>::value && std::is_standard_layout<q15>::value);
+static_assert((sizeof(q15) == 2) && (sizeof(q31) == 4));
+static_assert(sizeof(complex<q15>) == 2 * sizeof(q15));
+static_assert(sizeof(complex<q31>) == 2 * sizeof(q31));
+static_assert(sizeof(quaternion<q15>) == 4 * sizeof(q15));
+static_assert(sizeof(quaternion<q31>) == 4 * sizeof(q31));
+
+// Spot checks of the saturation and rounding
+static_assert(q15(1.0).bits() == 32767);
+static_assert((q15(-1.0) * q15(-1.0)).bits() == 32767);
+static_assert((-q15(-1.0)).bits() == 32767);
+static_assert((q15(0.5) * q15::from_bits(1)).bits() == 1);
+static_assert((fixed<std::int16_t, 15, truncate_shift>(0.5) * fixed<std::int16_t, 15, truncate_shift>::from_bits(1)).bits() == 0);
+static_assert((q15(0.25) / q15(0.5)) == q15(0.5));
+static_assert((q15(0.5) >> 1) == q15(0.25));
+static_assert((complex<q15>(0.5, 0.5) * complex<q15>(0.5, -0.5)) == complex<q15>(0.5, 0));
+static_assert((complex<q15>(0.25, 0.25) / complex<q15>(0.5, 0.5)) == complex<q15>(0.5, 0));
+static_assert(complex<q15>(0.375, 0.5).norm() == q15(0.625));
+
+}
+
+namespace std {
+
+template <typename Storage, int Fraction, typename Shift>
+class numeric_limits<Stephan::fixed<Storage, Fraction, Shift>> {
+	typedef Stephan::fixed<Storage, Fraction, Shift> T;
+
+public:
+	static constexpr bool is_specialized = true;
+	static constexpr bool is_signed = true;
+	static constexpr bool is_integer = false;
+	static constexpr bool is_exact = true;
+	static constexpr bool has_infinity = false;
+	static constexpr bool has_quiet_NaN = false;
+	static constexpr bool has_signaling_NaN = false;
+	static constexpr float_denorm_style has_denorm = denorm_absent;
+	static constexpr bool has_denorm_loss = false;
+	static constexpr float_round_style round_style = std::is_same<Shift, Stephan::round_shift>::value ? round_to_nearest : round_toward_neg_infinity;
+	static constexpr bool is_iec559 = false;
+	static constexpr bool is_bounded = true;
+	static constexpr bool is_modulo = false;
+	static constexpr int digits = numeric_limits<Storage>::digits;
+	static constexpr int digits10 = numeric_limits<Storage>::digits10;
+	static constexpr int max_digits10 = 0;
+	static constexpr int radix = 2;
+	static constexpr int min_exponent = 0;
+	static constexpr int min_exponent10 = 0;
+	static constexpr int max_exponent = 0;
+	static constexpr int max_exponent10 = 0;
+	static constexpr bool traps = false;
+	static constexpr bool tinyness_before = false;
+
+	static constexpr T min() noexcept { return T::from_bits(numeric_limits<Storage>::min()); }
+	static constexpr T lowest() noexcept { return T::from_bits(numeric_limits<Storage>::min()); }
+	static constexpr T max() noexcept { return T::from_bits(numeric_limits<Storage>::max()); }
+	static constexpr T epsilon() noexcept { return T::from_bits(1); }
+	static constexpr T round_error() noexcept { return std::is_same<Shift, Stephan::round_shift>::value ? T(0.5) : max(); }
+	static constexpr T infinity() noexcept { return T::from_bits(0); }
+	static constexpr T quiet_NaN() noexcept { return T::from_bits(0); }
+	static constexpr T signaling_NaN() noexcept { return T::from_bits(0); }
+	static constexpr T denorm_min() noexcept { return T::from_bits(0); }
+};
+
+}
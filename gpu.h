@@ -0,0 +1,467 @@
+/*
+Copyright (c) 2022, Dean Stephan
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of {{ project }} nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Provide a CUDA / HIP backend for the batch kernels
+// This header is for translation units compiled by nvcc (CUDA) or hipcc
+// (HIP); the same source builds for both. The value types themselves are
+// shared with the host: complex<T>, quaternion<T>, vec3<T> and
+// rotation_matrix<T> are usable in device code (see STEPHAN_HOST_DEVICE in
+// config.h), and a quaternion_soa<T> is copied lane by lane into a
+// device_quaternion_soa<T> of the same layout, so nothing is repacked on the
+// way to or from the device.
+//
+// Every operation is asynchronous on a gpu::stream and takes device memory:
+//      multiply(a, b, out, stream)             out[n] = a[n] * b[n], quaternion lanes
+//      cmul(a, b, out, stream)                 out[n] = a[n] * b[n], interleaved complex
+//      rotate(q, points, out, stream)          out[n] = q.rotate(points[n])
+//      slerp_n(a, b, t, out, stream)           out[n] = slerp(a[n], b[n], t[n])
+//      butterflies(data, twiddles, half, stream)
+//                                              one radix-2 FFT stage
+// Memory:
+//      device_buffer<T>        device array with upload() / download()
+//      device_quaternion_soa<T> four device lanes, upload() / download() from
+//                              any host container with Re(), Im1(), Im2(),
+//                              Im3() lanes such as quaternion_soa<T>
+//      pinned_allocator<T>     page-locked host memory for std::vector
+//      pinned_region           page locks existing host memory in place
+// Copies from ordinary (pageable) host memory are staged by the driver and
+// do not overlap with other work; host buffers should be pinned, by either
+// of the last two, for transfers to run asynchronously.
+//
+// Errors from the runtime are thrown as gpu::error.
+#pragma once
+
+#if !defined(__CUDACC__) && !defined(__HIPCC__)
+#error "gpu.h must be compiled by nvcc or hipcc"
+#endif
+
+#if defined(__HIPCC__)
+#include <hip/hip_runtime.h>
+#else
+#include <cuda_runtime.h>
+#endif
+
+#include <cassert>
+#include <cstddef>
+#include <new>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "complex.h"
+#include "config.h"
+#include "quaternions.h"
+#include "rotation_matrix.h"
+#include "vec3.h"
+
+namespace Stephan {
+namespace gpu {
+
+// The few runtime calls used here, under one name for both platforms
+namespace runtime {
+#if defined(__HIPCC__)
+typedef hipError_t status;
+typedef hipStream_t stream_type;
+inline constexpr status success = hipSuccess;
+inline const char* message(status code) { return hipGetErrorString(code); }
+inline status last_error() { return hipGetLastError(); }
+inline status allocate(void** pointer, std::size_t bytes) { return hipMalloc(pointer, bytes); }
+inline status release(void* pointer) { return hipFree(pointer); }
+inline status allocate_pinned(void** pointer, std::size_t bytes) { return hipHostMalloc(pointer, bytes, hipHostMallocDefault); }
+inline status release_pinned(void* pointer) { return hipHostFree(pointer); }
+inline status pin(void* pointer, std::size_t bytes) { return hipHostRegister(pointer, bytes, hipHostRegisterDefault); }
+inline status unpin(void* pointer) { return hipHostUnregister(pointer); }
+inline status copy(void* destination, const void* source, std::size_t bytes, stream_type stream) {
+	return hipMemcpyAsync(destination, source, bytes, hipMemcpyDefault, stream);
+}
+inline status create(stream_type* stream) { return hipStreamCreateWithFlags(stream, hipStreamNonBlocking); }
+inline status destroy(stream_type stream) { return hipStreamDestroy(stream); }
+inline status synchronize(stream_type stream) { return hipStreamSynchronize(stream); }
+#else
+typedef cudaError_t status;
+typedef cudaStream_t stream_type;
+inline constexpr status success = cudaSuccess;
+inline const char* message(status code) { return cudaGetErrorString(code); }
+inline status last_error() { return cudaGetLastError(); }
+inline status allocate(void** pointer, std::size_t bytes) { return cudaMalloc(pointer, bytes); }
+inline status release(void* pointer) { return cudaFree(pointer); }
+inline status allocate_pinned(void** pointer, std::size_t bytes) { return cudaMallocHost(pointer, bytes); }
+inline status release_pinned(void* pointer) { return cudaFreeHost(pointer); }
+inline status pin(void* pointer, std::size_t bytes) { return cudaHostRegister(pointer, bytes, cudaHostRegisterDefault); }
+inline status unpin(void* pointer) { return cudaHostUnregister(pointer); }
+inline status copy(void* destination, const void* source, std::size_t bytes, stream_type stream) {
+	return cudaMemcpyAsync(destination, source, bytes, cudaMemcpyDefault, stream);
+}
+inline status create(stream_type* stream) { return cudaStreamCreateWithFlags(stream, cudaStreamNonBlocking); }
+inline status destroy(stream_type stream) { return cudaStreamDestroy(stream); }
+inline status synchronize(stream_type stream) { return cudaStreamSynchronize(stream); }
+#endif
+}
+
+class error : public std::runtime_error {
+public:
+	explicit error(const char* what, runtime::status code)
+		: std::runtime_error(std::string(what) + ": " + runtime::message(code))
+	{}
+};
+
+namespace detail {
+inline void check(runtime::status code, const char* what) {
+	if (code != runtime::success) {
+		throw error(what, code);
+	}
+}
+}
+
+class stream {
+private:
+	runtime::stream_type	handle = nullptr;
+
+public:
+	stream() { detail::check(runtime::create(&this->handle), "creating a stream"); }
+	stream(const stream&) = delete;
+	stream& operator=(const stream&) = delete;
+	stream(stream&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+	stream& operator=(stream&& other) noexcept {
+		std::swap(this->handle, other.handle);
+		return *this;
+	}
+	~stream() {
+		if (this->handle != nullptr) {
+			runtime::destroy(this->handle);
+		}
+	}
+
+	runtime::stream_type native() const noexcept { return this->handle; }
+	// Block until all work queued so far has finished
+	void synchronize() const { detail::check(runtime::synchronize(this->handle), "synchronizing a stream"); }
+};
+
+template <typename T>
+class device_buffer {
+private:
+	T*		data_pointer = nullptr;
+	std::size_t	count = 0;
+
+public:
+	device_buffer() noexcept = default;
+	explicit device_buffer(std::size_t size)
+		: count(size)
+	{
+		static_assert(std::is_trivially_copyable<T>::value);
+		if (size != 0) {
+			void* pointer = nullptr;
+			detail::check(runtime::allocate(&pointer, size * sizeof(T)), "allocating device memory");
+			this->data_pointer = static_cast<T*>(pointer);
+		}
+	}
+	device_buffer(const device_buffer&) = delete;
+	device_buffer& operator=(const device_buffer&) = delete;
+	device_buffer(device_buffer&& other) noexcept
+		: data_pointer(std::exchange(other.data_pointer, nullptr))
+		, count(std::exchange(other.count, 0))
+	{}
+	device_buffer& operator=(device_buffer&& other) noexcept {
+		std::swap(this->data_pointer, other.data_pointer);
+		std::swap(this->count, other.count);
+		return *this;
+	}
+	~device_buffer() {
+		if (this->data_pointer != nullptr) {
+			runtime::release(this->data_pointer);
+		}
+	}
+
+	T* data() noexcept { return this->data_pointer; }
+	const T* data() const noexcept { return this->data_pointer; }
+	std::size_t size() const noexcept { return this->count; }
+	std::span<T> span() noexcept { return std::span<T>(this->data_pointer, this->count); }
+	std::span<const T> span() const noexcept { return std::span<const T>(this->data_pointer, this->count); }
+
+	// Queue a copy from or to host memory of the same size
+	void upload(std::span<const T> host, const stream& queue) {
+		assert(host.size() == this->count);
+		detail::check(runtime::copy(this->data_pointer, host.data(), this->count * sizeof(T), queue.native()), "copying to the device");
+	}
+	void download(std::span<T> host, const stream& queue) const {
+		assert(host.size() == this->count);
+		detail::check(runtime::copy(host.data(), this->data_pointer, this->count * sizeof(T), queue.native()), "copying from the device");
+	}
+};
+
+// Allocator for host memory that transfers can use directly, e.g.
+//      std::vector<quaternion<float>, gpu::pinned_allocator<quaternion<float>>>
+template <typename T>
+struct pinned_allocator {
+	typedef T value_type;
+
+	pinned_allocator() noexcept = default;
+	template <typename U>
+	pinned_allocator(const pinned_allocator<U>&) noexcept {}
+
+	T* allocate(std::size_t n) {
+		void* pointer = nullptr;
+		if (runtime::allocate_pinned(&pointer, n * sizeof(T)) != runtime::success) {
+			throw std::bad_alloc();
+		}
+		return static_cast<T*>(pointer);
+	}
+	void deallocate(T* pointer, std::size_t) noexcept { runtime::release_pinned(pointer); }
+
+	template <typename U>
+	bool operator==(const pinned_allocator<U>&) const noexcept { return true; }
+};
+
+// Page locks existing host memory, e.g. the lanes of a quaternion_soa<T>,
+// for as long as the region lives. The memory must not be reallocated or
+// freed in the meantime.
+class pinned_region {
+private:
+	void*	pointer = nullptr;
+
+public:
+	template <typename T>
+	explicit pinned_region(std::span<T> memory) {
+		if (!memory.empty()) {
+			void* start = const_cast<std::remove_const_t<T>*>(memory.data());
+			detail::check(runtime::pin(start, memory.size_bytes()), "pinning host memory");
+			this->pointer = start;
+		}
+	}
+	pinned_region(const pinned_region&) = delete;
+	pinned_region& operator=(const pinned_region&) = delete;
+	pinned_region(pinned_region&& other) noexcept : pointer(std::exchange(other.pointer, nullptr)) {}
+	pinned_region& operator=(pinned_region&& other) noexcept {
+		std::swap(this->pointer, other.pointer);
+		return *this;
+	}
+	~pinned_region() {
+		if (this->pointer != nullptr) {
+			runtime::unpin(this->pointer);
+		}
+	}
+};
+
+// Four component lanes in device memory, as passed to the kernels
+template <typename T>
+struct soa_view {
+	T*		lane[4];
+	std::size_t	size;
+
+	STEPHAN_HOST_DEVICE quaternion<T> operator[](std::size_t n) const noexcept {
+		return quaternion<T>(this->lane[0][n], this->lane[1][n], this->lane[2][n], this->lane[3][n]);
+	}
+	STEPHAN_HOST_DEVICE void set(std::size_t n, const quaternion<T>& value) const noexcept {
+		this->lane[0][n] = value.Re();
+		this->lane[1][n] = value.Im1();
+		this->lane[2][n] = value.Im2();
+		this->lane[3][n] = value.Im3();
+	}
+};
+
+// The device counterpart of quaternion_soa<T>
+template <typename T>
+class device_quaternion_soa {
+private:
+	device_buffer<T>	lanes[4];
+
+public:
+	device_quaternion_soa() noexcept = default;
+	explicit device_quaternion_soa(std::size_t size)
+		: lanes{ device_buffer<T>(size), device_buffer<T>(size), device_buffer<T>(size), device_buffer<T>(size) }
+	{}
+
+	std::size_t size() const noexcept { return this->lanes[0].size(); }
+	soa_view<T> view() noexcept {
+		return soa_view<T>{ { this->lanes[0].data(), this->lanes[1].data(), this->lanes[2].data(), this->lanes[3].data() }, this->size() };
+	}
+	soa_view<T> view() const noexcept {
+		return const_cast<device_quaternion_soa*>(this)->view();
+	}
+
+	template <typename Host>
+	void upload(Host& host, const stream& queue) {
+		this->lanes[0].upload(std::span<const T>(host.Re()), queue);
+		this->lanes[1].upload(std::span<const T>(host.Im1()), queue);
+		this->lanes[2].upload(std::span<const T>(host.Im2()), queue);
+		this->lanes[3].upload(std::span<const T>(host.Im3()), queue);
+	}
+	template <typename Host>
+	void download(Host& host, const stream& queue) const {
+		this->lanes[0].download(std::span<T>(host.Re()), queue);
+		this->lanes[1].download(std::span<T>(host.Im1()), queue);
+		this->lanes[2].download(std::span<T>(host.Im2()), queue);
+		this->lanes[3].download(std::span<T>(host.Im3()), queue);
+	}
+};
+
+namespace detail {
+
+inline constexpr unsigned block_threads = 256;
+inline constexpr std::size_t max_blocks = 65535;
+
+// Grid size for n elements; the kernels loop with the grid stride over
+// anything beyond it
+inline unsigned blocks_for(std::size_t n) {
+	std::size_t blocks = (n + block_threads - 1) / block_threads;
+	return static_cast<unsigned>((blocks < max_blocks) ? blocks : max_blocks);
+}
+
+inline void check_launch() { check(runtime::last_error(), "launching a kernel"); }
+
+#define STEPHAN_GPU_FOR_EACH(index, count) \
+	for (std::size_t index = (static_cast<std::size_t>(blockIdx.x) * blockDim.x) + threadIdx.x; index < (count); \
+		index += static_cast<std::size_t>(gridDim.x) * blockDim.x)
+
+template <typename T>
+__global__ void multiply_kernel(soa_view<T> a, soa_view<T> b, soa_view<T> out) {
+	STEPHAN_GPU_FOR_EACH(n, out.size) {
+		out.set(n, a[n] * b[n]);
+	}
+}
+
+template <typename T>
+__global__ void cmul_kernel(const complex<T>* a, const complex<T>* b, complex<T>* out, std::size_t count) {
+	STEPHAN_GPU_FOR_EACH(n, count) {
+		out[n] = a[n] * b[n];
+	}
+}
+
+template <typename T>
+__global__ void rotate_kernel(rotation_matrix<T> matrix, const vec3<T>* points, vec3<T>* out, std::size_t count) {
+	STEPHAN_GPU_FOR_EACH(n, count) {
+		out[n] = matrix * points[n];
+	}
+}
+
+// The same formula as slerp() in slerp.h
+template <typename T>
+STEPHAN_HOST_DEVICE quaternion<T> slerp(const quaternion<T>& q0, const quaternion<T>& q1, T t) {
+	quaternion<T> target = (dot(q0, q1) < T(0)) ? q1 * T(-1) : q1;
+	T theta = T(2) * atan2((target - q0).norm(), (target + q0).norm());
+	T sine = sin(theta);
+	if (sine == T(0)) {
+		return q0;
+	}
+	T scale = T(1) / sine;
+	return (q0 * (sin((T(1) - t) * theta) * scale)) + (target * (sin(t * theta) * scale));
+}
+
+template <typename T>
+__global__ void slerp_kernel(soa_view<T> a, soa_view<T> b, const T* t, soa_view<T> out) {
+	STEPHAN_GPU_FOR_EACH(n, out.size) {
+		out.set(n, slerp(a[n], b[n], t[n]));
+	}
+}
+
+template <typename T>
+__global__ void butterfly_kernel(complex<T>* data, const complex<T>* twiddles, std::size_t size, std::size_t half) {
+	std::size_t stride = size / (2 * half);
+	STEPHAN_GPU_FOR_EACH(pair, size / 2) {
+		std::size_t k = pair % half;
+		std::size_t top = ((pair / half) * (2 * half)) + k;
+		complex<T> a = data[top];
+		complex<T> b = data[top + half] * twiddles[k * stride];
+		data[top] = a + b;
+		data[top + half] = a - b;
+	}
+}
+
+#undef STEPHAN_GPU_FOR_EACH
+
+}
+
+template <typename T>
+void multiply(const device_quaternion_soa<T>& a, const device_quaternion_soa<T>& b, device_quaternion_soa<T>& out, const stream& queue) {
+	static_assert(std::is_floating_point<T>::value);
+	assert((a.size() == b.size()) && (a.size() == out.size()));
+	if (out.size() == 0) {
+		return;
+	}
+	detail::multiply_kernel<T><<<detail::blocks_for(out.size()), detail::block_threads, 0, queue.native()>>>(a.view(), b.view(), out.view());
+	detail::check_launch();
+}
+
+template <typename T>
+void cmul(std::span<const complex<T>> a, std::span<const complex<T>> b, std::span<complex<T>> out, const stream& queue) {
+	static_assert(std::is_floating_point<T>::value);
+	assert((a.size() == b.size()) && (a.size() == out.size()));
+	if (out.empty()) {
+		return;
+	}
+	detail::cmul_kernel<T><<<detail::blocks_for(out.size()), detail::block_threads, 0, queue.native()>>>(a.data(), b.data(), out.data(), out.size());
+	detail::check_launch();
+}
+
+// q must have unit norm; points and out may be the same array
+template <typename T>
+void rotate(const quaternion<T>& q, std::span<const vec3<T>> points, std::span<vec3<T>> out, const stream& queue) {
+	static_assert(std::is_floating_point<T>::value);
+	assert(points.size() == out.size());
+	if (out.empty()) {
+		return;
+	}
+	detail::rotate_kernel<T><<<detail::blocks_for(out.size()), detail::block_threads, 0, queue.native()>>>(rotation_matrix<T>(q), points.data(), out.data(), out.size());
+	detail::check_launch();
+}
+
+// a and b must hold unit quaternions, t is in device memory
+template <typename T>
+void slerp_n(const device_quaternion_soa<T>& a, const device_quaternion_soa<T>& b, std::span<const std::type_identity_t<T>> t, device_quaternion_soa<T>& out, const stream& queue) {
+	static_assert(std::is_floating_point<T>::value);
+	assert((a.size() == b.size()) && (a.size() == t.size()) && (a.size() == out.size()));
+	if (out.size() == 0) {
+		return;
+	}
+	detail::slerp_kernel<T><<<detail::blocks_for(out.size()), detail::block_threads, 0, queue.native()>>>(a.view(), b.view(), t.data(), out.view());
+	detail::check_launch();
+}
+
+// One decimation-in-time stage of a radix-2 FFT of data.size() points (a
+// power of two), in place: within every group of 2 half values,
+//      (x[k], x[k + half]) <- (x[k] + w x[k + half], x[k] - w x[k + half])
+// with w = twiddles[k * data.size() / (2 half)]. twiddles holds the
+// data.size() / 2 factors exp(-2 pi i j / data.size()). Running the stages
+// for half = 1, 2, 4, ... over bit-reversed input gives the transform.
+template <typename T>
+void butterflies(std::span<complex<T>> data, std::span<const complex<T>> twiddles, std::size_t half, const stream& queue) {
+	static_assert(std::is_floating_point<T>::value);
+	assert((half > 0) && ((data.size() % (2 * half)) == 0) && (twiddles.size() >= data.size() / 2));
+	if (data.empty()) {
+		return;
+	}
+	detail::butterfly_kernel<T><<<detail::blocks_for(data.size() / 2), detail::block_threads, 0, queue.native()>>>(data.data(), twiddles.data(), data.size(), half);
+	detail::check_launch();
+}
+
+}
+}
@@ -0,0 +1,310 @@
+/*
+Copyright (c) 2022, Dean Stephan
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of {{ project }} nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Provide 16-bit floating-point storage types
+//      float16     IEEE 754 binary16: 5 exponent and 10 mantissa bits,
+//                  about 3 decimal digits up to 65504
+//      bfloat16    the upper half of a float: 8 exponent and 7 mantissa
+//                  bits, about 2 decimal digits over the whole float range
+// Both are storage types only. They convert implicitly to float, so any
+// expression on them is evaluated in float, and from float, rounded to
+// nearest even, when the result is stored. complex<float16>,
+// quaternion<bfloat16> and the other algebras over them therefore compute
+// each component of a product in float and round it once; norm2() and
+// division work in float throughout (see compute_type in complex.h).
+//
+// Single values are converted with F16C when the compiler targets it
+// (-mf16c, or -march for any x86 processor with AVX2) and with exact
+// integer arithmetic otherwise; the two differ, if at all, only in the
+// payload of a NaN. Conversion of whole arrays, and the batch kernels on
+// arrays of complex<float16> and friends, are in half_batch.h.
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+#include "complex.h"
+#include "config.h"
+#include "quaternions.h"
+
+#if defined(__F16C__) && !defined(__CUDA_ARCH__) && !defined(__HIP_DEVICE_COMPILE__)
+#include <immintrin.h>
+#define STEPHAN_HALF_F16C 1
+#endif
+
+namespace Stephan {
+
+namespace detail {
+
+// binary16 to float, exact for every value
+STEPHAN_HOST_DEVICE constexpr float half_to_float(std::uint16_t value) noexcept {
+	std::uint32_t bits = std::uint32_t(value & 0x7FFF) << 13;
+	std::uint32_t exponent = bits & (0x1Fu << 23);
+	bits += (127u - 15u) << 23;
+	if (exponent == (0x1Fu << 23)) {
+		// Infinity or NaN
+		bits += (128u - 16u) << 23;
+	}
+	else if (exponent == 0) {
+		// Zero or subnormal: 2^-14 (1 + m / 1024) - 2^-14 = m 2^-24
+		bits += 1u << 23;
+		bits = std::bit_cast<std::uint32_t>(std::bit_cast<float>(bits) - std::bit_cast<float>(113u << 23));
+	}
+	return std::bit_cast<float>(bits | (std::uint32_t(value & 0x8000) << 16));
+}
+
+// float to binary16, rounded to nearest even. Overflow goes to infinity
+// and every NaN to the same quiet NaN, with its sign.
+STEPHAN_HOST_DEVICE constexpr std::uint16_t float_to_half(float value) noexcept {
+	std::uint32_t bits = std::bit_cast<std::uint32_t>(value);
+	std::uint32_t sign = bits & 0x80000000u;
+	bits ^= sign;
+	std::uint32_t result;
+	if (bits >= (143u << 23)) {
+		// 2^16 and above, infinity or NaN
+		result = (bits > (255u << 23)) ? 0x7E00u : 0x7C00u;
+	}
+	else if (bits < (113u << 23)) {
+		// Below 2^-14: adding 0.5 leaves the subnormal mantissa, rounded,
+		// in the low bits
+		float shifted = std::bit_cast<float>(bits) + std::bit_cast<float>(126u << 23);
+		result = std::bit_cast<std::uint32_t>(shifted) - (126u << 23);
+	}
+	else {
+		// Rebias, then round on the 13 bits that are dropped; a carry out
+		// of the mantissa correctly steps the exponent, up to infinity
+		std::uint32_t odd = (bits >> 13) & 1;
+		bits -= (127u - 15u) << 23;
+		bits += 0xFFF + odd;
+		result = bits >> 13;
+	}
+	return static_cast<std::uint16_t>(result | (sign >> 16));
+}
+
+STEPHAN_HOST_DEVICE constexpr float bfloat16_to_float(std::uint16_t value) noexcept {
+	return std::bit_cast<float>(std::uint32_t(value) << 16);
+}
+
+// Rounded to nearest even, NaN kept quiet
+STEPHAN_HOST_DEVICE constexpr std::uint16_t float_to_bfloat16(float value) noexcept {
+	std::uint32_t bits = std::bit_cast<std::uint32_t>(value);
+	if ((bits & 0x7FFFFFFFu) > 0x7F800000u) {
+		return static_cast<std::uint16_t>((bits >> 16) | 0x40);
+	}
+	return static_cast<std::uint16_t>((bits + 0x7FFF + ((bits >> 16) & 1)) >> 16);
+}
+
+}
+
+class float16 {
+private:
+	std::uint16_t	storage;
+
+	struct raw {};
+	constexpr float16(std::uint16_t bits, raw) noexcept : storage(bits) {}
+
+public:
+	float16() noexcept = default;
+	STEPHAN_HOST_DEVICE constexpr float16(float value) noexcept
+		: storage(0)
+	{
+#if defined(STEPHAN_HALF_F16C)
+		if (!std::is_constant_evaluated()) {
+			this->storage = static_cast<std::uint16_t>(_cvtss_sh(value, _MM_FROUND_TO_NEAREST_INT));
+			return;
+		}
+#endif
+		this->storage = detail::float_to_half(value);
+	}
+
+	STEPHAN_HOST_DEVICE constexpr operator float() const noexcept {
+#if defined(STEPHAN_HALF_F16C)
+		if (!std::is_constant_evaluated()) {
+			return _cvtsh_ss(this->storage);
+		}
+#endif
+		return detail::half_to_float(this->storage);
+	}
+
+	static constexpr float16 from_bits(std::uint16_t bits) noexcept { return float16(bits, raw()); }
+	constexpr std::uint16_t bits() const noexcept { return this->storage; }
+
+	STEPHAN_HOST_DEVICE constexpr float16& operator+=(float value) noexcept { return *this = float(*this) + value; }
+	STEPHAN_HOST_DEVICE constexpr float16& operator-=(float value) noexcept { return *this = float(*this) - value; }
+	STEPHAN_HOST_DEVICE constexpr float16& operator*=(float value) noexcept { return *this = float(*this) * value; }
+	STEPHAN_HOST_DEVICE constexpr float16& operator/=(float value) noexcept { return *this = float(*this) / value; }
+};
+
+class bfloat16 {
+private:
+	std::uint16_t	storage;
+
+	struct raw {};
+	constexpr bfloat16(std::uint16_t bits, raw) noexcept : storage(bits) {}
+
+public:
+	bfloat16() noexcept = default;
+	STEPHAN_HOST_DEVICE constexpr bfloat16(float value) noexcept
+		: storage(detail::float_to_bfloat16(value))
+	{}
+
+	STEPHAN_HOST_DEVICE constexpr operator float() const noexcept { return detail::bfloat16_to_float(this->storage); }
+
+	static constexpr bfloat16 from_bits(std::uint16_t bits) noexcept { return bfloat16(bits, raw()); }
+	constexpr std::uint16_t bits() const noexcept { return this->storage; }
+
+	STEPHAN_HOST_DEVICE constexpr bfloat16& operator+=(float value) noexcept { return *this = float(*this) + value; }
+	STEPHAN_HOST_DEVICE constexpr bfloat16& operator-=(float value) noexcept { return *this = float(*this) - value; }
+	STEPHAN_HOST_DEVICE constexpr bfloat16& operator*=(float value) noexcept { return *this = float(*this) * value; }
+	STEPHAN_HOST_DEVICE constexpr bfloat16& operator/=(float value) noexcept { return *this = float(*this) / value; }
+};
+
+template <>
+struct compute_type<float16> {
+	typedef float type;
+};
+template <>
+struct compute_type<bfloat16> {
+	typedef float type;
+};
+
+namespace detail {
+template <typename T>
+struct is_half : std::false_type {};
+template <>
+struct is_half<float16> : std::true_type {};
+template <>
+struct is_half<bfloat16> : std::true_type {};
+}
+
+// Layout guarantees, as for the wider types: arrays of complex<float16>
+// are interleaved 16-bit pairs, and so on
+static_assert(std::is_trivially_copyable<float16>::value && std::is_standard_layout<float16>::value);
+static_assert(std::is_trivially_copyable<bfloat16>::value && std::is_standard_layout<bfloat16>::value);
+static_assert((sizeof(float16) == 2) && (sizeof(bfloat16) == 2));
+static_assert(sizeof(complex<float16>) == 2 * sizeof(float16));
+static_assert(sizeof(complex<bfloat16>) == 2 * sizeof(bfloat16));
+static_assert(sizeof(quaternion<float16>) == 4 * sizeof(float16));
+static_assert(sizeof(quaternion<bfloat16>) == 4 * sizeof(bfloat16));
+
+// Spot checks of the rounding
+static_assert(detail::float_to_half(1.0f) == 0x3C00);
+static_assert(detail::float_to_half(65504.0f) == 0x7BFF);
+static_assert(detail::float_to_half(65520.0f) == 0x7C00);
+static_assert(detail::float_to_half(1.0f + 0x1p-11f) == 0x3C00);
+static_assert(detail::float_to_half(1.0f + 0x3p-11f) == 0x3C02);
+static_assert(detail::float_to_half(0x1p-24f) == 0x0001);
+static_assert(detail::half_to_float(0x0001) == 0x1p-24f);
+static_assert(detail::float_to_bfloat16(1.0f + 0x1p-8f) == 0x3F80);
+static_assert(detail::float_to_bfloat16(1.0f + 0x3p-8f) == 0x3F82);
+
+}
+
+namespace std {
+
+template <>
+class numeric_limits<Stephan::float16> {
+public:
+	static constexpr bool is_specialized = true;
+	static constexpr bool is_signed = true;
+	static constexpr bool is_integer = false;
+	static constexpr bool is_exact = false;
+	static constexpr bool has_infinity = true;
+	static constexpr bool has_quiet_NaN = true;
+	static constexpr bool has_signaling_NaN = true;
+	static constexpr float_denorm_style has_denorm = denorm_present;
+	static constexpr bool has_denorm_loss = false;
+	static constexpr float_round_style round_style = round_to_nearest;
+	static constexpr bool is_iec559 = true;
+	static constexpr bool is_bounded = true;
+	static constexpr bool is_modulo = false;
+	static constexpr int digits = 11;
+	static constexpr int digits10 = 3;
+	static constexpr int max_digits10 = 5;
+	static constexpr int radix = 2;
+	static constexpr int min_exponent = -13;
+	static constexpr int min_exponent10 = -4;
+	static constexpr int max_exponent = 16;
+	static constexpr int max_exponent10 = 4;
+	static constexpr bool traps = false;
+	static constexpr bool tinyness_before = false;
+
+	static constexpr Stephan::float16 min() noexcept { return Stephan::float16::from_bits(0x0400); }
+	static constexpr Stephan::float16 lowest() noexcept { return Stephan::float16::from_bits(0xFBFF); }
+	static constexpr Stephan::float16 max() noexcept { return Stephan::float16::from_bits(0x7BFF); }
+	static constexpr Stephan::float16 epsilon() noexcept { return Stephan::float16::from_bits(0x1400); }
+	static constexpr Stephan::float16 round_error() noexcept { return Stephan::float16::from_bits(0x3800); }
+	static constexpr Stephan::float16 infinity() noexcept { return Stephan::float16::from_bits(0x7C00); }
+	static constexpr Stephan::float16 quiet_NaN() noexcept { return Stephan::float16::from_bits(0x7E00); }
+	static constexpr Stephan::float16 signaling_NaN() noexcept { return Stephan::float16::from_bits(0x7D00); }
+	static constexpr Stephan::float16 denorm_min() noexcept { return Stephan::float16::from_bits(0x0001); }
+};
+
+template <>
+class numeric_limits<Stephan::bfloat16> {
+public:
+	static constexpr bool is_specialized = true;
+	static constexpr bool is_signed = true;
+	static constexpr bool is_integer = false;
+	static constexpr bool is_exact = false;
+	static constexpr bool has_infinity = true;
+	static constexpr bool has_quiet_NaN = true;
+	static constexpr bool has_signaling_NaN = true;
+	static constexpr float_denorm_style has_denorm = denorm_present;
+	static constexpr bool has_denorm_loss = false;
+	static constexpr float_round_style round_style = round_to_nearest;
+	static constexpr bool is_iec559 = false;
+	static constexpr bool is_bounded = true;
+	static constexpr bool is_modulo = false;
+	static constexpr int digits = 8;
+	static constexpr int digits10 = 2;
+	static constexpr int max_digits10 = 4;
+	static constexpr int radix = 2;
+	static constexpr int min_exponent = -125;
+	static constexpr int min_exponent10 = -37;
+	static constexpr int max_exponent = 128;
+	static constexpr int max_exponent10 = 38;
+	static constexpr bool traps = false;
+	static constexpr bool tinyness_before = false;
+
+	static constexpr Stephan::bfloat16 min() noexcept { return Stephan::bfloat16::from_bits(0x0080); }
+	static constexpr Stephan::bfloat16 lowest() noexcept { return Stephan::bfloat16::from_bits(0xFF7F); }
+	static constexpr Stephan::bfloat16 max() noexcept { return Stephan::bfloat16::from_bits(0x7F7F); }
+	static constexpr Stephan::bfloat16 epsilon() noexcept { return Stephan::bfloat16::from_bits(0x3C00); }
+	static constexpr Stephan::bfloat16 round_error() noexcept { return Stephan::bfloat16::from_bits(0x3F00); }
+	static constexpr Stephan::bfloat16 infinity() noexcept { return Stephan::bfloat16::from_bits(0x7F80); }
+	static constexpr Stephan::bfloat16 quiet_NaN() noexcept { return Stephan::bfloat16::from_bits(0x7FC0); }
+	static constexpr Stephan::bfloat16 signaling_NaN() noexcept { return Stephan::bfloat16::from_bits(0x7FA0); }
+	static constexpr Stephan::bfloat16 denorm_min() noexcept { return Stephan::bfloat16::from_bits(0x0001); }
+};
+
+}
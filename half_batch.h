@@ -0,0 +1,305 @@
+/*
+Copyright (c) 2022, Dean Stephan
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of {{ project }} nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Provide batch conversion and batch kernels for arrays held in 16-bit floating point
+//      widen(in, out)          out[n] = float(in[n])
+//      narrow(in, out)         out[n] = in[n], rounded to nearest even
+// for spans of float16 or bfloat16 (see half.h) and spans of float, e.g.
+//      Stephan::widen<Stephan::float16>(weights, scratch);
+// These are vectorised on every SIMD target (see simd.h and half_kernels.h).
+//
+// With this header included, the batch functions of complex_batch.h and
+// inplace.h also take spans of complex<H> and quaternion<H>, H float16 or
+// bfloat16:
+//      Stephan::cmul<Stephan::float16>(a, b, out);
+//      Stephan::left_multiply_inplace<Stephan::bfloat16>(q, values);
+// They stream the arrays through a float staging buffer of
+// half_stage_size components that stays in the L1 cache: every chunk is
+// widened, goes through the float kernel and is narrowed on the way out,
+// so each result is computed in float and rounded once, and only the
+// 16-bit data crosses the memory bus. dot and dotc accumulate the chunk
+// sums in float and round once, at the end.
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <type_traits>
+
+#include "complex.h"
+#include "complex_batch.h"
+#include "half.h"
+#include "inplace.h"
+#include "quaternions.h"
+#include "simd.h"
+
+#define STEPHAN_SIMD_KERNELS "half_kernels.h"
+#include "simd_foreach.h"
+
+namespace Stephan {
+
+// Components of float per staging buffer
+inline constexpr std::size_t half_stage_size = 1024;
+
+namespace detail {
+
+template <typename H>
+void half_widen(std::size_t n, const H* in, float* out) {
+	const std::uint16_t* bits = reinterpret_cast<const std::uint16_t*>(in);
+	if constexpr (std::is_same<H, float16>::value) {
+		STEPHAN_SIMD_DISPATCH(float16_widen(n, bits, out));
+	}
+	else {
+		STEPHAN_SIMD_DISPATCH(bfloat16_widen(n, bits, out));
+	}
+}
+
+template <typename H>
+void half_narrow(std::size_t n, const float* in, H* out) {
+	std::uint16_t* bits = reinterpret_cast<std::uint16_t*>(out);
+	if constexpr (std::is_same<H, float16>::value) {
+		STEPHAN_SIMD_DISPATCH(float16_narrow(n, in, bits));
+	}
+	else {
+		STEPHAN_SIMD_DISPATCH(bfloat16_narrow(n, in, bits));
+	}
+}
+
+// One float staging buffer. V is complex or quaternion; values
+// [first, first + count) of an array of V<H> are widened into the buffer
+// and narrowed back out of it.
+class half_stage {
+private:
+	float	components[half_stage_size];
+
+public:
+	template <template <typename> class V, typename H>
+	std::span<V<float>> load(std::span<const V<H>> source, std::size_t first, std::size_t count) {
+		constexpr std::size_t width = sizeof(V<H>) / sizeof(H);
+		assert(count * width <= half_stage_size);
+		half_widen(count * width, reinterpret_cast<const H*>(source.data() + first), this->components);
+		return this->values<V>(count);
+	}
+	template <template <typename> class V, typename H>
+	void store(std::span<V<H>> destination, std::size_t first, std::size_t count) const {
+		constexpr std::size_t width = sizeof(V<H>) / sizeof(H);
+		half_narrow(count * width, this->components, reinterpret_cast<H*>(destination.data() + first));
+	}
+	template <typename H>
+	void store_scalars(std::span<H> destination, std::size_t first, std::size_t count) const {
+		half_narrow(count, this->components, destination.data() + first);
+	}
+
+	template <template <typename> class V>
+	std::span<V<float>> values(std::size_t count) noexcept {
+		return { reinterpret_cast<V<float>*>(this->components), count };
+	}
+	std::span<float> scalars(std::size_t count) noexcept {
+		return { this->components, count };
+	}
+};
+
+// body(first, count) over chunks of n values of N components each
+template <std::size_t N, typename Body>
+void half_chunks(std::size_t n, Body&& body) {
+	constexpr std::size_t chunk = half_stage_size / N;
+	for (std::size_t first = 0; first < n; first += chunk) {
+		body(first, std::min(chunk, n - first));
+	}
+}
+
+template <bool Conjugate, typename H>
+complex<H> half_dot(std::span<const complex<H>> a, std::span<const complex<H>> b) {
+	assert(a.size() == b.size());
+	half_stage x, y;
+	complex<float> sum;
+	half_chunks<2>(a.size(), [&](std::size_t first, std::size_t count) {
+		if constexpr (Conjugate) {
+			sum += dotc<float>(x.load(a, first, count), y.load(b, first, count));
+		}
+		else {
+			sum += dot<float>(x.load(a, first, count), y.load(b, first, count));
+		}
+	});
+	return complex<H>(sum);
+}
+
+}
+
+template <typename H>
+void widen(std::span<const H> in, std::span<float> out) {
+	static_assert(detail::is_half<H>::value);
+	assert(in.size() == out.size());
+	detail::half_widen(in.size(), in.data(), out.data());
+}
+
+template <typename H>
+void narrow(std::span<const float> in, std::span<H> out) {
+	static_assert(detail::is_half<H>::value);
+	assert(in.size() == out.size());
+	detail::half_narrow(in.size(), in.data(), out.data());
+}
+
+// complex_batch.h
+
+template <typename T> requires detail::is_half<T>::value
+void cmul(std::span<const complex<T>> a, std::span<const complex<T>> b, std::span<complex<T>> out) {
+	assert((a.size() == b.size()) && (a.size() == out.size()));
+	detail::half_stage x, y;
+	detail::half_chunks<2>(a.size(), [&](std::size_t first, std::size_t count) {
+		cmul<float>(x.load(a, first, count), y.load(b, first, count), x.values<complex>(count));
+		x.store(out, first, count);
+	});
+}
+
+template <typename T> requires detail::is_half<T>::value
+void conj_mul(std::span<const complex<T>> a, std::span<const complex<T>> b, std::span<complex<T>> out) {
+	assert((a.size() == b.size()) && (a.size() == out.size()));
+	detail::half_stage x, y;
+	detail::half_chunks<2>(a.size(), [&](std::size_t first, std::size_t count) {
+		conj_mul<float>(x.load(a, first, count), y.load(b, first, count), x.values<complex>(count));
+		x.store(out, first, count);
+	});
+}
+
+template <typename T> requires detail::is_half<T>::value
+void cmla(std::span<const complex<T>> a, std::span<const complex<T>> b, std::span<complex<T>> accumulator) {
+	assert((a.size() == b.size()) && (a.size() == accumulator.size()));
+	detail::half_stage x, y, z;
+	detail::half_chunks<2>(a.size(), [&](std::size_t first, std::size_t count) {
+		std::span<complex<float>> sum = z.load(std::span<const complex<T>>(accumulator), first, count);
+		cmla<float>(x.load(a, first, count), y.load(b, first, count), sum);
+		z.store(accumulator, first, count);
+	});
+}
+
+template <typename T> requires detail::is_half<T>::value
+void cdiv(std::span<const complex<T>> a, std::span<const complex<T>> b, std::span<complex<T>> out) {
+	assert((a.size() == b.size()) && (a.size() == out.size()));
+	detail::half_stage x, y;
+	detail::half_chunks<2>(a.size(), [&](std::size_t first, std::size_t count) {
+		cdiv<float>(x.load(a, first, count), y.load(b, first, count), x.values<complex>(count));
+		x.store(out, first, count);
+	});
+}
+
+template <typename T> requires detail::is_half<T>::value
+complex<T> dot(std::span<const complex<T>> a, std::span<const complex<T>> b) {
+	return detail::half_dot<false>(a, b);
+}
+
+template <typename T> requires detail::is_half<T>::value
+complex<T> dotc(std::span<const complex<T>> a, std::span<const complex<T>> b) {
+	return detail::half_dot<true>(a, b);
+}
+
+template <typename T> requires detail::is_half<T>::value
+void abs(std::span<const complex<T>> z, std::span<std::type_identity_t<T>> out) {
+	assert(z.size() == out.size());
+	detail::half_stage x, y;
+	detail::half_chunks<2>(z.size(), [&](std::size_t first, std::size_t count) {
+		abs<float>(x.load(z, first, count), y.scalars(count));
+		y.store_scalars(out, first, count);
+	});
+}
+
+template <typename T> requires detail::is_half<T>::value
+void norm2(std::span<const complex<T>> z, std::span<std::type_identity_t<T>> out) {
+	assert(z.size() == out.size());
+	detail::half_stage x, y;
+	detail::half_chunks<2>(z.size(), [&](std::size_t first, std::size_t count) {
+		norm2<float>(x.load(z, first, count), y.scalars(count));
+		y.store_scalars(out, first, count);
+	});
+}
+
+// inplace.h
+
+namespace detail {
+template <template <typename> class V, typename H, typename Update>
+void half_update(std::span<V<H>> values, Update&& update) {
+	half_stage x;
+	half_chunks<sizeof(V<H>) / sizeof(H)>(values.size(), [&](std::size_t first, std::size_t count) {
+		update(x.load(std::span<const V<H>>(values), first, count));
+		x.store(values, first, count);
+	});
+}
+}
+
+template <typename T> requires detail::is_half<T>::value
+void scale_inplace(std::span<complex<T>> values, std::type_identity_t<T> factor) {
+	detail::half_update(values, [&](std::span<complex<float>> staged) { scale_inplace<float>(staged, factor); });
+}
+template <typename T> requires detail::is_half<T>::value
+void conjugate_inplace(std::span<complex<T>> values) {
+	detail::half_update(values, [](std::span<complex<float>> staged) { conjugate_inplace<float>(staged); });
+}
+template <typename T> requires detail::is_half<T>::value
+void normalize_inplace(std::span<complex<T>> values) {
+	detail::half_update(values, [](std::span<complex<float>> staged) { normalize_inplace<float>(staged); });
+}
+template <typename T> requires detail::is_half<T>::value
+void left_multiply_inplace(const std::type_identity_t<complex<T>>& z, std::span<complex<T>> values) {
+	complex<float> factor(z);
+	detail::half_update(values, [&](std::span<complex<float>> staged) { left_multiply_inplace<float>(factor, staged); });
+}
+template <typename T> requires detail::is_half<T>::value
+void right_multiply_inplace(std::span<complex<T>> values, const std::type_identity_t<complex<T>>& z) {
+	complex<float> factor(z);
+	detail::half_update(values, [&](std::span<complex<float>> staged) { right_multiply_inplace<float>(staged, factor); });
+}
+
+template <typename T> requires detail::is_half<T>::value
+void scale_inplace(std::span<quaternion<T>> values, std::type_identity_t<T> factor) {
+	detail::half_update(values, [&](std::span<quaternion<float>> staged) { scale_inplace<float>(staged, factor); });
+}
+template <typename T> requires detail::is_half<T>::value
+void conjugate_inplace(std::span<quaternion<T>> values) {
+	detail::half_update(values, [](std::span<quaternion<float>> staged) { conjugate_inplace<float>(staged); });
+}
+template <typename T> requires detail::is_half<T>::value
+void normalize_inplace(std::span<quaternion<T>> values) {
+	detail::half_update(values, [](std::span<quaternion<float>> staged) { normalize_inplace<float>(staged); });
+}
+template <typename T> requires detail::is_half<T>::value
+void left_multiply_inplace(const std::type_identity_t<quaternion<T>>& q, std::span<quaternion<T>> values) {
+	quaternion<float> factor(q);
+	detail::half_update(values, [&](std::span<quaternion<float>> staged) { left_multiply_inplace<float>(factor, staged); });
+}
+template <typename T> requires detail::is_half<T>::value
+void right_multiply_inplace(std::span<quaternion<T>> values, const std::type_identity_t<quaternion<T>>& q) {
+	quaternion<float> factor(q);
+	detail::half_update(values, [&](std::span<quaternion<float>> staged) { right_multiply_inplace<float>(staged, factor); });
+}
+
+}
@@ -0,0 +1,113 @@
+/*
+Copyright (c) 2022, Dean Stephan
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of {{ project }} nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Provide the conversion kernels behind half_batch.h
+// This file is included once per SIMD target through simd_foreach.h and
+// must not be included directly. float16 goes through the hardware
+// conversions, 16 values per instruction on AVX-512F and 8 with F16C on
+// the AVX2 target, and through the exact integer conversions of half.h
+// elsewhere. bfloat16 is the upper half of a float, so widening is a
+// shift and narrowing an integer rounding, vectorised on every target.
+// Rounding is to nearest even throughout. As in simd_ops.h, the masked
+// AVX-512 forms avoid a spurious -Wmaybe-uninitialized from GCC.
+
+inline void float16_widen(std::size_t n, const std::uint16_t* in, float* out) {
+	std::size_t k = 0;
+#if defined(STEPHAN_SIMD_TARGET_AVX512)
+	for (; k + 16 <= n; k += 16) {
+		_mm512_storeu_ps(out + k, _mm512_maskz_cvtph_ps(0xFFFF, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + k))));
+	}
+#elif defined(STEPHAN_SIMD_TARGET_AVX2)
+	for (; k + 8 <= n; k += 8) {
+		_mm256_storeu_ps(out + k, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + k))));
+	}
+#elif defined(STEPHAN_SIMD_TARGET_NEON)
+	for (; k + 4 <= n; k += 4) {
+		vst1q_f32(out + k, vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(in + k))));
+	}
+#endif
+	for (; k < n; ++k) {
+		out[k] = ::Stephan::detail::half_to_float(in[k]);
+	}
+}
+
+inline void float16_narrow(std::size_t n, const float* in, std::uint16_t* out) {
+	std::size_t k = 0;
+#if defined(STEPHAN_SIMD_TARGET_AVX512)
+	for (; k + 16 <= n; k += 16) {
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + k), _mm512_maskz_cvtps_ph(0xFFFF, _mm512_loadu_ps(in + k), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC));
+	}
+#elif defined(STEPHAN_SIMD_TARGET_AVX2)
+	for (; k + 8 <= n; k += 8) {
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + k), _mm256_cvtps_ph(_mm256_loadu_ps(in + k), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC));
+	}
+#elif defined(STEPHAN_SIMD_TARGET_NEON)
+	for (; k + 4 <= n; k += 4) {
+		vst1_u16(out + k, vreinterpret_u16_f16(vcvt_f16_f32(vld1q_f32(in + k))));
+	}
+#endif
+	for (; k < n; ++k) {
+		out[k] = ::Stephan::detail::float_to_half(in[k]);
+	}
+}
+
+inline void bfloat16_widen(std::size_t n, const std::uint16_t* in, float* out) {
+	std::size_t k = 0;
+#if !defined(STEPHAN_SIMD_TARGET_SCALAR)
+	typedef typename vector_type<std::uint16_t, vector_bytes / 2>::type halves;
+	for (; k + lanes<float> <= n; k += lanes<float>) {
+		halves stored;
+		std::memcpy(&stored, in + k, sizeof(stored));
+		vec<std::uint32_t> bits = __builtin_convertvector(stored, vec<std::uint32_t>) << 16;
+		std::memcpy(out + k, &bits, sizeof(bits));
+	}
+#endif
+	for (; k < n; ++k) {
+		out[k] = ::Stephan::detail::bfloat16_to_float(in[k]);
+	}
+}
+
+inline void bfloat16_narrow(std::size_t n, const float* in, std::uint16_t* out) {
+	std::size_t k = 0;
+#if !defined(STEPHAN_SIMD_TARGET_SCALAR)
+	typedef typename vector_type<std::uint16_t, vector_bytes / 2>::type halves;
+	for (; k + lanes<float> <= n; k += lanes<float>) {
+		vec<std::uint32_t> bits = load(reinterpret_cast<const std::uint32_t*>(in + k));
+		vec<std::uint32_t> rounded = (bits + 0x7FFF + ((bits >> 16) & 1)) >> 16;
+		vec<std::uint32_t> quiet = (bits >> 16) | 0x40;
+		vec<std::uint32_t> nan = (vec<std::uint32_t>)((bits & 0x7FFFFFFF) > 0x7F800000);
+		halves result = __builtin_convertvector((quiet & nan) | (rounded & ~nan), halves);
+		std::memcpy(out + k, &result, sizeof(result));
+	}
+#endif
+	for (; k < n; ++k) {
+		out[k] = ::Stephan::detail::float_to_bfloat16(in[k]);
+	}
+}
@@ -0,0 +1,118 @@
+/*
+Copyright (c) 2022, Dean Stephan
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of {{ project }} nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Provide orientation propagation from gyroscope samples for many sensors
+// A gyroscope sample is the body-frame angular rate w (rad/s) over a step
+// dt, and the orientation q (body to world, as in quaternion<T>::rotate())
+// moves on by
+//      q = q * exp((0, w dt / 2))
+//      integrate_rate(q, w, dt)            one sample of one sensor
+//      integrate_rates(orientations, x, y, z, dt)
+//                                          a run of samples for every
+//                                          sensor of a quaternion_soa
+// For the batch form the rates are structure-of-arrays over the sensors
+// too, one lane per axis, sample by sample:
+//      x[(sample * count) + n]     x rate of sensor n in that sample
+// with count = orientations.size() and every sensor sampled with the same
+// dt. The samples are applied in order.
+//
+// The batch form never leaves the registers while it works through the
+// samples of a vector of sensors. The exp is the small-angle one: with
+// theta = |w| dt / 2, cos(theta) and sin(theta) / theta are the truncated
+// series of simd_math.h without its range reduction, so there is no
+// division and no special case at theta = 0. It is as accurate as
+// exp(quaternion) for |w| dt <= pi / 2 per sample, a quarter turn, far
+// above what any gyroscope reports at its output rate; past that the
+// error grows with the dropped terms. After every product the norm is
+// pulled back towards 1 with the Newton step of unit_quaternion.h,
+//      q *= (3 - |q|^2) / 2
+// so the orientations have to start out with unit norm, and stay at it
+// to within a few eps however many samples go by.
+//
+// Each task of the thread_pool takes imu_block_size sensors through all of
+// the samples, and the sensors of a task write nothing but their own
+// orientations.
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <span>
+#include <type_traits>
+
+#include "parallel.h"
+#include "quaternion_soa.h"
+#include "quaternions.h"
+#include "simd.h"
+#include "simd_math.h"
+#include "vec3.h"
+
+#define STEPHAN_SIMD_KERNELS "imu_kernels.h"
+#include "simd_foreach.h"
+
+namespace Stephan {
+
+// Sensors per thread task
+inline constexpr std::size_t imu_block_size = 1024;
+
+template <typename T>
+quaternion<T> integrate_rate(const quaternion<T>& q, const vec3<T>& rate, std::type_identity_t<T> dt) {
+	static_assert(std::is_floating_point<T>::value);
+	vec3<T> half = rate * (dt * T(0.5));
+	T angle = std::sqrt(dot(half, half));
+	T vector_scale = (angle == T(0)) ? T(1) : std::sin(angle) / angle;
+	quaternion<T> result = q * quaternion<T>(std::cos(angle), half.x * vector_scale, half.y * vector_scale, half.z * vector_scale);
+	return result * ((T(3) - result.norm2()) * T(0.5));
+}
+
+template <typename T>
+void integrate_rates(quaternion_soa<T>& orientations, std::span<const T> x, std::span<const T> y, std::span<const T> z, std::type_identity_t<T> dt,
+	thread_pool& pool = thread_pool::shared()) {
+	static_assert(std::is_floating_point<T>::value);
+	std::size_t count = orientations.size();
+	assert((y.size() == x.size()) && (z.size() == x.size()));
+	assert((count == 0) ? x.empty() : (x.size() % count) == 0);
+	if (count == 0) {
+		return;
+	}
+	std::size_t samples = x.size() / count;
+	std::size_t tasks = (count + imu_block_size - 1) / imu_block_size;
+	pool.run(tasks, [&](std::size_t task) {
+		std::size_t first = task * imu_block_size;
+		std::size_t length = std::min(imu_block_size, count - first);
+		const T* const rates[3] = { x.data() + first, y.data() + first, z.data() + first };
+		T* const parts[4] = { orientations.Re().data() + first, orientations.Im1().data() + first,
+			orientations.Im2().data() + first, orientations.Im3().data() + first };
+		STEPHAN_SIMD_DISPATCH(imu_integrate<T>(length, count, samples, rates, dt * T(0.5), parts));
+	});
+}
+
+}
@@ -0,0 +1,101 @@
+/*
+Copyright (c) 2022, Dean Stephan
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of {{ project }} nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Provide the batch kernels behind imu.h
+// This file is included once per SIMD target through simd_foreach.h and
+// must not be included directly. Orientations are structure-of-arrays
+// lanes (real, i, j, k), as in quaternion_soa_kernels.h, and the rates one
+// lane per axis with one row of stride values per sample.
+
+// q = q * exp((0, w half_dt)), then one Newton step towards unit norm
+template <typename T>
+STEPHAN_FORCE_INLINE void imu_step(vec<T> (&q)[4], vec<T> x, vec<T> y, vec<T> z, const vec<T>& half_dt) {
+	typedef ::Stephan::simd::detail::float_format<T> format;
+	x = x * half_dt;
+	y = y * half_dt;
+	z = z * half_dt;
+	vec<T> angle2 = (x * x) + (y * y) + (z * z);
+	vec<T> c = horner<T>(angle2, format::cos_terms);
+	vec<T> s = horner<T>(angle2, format::sin_terms);
+	x = x * s;
+	y = y * s;
+	z = z * s;
+	vec<T> r0 = (q[0] * c) - (q[1] * x) - (q[2] * y) - (q[3] * z);
+	vec<T> r1 = (q[0] * x) + (q[1] * c) + (q[2] * z) - (q[3] * y);
+	vec<T> r2 = (q[0] * y) + (q[2] * c) + (q[3] * x) - (q[1] * z);
+	vec<T> r3 = (q[0] * z) + (q[3] * c) + (q[1] * y) - (q[2] * x);
+	vec<T> scale = (broadcast(T(3)) - ((r0 * r0) + (r1 * r1) + (r2 * r2) + (r3 * r3))) * broadcast(T(0.5));
+	q[0] = r0 * scale;
+	q[1] = r1 * scale;
+	q[2] = r2 * scale;
+	q[3] = r3 * scale;
+}
+
+// Apply samples rows of rates to the n orientations in q. The rates of
+// sample s for sensor m are rates[axis][(s * stride) + m].
+template <typename T>
+void imu_integrate(std::size_t n, std::size_t stride, std::size_t samples, const T* const (&rates)[3], T half_dt, T* const (&q)[4]) {
+	constexpr std::size_t width = lanes<T>;
+	vec<T> half = broadcast(half_dt);
+	std::size_t offset = 0;
+	for (; offset + width <= n; offset += width) {
+		vec<T> value[4] = { load(q[0] + offset), load(q[1] + offset), load(q[2] + offset), load(q[3] + offset) };
+		for (std::size_t sample = 0; sample < samples; ++sample) {
+			std::size_t at = (sample * stride) + offset;
+			imu_step<T>(value, load(rates[0] + at), load(rates[1] + at), load(rates[2] + at), half);
+		}
+		for (std::size_t c = 0; c < 4; ++c) {
+			store(q[c] + offset, value[c]);
+		}
+	}
+
+	// The last sensors go through zero-padded copies; the padding lanes
+	// stay at zero
+	std::size_t remaining = n - offset;
+	if (remaining == 0) {
+		return;
+	}
+	T tail[4][width] = {};
+	for (std::size_t c = 0; c < 4; ++c) {
+		std::memcpy(tail[c], q[c] + offset, remaining * sizeof(T));
+	}
+	vec<T> value[4] = { load(tail[0]), load(tail[1]), load(tail[2]), load(tail[3]) };
+	for (std::size_t sample = 0; sample < samples; ++sample) {
+		T rate[3][width] = {};
+		for (std::size_t axis = 0; axis < 3; ++axis) {
+			std::memcpy(rate[axis], rates[axis] + (sample * stride) + offset, remaining * sizeof(T));
+		}
+		imu_step<T>(value, load(rate[0]), load(rate[1]), load(rate[2]), half);
+	}
+	for (std::size_t c = 0; c < 4; ++c) {
+		store(tail[c], value[c]);
+		std::memcpy(q[c] + offset, tail[c], remaining * sizeof(T));
+	}
+}
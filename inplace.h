@@ -0,0 +1,240 @@
+/*
+Copyright (c) 2022, Dean Stephan
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of {{ project }} nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Provide in-place batch updates
+// These overwrite the caller's values rather than writing to a second
+// array, so an update loop needs no scratch memory at all:
+//      scale_inplace(values, s)            values[n] *= s
+//      conjugate_inplace(values)           values[n] = values[n].conjugate()
+//      normalize_inplace(values)           values[n] /= values[n].norm()
+//      left_multiply_inplace(q, values)    values[n] = q * values[n]
+//      right_multiply_inplace(values, q)   values[n] = values[n] * q
+// values is a std::span of complex<T>, quaternion<T> or octonion<T>, or a
+// quaternion_soa<T>, e.g.
+//      Stephan::normalize_inplace<float>(orientations);
+// The complex and quaternion forms run on the SIMD
+// kernels (see simd.h): spans are processed as interleaved records, and
+// quaternion_soa<T> lane by lane. The octonion forms are plain loops over
+// the force-inlined Cayley-Dickson operators.
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <type_traits>
+
+#include "cayley_dickson.h"
+#include "complex.h"
+#include "expression.h"
+#include "quaternion_soa.h"
+#include "quaternions.h"
+#include "simd.h"
+
+#define STEPHAN_SIMD_KERNELS "inplace_kernels.h"
+#include "simd_foreach.h"
+
+namespace Stephan {
+namespace detail {
+
+// Interleaved records of N components
+template <typename T>
+struct inplace_records;
+template <typename T>
+struct inplace_records<complex<T>> {
+	typedef T scalar_type;
+	static constexpr int dimension = 2;
+	static void components(const complex<T>& value, T (&c)[2]) {
+		c[0] = value.Re();
+		c[1] = value.Im();
+	}
+};
+template <typename T>
+struct inplace_records<quaternion<T>> {
+	typedef T scalar_type;
+	static constexpr int dimension = 4;
+	static void components(const quaternion<T>& value, T (&c)[4]) {
+		c[0] = value.Re();
+		c[1] = value.Im1();
+		c[2] = value.Im2();
+		c[3] = value.Im3();
+	}
+};
+
+template <typename V>
+typename inplace_records<V>::scalar_type* record_data(std::span<V> values) {
+	return reinterpret_cast<typename inplace_records<V>::scalar_type*>(values.data());
+}
+
+template <typename V>
+void scale_records(std::span<V> values, typename inplace_records<V>::scalar_type factor) {
+	typedef typename inplace_records<V>::scalar_type T;
+	static_assert(std::is_floating_point<T>::value);
+	STEPHAN_SIMD_DISPATCH(inplace_scale<T>(values.size() * inplace_records<V>::dimension, record_data(values), factor));
+}
+template <typename V>
+void conjugate_records(std::span<V> values) {
+	typedef typename inplace_records<V>::scalar_type T;
+	static_assert(std::is_floating_point<T>::value);
+	STEPHAN_SIMD_DISPATCH(inplace_conjugate<T, inplace_records<V>::dimension>(values.size(), record_data(values)));
+}
+template <typename V>
+void normalize_records(std::span<V> values) {
+	typedef typename inplace_records<V>::scalar_type T;
+	static_assert(std::is_floating_point<T>::value);
+	STEPHAN_SIMD_DISPATCH(inplace_normalize<T, inplace_records<V>::dimension>(values.size(), record_data(values)));
+}
+template <bool Left, typename V>
+void multiply_records(const V& q, std::span<V> values) {
+	typedef typename inplace_records<V>::scalar_type T;
+	static_assert(std::is_floating_point<T>::value);
+	constexpr int N = inplace_records<V>::dimension;
+	T factor[N];
+	inplace_records<V>::components(q, factor);
+	STEPHAN_SIMD_DISPATCH(inplace_multiply<T, N, Left>(values.size(), factor, record_data(values)));
+}
+
+}
+
+// Spans of complex<T> and quaternion<T>
+
+template <typename T>
+void scale_inplace(std::span<complex<T>> values, std::type_identity_t<T> factor) {
+	detail::scale_records(values, factor);
+}
+template <typename T>
+void conjugate_inplace(std::span<complex<T>> values) {
+	detail::conjugate_records(values);
+}
+template <typename T>
+void normalize_inplace(std::span<complex<T>> values) {
+	detail::normalize_records(values);
+}
+template <typename T>
+void left_multiply_inplace(const std::type_identity_t<complex<T>>& z, std::span<complex<T>> values) {
+	detail::multiply_records<true>(z, values);
+}
+template <typename T>
+void right_multiply_inplace(std::span<complex<T>> values, const std::type_identity_t<complex<T>>& z) {
+	detail::multiply_records<false>(z, values);
+}
+
+template <typename T>
+void scale_inplace(std::span<quaternion<T>> values, std::type_identity_t<T> factor) {
+	detail::scale_records(values, factor);
+}
+template <typename T>
+void conjugate_inplace(std::span<quaternion<T>> values) {
+	detail::conjugate_records(values);
+}
+template <typename T>
+void normalize_inplace(std::span<quaternion<T>> values) {
+	detail::normalize_records(values);
+}
+template <typename T>
+void left_multiply_inplace(const std::type_identity_t<quaternion<T>>& q, std::span<quaternion<T>> values) {
+	detail::multiply_records<true>(q, values);
+}
+template <typename T>
+void right_multiply_inplace(std::span<quaternion<T>> values, const std::type_identity_t<quaternion<T>>& q) {
+	detail::multiply_records<false>(q, values);
+}
+
+// quaternion_soa<T>
+
+template <typename T>
+void scale_inplace(quaternion_soa<T>& values, std::type_identity_t<T> factor) {
+	static_assert(std::is_floating_point<T>::value);
+	for (std::span<T> lane : { values.Re(), values.Im1(), values.Im2(), values.Im3() }) {
+		STEPHAN_SIMD_DISPATCH(inplace_scale<T>(lane.size(), lane.data(), factor));
+	}
+}
+
+template <typename T>
+void conjugate_inplace(quaternion_soa<T>& values) {
+	static_assert(std::is_floating_point<T>::value);
+	for (std::span<T> lane : { values.Im1(), values.Im2(), values.Im3() }) {
+		STEPHAN_SIMD_DISPATCH(inplace_scale<T>(lane.size(), lane.data(), T(-1)));
+	}
+}
+
+template <typename T>
+void normalize_inplace(quaternion_soa<T>& values) {
+	normalize(values, values);
+}
+
+template <typename T>
+void left_multiply_inplace(const quaternion<T>& q, quaternion_soa<T>& values) {
+	values = q * values;
+}
+
+template <typename T>
+void right_multiply_inplace(quaternion_soa<T>& values, const quaternion<T>& q) {
+	values = values * q;
+}
+
+// Spans of octonions and the other Cayley-Dickson algebras
+
+template <typename Base>
+void scale_inplace(std::span<cayley_dickson<Base>> values, typename cayley_dickson<Base>::value_type factor) {
+	for (cayley_dickson<Base>& value : values) {
+		value *= factor;
+	}
+}
+
+template <typename Base>
+void conjugate_inplace(std::span<cayley_dickson<Base>> values) {
+	for (cayley_dickson<Base>& value : values) {
+		value = value.conjugate();
+	}
+}
+
+template <typename Base>
+void normalize_inplace(std::span<cayley_dickson<Base>> values) {
+	typedef typename cayley_dickson<Base>::value_type T;
+	static_assert(std::is_floating_point<T>::value);
+	for (cayley_dickson<Base>& value : values) {
+		value *= T(1) / value.norm();
+	}
+}
+
+template <typename Base>
+void left_multiply_inplace(const std::type_identity_t<cayley_dickson<Base>>& q, std::span<cayley_dickson<Base>> values) {
+	for (cayley_dickson<Base>& value : values) {
+		value = q * value;
+	}
+}
+
+template <typename Base>
+void right_multiply_inplace(std::span<cayley_dickson<Base>> values, const std::type_identity_t<cayley_dickson<Base>>& q) {
+	for (cayley_dickson<Base>& value : values) {
+		value *= q;
+	}
+}
+
+}
@@ -0,0 +1,107 @@
+/*
+Copyright (c) 2022, Dean Stephan
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of {{ project }} nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Provide the batch kernels behind inplace.h
+// This file is included once per SIMD target through simd_foreach.h and
+// must not be included directly. The record kernels work on n interleaved
+// records of N = 2 (complex) or N = 4 (quaternion) components and write
+// back to the same memory.
+
+// Product of two records: c = a * b
+template <typename T, int N>
+STEPHAN_FORCE_INLINE void record_product(const vec<T> (&a)[N], const vec<T> (&b)[N], vec<T> (&c)[N]) {
+	product_lanes<T, N>(a, b, c);
+}
+
+// data[n] *= factor over n plain values
+template <typename T>
+void inplace_scale(std::size_t n, T* data, T factor) {
+	const T* const in[1] = { data };
+	T* const out[1] = { data };
+	vec<T> scale = broadcast(factor);
+	for_each_block(n, in, out, [scale](const T* const* x, T* const* r, std::size_t offset) {
+		store(r[0] + offset, load(x[0] + offset) * scale);
+	});
+}
+
+template <typename T, int N>
+void inplace_conjugate(std::size_t n, T* data) {
+	const T* const in[1] = { data };
+	T* const out[1] = { data };
+	for_each_block<N, N>(n, in, out, [](const T* const* x, T* const* r, std::size_t offset) {
+		vec<T> c[N];
+		load_interleaved<N>(x[0] + (N * offset), c);
+		for (int k = 1; k < N; ++k) {
+			c[k] = -c[k];
+		}
+		store_interleaved<N>(r[0] + (N * offset), c);
+	});
+}
+
+template <typename T, int N>
+void inplace_normalize(std::size_t n, T* data) {
+	const T* const in[1] = { data };
+	T* const out[1] = { data };
+	for_each_block<N, N>(n, in, out, [](const T* const* x, T* const* r, std::size_t offset) {
+		vec<T> c[N];
+		load_interleaved<N>(x[0] + (N * offset), c);
+		vec<T> sum = c[0] * c[0];
+		for (int k = 1; k < N; ++k) {
+			sum = sum + (c[k] * c[k]);
+		}
+		vec<T> scale = broadcast(T(1)) / sqrt(sum);
+		for (int k = 0; k < N; ++k) {
+			c[k] = c[k] * scale;
+		}
+		store_interleaved<N>(r[0] + (N * offset), c);
+	});
+}
+
+// data[n] = q * data[n] (Left) or data[n] * q
+template <typename T, int N, bool Left>
+void inplace_multiply(std::size_t n, const T (&q)[N], T* data) {
+	const T* const in[1] = { data };
+	T* const out[1] = { data };
+	vec<T> factor[N];
+	for (int k = 0; k < N; ++k) {
+		factor[k] = broadcast(q[k]);
+	}
+	for_each_block<N, N>(n, in, out, [&factor](const T* const* x, T* const* r, std::size_t offset) {
+		vec<T> c[N], result[N];
+		load_interleaved<N>(x[0] + (N * offset), c);
+		if constexpr (Left) {
+			record_product<T, N>(factor, c, result);
+		}
+		else {
+			record_product<T, N>(c, factor, result);
+		}
+		store_interleaved<N>(r[0] + (N * offset), result);
+	});
+}
@@ -0,0 +1,456 @@
+/*
+Copyright (c) 2022, Dean Stephan
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of {{ project }} nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Provide opt-in counters and timings for the hot paths of the library
+// Built with STEPHAN_INSTRUMENTATION defined, e.g. -DSTEPHAN_INSTRUMENTATION,
+//      - every division, reciprocal, norm, square root and normalization of
+//        the value types (complex, quaternion, the Cayley-Dickson algebras,
+//        unit and dual quaternions) is counted per type and per operation,
+//        and its result checked for NaN and subnormal components
+//      - every batch kernel started through STEPHAN_SIMD_DISPATCH is timed,
+//        per kernel and per thread
+// and take_snapshot() returns everything counted so far, for export to a
+// metrics system:
+//      for (const auto& record : Stephan::instrumentation::take_snapshot().operations) {
+//          gauge(std::string(record.type) + "." + operation_name(record.op), record.calls);
+//      }
+// Without STEPHAN_INSTRUMENTATION the hooks expand to nothing, so the library
+// compiles to exactly the same code as before, and take_snapshot() returns
+// an empty snapshot; the exporting code needs no #if of its own.
+//
+// When enabled, each thread counts into its own block, so the hooks take no
+// lock and share no cache lines. take_snapshot() and reset() lock the list
+// of blocks, and the counts of threads that have exited are kept in one
+// block of their own. Counting is not free: it costs a thread_local access
+// and, for the checks, a few compares per call, and a batch kernel two clock
+// reads. Operations evaluated at compile time, and device code, are never
+// counted. Only floating point components are checked for subnormals; the
+// 16-bit storage types (half.h) are checked for NaN in float, and fixed
+// point never is NaN. The batch kernels are timed but their outputs are not
+// checked.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace Stephan {
+namespace instrumentation {
+
+#if defined(STEPHAN_INSTRUMENTATION) && !defined(__CUDA_ARCH__) && !defined(__HIP_DEVICE_COMPILE__)
+inline constexpr bool enabled = true;
+#else
+inline constexpr bool enabled = false;
+#endif
+
+enum class operation {
+	divide,
+	reciprocal,
+	norm,
+	sqrt,
+	normalize
+};
+inline constexpr std::size_t operations = 5;
+
+constexpr const char* operation_name(operation op) noexcept {
+	constexpr const char* names[operations] = { "divide", "reciprocal", "norm", "sqrt", "normalize" };
+	return names[static_cast<std::size_t>(op)];
+}
+
+// Calls of one operation on one type, and how many of them gave a result
+// with a NaN or a subnormal component
+struct operation_record {
+	std::string_view	type;
+	operation		op;
+	std::uint64_t		calls;
+	std::uint64_t		nan;
+	std::uint64_t		denormal;
+};
+
+struct kernel_record {
+	std::string_view	kernel;
+	std::uint64_t		calls;
+	std::uint64_t		nanoseconds;
+};
+
+// Kernel timings of one thread. Threads are numbered in the order they
+// first recorded anything, from 0; the ones that have exited are summed up
+// under thread retired_thread.
+struct thread_record {
+	static constexpr std::uint64_t retired_thread = ~std::uint64_t(0);
+
+	std::uint64_t			thread;
+	std::vector<kernel_record>	kernels;
+};
+
+// Only entries with at least one call are listed. kernels sums threads.
+struct snapshot {
+	std::vector<operation_record>	operations;
+	std::vector<kernel_record>	kernels;
+	std::vector<thread_record>	threads;
+};
+
+}
+}
+
+#if defined(STEPHAN_INSTRUMENTATION) && !defined(__CUDA_ARCH__) && !defined(__HIP_DEVICE_COMPILE__)
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <typeinfo>
+
+namespace Stephan {
+namespace instrumentation {
+namespace detail {
+
+// Types and kernels past these share the last slot, named "other"
+inline constexpr std::size_t max_types = 64;
+inline constexpr std::size_t max_kernels = 128;
+
+// Names handed out to slots, in slot order. They never move or go away.
+class name_table {
+private:
+	std::mutex		mutex;
+	std::string		names[max_kernels];
+	std::atomic<std::size_t>	used{ 0 };
+	std::size_t		capacity;
+
+public:
+	explicit name_table(std::size_t capacity) : capacity(capacity) {}
+
+	std::size_t slot(std::string_view name) {
+		std::scoped_lock lock(this->mutex);
+		std::size_t count = this->used.load(std::memory_order_relaxed);
+		for (std::size_t n = 0; n < count; ++n) {
+			if (this->names[n] == name) {
+				return n;
+			}
+		}
+		if (count == this->capacity - 1) {
+			this->names[count] = "other";
+			this->used.store(count + 1, std::memory_order_release);
+			return count;
+		}
+		if (count == this->capacity) {
+			return count - 1;
+		}
+		this->names[count] = name;
+		this->used.store(count + 1, std::memory_order_release);
+		return count;
+	}
+	std::size_t size() const noexcept { return this->used.load(std::memory_order_acquire); }
+	std::string_view name(std::size_t slot) const noexcept { return this->names[slot]; }
+};
+
+inline name_table& type_names() {
+	static name_table table(max_types);
+	return table;
+}
+inline name_table& kernel_names() {
+	static name_table table(max_kernels);
+	return table;
+}
+
+// The type as the compiler spells it, e.g. "Stephan::complex<float>"
+template <typename V>
+std::string_view type_name() {
+#if defined(__clang__) || defined(__GNUC__)
+	std::string_view signature = __PRETTY_FUNCTION__;
+	std::size_t first = signature.find("V = ");
+	if (first != std::string_view::npos) {
+		first += 4;
+		std::size_t last = signature.find_first_of(";]", first);
+		return signature.substr(first, last - first);
+	}
+#endif
+	return typeid(V).name();
+}
+
+template <typename V>
+std::size_t type_slot() {
+	static const std::size_t slot = type_names().slot(type_name<V>());
+	return slot;
+}
+
+// The kernel name of a dispatch, the text before its template arguments
+inline std::size_t kernel_slot(std::string_view call) {
+	return kernel_names().slot(call.substr(0, call.find_first_of("<( ")));
+}
+
+// One writer per counter, so a relaxed load and store is enough
+inline void bump(std::atomic<std::uint64_t>& counter, std::uint64_t amount = 1) noexcept {
+	counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+struct counters {
+	std::atomic<std::uint64_t>	calls[max_types][operations] = {};
+	std::atomic<std::uint64_t>	nan[max_types][operations] = {};
+	std::atomic<std::uint64_t>	denormal[max_types][operations] = {};
+	std::atomic<std::uint64_t>	kernel_calls[max_kernels] = {};
+	std::atomic<std::uint64_t>	kernel_nanoseconds[max_kernels] = {};
+
+	void add_to(counters& total) const noexcept {
+		for (std::size_t t = 0; t < max_types; ++t) {
+			for (std::size_t o = 0; o < operations; ++o) {
+				bump(total.calls[t][o], this->calls[t][o].load(std::memory_order_relaxed));
+				bump(total.nan[t][o], this->nan[t][o].load(std::memory_order_relaxed));
+				bump(total.denormal[t][o], this->denormal[t][o].load(std::memory_order_relaxed));
+			}
+		}
+		for (std::size_t k = 0; k < max_kernels; ++k) {
+			bump(total.kernel_calls[k], this->kernel_calls[k].load(std::memory_order_relaxed));
+			bump(total.kernel_nanoseconds[k], this->kernel_nanoseconds[k].load(std::memory_order_relaxed));
+		}
+	}
+	void clear() noexcept {
+		for (std::size_t t = 0; t < max_types; ++t) {
+			for (std::size_t o = 0; o < operations; ++o) {
+				this->calls[t][o].store(0, std::memory_order_relaxed);
+				this->nan[t][o].store(0, std::memory_order_relaxed);
+				this->denormal[t][o].store(0, std::memory_order_relaxed);
+			}
+		}
+		for (std::size_t k = 0; k < max_kernels; ++k) {
+			this->kernel_calls[k].store(0, std::memory_order_relaxed);
+			this->kernel_nanoseconds[k].store(0, std::memory_order_relaxed);
+		}
+	}
+};
+
+struct thread_counters;
+
+struct registry {
+	std::mutex			mutex;
+	std::vector<thread_counters*>	live;
+	counters			retired;
+	std::uint64_t			next_thread = 0;
+
+	static registry& instance() {
+		static registry value;
+		return value;
+	}
+};
+
+// The block of the calling thread, registered on first use and folded
+// into the retired counts when the thread exits
+struct thread_counters : counters {
+	std::uint64_t	thread;
+
+	thread_counters() {
+		registry& list = registry::instance();
+		std::scoped_lock lock(list.mutex);
+		this->thread = list.next_thread++;
+		list.live.push_back(this);
+	}
+	thread_counters(const thread_counters&) = delete;
+	thread_counters& operator=(const thread_counters&) = delete;
+	~thread_counters() {
+		registry& list = registry::instance();
+		std::scoped_lock lock(list.mutex);
+		this->add_to(list.retired);
+		std::erase(list.live, this);
+	}
+
+	static thread_counters& current() {
+		thread_local thread_counters block;
+		return block;
+	}
+};
+
+template <typename S>
+void check_component(const S& value, bool& nan, bool& denormal) noexcept {
+	if constexpr (std::is_floating_point<S>::value) {
+		int kind = std::fpclassify(value);
+		nan = nan || (kind == FP_NAN);
+		denormal = denormal || (kind == FP_SUBNORMAL);
+	}
+	else if constexpr (std::is_constructible<float, S>::value) {
+		nan = nan || std::isnan(static_cast<float>(value));
+	}
+}
+
+// The components of any of the value types, or a scalar
+template <typename V>
+void check(const V& value, bool& nan, bool& denormal) noexcept {
+	if constexpr (requires { value.dual(); }) {
+		check(value.real(), nan, denormal);
+		check(value.dual(), nan, denormal);
+	}
+	else if constexpr (requires { value.Im3(); }) {
+		check_component(value.Re(), nan, denormal);
+		check_component(value.Im1(), nan, denormal);
+		check_component(value.Im2(), nan, denormal);
+		check_component(value.Im3(), nan, denormal);
+	}
+	else if constexpr (requires { value.Im(); }) {
+		check_component(value.Re(), nan, denormal);
+		check_component(value.Im(), nan, denormal);
+	}
+	else if constexpr (requires { V::dimension; value[0]; }) {
+		for (std::size_t n = 0; n < V::dimension; ++n) {
+			check_component(value[n], nan, denormal);
+		}
+	}
+	else {
+		check_component(value, nan, denormal);
+	}
+}
+
+template <typename V, typename R>
+void record(operation op, const R& result) noexcept {
+	thread_counters& block = thread_counters::current();
+	std::size_t type = type_slot<V>();
+	std::size_t index = static_cast<std::size_t>(op);
+	bump(block.calls[type][index]);
+	bool nan = false, denormal = false;
+	check(result, nan, denormal);
+	if (nan) {
+		bump(block.nan[type][index]);
+	}
+	if (denormal) {
+		bump(block.denormal[type][index]);
+	}
+}
+
+class kernel_timer {
+private:
+	std::size_t					slot;
+	std::chrono::steady_clock::time_point		start;
+
+public:
+	explicit kernel_timer(std::size_t slot) noexcept
+		: slot(slot)
+		, start(std::chrono::steady_clock::now())
+	{}
+	kernel_timer(const kernel_timer&) = delete;
+	kernel_timer& operator=(const kernel_timer&) = delete;
+	~kernel_timer() {
+		auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - this->start);
+		thread_counters& block = thread_counters::current();
+		bump(block.kernel_calls[this->slot]);
+		bump(block.kernel_nanoseconds[this->slot], static_cast<std::uint64_t>(elapsed.count()));
+	}
+};
+
+inline std::vector<kernel_record> kernel_records(const counters& source) {
+	std::vector<kernel_record> result;
+	name_table& names = kernel_names();
+	for (std::size_t k = 0; k < names.size(); ++k) {
+		std::uint64_t calls = source.kernel_calls[k].load(std::memory_order_relaxed);
+		if (calls != 0) {
+			result.push_back(kernel_record{ names.name(k), calls, source.kernel_nanoseconds[k].load(std::memory_order_relaxed) });
+		}
+	}
+	return result;
+}
+
+}
+
+inline snapshot take_snapshot() {
+	detail::registry& list = detail::registry::instance();
+	std::scoped_lock lock(list.mutex);
+	snapshot result;
+	detail::counters total;
+	list.retired.add_to(total);
+	for (const detail::thread_counters* block : list.live) {
+		block->add_to(total);
+		std::vector<kernel_record> kernels = detail::kernel_records(*block);
+		if (!kernels.empty()) {
+			result.threads.push_back(thread_record{ block->thread, std::move(kernels) });
+		}
+	}
+	std::vector<kernel_record> retired = detail::kernel_records(list.retired);
+	if (!retired.empty()) {
+		result.threads.push_back(thread_record{ thread_record::retired_thread, std::move(retired) });
+	}
+	result.kernels = detail::kernel_records(total);
+
+	detail::name_table& types = detail::type_names();
+	for (std::size_t t = 0; t < types.size(); ++t) {
+		for (std::size_t o = 0; o < operations; ++o) {
+			std::uint64_t calls = total.calls[t][o].load(std::memory_order_relaxed);
+			if (calls != 0) {
+				result.operations.push_back(operation_record{ types.name(t), static_cast<operation>(o), calls,
+					total.nan[t][o].load(std::memory_order_relaxed), total.denormal[t][o].load(std::memory_order_relaxed) });
+			}
+		}
+	}
+	return result;
+}
+
+// Set every count back to zero. Counts made by other threads while this
+// runs may or may not survive it.
+inline void reset() {
+	detail::registry& list = detail::registry::instance();
+	std::scoped_lock lock(list.mutex);
+	list.retired.clear();
+	for (detail::thread_counters* block : list.live) {
+		block->clear();
+	}
+}
+
+}
+}
+
+// Count op on a V, with the result it produced. Skipped in constant
+// evaluation, where nothing can be recorded.
+#define STEPHAN_INSTRUMENT(V, op, result) \
+	do { \
+		if (!std::is_constant_evaluated()) { \
+			::Stephan::instrumentation::detail::record<V>(::Stephan::instrumentation::operation::op, result); \
+		} \
+	} while (0)
+
+// Time the rest of the enclosing block as one run of kernel, the text of
+// a STEPHAN_SIMD_DISPATCH call
+#define STEPHAN_INSTRUMENT_KERNEL(kernel) \
+	static const std::size_t stephan_kernel_slot = ::Stephan::instrumentation::detail::kernel_slot(kernel); \
+	::Stephan::instrumentation::detail::kernel_timer stephan_kernel_timer(stephan_kernel_slot)
+
+#else
+
+namespace Stephan {
+namespace instrumentation {
+
+inline snapshot take_snapshot() { return snapshot(); }
+inline void reset() {}
+
+}
+}
+
+#define STEPHAN_INSTRUMENT(V, op, result) ((void)0)
+#define STEPHAN_INSTRUMENT_KERNEL(kernel) ((void)0)
+
+#endif
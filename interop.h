@@ -0,0 +1,223 @@
+/*
+Copyright (c) 2022, Dean Stephan
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of {{ project }} nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Provide zero-copy views of foreign buffers as complex numbers, quaternions and octonions
+// complex<T>, quaternion<T> and octonion<T> are dense arrays of their real
+// components, real part first (see the layout guarantees at the end of
+// each header), so buffers with the same layout are reinterpreted in place
+// rather than converted value by value:
+//      as_complex(values)          std::complex<T>[n]           -> complex<T>[n]
+//      as_std_complex(values)      complex<T>[n]                -> std::complex<T>[n]
+//      as_complex(components)      T[2 n], (re, im) pairs       -> complex<T>[n]
+//      as_quaternions(components)  T[4 n], (w, x, y, z) records -> quaternion<T>[n]
+//      as_octonions(components)    T[8 n], (e0, ..., e7)        -> octonion<T>[n]
+// Each returns a std::span over the caller's memory, const if the input
+// was, so the results go straight to the batch functions, e.g.
+//      Stephan::normalize_inplace<float>(Stephan::as_quaternions(std::span<float>(dma_buffer, 4 * n)));
+//
+// Quaternions stored with the real part last, (x, y, z, w) as in Eigen or
+// most sensor and graphics APIs, have no such reinterpretation.
+// quaternion_view<T, component_order::xyzw> maps the order on each access
+// instead, which costs no more than the loads and stores themselves:
+//      quaternion_view<float, component_order::xyzw> view(components);
+//      view[n] = q * view[n];
+// The view is non-owning like a span; a view over const T is read only.
+// eigen_interop.h gives such views over arrays of Eigen::Quaternion.
+#pragma once
+
+#include <cassert>
+#include <complex>
+#include <cstddef>
+#include <iterator>
+#include <span>
+#include <type_traits>
+
+#include "complex.h"
+#include "octonions.h"
+#include "quaternions.h"
+
+namespace Stephan {
+
+static_assert(sizeof(std::complex<float>) == sizeof(complex<float>));
+static_assert(sizeof(std::complex<double>) == sizeof(complex<double>));
+
+namespace detail {
+// S with the constness of From
+template <typename From, typename S>
+using interop_like = std::conditional_t<std::is_const<From>::value, const S, S>;
+}
+
+template <typename T>
+std::span<complex<T>> as_complex(std::span<std::complex<T>> values) noexcept {
+	return { reinterpret_cast<complex<T>*>(values.data()), values.size() };
+}
+template <typename T>
+std::span<const complex<T>> as_complex(std::span<const std::complex<T>> values) noexcept {
+	return { reinterpret_cast<const complex<T>*>(values.data()), values.size() };
+}
+
+template <typename T>
+std::span<std::complex<T>> as_std_complex(std::span<complex<T>> values) noexcept {
+	return { reinterpret_cast<std::complex<T>*>(values.data()), values.size() };
+}
+template <typename T>
+std::span<const std::complex<T>> as_std_complex(std::span<const complex<T>> values) noexcept {
+	return { reinterpret_cast<const std::complex<T>*>(values.data()), values.size() };
+}
+
+// Interleaved T buffers. T may be const.
+template <typename T>
+std::span<detail::interop_like<T, complex<std::remove_const_t<T>>>> as_complex(std::span<T> components) noexcept {
+	static_assert(std::is_arithmetic<T>::value);
+	assert((components.size() % 2) == 0);
+	return { reinterpret_cast<detail::interop_like<T, complex<std::remove_const_t<T>>>*>(components.data()), components.size() / 2 };
+}
+template <typename T>
+std::span<detail::interop_like<T, quaternion<std::remove_const_t<T>>>> as_quaternions(std::span<T> components) noexcept {
+	static_assert(std::is_arithmetic<T>::value);
+	assert((components.size() % 4) == 0);
+	return { reinterpret_cast<detail::interop_like<T, quaternion<std::remove_const_t<T>>>*>(components.data()), components.size() / 4 };
+}
+template <typename T>
+std::span<detail::interop_like<T, octonion<std::remove_const_t<T>>>> as_octonions(std::span<T> components) noexcept {
+	static_assert(std::is_arithmetic<T>::value);
+	assert((components.size() % 8) == 0);
+	return { reinterpret_cast<detail::interop_like<T, octonion<std::remove_const_t<T>>>*>(components.data()), components.size() / 8 };
+}
+
+enum class component_order {
+	wxyz,	// real part first, as quaternion<T>
+	xyzw	// real part last
+};
+
+template <typename T, component_order Order = component_order::wxyz>
+class quaternion_view {
+public:
+	typedef std::remove_const_t<T> scalar_type;
+	typedef quaternion<scalar_type> value_type;
+
+private:
+	static constexpr std::size_t w = (Order == component_order::wxyz) ? 0 : 3;
+	static constexpr std::size_t x = (Order == component_order::wxyz) ? 1 : 0;
+
+	T*		components = nullptr;
+	std::size_t	count = 0;
+
+public:
+	// Proxy for one record, converting on read and on assignment
+	class reference {
+	private:
+		T*	record;
+
+	public:
+		explicit reference(T* c) noexcept : record(c) {}
+		reference(const reference&) = default;
+
+		operator value_type() const noexcept {
+			return value_type(this->record[w], this->record[x], this->record[x + 1], this->record[x + 2]);
+		}
+		const reference& operator=(const value_type& value) const noexcept requires (!std::is_const<T>::value) {
+			this->record[w] = value.Re();
+			this->record[x] = value.Im1();
+			this->record[x + 1] = value.Im2();
+			this->record[x + 2] = value.Im3();
+			return *this;
+		}
+		const reference& operator=(const reference& other) const noexcept requires (!std::is_const<T>::value) {
+			return *this = static_cast<value_type>(other);
+		}
+	};
+
+	class iterator {
+	private:
+		T*	record = nullptr;
+
+	public:
+		typedef std::forward_iterator_tag iterator_category;
+		typedef quaternion_view::value_type value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef quaternion_view::reference reference;
+		typedef void pointer;
+
+		iterator() noexcept = default;
+		explicit iterator(T* c) noexcept : record(c) {}
+
+		reference operator*() const noexcept { return reference(this->record); }
+		iterator& operator++() noexcept {
+			this->record += 4;
+			return *this;
+		}
+		iterator operator++(int) noexcept {
+			iterator previous = *this;
+			this->record += 4;
+			return previous;
+		}
+		bool operator==(const iterator& other) const noexcept { return this->record == other.record; }
+	};
+
+	quaternion_view() noexcept = default;
+	// size records of four T at data
+	quaternion_view(T* data, std::size_t size) noexcept
+		: components(data)
+		, count(size)
+	{}
+	explicit quaternion_view(std::span<T> values) noexcept
+		: components(values.data())
+		, count(values.size() / 4)
+	{
+		assert((values.size() % 4) == 0);
+	}
+
+	T* data() const noexcept { return this->components; }
+	std::size_t size() const noexcept { return this->count; }
+	bool empty() const noexcept { return this->count == 0; }
+
+	reference operator[](std::size_t n) const noexcept {
+		assert(n < this->count);
+		return reference(this->components + (4 * n));
+	}
+	value_type get(std::size_t n) const noexcept { return (*this)[n]; }
+	void set(std::size_t n, const value_type& value) const noexcept requires (!std::is_const<T>::value) { (*this)[n] = value; }
+
+	quaternion_view subview(std::size_t first, std::size_t size) const noexcept {
+		assert(first + size <= this->count);
+		return quaternion_view(this->components + (4 * first), size);
+	}
+
+	iterator begin() const noexcept { return iterator(this->components); }
+	iterator end() const noexcept { return iterator(this->components + (4 * this->count)); }
+
+	// The same records as a span, for the real part first only
+	std::span<detail::interop_like<T, value_type>> span() const noexcept requires (Order == component_order::wxyz) {
+		return { reinterpret_cast<detail::interop_like<T, value_type>*>(this->components), this->count };
+	}
+};
+
+}
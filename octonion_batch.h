@@ -0,0 +1,261 @@
+/*
+Copyright (c) 2022, Dean Stephan
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of {{ project }} nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Provide batch and multithreaded evaluation of octonion products
+// Octonion multiplication is not associative: in general
+//      (a * b) * c != a * (b * c)
+// so the regrouping that parallel.h relies on for quaternions would give a
+// different, wrong, result. Here the order of evaluation is always spelled
+// out by the caller, and the parallelism comes only from evaluating many
+// independent products side by side, across the SIMD lanes and the cores.
+//      multiply(a, b, out)                 out[n] = a[n] * b[n]
+//      evaluate(tree, factors, out)        out[n] = the product that tree
+//                                          describes, over factor set n
+// An octonion_tree is an explicitly parenthesized product of a number of
+// leaves. It is built either from the standard shapes
+//      octonion_tree::left_fold(4)         ((x0 * x1) * x2) * x3
+//      octonion_tree::right_fold(4)        x0 * (x1 * (x2 * x3))
+//      octonion_tree::balanced(4)          (x0 * x1) * (x2 * x3)
+// or node by node, each multiply() returning the id of a new node:
+//      octonion_tree tree(3);
+//      tree.multiply(tree.leaf(0), tree.multiply(tree.leaf(1), tree.leaf(2)));
+// The last node created is the root. For a batch of count products the
+// factors are laid out leaf by leaf,
+//      factors[(leaf * count) + n]       leaf of product n
+// so that every node of the tree is one elementwise multiply over the
+// batch. Each thread takes a block of octonion_block_size products through
+// the whole tree, with the intermediate results in a few reused buffers
+// that stay in its cache. out must not overlap factors.
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+#include "cayley_dickson.h"
+#include "octonions.h"
+#include "parallel.h"
+#include "simd.h"
+
+#define STEPHAN_SIMD_KERNELS "octonion_batch_kernels.h"
+#include "simd_foreach.h"
+
+namespace Stephan {
+
+// Products per thread task when evaluating a tree
+inline constexpr std::size_t octonion_block_size = 256;
+
+class octonion_tree {
+private:
+	struct node {
+		std::size_t	lhs;
+		std::size_t	rhs;
+	};
+
+	std::size_t		leaf_count;
+	std::vector<node>	nodes;
+
+public:
+	// Node ids 0 .. leaves - 1 are the leaves
+	explicit octonion_tree(std::size_t leaves)
+		: leaf_count(leaves)
+	{
+		assert(leaves > 0);
+	}
+
+	static octonion_tree left_fold(std::size_t leaves) {
+		octonion_tree tree(leaves);
+		std::size_t result = 0;
+		for (std::size_t n = 1; n < leaves; ++n) {
+			result = tree.multiply(result, n);
+		}
+		return tree;
+	}
+	static octonion_tree right_fold(std::size_t leaves) {
+		octonion_tree tree(leaves);
+		std::size_t result = leaves - 1;
+		for (std::size_t n = leaves - 1; n > 0; --n) {
+			result = tree.multiply(n - 1, result);
+		}
+		return tree;
+	}
+	// Adjacent pairs multiplied level by level, an odd one out carried up
+	static octonion_tree balanced(std::size_t leaves) {
+		octonion_tree tree(leaves);
+		std::vector<std::size_t> level(leaves);
+		for (std::size_t n = 0; n < leaves; ++n) {
+			level[n] = n;
+		}
+		while (level.size() > 1) {
+			std::vector<std::size_t> next;
+			for (std::size_t n = 0; n + 1 < level.size(); n += 2) {
+				next.push_back(tree.multiply(level[n], level[n + 1]));
+			}
+			if ((level.size() % 2) != 0) {
+				next.push_back(level.back());
+			}
+			level.swap(next);
+		}
+		return tree;
+	}
+
+	std::size_t leaves() const noexcept { return this->leaf_count; }
+	// Number of multiplications
+	std::size_t size() const noexcept { return this->nodes.size(); }
+	std::size_t leaf(std::size_t n) const noexcept {
+		assert(n < this->leaf_count);
+		return n;
+	}
+	// Id of the node holding lhs * rhs, either of which is an earlier node or a leaf
+	std::size_t multiply(std::size_t lhs, std::size_t rhs) {
+		assert((lhs < this->leaf_count + this->nodes.size()) && (rhs < this->leaf_count + this->nodes.size()));
+		this->nodes.push_back(node{ lhs, rhs });
+		return this->leaf_count + this->nodes.size() - 1;
+	}
+	std::size_t root() const noexcept { return this->leaf_count + this->nodes.size() - 1; }
+
+	// Operands of product number n, i.e. of node leaves() + n
+	std::size_t lhs(std::size_t n) const noexcept { return this->nodes[n].lhs; }
+	std::size_t rhs(std::size_t n) const noexcept { return this->nodes[n].rhs; }
+};
+
+namespace detail {
+
+template <typename T>
+const T* octonion_data(std::span<const octonion<T>> values) { return reinterpret_cast<const T*>(values.data()); }
+template <typename T>
+T* octonion_data(std::span<octonion<T>> values) { return reinterpret_cast<T*>(values.data()); }
+
+// Assigns every product of a tree a scratch buffer, reusing the buffer of
+// an operand after its last use. The root goes straight to the output and
+// gets none (npos).
+class octonion_schedule {
+public:
+	static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+	std::vector<std::size_t>	buffer;
+	std::size_t			buffers = 0;
+
+	explicit octonion_schedule(const octonion_tree& tree)
+		: buffer(tree.size(), npos)
+	{
+		std::size_t leaves = tree.leaves();
+		std::vector<std::size_t> last_use(tree.size(), 0);
+		for (std::size_t n = 0; n < tree.size(); ++n) {
+			for (std::size_t operand : { tree.lhs(n), tree.rhs(n) }) {
+				if (operand >= leaves) {
+					last_use[operand - leaves] = n;
+				}
+			}
+		}
+		std::vector<bool> released(tree.size(), false);
+		std::vector<std::size_t> free;
+		for (std::size_t n = 0; n < tree.size(); ++n) {
+			// The kernel allows the result to overwrite an operand, so the
+			// operands' buffers can be handed on before this one is chosen
+			for (std::size_t operand : { tree.lhs(n), tree.rhs(n) }) {
+				if ((operand >= leaves) && (last_use[operand - leaves] == n) && !released[operand - leaves]) {
+					free.push_back(this->buffer[operand - leaves]);
+					released[operand - leaves] = true;
+				}
+			}
+			if (n + 1 == tree.size()) {
+				break;
+			}
+			if (free.empty()) {
+				free.push_back(this->buffers++);
+			}
+			this->buffer[n] = free.back();
+			free.pop_back();
+			// A product that nothing uses is still computed, into a buffer
+			// that is free again at once
+			if (last_use[n] <= n) {
+				free.push_back(this->buffer[n]);
+				released[n] = true;
+			}
+		}
+	}
+};
+
+}
+
+template <typename T>
+void multiply(std::span<const octonion<T>> a, std::span<const octonion<T>> b, std::span<octonion<T>> out, thread_pool& pool = thread_pool::shared()) {
+	static_assert(std::is_floating_point<T>::value);
+	assert((a.size() == b.size()) && (a.size() == out.size()));
+	pool.run(detail::parallel_blocks(out.size()), [&](std::size_t block) {
+		std::size_t first = block * parallel_block_size;
+		std::size_t count = std::min(parallel_block_size, out.size() - first);
+		const T* lhs = detail::octonion_data(a) + (8 * first);
+		const T* rhs = detail::octonion_data(b) + (8 * first);
+		T* result = detail::octonion_data(out) + (8 * first);
+		STEPHAN_SIMD_DISPATCH(octonion_multiply<T>(count, lhs, rhs, result));
+	});
+}
+
+template <typename T>
+void evaluate(const octonion_tree& tree, std::span<const octonion<T>> factors, std::span<octonion<T>> out, thread_pool& pool = thread_pool::shared()) {
+	static_assert(std::is_floating_point<T>::value);
+	assert(factors.size() == tree.leaves() * out.size());
+	std::size_t count = out.size();
+	if (tree.size() == 0) {
+		std::copy(factors.begin(), factors.end(), out.begin());
+		return;
+	}
+
+	detail::octonion_schedule schedule(tree);
+	std::size_t tasks = (count + octonion_block_size - 1) / octonion_block_size;
+	pool.run(tasks, [&](std::size_t task) {
+		std::size_t first = task * octonion_block_size;
+		std::size_t length = std::min(octonion_block_size, count - first);
+		thread_local std::vector<octonion<T>> scratch;
+		scratch.resize(schedule.buffers * octonion_block_size);
+
+		auto operand = [&](std::size_t id) -> const T* {
+			if (id < tree.leaves()) {
+				return detail::octonion_data(factors) + (8 * ((id * count) + first));
+			}
+			return reinterpret_cast<const T*>(scratch.data() + (schedule.buffer[id - tree.leaves()] * octonion_block_size));
+		};
+		for (std::size_t n = 0; n < tree.size(); ++n) {
+			const T* lhs = operand(tree.lhs(n));
+			const T* rhs = operand(tree.rhs(n));
+			T* result = (n + 1 == tree.size())
+				? detail::octonion_data(out) + (8 * first)
+				: reinterpret_cast<T*>(scratch.data() + (schedule.buffer[n] * octonion_block_size));
+			STEPHAN_SIMD_DISPATCH(octonion_multiply<T>(length, lhs, rhs, result));
+		}
+	});
+}
+
+}
@@ -0,0 +1,73 @@
+/*
+Copyright (c) 2022, Dean Stephan
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of {{ project }} nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Provide the batch kernels behind octonion_batch.h
+// This file is included once per SIMD target through simd_foreach.h and
+// must not be included directly. The product is the Cayley-Dickson one of
+// cayley_dickson.h written out on registers: with x = (a, b) and y = (c, d)
+// pairs of quaternions,
+//      x * y = (a * c - d* * b, d * a + b * c*)
+// and every lane carries an independent octonion product.
+
+// Hamilton product r = p * q of quaternions held as four registers, with
+// either operand optionally conjugated first
+template <typename T, bool ConjugateP, bool ConjugateQ>
+STEPHAN_FORCE_INLINE void octonion_half_product(const vec<T>* p, const vec<T>* q, vec<T>* r) {
+	vec<T> a[4] = { p[0], ConjugateP ? -p[1] : p[1], ConjugateP ? -p[2] : p[2], ConjugateP ? -p[3] : p[3] };
+	vec<T> b[4] = { q[0], ConjugateQ ? -q[1] : q[1], ConjugateQ ? -q[2] : q[2], ConjugateQ ? -q[3] : q[3] };
+	vec<T> c[4];
+	product_lanes<T, 4>(a, b, c);
+	for (int k = 0; k < 4; ++k) {
+		r[k] = c[k];
+	}
+}
+
+// out[n] = a[n] * b[n] over n interleaved octonions; out may alias a or b
+template <typename T>
+void octonion_multiply(std::size_t n, const T* a, const T* b, T* out) {
+	const T* const in[2] = { a, b };
+	T* const result[1] = { out };
+	for_each_block<8, 8>(n, in, result, [](const T* const* x, T* const* r, std::size_t offset) {
+		vec<T> lhs[8], rhs[8], left[4], right[4], product[8];
+		load_interleaved<8>(x[0] + (8 * offset), lhs);
+		load_interleaved<8>(x[1] + (8 * offset), rhs);
+		octonion_half_product<T, false, false>(lhs, rhs, left);
+		octonion_half_product<T, true, false>(rhs + 4, lhs + 4, right);
+		for (int k = 0; k < 4; ++k) {
+			product[k] = left[k] - right[k];
+		}
+		octonion_half_product<T, false, false>(rhs + 4, lhs, left);
+		octonion_half_product<T, false, true>(lhs + 4, rhs, right);
+		for (int k = 0; k < 4; ++k) {
+			product[k + 4] = left[k] + right[k];
+		}
+		store_interleaved<8>(r[0] + (8 * offset), product);
+	});
+}
@@ -30,97 +30,78 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 // Provide templated class definition for octonion numbers
 // See https://en.wikipedia.org/wiki/Octonion for mathematical explanation
+// The octonions are the third step of the Cayley-Dickson construction: an
+// octonion is a pair of quaternions, i.e. eight real components
+//      a0 + a1 e1 + a2 e2 + ... + a7 e7
+// where component 0 is the real part. Multiplication is neither commutative
+// nor associative, but the octonions are still a division algebra.
 #pragma once
 
+#include <array>
+#include <cstddef>
+
+#include "cayley_dickson.h"
+
 namespace Stephan {
 
 template <typename T>
-class octonion {
-private:
-	T	real_part;
-	T	imaginary_part;
-
-public:
-	octonion(T _real_part = 0, T _imaginary_part = 0, bool _use_electric_syntax = false)
-		: real_part(_real_part)
-		, imaginary_part(_imaginary_part)
-		, use_electric_syntax(_use_electric_syntax)
-	{}
-	octonion()
-		: octonion(0,0)
-	{}
-
-	// Provide real-part and imaginary-part routines
-	T Re() { return real_part; }
-	T Im() { return imaginary_part; }
-
-	// Boolean relationships
-	// Note that only equality is defined. There is no ordering, so the concept
-	// of greater than and less than has no meaning.
-	bool operator==(const octonion<T>& rhs) {
-		return (this->real_part == rhs.real_part) && (this->imaginary_part == rhs.imaginary_part);
-	}
+using octonion = cd_octonion<T>;
 
-	// Conjugate operation.
-	// For a octonion number a+bi, the conjugate is a-bi
-	octonion<T> conjugate() { return octonion(this->real_part, -(this->imaginary_part)); }
+// The basis units e0 = 1, e1 .. e7 as compile-time constants. Unit n is
+// component n, so e1, e2, e3 are the i, j, k of the lower quaternion and
+// e4 .. e7 those of the upper one.
+namespace octonion_basis {
+template <typename T>
+STEPHAN_HOST_DEVICE constexpr octonion<T> unit(std::size_t n) noexcept {
+	octonion<T> result;
+	result[n] = T(1);
+	return result;
+}
 
-	// Addition + Subtraction
-	octonion<T> operator+(const octonion<T>& rhs) {
-		return octonion(this->real_part + rhs.real_part, this->imaginary_part + rhs.imaginary_part);
-	}
-	octonion<T> operator+(const T& value) {
-		return octonion(this->real_part + value, this->imaginary_part);
-	}
-	octonion<T> operator-(const octonion<T>& rhs) {
-		return octonion(this->real_part - rhs.real_part, this->imaginary_part - rhs.imaginary_part);
-	}
-	octonion<T> operator-(const T& value) {
-		return octonion(this->real_part - value, this->imaginary_part);
-	}
+template <typename T>
+inline constexpr octonion<T> e1 = unit<T>(1);
+template <typename T>
+inline constexpr octonion<T> e2 = unit<T>(2);
+template <typename T>
+inline constexpr octonion<T> e3 = unit<T>(3);
+template <typename T>
+inline constexpr octonion<T> e4 = unit<T>(4);
+template <typename T>
+inline constexpr octonion<T> e5 = unit<T>(5);
+template <typename T>
+inline constexpr octonion<T> e6 = unit<T>(6);
+template <typename T>
+inline constexpr octonion<T> e7 = unit<T>(7);
 
-	// Multiplication
-	octonion<T> operator*(const octonion<T>& rhs) {
-		return octonion(this->real_part * rhs.real_part) - (this->imaginary_part * rhs.imaginary_part), (this->real_part * rhs.imaginary_part) + (this->imaginary_part * rhs.real_part));
-	}
-	octonion<T> operator*(const T& value) {
-		return octonion(this->real_part * value, this->imaginary_part * value);
-	}
+// The product of two basis units is again a basis unit up to sign:
+//      e_a * e_b = sign * e_index
+struct product {
+	int		sign;
+	std::size_t	index;
+};
 
-	// Division
-	octonion<T> operator/(const octonion<T>& rhs) {
-		T divisor = (this->real_part * this->real_part) + (this->imaginary_part * this->imaginary_part);
-		T real_numerator = (this->real_part * rhs.real_part) + (this->imaginary_part * rhs.imaginary_part);
-		T imaginary_numerator = (rhs.imaginary_part * this->real_part) - (rhs.real_part * this->imaginary_part);
-		return octonion(T(real_numerator/divisor), T(imaginary_numerator/divisor))
-	}
-	octonion<T> operator/(const T& value) {
-		return octonion(this->real_part / value, this->imaginary_part / value);
+// Multiplication table of the basis units, computed by the compiler from
+// the Cayley-Dickson product: table[a][b] describes e_a * e_b
+inline constexpr std::array<std::array<product, 8>, 8> table = [] {
+	std::array<std::array<product, 8>, 8> result{};
+	for (std::size_t a = 0; a < 8; ++a) {
+		for (std::size_t b = 0; b < 8; ++b) {
+			octonion<int> value = unit<int>(a) * unit<int>(b);
+			for (std::size_t n = 0; n < 8; ++n) {
+				if (value[n] != 0) {
+					result[a][b] = product{ value[n], n };
+				}
+			}
+		}
 	}
+	return result;
+}();
 
-#ifdef 0
-	// Because octonion multiplication involves combining both real and imaginary
-	// parts, it appears that a remainder function will require performing division
-	// and then multiplication followed by subtraction from the lhs.
-	octonion<T> operator%(const octonion<T>& rhs) {
-		T divisor = (this->real_part * this->real_part) + (this->imaginary_part * this->imaginary_part);
-		T real_numerator = (this->real_part * rhs.real_part) + (this->imaginary_part * rhs.imaginary_part);
-		T imaginary_numerator = (rhs.imaginary_part * this->real_part) - (rhs.real_part * this->imaginary_part);
-		return octonion(T(real_numerator%divisor), T(imaginary_numerator%divisor))
-	}
-	octonion<T> operator%(const T& value) {
-		return octonion(this->real_part % value, this->imaginary_part % value);
-	}
-#endif
-
-	// This returns the principal square root. 
-	octonion<T> sqrt() {
-		T common = std::sqrt(this->real_part*this->real_part + this->imaginary_part*this->imaginary_part);
-		T gamma = std::sqrt((this->real_part + common) / 2);
-		int sign_bit = std::signbit(this->imaginary_part) ? -1 : 1;
-		T delta = sign_bit * std::sqrt((-this->real_part + common) / 2);
-		return octonion(T(gamma), T(delta));
 }
-};
 
-}
\ No newline at end of file
+static_assert(octonion_basis::e1<int> * octonion_basis::e1<int> == octonion<int>(-1));
+static_assert(octonion_basis::e1<int> * octonion_basis::e2<int> == octonion_basis::e3<int>);
+static_assert(octonion_basis::e2<int> * octonion_basis::e1<int> == -octonion_basis::e3<int>);
+static_assert((octonion_basis::table[1][2].sign == 1) && (octonion_basis::table[1][2].index == 3));
+
+}
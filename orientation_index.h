@@ -0,0 +1,488 @@
+/*
+Copyright (c) 2022, Dean Stephan
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of {{ project }} nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Provide a nearest-orientation index over large sets of quaternions
+// q and -q are the same rotation, so orientations are compared by the
+// angle of the rotation that takes one to the other,
+//      angle(q, p) = 2 acos(|q.p| / (|q| |p|))     in [0, pi]
+// which needs no care for the sign either quaternion was stored with.
+// orientation_index<T> answers, for any query orientation,
+//      nearest(q)                  the closest stored orientation
+//      nearest(q, out)             the out.size() closest, closest first
+//      within(q, angle)            every one at most angle away, closest first
+// as orientation_match<T> records of the position of the orientation in
+// the array the index was built from and its angle from the query. Batch
+// forms take a span of queries and share them out over a thread_pool;
+// nearest(queries, out) writes out.size() / queries.size() matches per
+// query, one query after the other.
+//
+// The index is a vantage-point tree. Each node takes one of its
+// orientations as vantage point, and splits the others at their median
+// distance from it into an inside and an outside half, which become its
+// children; nodes of orientation_leaf_size or fewer are leaves and are
+// scanned. A search only enters a child the triangle inequality cannot
+// rule out, so it touches a few leaves out of millions. The distance
+// within the tree is the chord min(|q - p|, |q + p|) between normalized
+// quaternions, a metric on orientations which grows with the angle, and
+// costs no trigonometry or square root in the leaves. The halves have the
+// same size at every node, so the shape of the tree follows from the
+// number of orientations and the nodes are laid out as an implicit binary
+// heap holding only their median radius.
+//
+// The top levels of the tree are split over the pool, each node's
+// distances computed in parallel_block_size blocks, and the subtrees below
+// them built one per task. write() stores the index as a short header
+// followed by the orientations and radii as binary.h arrays and the
+// 32-bit positions, about 4 sizeof(T) + 4 bytes per orientation; read()
+// loads it back, in either precision and byte order. Errors are thrown as
+// binary_error.
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <limits>
+#include <numbers>
+#include <ostream>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "arena.h"
+#include "binary.h"
+#include "parallel.h"
+#include "quaternions.h"
+
+namespace Stephan {
+
+// Orientations per leaf of an orientation_index
+inline constexpr std::size_t orientation_leaf_size = 32;
+
+// Queries per task of the batch searches
+inline constexpr std::size_t orientation_query_block = 64;
+
+template <typename T>
+struct orientation_match {
+	std::size_t	index = 0;
+	T		angle = T(0);
+};
+
+namespace detail {
+
+// Squared chord between unit quaternions, taking p or -p, whichever is closer
+template <typename T>
+inline T orientation_chord2(const quaternion<T>& q, const quaternion<T>& p) noexcept {
+	T s = (dot(q, p) < T(0)) ? T(-1) : T(1);
+	T dw = q.Re() - (s * p.Re());
+	T dx = q.Im1() - (s * p.Im1());
+	T dy = q.Im2() - (s * p.Im2());
+	T dz = q.Im3() - (s * p.Im3());
+	return (dw * dw) + (dx * dx) + (dy * dy) + (dz * dz);
+}
+
+// The chord is 2 sin(acos|q.p| / 2) and the rotation angle 2 acos|q.p|
+template <typename T>
+inline T orientation_angle(T chord2) noexcept {
+	return T(4) * std::asin(std::min(T(1), std::sqrt(chord2) / T(2)));
+}
+
+template <typename T>
+inline T orientation_chord(T angle) noexcept {
+	return (angle >= std::numbers::pi_v<T>) ? std::numbers::sqrt2_v<T> : T(2) * std::sin(std::max(T(0), angle) / T(4));
+}
+
+template <typename T>
+inline quaternion<T> orientation_normalized(const quaternion<T>& q) noexcept {
+	T n = std::sqrt(dot(q, q));
+	assert(n > T(0));
+	return quaternion<T>(q.Re() / n, q.Im1() / n, q.Im2() / n, q.Im3() / n);
+}
+
+inline void orientation_write_bytes(std::ostream& out, const void* data, std::size_t bytes) {
+	if (!out.write(static_cast<const char*>(data), static_cast<std::streamsize>(bytes))) {
+		throw binary_error("writing an orientation index failed");
+	}
+}
+
+inline void orientation_read_bytes(std::istream& in, void* data, std::size_t bytes) {
+	if (!in.read(static_cast<char*>(data), static_cast<std::streamsize>(bytes))) {
+		throw binary_error("reading an orientation index failed");
+	}
+}
+
+}
+
+template <typename T>
+class orientation_index {
+	static_assert(std::is_floating_point<T>::value);
+
+public:
+	typedef orientation_match<T> match;
+
+private:
+	// A node of the tree: the heap position of its radius and the range of
+	// points it holds, the vantage point first
+	struct node_range {
+		std::size_t	node;
+		std::size_t	first;
+		std::size_t	last;
+	};
+
+	// An orientation being sorted into the tree
+	struct entry {
+		quaternion<T>	point;
+		T		distance;
+		std::uint32_t	id;
+	};
+
+	// A candidate of a nearest search, kept in a max-heap on distance
+	struct candidate {
+		T		chord2;
+		std::uint32_t	position;
+
+		bool operator<(const candidate& rhs) const noexcept { return this->chord2 < rhs.chord2; }
+	};
+
+	std::vector<quaternion<T>>	points_part;
+	std::vector<std::uint32_t>	ids_part;
+	std::vector<T>			radius_part;
+	std::size_t			leaf_part = orientation_leaf_size;
+
+	bool is_leaf(std::size_t first, std::size_t last) const noexcept { return (last - first) <= this->leaf_part; }
+
+	// End of the inside half of [first, last)
+	static std::size_t split(std::size_t first, std::size_t last) noexcept { return first + 1 + ((last - first - 1) / 2); }
+
+	// Number of heap positions the internal nodes of a tree over n points need
+	static std::size_t heap_size(std::size_t n, std::size_t leaf) noexcept {
+		std::size_t levels = 0;
+		for (; n > leaf; n -= 1 + ((n - 1) / 2)) {
+			++levels;
+		}
+		return (std::size_t(1) << levels) - 1;
+	}
+
+	// Picks a vantage point for the range, moves it first and sorts the rest
+	// into the inside and outside halves around their median distance.
+	// Distances are computed over the pool for ranges worth it.
+	void partition(std::vector<entry>& entries, const node_range& range, thread_pool* pool) {
+		std::uint64_t seed = (range.node + 1) * std::uint64_t(0x9e3779b97f4a7c15);
+		seed ^= seed >> 31;
+		std::swap(entries[range.first], entries[range.first + (seed % (range.last - range.first))]);
+		const quaternion<T> vantage = entries[range.first].point;
+		std::span<entry> rest = std::span<entry>(entries).subspan(range.first + 1, range.last - range.first - 1);
+		auto measure = [&](std::span<entry> block) {
+			for (entry& e : block) {
+				e.distance = std::sqrt(detail::orientation_chord2(vantage, e.point));
+			}
+		};
+		if ((pool != nullptr) && (rest.size() > parallel_block_size)) {
+			pool->run(detail::parallel_blocks(rest.size()), [&](std::size_t block) {
+				measure(detail::parallel_block(rest, block));
+			});
+		}
+		else {
+			measure(rest);
+		}
+		std::size_t middle = split(range.first, range.last);
+		auto by_distance = [](const entry& lhs, const entry& rhs) { return lhs.distance < rhs.distance; };
+		std::nth_element(entries.begin() + std::ptrdiff_t(range.first + 1), entries.begin() + std::ptrdiff_t(middle),
+			entries.begin() + std::ptrdiff_t(range.last), by_distance);
+		this->radius_part[range.node] = entries[middle].distance;
+	}
+
+	void build_subtree(std::vector<entry>& entries, const node_range& range) {
+		if (this->is_leaf(range.first, range.last)) {
+			return;
+		}
+		this->partition(entries, range, nullptr);
+		std::size_t middle = split(range.first, range.last);
+		this->build_subtree(entries, { (2 * range.node) + 1, range.first + 1, middle });
+		this->build_subtree(entries, { (2 * range.node) + 2, middle, range.last });
+	}
+
+	// Keeps the k closest points seen in heap, the farthest first
+	void nearest_search(const quaternion<T>& q, std::span<candidate> heap, std::size_t& found, std::size_t node, std::size_t first, std::size_t last) const {
+		auto consider = [&](std::size_t position, T chord2) {
+			if (found < heap.size()) {
+				heap[found++] = { chord2, static_cast<std::uint32_t>(position) };
+				std::push_heap(heap.begin(), heap.begin() + std::ptrdiff_t(found));
+			}
+			else if (chord2 < heap[0].chord2) {
+				std::pop_heap(heap.begin(), heap.end());
+				heap.back() = { chord2, static_cast<std::uint32_t>(position) };
+				std::push_heap(heap.begin(), heap.end());
+			}
+		};
+		if (this->is_leaf(first, last)) {
+			for (std::size_t n = first; n < last; ++n) {
+				T chord2 = detail::orientation_chord2(q, this->points_part[n]);
+				if ((found < heap.size()) || (chord2 < heap[0].chord2)) {
+					consider(n, chord2);
+				}
+			}
+			return;
+		}
+		T chord2 = detail::orientation_chord2(q, this->points_part[first]);
+		consider(first, chord2);
+		T chord = std::sqrt(chord2);
+		T radius = this->radius_part[node];
+		std::size_t middle = split(first, last);
+		auto reach = [&]() { return (found < heap.size()) ? std::numeric_limits<T>::infinity() : std::sqrt(heap[0].chord2); };
+		if (chord < radius) {
+			this->nearest_search(q, heap, found, (2 * node) + 1, first + 1, middle);
+			if (chord + reach() >= radius) {
+				this->nearest_search(q, heap, found, (2 * node) + 2, middle, last);
+			}
+		}
+		else {
+			this->nearest_search(q, heap, found, (2 * node) + 2, middle, last);
+			if (chord - reach() <= radius) {
+				this->nearest_search(q, heap, found, (2 * node) + 1, first + 1, middle);
+			}
+		}
+	}
+
+	void within_search(const quaternion<T>& q, T reach, std::vector<candidate>& hits, std::size_t node, std::size_t first, std::size_t last) const {
+		T reach2 = reach * reach;
+		if (this->is_leaf(first, last)) {
+			for (std::size_t n = first; n < last; ++n) {
+				T chord2 = detail::orientation_chord2(q, this->points_part[n]);
+				if (chord2 <= reach2) {
+					hits.push_back({ chord2, static_cast<std::uint32_t>(n) });
+				}
+			}
+			return;
+		}
+		T chord2 = detail::orientation_chord2(q, this->points_part[first]);
+		if (chord2 <= reach2) {
+			hits.push_back({ chord2, static_cast<std::uint32_t>(first) });
+		}
+		T chord = std::sqrt(chord2);
+		T radius = this->radius_part[node];
+		std::size_t middle = split(first, last);
+		if (chord - reach <= radius) {
+			this->within_search(q, reach, hits, (2 * node) + 1, first + 1, middle);
+		}
+		if (chord + reach >= radius) {
+			this->within_search(q, reach, hits, (2 * node) + 2, middle, last);
+		}
+	}
+
+	match to_match(const candidate& c) const noexcept { return { this->ids_part[c.position], detail::orientation_angle(c.chord2) }; }
+
+	std::size_t nearest_into(const quaternion<T>& q, std::span<candidate> heap, std::span<match> out) const {
+		std::size_t found = 0;
+		if (!this->points_part.empty()) {
+			this->nearest_search(detail::orientation_normalized(q), heap, found, 0, 0, this->points_part.size());
+		}
+		std::sort_heap(heap.begin(), heap.begin() + std::ptrdiff_t(found));
+		for (std::size_t n = 0; n < found; ++n) {
+			out[n] = this->to_match(heap[n]);
+		}
+		return found;
+	}
+
+public:
+	orientation_index() = default;
+
+	// Orientations need not be normalized, but must not be zero
+	explicit orientation_index(std::span<const quaternion<T>> orientations, thread_pool& pool = thread_pool::shared()) {
+		assert(orientations.size() <= std::numeric_limits<std::uint32_t>::max());
+		std::size_t n = orientations.size();
+		std::vector<entry> entries(n);
+		pool.run(detail::parallel_blocks(n), [&](std::size_t block) {
+			std::size_t first = block * parallel_block_size;
+			std::size_t last = std::min(first + parallel_block_size, n);
+			for (std::size_t m = first; m < last; ++m) {
+				entries[m] = { detail::orientation_normalized(orientations[m]), T(0), static_cast<std::uint32_t>(m) };
+			}
+		});
+		this->radius_part.assign(heap_size(n, this->leaf_part), T(0));
+
+		// Split breadth first until there are enough subtrees to go round
+		std::vector<node_range> level;
+		if (!this->is_leaf(0, n)) {
+			level.push_back({ 0, 0, n });
+		}
+		while (!level.empty() && (level.size() < 4 * std::size_t(pool.size())) && ((level.front().last - level.front().first) > parallel_block_size)) {
+			std::vector<node_range> next;
+			for (const node_range& range : level) {
+				this->partition(entries, range, &pool);
+				std::size_t middle = split(range.first, range.last);
+				for (node_range child : { node_range{ (2 * range.node) + 1, range.first + 1, middle }, node_range{ (2 * range.node) + 2, middle, range.last } }) {
+					if (!this->is_leaf(child.first, child.last)) {
+						next.push_back(child);
+					}
+				}
+			}
+			level = std::move(next);
+		}
+		pool.run(level.size(), [&](std::size_t task) {
+			this->build_subtree(entries, level[task]);
+		});
+
+		this->points_part.resize(n);
+		this->ids_part.resize(n);
+		pool.run(detail::parallel_blocks(n), [&](std::size_t block) {
+			std::size_t first = block * parallel_block_size;
+			std::size_t last = std::min(first + parallel_block_size, n);
+			for (std::size_t m = first; m < last; ++m) {
+				this->points_part[m] = entries[m].point;
+				this->ids_part[m] = entries[m].id;
+			}
+		});
+	}
+
+	std::size_t size() const noexcept { return this->points_part.size(); }
+	bool empty() const noexcept { return this->points_part.empty(); }
+
+	match nearest(const quaternion<T>& q) const {
+		assert(!this->empty());
+		candidate best[1];
+		match result;
+		this->nearest_into(q, best, std::span<match>(&result, 1));
+		return result;
+	}
+
+	// The out.size() nearest, or all of them if there are fewer; returns how
+	// many were written
+	std::size_t nearest(const quaternion<T>& q, std::span<match> out) const {
+		scratch_scope scratch;
+		return this->nearest_into(q, scratch.allocate<candidate>(out.size()), out);
+	}
+
+	std::vector<match> within(const quaternion<T>& q, T angle) const {
+		std::vector<candidate> hits;
+		if (!this->points_part.empty()) {
+			this->within_search(detail::orientation_normalized(q), detail::orientation_chord(angle), hits, 0, 0, this->points_part.size());
+		}
+		std::sort(hits.begin(), hits.end());
+		std::vector<match> result(hits.size());
+		for (std::size_t n = 0; n < hits.size(); ++n) {
+			result[n] = this->to_match(hits[n]);
+		}
+		return result;
+	}
+
+	// out.size() / queries.size() matches per query, which must not be more
+	// than size()
+	void nearest(std::span<const quaternion<T>> queries, std::span<match> out, thread_pool& pool = thread_pool::shared()) const {
+		if (queries.empty()) {
+			return;
+		}
+		assert((out.size() % queries.size()) == 0);
+		std::size_t k = out.size() / queries.size();
+		assert(k <= this->size());
+		pool.run((queries.size() + orientation_query_block - 1) / orientation_query_block, [&](std::size_t block) {
+			scratch_scope scratch;
+			std::span<candidate> heap = scratch.allocate<candidate>(k);
+			std::size_t first = block * orientation_query_block;
+			std::size_t last = std::min(first + orientation_query_block, queries.size());
+			for (std::size_t n = first; n < last; ++n) {
+				this->nearest_into(queries[n], heap, out.subspan(n * k, k));
+			}
+		});
+	}
+
+	std::vector<std::vector<match>> within(std::span<const quaternion<T>> queries, T angle, thread_pool& pool = thread_pool::shared()) const {
+		std::vector<std::vector<match>> result(queries.size());
+		pool.run((queries.size() + orientation_query_block - 1) / orientation_query_block, [&](std::size_t block) {
+			std::size_t first = block * orientation_query_block;
+			std::size_t last = std::min(first + orientation_query_block, queries.size());
+			for (std::size_t n = first; n < last; ++n) {
+				result[n] = this->within(queries[n], angle);
+			}
+		});
+		return result;
+	}
+
+	// Layout: 16 byte header, then the orientations (quaternion<T>) and radii
+	// (T) as binary.h arrays, then a position per orientation
+	//      offset  size
+	//      0       4       "SCDI"
+	//      4       1       format version, 1
+	//      5       1       byte order of the positions: 0 little, 1 big endian
+	//      6       2       reserved, zero
+	//      8       4       orientations per leaf, little endian
+	//      12      4       reserved, zero
+	void write(std::ostream& out) const {
+		unsigned char header[16] = { 'S', 'C', 'D', 'I', 1, (std::endian::native == std::endian::big) ? 1 : 0 };
+		for (int n = 0; n < 4; ++n) {
+			header[8 + n] = static_cast<unsigned char>(this->leaf_part >> (8 * n));
+		}
+		detail::orientation_write_bytes(out, header, sizeof(header));
+		write_binary<quaternion<T>>(out, this->points_part);
+		write_binary<T>(out, this->radius_part);
+		detail::orientation_write_bytes(out, this->ids_part.data(), this->ids_part.size() * sizeof(std::uint32_t));
+	}
+
+	static orientation_index read(std::istream& in) {
+		unsigned char header[16];
+		detail::orientation_read_bytes(in, header, sizeof(header));
+		if (std::memcmp(header, "SCDI", 4) != 0) {
+			throw binary_error("not an orientation index");
+		}
+		if (header[4] != 1) {
+			throw binary_error("unsupported orientation index version " + std::to_string(header[4]));
+		}
+		orientation_index index;
+		index.leaf_part = 0;
+		for (int n = 0; n < 4; ++n) {
+			index.leaf_part |= std::size_t(header[8 + n]) << (8 * n);
+		}
+		index.points_part = read_binary<quaternion<T>>(in);
+		index.radius_part = read_binary<T>(in);
+		std::size_t n = index.points_part.size();
+		if ((header[5] > 1) || (index.leaf_part == 0) || (n > std::numeric_limits<std::uint32_t>::max())
+			|| (index.radius_part.size() != heap_size(n, index.leaf_part))) {
+			throw binary_error("corrupt orientation index");
+		}
+		index.ids_part.resize(n);
+		detail::orientation_read_bytes(in, index.ids_part.data(), n * sizeof(std::uint32_t));
+		if ((header[5] != 0) != (std::endian::native == std::endian::big)) {
+			detail::binary_swap_bytes(reinterpret_cast<unsigned char*>(index.ids_part.data()), n, sizeof(std::uint32_t));
+		}
+		for (std::uint32_t id : index.ids_part) {
+			if (id >= n) {
+				throw binary_error("corrupt orientation index");
+			}
+		}
+		return index;
+	}
+};
+
+}
@@ -0,0 +1,381 @@
+/*
+Copyright (c) 2022, Dean Stephan
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of {{ project }} nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Provide multithreaded reductions and scans over large arrays
+// The product of complex numbers or quaternions is associative, so a long
+// chain of them can be cut into contiguous blocks, each block folded on its
+// own thread and the block results multiplied together in order. Only the
+// grouping of the factors changes, never their order, which keeps the
+// result correct for the non-commutative quaternion product.
+//      parallel_product(values)                values[0] * values[1] * ... * values[n - 1]
+//      parallel_prefix_product(values, out)    out[n] = values[0] * ... * values[n]
+//      parallel_sum(values)                    values[0] + values[1] + ... + values[n - 1]
+// An empty product is 1 and an empty sum is 0.
+//
+// The arrays are always cut into blocks of parallel_block_size values,
+// whatever the number of threads, so results are reproducible from one
+// machine to the next. They differ from a sequential fold only by the
+// regrouping. parallel_sum(values, summation::compensated) also carries a
+// Kahan correction term through every block and through the combination
+// of the blocks, which keeps the rounding error of the sum independent of
+// its length. The correction does not survive -ffast-math or similar
+// options that let the compiler reassociate additions.
+// parallel_prefix_product makes a second pass over out to bring every
+// block up to date with the blocks before it, so it only pays off from
+// two threads up.
+//
+// The blocks are handed out by a thread_pool. Every thread, the caller
+// included, claims the next block from a shared counter as soon as it
+// finishes the last one, so uneven blocks or busy cores balance out
+// without any up-front partitioning. thread_pool::shared() has one thread
+// per core and is created on first use; a smaller or dedicated pool can be
+// passed to any of the functions instead. The block results are kept in
+// the calling thread's scratch arena (see arena.h), so a reduction does
+// not allocate.
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "arena.h"
+#include "complex.h"
+#include "inplace.h"
+#include "quaternions.h"
+
+namespace Stephan {
+
+// Values per block of work
+inline constexpr std::size_t parallel_block_size = 4096;
+
+enum class summation {
+	plain,
+	compensated
+};
+
+namespace detail {
+// Set while the current thread is running a task of any pool. A run()
+// issued from inside a task is executed inline rather than deadlocking on
+// the workers that are busy with the outer one.
+inline thread_local bool in_parallel_task = false;
+}
+
+class thread_pool {
+private:
+	// One call of run(): tasks are claimed from next until none are left
+	struct job {
+		void			(*invoke)(void*, std::size_t);
+		void*			body;
+		std::size_t		tasks;
+		std::atomic<std::size_t>	next{ 0 };
+		std::atomic<bool>	failed{ false };
+		std::mutex		error_mutex;
+		std::exception_ptr	error;
+
+		void execute() noexcept {
+			bool outer = detail::in_parallel_task;
+			detail::in_parallel_task = true;
+			for (;;) {
+				std::size_t task = this->next.fetch_add(1, std::memory_order_relaxed);
+				if ((task >= this->tasks) || this->failed.load(std::memory_order_relaxed)) {
+					break;
+				}
+				try {
+					this->invoke(this->body, task);
+				}
+				catch (...) {
+					std::scoped_lock lock(this->error_mutex);
+					if (!this->error) {
+						this->error = std::current_exception();
+					}
+					this->failed.store(true, std::memory_order_relaxed);
+				}
+			}
+			detail::in_parallel_task = outer;
+		}
+	};
+
+	std::vector<std::thread>	workers;
+	std::mutex			run_mutex;
+	std::mutex			mutex;
+	std::condition_variable		wake;
+	std::condition_variable		done;
+	job*				current = nullptr;
+	std::uint64_t			generation = 0;
+	std::size_t			busy = 0;
+	bool				stopping = false;
+
+	void work() {
+		std::uint64_t seen = 0;
+		std::unique_lock lock(this->mutex);
+		for (;;) {
+			this->wake.wait(lock, [&]() { return this->stopping || (this->generation != seen); });
+			if (this->stopping) {
+				return;
+			}
+			seen = this->generation;
+			job* active = this->current;
+			lock.unlock();
+			active->execute();
+			lock.lock();
+			if (--this->busy == 0) {
+				this->done.notify_one();
+			}
+		}
+	}
+
+public:
+	// threads counts the calling thread, so thread_pool(1) has no workers
+	// and runs everything inline
+	explicit thread_pool(unsigned threads = std::max(1u, std::thread::hardware_concurrency())) {
+		for (unsigned n = 1; n < threads; ++n) {
+			this->workers.emplace_back([this]() { this->work(); });
+		}
+	}
+	thread_pool(const thread_pool&) = delete;
+	thread_pool& operator=(const thread_pool&) = delete;
+	~thread_pool() {
+		{
+			std::scoped_lock lock(this->mutex);
+			this->stopping = true;
+		}
+		this->wake.notify_all();
+		for (std::thread& worker : this->workers) {
+			worker.join();
+		}
+	}
+
+	unsigned size() const noexcept { return static_cast<unsigned>(this->workers.size()) + 1; }
+
+	// Calls body(task) once for every task in [0, tasks) and returns when all
+	// have finished. If a task throws, the tasks not yet started are skipped
+	// and the first exception is rethrown here.
+	template <typename Function>
+	void run(std::size_t tasks, Function&& body) {
+		if ((tasks <= 1) || this->workers.empty() || detail::in_parallel_task) {
+			for (std::size_t task = 0; task < tasks; ++task) {
+				body(task);
+			}
+			return;
+		}
+
+		std::scoped_lock serial(this->run_mutex);
+		job batch;
+		batch.invoke = [](void* function, std::size_t task) { (*static_cast<std::remove_reference_t<Function>*>(function))(task); };
+		batch.body = &body;
+		batch.tasks = tasks;
+		{
+			std::scoped_lock lock(this->mutex);
+			this->current = &batch;
+			this->busy = this->workers.size();
+			++this->generation;
+		}
+		this->wake.notify_all();
+		batch.execute();
+		{
+			std::unique_lock lock(this->mutex);
+			this->done.wait(lock, [this]() { return this->busy == 0; });
+			this->current = nullptr;
+		}
+		if (batch.error) {
+			std::rethrow_exception(batch.error);
+		}
+	}
+
+	// Pool with one thread per core, shared by every caller
+	static thread_pool& shared() {
+		static thread_pool pool;
+		return pool;
+	}
+};
+
+namespace detail {
+
+inline std::size_t parallel_blocks(std::size_t n) noexcept {
+	return (n + parallel_block_size - 1) / parallel_block_size;
+}
+
+template <typename V>
+std::span<V> parallel_block(std::span<V> values, std::size_t block) noexcept {
+	std::size_t first = block * parallel_block_size;
+	return values.subspan(first, std::min(parallel_block_size, values.size() - first));
+}
+
+template <typename V>
+struct kahan_sum {
+	V	sum = V();
+	V	correction = V();
+
+	void add(const V& value) noexcept {
+		V y = value - this->correction;
+		V t = this->sum + y;
+		this->correction = (t - this->sum) - y;
+		this->sum = t;
+	}
+	V result() const noexcept { return this->sum - this->correction; }
+};
+
+template <typename V>
+V product(std::span<const V> values, thread_pool& pool) {
+	std::size_t blocks = parallel_blocks(values.size());
+	scratch_scope scratch;
+	std::span<V> partial = scratch.allocate<V>(blocks);
+	pool.run(blocks, [&](std::size_t block) {
+		std::span<const V> range = parallel_block(values, block);
+		V result = range[0];
+		for (std::size_t n = 1; n < range.size(); ++n) {
+			result *= range[n];
+		}
+		partial[block] = result;
+	});
+	V result(1);
+	for (const V& value : partial) {
+		result *= value;
+	}
+	return result;
+}
+
+// values and out may be the same span
+template <typename V>
+void prefix_product(std::span<const V> values, std::span<V> out, thread_pool& pool) {
+	assert(values.size() == out.size());
+	std::size_t blocks = parallel_blocks(values.size());
+	pool.run(blocks, [&](std::size_t block) {
+		std::size_t first = block * parallel_block_size;
+		std::size_t last = std::min(first + parallel_block_size, values.size());
+		V running = values[first];
+		out[first] = running;
+		for (std::size_t n = first + 1; n < last; ++n) {
+			running *= values[n];
+			out[n] = running;
+		}
+	});
+	if (blocks <= 1) {
+		return;
+	}
+
+	// Block b still has to be multiplied on the left by the product of every
+	// block before it, which is the running product up to b - 1 times the
+	// last prefix of b - 1.
+	scratch_scope scratch;
+	std::span<V> offset = scratch.allocate<V>(blocks);
+	offset[1] = out[parallel_block_size - 1];
+	for (std::size_t block = 2; block < blocks; ++block) {
+		offset[block] = offset[block - 1] * out[(block * parallel_block_size) - 1];
+	}
+	pool.run(blocks - 1, [&](std::size_t task) {
+		std::size_t block = task + 1;
+		std::span<V> range = parallel_block(out, block);
+		if constexpr (std::is_floating_point<typename inplace_records<V>::scalar_type>::value) {
+			left_multiply_inplace<typename inplace_records<V>::scalar_type>(offset[block], range);
+		}
+		else {
+			for (V& value : range) {
+				value = offset[block] * value;
+			}
+		}
+	});
+}
+
+template <typename V>
+V sum(std::span<const V> values, summation mode, thread_pool& pool) {
+	std::size_t blocks = parallel_blocks(values.size());
+	scratch_scope scratch;
+	std::span<V> partial = scratch.allocate<V>(blocks);
+	pool.run(blocks, [&](std::size_t block) {
+		std::span<const V> range = parallel_block(values, block);
+		if (mode == summation::compensated) {
+			kahan_sum<V> result;
+			for (const V& value : range) {
+				result.add(value);
+			}
+			partial[block] = result.result();
+		}
+		else {
+			V result = range[0];
+			for (std::size_t n = 1; n < range.size(); ++n) {
+				result += range[n];
+			}
+			partial[block] = result;
+		}
+	});
+	if (mode == summation::compensated) {
+		kahan_sum<V> result;
+		for (const V& value : partial) {
+			result.add(value);
+		}
+		return result.result();
+	}
+	V result = V();
+	for (const V& value : partial) {
+		result += value;
+	}
+	return result;
+}
+
+}
+
+template <typename T>
+complex<T> parallel_product(std::span<const complex<T>> values, thread_pool& pool = thread_pool::shared()) {
+	return detail::product(values, pool);
+}
+template <typename T>
+quaternion<T> parallel_product(std::span<const quaternion<T>> values, thread_pool& pool = thread_pool::shared()) {
+	return detail::product(values, pool);
+}
+
+template <typename T>
+void parallel_prefix_product(std::span<const complex<T>> values, std::span<complex<T>> out, thread_pool& pool = thread_pool::shared()) {
+	detail::prefix_product(values, out, pool);
+}
+template <typename T>
+void parallel_prefix_product(std::span<const quaternion<T>> values, std::span<quaternion<T>> out, thread_pool& pool = thread_pool::shared()) {
+	detail::prefix_product(values, out, pool);
+}
+
+template <typename T>
+complex<T> parallel_sum(std::span<const complex<T>> values, summation mode = summation::plain, thread_pool& pool = thread_pool::shared()) {
+	return detail::sum(values, mode, pool);
+}
+template <typename T>
+quaternion<T> parallel_sum(std::span<const quaternion<T>> values, summation mode = summation::plain, thread_pool& pool = thread_pool::shared()) {
+	return detail::sum(values, mode, pool);
+}
+
+}
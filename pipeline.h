@@ -0,0 +1,540 @@
+/*
+Copyright (c) 2022, Dean Stephan
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of {{ project }} nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Provide fused, tiled passes of batch stages and a bounded streaming pipeline
+// A pipeline<V> is a chain of stages that each update a span of V in
+// place. run() cuts the values into tiles of tile_size() values, sized to
+// stay in a core's L2 cache, and takes every tile through all of the
+// stages before moving on, so the whole chain costs one pass over memory
+// instead of one per stage:
+//      Stephan::pipeline<Stephan::quaternion<float>> chain;
+//      chain.then(Stephan::stage::left_multiply(correction))
+//           .then(Stephan::stage::slerp<float>(keyframe, 0.25f))
+//           .then(Stephan::stage::normalize<float>())
+//           .into(writer);
+//      chain.run(frame);
+// The stages shipped here run the batch kernels of the library on a tile:
+//      stage::rotate(q)            vec3<T>: v = q v q*         (rotation.h)
+//      stage::left_multiply(q)     quaternion<T>: x = q x      (inplace.h)
+//      stage::right_multiply(q)    quaternion<T>: x = x q      (inplace.h)
+//      stage::normalize<T>()       quaternion<T>: x = x / |x|  (inplace.h)
+//      stage::slerp<T>(to, t)      quaternion<T>: x[n] = slerp(x[n], to[n], t)
+//                                                              (slerp.h)
+// and then() takes any callable stage(tile, first), where first is the
+// index of tile[0] among the values. into() sets a sink, which is handed
+// the finished values in order, in runs of whole tiles: a binary_writer<V>
+// (binary.h), or any callable sink(values). run(in, out) copies each tile
+// from in to out as its first step.
+//
+// Tiles are shared out over a thread_pool, so stages run concurrently on
+// different tiles and must not share state they write. The sink is called
+// by one thread at a time, by whichever thread completes the next tile in
+// order; a tile that finishes early is written out after the ones before
+// it, without holding up its thread.
+//
+// For a stream of frames, pipeline_stream<V> runs one pipeline on a thread
+// of its own, frame after frame, between two bounded_queue<std::vector<V>>:
+//      Stephan::pipeline_stream<Stephan::quaternion<float>> stream(chain, 4);
+//      stream.submit(std::move(frame));        blocks while 4 frames wait
+//      std::optional<std::vector<...>> done = stream.next();
+//                                              the next processed frame
+//      stream.close();                         no more frames; next() returns
+//                                              the rest and then nullopt
+// A producer faster than the pipeline is held up in submit() and the
+// pipeline is held up by a consumer slower than it, so neither queue
+// grows past its depth. Frames come out in the order they went in; with a
+// sink the processed frames are still returned, for their buffers to be
+// reused. An exception thrown by a stage stops the stream and is rethrown
+// by next().
+//
+// With C++20 coroutines, bounded_queue also has co_await forms,
+//      bool accepted = co_await queue.async_push(value);
+//      std::optional<T> value = co_await queue.async_pop();
+// and pipeline_stream has submit_async() and next_async() built on them.
+// The coroutine type is the caller's own. A suspended coroutine is resumed
+// by the thread that makes room or brings the value, usually the stream's
+// thread, and should hand off any long work rather than do it there.
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#include <coroutine>
+#define STEPHAN_PIPELINE_COROUTINES 1
+#else
+#define STEPHAN_PIPELINE_COROUTINES 0
+#endif
+
+#include "arena.h"
+#include "binary.h"
+#include "inplace.h"
+#include "parallel.h"
+#include "quaternion_soa.h"
+#include "quaternions.h"
+#include "rotation.h"
+#include "slerp.h"
+#include "vec3.h"
+
+namespace Stephan {
+
+namespace detail {
+// A coroutine to resume once the queue's lock is released, or without
+// coroutines a stand-in that is never set
+#if STEPHAN_PIPELINE_COROUTINES
+typedef std::coroutine_handle<> queue_resume;
+#else
+struct queue_resume {
+	explicit operator bool() const noexcept { return false; }
+	void resume() const noexcept {}
+};
+#endif
+}
+
+// Bytes of values per tile, half of a typical per-core L2 cache, leaving
+// room for the scratch copies a stage may make
+inline constexpr std::size_t pipeline_tile_bytes = 128 * 1024;
+
+template <typename V>
+inline constexpr std::size_t pipeline_tile_size = std::max<std::size_t>(1, pipeline_tile_bytes / sizeof(V));
+
+template <typename V>
+class pipeline {
+public:
+	typedef std::function<void(std::span<V>, std::size_t)> stage_function;
+	typedef std::function<void(std::span<const V>)> sink_function;
+
+private:
+	std::vector<stage_function>	stages;
+	sink_function			sink;
+	std::size_t			tile;
+
+	void process(const V* in, std::span<V> values, thread_pool& pool) const {
+		std::size_t count = values.size();
+		std::size_t tiles = (count + this->tile - 1) / this->tile;
+		scratch_scope scratch;
+		std::span<unsigned char> finished = scratch.allocate<unsigned char>(this->sink ? tiles : 0);
+		std::mutex order;
+		std::size_t next_write = 0;
+		bool writing = false;
+		pool.run(tiles, [&](std::size_t index) {
+			std::size_t first = index * this->tile;
+			std::span<V> part = values.subspan(first, std::min(this->tile, count - first));
+			if ((in != nullptr) && (in != values.data())) {
+				std::copy(in + first, in + first + part.size(), part.begin());
+			}
+			for (const stage_function& stage : this->stages) {
+				stage(part, first);
+			}
+			if (!this->sink) {
+				return;
+			}
+			// Whoever completes the next tile in order writes out every
+			// finished tile from there on; the others only mark theirs
+			{
+				std::scoped_lock lock(order);
+				finished[index] = 1;
+				if (writing) {
+					return;
+				}
+				writing = true;
+			}
+			for (;;) {
+				std::size_t from, to;
+				{
+					std::scoped_lock lock(order);
+					from = next_write;
+					while ((next_write < tiles) && finished[next_write]) {
+						++next_write;
+					}
+					to = next_write;
+					if (from == to) {
+						writing = false;
+						return;
+					}
+				}
+				std::size_t begin = from * this->tile;
+				this->sink(std::span<const V>(values.subspan(begin, std::min(to * this->tile, count) - begin)));
+			}
+		});
+	}
+
+public:
+	explicit pipeline(std::size_t tile_size = pipeline_tile_size<V>)
+		: tile(std::max<std::size_t>(1, tile_size))
+	{}
+
+	std::size_t tile_size() const noexcept { return this->tile; }
+	std::size_t size() const noexcept { return this->stages.size(); }
+
+	pipeline& then(stage_function stage) {
+		this->stages.push_back(std::move(stage));
+		return *this;
+	}
+	pipeline& into(sink_function values) {
+		this->sink = std::move(values);
+		return *this;
+	}
+	// The writer must outlive the pipeline's runs
+	pipeline& into(binary_writer<V>& writer) {
+		return this->into([&writer](std::span<const V> values) { writer.write(values); });
+	}
+
+	void run(std::span<V> values, thread_pool& pool = thread_pool::shared()) const {
+		this->process(nullptr, values, pool);
+	}
+	// out must hold in.size() values and may be the same span as in
+	void run(std::span<const V> in, std::span<V> out, thread_pool& pool = thread_pool::shared()) const {
+		assert(in.size() == out.size());
+		this->process(in.data(), out, pool);
+	}
+};
+
+namespace stage {
+
+template <typename T>
+typename pipeline<vec3<T>>::stage_function rotate(const quaternion<T>& q) {
+	return [q](std::span<vec3<T>> points, std::size_t) { ::Stephan::rotate(q, points); };
+}
+
+template <typename T>
+typename pipeline<quaternion<T>>::stage_function left_multiply(const quaternion<T>& q) {
+	return [q](std::span<quaternion<T>> values, std::size_t) { left_multiply_inplace<T>(q, values); };
+}
+
+template <typename T>
+typename pipeline<quaternion<T>>::stage_function right_multiply(const quaternion<T>& q) {
+	return [q](std::span<quaternion<T>> values, std::size_t) { right_multiply_inplace<T>(values, q); };
+}
+
+template <typename T>
+typename pipeline<quaternion<T>>::stage_function normalize() {
+	return [](std::span<quaternion<T>> values, std::size_t) { normalize_inplace<T>(values); };
+}
+
+// x[n] = slerp(x[n], to[n], t), on unit quaternions. to must hold as many
+// values as every run of the pipeline, and outlive them.
+template <typename T>
+typename pipeline<quaternion<T>>::stage_function slerp(std::span<const quaternion<T>> to, std::type_identity_t<T> t) {
+	return [to, t](std::span<quaternion<T>> values, std::size_t first) {
+		assert(first + values.size() <= to.size());
+		scratch_scope scratch;
+		quaternion_soa<T> from(std::span<const quaternion<T>>(values), scratch.resource());
+		quaternion_soa<T> target(to.subspan(first, values.size()), scratch.resource());
+		std::span<T> weights = scratch.allocate<T>(values.size());
+		std::fill(weights.begin(), weights.end(), t);
+		slerp_n(from, target, std::span<const T>(weights), from);
+		from.copy_to(values);
+	};
+}
+
+}
+
+// A FIFO of at most capacity values, safe to use from any number of
+// threads. push() waits while it is full and pop() while it is empty, until
+// close(): from then on push() refuses values, and pop() returns what is
+// left and then nullopt.
+template <typename T>
+class bounded_queue {
+private:
+#if STEPHAN_PIPELINE_COROUTINES
+	// Coroutines suspended in async_push() and async_pop(). A value is
+	// handed straight to or taken straight from them under the lock, and
+	// they are resumed after it is released.
+	struct push_waiter {
+		T*				value;
+		bool*				accepted;
+		std::coroutine_handle<>		handle;
+	};
+	struct pop_waiter {
+		std::optional<T>*		slot;
+		std::coroutine_handle<>		handle;
+	};
+	std::deque<push_waiter>		pushers;
+	std::deque<pop_waiter>		poppers;
+#endif
+	std::mutex			mutex;
+	std::condition_variable		readable;
+	std::condition_variable		writable;
+	std::deque<T>			items;
+	std::size_t			limit;
+	bool				closed = false;
+
+	// Take the front value, refilling from a suspended pusher, which is
+	// left in resume
+	T take_front(detail::queue_resume& resume) {
+		T value = std::move(this->items.front());
+		this->items.pop_front();
+#if STEPHAN_PIPELINE_COROUTINES
+		if (!this->pushers.empty()) {
+			push_waiter waiter = this->pushers.front();
+			this->pushers.pop_front();
+			this->items.push_back(std::move(*waiter.value));
+			*waiter.accepted = true;
+			resume = waiter.handle;
+		}
+#else
+		(void)resume;
+#endif
+		return value;
+	}
+
+	// Store a value, or hand it to a suspended popper, which is left in
+	// resume
+	void put(T&& value, detail::queue_resume& resume) {
+#if STEPHAN_PIPELINE_COROUTINES
+		if (!this->poppers.empty()) {
+			pop_waiter waiter = this->poppers.front();
+			this->poppers.pop_front();
+			waiter.slot->emplace(std::move(value));
+			resume = waiter.handle;
+			return;
+		}
+#else
+		(void)resume;
+#endif
+		this->items.push_back(std::move(value));
+	}
+
+public:
+	explicit bounded_queue(std::size_t capacity)
+		: limit(std::max<std::size_t>(1, capacity))
+	{}
+	bounded_queue(const bounded_queue&) = delete;
+	bounded_queue& operator=(const bounded_queue&) = delete;
+
+	std::size_t capacity() const noexcept { return this->limit; }
+
+	// false, with value untouched, if the queue was closed
+	bool push(T value) {
+		std::unique_lock lock(this->mutex);
+		this->writable.wait(lock, [this]() { return this->closed || (this->items.size() < this->limit); });
+		if (this->closed) {
+			return false;
+		}
+		detail::queue_resume resume{};
+		this->put(std::move(value), resume);
+		lock.unlock();
+		this->readable.notify_one();
+		if (resume) {
+			resume.resume();
+		}
+		return true;
+	}
+
+	std::optional<T> pop() {
+		std::unique_lock lock(this->mutex);
+		this->readable.wait(lock, [this]() { return this->closed || !this->items.empty(); });
+		if (this->items.empty()) {
+			return std::nullopt;
+		}
+		detail::queue_resume resume{};
+		std::optional<T> value(this->take_front(resume));
+		lock.unlock();
+		this->writable.notify_one();
+		if (resume) {
+			resume.resume();
+		}
+		return value;
+	}
+
+	void close() {
+		std::unique_lock lock(this->mutex);
+		this->closed = true;
+#if STEPHAN_PIPELINE_COROUTINES
+		std::deque<push_waiter> refused = std::move(this->pushers);
+		std::deque<pop_waiter> starved = std::move(this->poppers);
+		this->pushers.clear();
+		this->poppers.clear();
+#endif
+		lock.unlock();
+		this->readable.notify_all();
+		this->writable.notify_all();
+#if STEPHAN_PIPELINE_COROUTINES
+		for (const push_waiter& waiter : refused) {
+			waiter.handle.resume();
+		}
+		for (const pop_waiter& waiter : starved) {
+			waiter.handle.resume();
+		}
+#endif
+	}
+
+#if STEPHAN_PIPELINE_COROUTINES
+	class push_awaiter {
+	private:
+		bounded_queue*	queue;
+		T		value;
+		bool		accepted = false;
+
+	public:
+		push_awaiter(bounded_queue& queue, T value) : queue(&queue), value(std::move(value)) {}
+
+		bool await_ready() const noexcept { return false; }
+		bool await_suspend(std::coroutine_handle<> handle) {
+			std::unique_lock lock(this->queue->mutex);
+			if (this->queue->closed) {
+				return false;
+			}
+			if (this->queue->items.size() < this->queue->limit) {
+				detail::queue_resume resume{};
+				this->queue->put(std::move(this->value), resume);
+				this->accepted = true;
+				lock.unlock();
+				this->queue->readable.notify_one();
+				if (resume) {
+					resume.resume();
+				}
+				return false;
+			}
+			this->queue->pushers.push_back(push_waiter{ &this->value, &this->accepted, handle });
+			return true;
+		}
+		bool await_resume() const noexcept { return this->accepted; }
+	};
+
+	class pop_awaiter {
+	private:
+		bounded_queue*		queue;
+		std::optional<T>	slot;
+
+	public:
+		explicit pop_awaiter(bounded_queue& queue) : queue(&queue) {}
+
+		bool await_ready() const noexcept { return false; }
+		bool await_suspend(std::coroutine_handle<> handle) {
+			std::unique_lock lock(this->queue->mutex);
+			if (!this->queue->items.empty()) {
+				detail::queue_resume resume{};
+				this->slot.emplace(this->queue->take_front(resume));
+				lock.unlock();
+				this->queue->writable.notify_one();
+				if (resume) {
+					resume.resume();
+				}
+				return false;
+			}
+			if (this->queue->closed) {
+				return false;
+			}
+			this->queue->poppers.push_back(pop_waiter{ &this->slot, handle });
+			return true;
+		}
+		std::optional<T> await_resume() { return std::move(this->slot); }
+	};
+
+	// co_await forms of push() and pop()
+	push_awaiter async_push(T value) { return push_awaiter(*this, std::move(value)); }
+	pop_awaiter async_pop() { return pop_awaiter(*this); }
+#endif
+};
+
+template <typename V>
+class pipeline_stream {
+public:
+	typedef std::vector<V> frame;
+
+private:
+	pipeline<V>			stages;
+	thread_pool*			pool;
+	bounded_queue<frame>		input;
+	bounded_queue<frame>		output;
+	std::exception_ptr		error;
+	std::thread			worker;
+
+	void work() {
+		try {
+			while (std::optional<frame> values = this->input.pop()) {
+				this->stages.run(std::span<V>(*values), *this->pool);
+				if (!this->output.push(std::move(*values))) {
+					break;
+				}
+			}
+		}
+		catch (...) {
+			this->error = std::current_exception();
+			this->input.close();
+		}
+		this->output.close();
+	}
+
+public:
+	// depth frames may wait on each side of the pipeline
+	explicit pipeline_stream(pipeline<V> chain, std::size_t depth = 4, thread_pool& pool = thread_pool::shared())
+		: stages(std::move(chain))
+		, pool(&pool)
+		, input(depth)
+		, output(depth)
+		, worker([this]() { this->work(); })
+	{}
+	pipeline_stream(const pipeline_stream&) = delete;
+	pipeline_stream& operator=(const pipeline_stream&) = delete;
+	// Frames not yet taken with next() are dropped
+	~pipeline_stream() {
+		this->input.close();
+		this->output.close();
+		this->worker.join();
+	}
+
+	// false if the stream was closed, or stopped by an exception
+	bool submit(frame values) { return this->input.push(std::move(values)); }
+	void close() { this->input.close(); }
+
+	// The next processed frame, nullopt once the stream is closed and
+	// drained. Rethrows the exception that stopped the stream, if any.
+	std::optional<frame> next() {
+		std::optional<frame> values = this->output.pop();
+		if (!values && this->error) {
+			std::rethrow_exception(this->error);
+		}
+		return values;
+	}
+
+#if STEPHAN_PIPELINE_COROUTINES
+	// co_await forms of submit() and next(). next_async() gives nullopt
+	// both at the end and after an exception; next() tells them apart.
+	auto submit_async(frame values) { return this->input.async_push(std::move(values)); }
+	auto next_async() { return this->output.async_pop(); }
+#endif
+};
+
+}
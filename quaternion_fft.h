@@ -0,0 +1,231 @@
+/*
+Copyright (c) 2022, Dean Stephan
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of {{ project }} nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Provide the quaternion Fourier transform of images and fast quaternion convolution
+// A colour image is held as pure quaternions, r i + g j + b k, row by row.
+// quaternion_fft_plan<T> is the two-dimensional, left-sided quaternion
+// Fourier transform about a unit pure axis mu,
+//      F(u, v) = sum over (x, y) of exp(-mu 2 pi (u x / rows + v y / columns)) f(x, y)
+//      f(x, y) = 1 / (rows columns) sum over (u, v) of exp(mu 2 pi (...)) F(u, v)
+// The axis defaults to i; mu = (i + j + k) / sqrt(3), the grey line, is the
+// usual choice for colour images. It is computed by the symplectic
+// decomposition: with nu a unit pure quaternion perpendicular to mu,
+//      q = (a + b mu) + (c + d mu) nu
+// and both a + b mu and c + d mu behave as complex numbers with mu for
+// their imaginary unit. exp(-mu t) commutes with both and the transform of
+// q is the complex transform (see fft2_plan in fft.h) of each of the two
+// planes, recombined the same way.
+//
+// convolve(kernel, image, out) is the convolution with the kernel on the
+// left of every product,
+//      out(x, y) = sum over (s, t) of kernel(s, t) * image(x - s, y - t)
+// with the image zero outside its bounds, in O(N log N) rather than the
+// O(N M) of the direct sum. convolution_size::full gives every output the
+// kernel touches, (rows + kernel rows - 1) x (columns + kernel columns - 1);
+// convolution_size::same gives the rows x columns centred on the image,
+// the kernel's origin at (kernel rows / 2, kernel columns / 2). Writing
+// kernel = h1 + h2 j and image = f1 + f2 j as planes over i,
+//      kernel * image = (h1 f1 - h2 conj(f2)) + (h1 f2 + h2 conj(f1)) j
+// so the convolution is four complex convolutions, done with six padded
+// complex transforms. For the kernel on the right, conj(p q) =
+// conj(q) conj(p) turns convolve(conj(image), conj(kernel)) into the
+// conjugate of image * kernel. The padded planes are taken from the
+// calling thread's scratch arena (see arena.h).
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+#include "arena.h"
+#include "complex.h"
+#include "fft.h"
+#include "parallel.h"
+#include "quaternions.h"
+
+namespace Stephan {
+
+enum class convolution_size {
+	full,
+	same
+};
+
+namespace detail {
+
+template <typename T>
+T vector_dot(const quaternion<T>& lhs, const quaternion<T>& rhs) noexcept {
+	return (lhs.Im1() * rhs.Im1()) + (lhs.Im2() * rhs.Im2()) + (lhs.Im3() * rhs.Im3());
+}
+
+// values[n] = z1[n] + z2[n] j, z1 and z2 complex over i
+template <typename T>
+void quaternion_planes(std::span<const quaternion<T>> values, complex<T>* z1, complex<T>* z2) {
+	for (std::size_t n = 0; n < values.size(); ++n) {
+		z1[n] = complex<T>(values[n].Re(), values[n].Im1());
+		z2[n] = complex<T>(values[n].Im2(), values[n].Im3());
+	}
+}
+
+}
+
+template <typename T>
+class quaternion_fft_plan {
+private:
+	static_assert(std::is_floating_point<T>::value);
+
+	fft2_plan<T>	planes;
+	// The axis, a unit pure quaternion perpendicular to it, and their product
+	quaternion<T>	mu;
+	quaternion<T>	nu;
+	quaternion<T>	lambda;
+
+	template <bool Inverse>
+	void execute(std::span<const quaternion<T>> in, std::span<quaternion<T>> out, thread_pool& pool) const {
+		assert((in.size() == this->planes.size()) && (out.size() == this->planes.size()));
+		thread_local std::vector<complex<T>> z1, z2;
+		z1.resize(in.size());
+		z2.resize(in.size());
+		for (std::size_t n = 0; n < in.size(); ++n) {
+			const quaternion<T>& q = in[n];
+			z1[n] = complex<T>(q.Re(), detail::vector_dot(q, this->mu));
+			z2[n] = complex<T>(detail::vector_dot(q, this->nu), detail::vector_dot(q, this->lambda));
+		}
+		for (std::vector<complex<T>>* plane : { &z1, &z2 }) {
+			if constexpr (Inverse) {
+				this->planes.inverse(*plane, pool);
+			}
+			else {
+				this->planes.forward(*plane, pool);
+			}
+		}
+		for (std::size_t n = 0; n < out.size(); ++n) {
+			out[n] = quaternion<T>(z1[n].Re()) + (this->mu * z1[n].Im()) + (this->nu * z2[n].Re()) + (this->lambda * z2[n].Im());
+		}
+	}
+
+public:
+	quaternion_fft_plan(std::size_t rows, std::size_t columns, const quaternion<T>& axis = quaternion<T>(0, 1, 0, 0))
+		: planes(rows, columns)
+	{
+		quaternion<T> pure(T(0), axis.Im1(), axis.Im2(), axis.Im3());
+		assert((axis.Re() == T(0)) && (pure.norm() > T(0)));
+		this->mu = pure * (T(1) / pure.norm());
+		// Start nu from the coordinate axis furthest from mu
+		T x = std::abs(this->mu.Im1()), y = std::abs(this->mu.Im2()), z = std::abs(this->mu.Im3());
+		quaternion<T> start = ((x <= y) && (x <= z)) ? quaternion<T>(0, 1, 0, 0) : ((y <= z) ? quaternion<T>(0, 0, 1, 0) : quaternion<T>(0, 0, 0, 1));
+		quaternion<T> perpendicular = start - (this->mu * detail::vector_dot(start, this->mu));
+		this->nu = perpendicular * (T(1) / perpendicular.norm());
+		this->lambda = this->mu * this->nu;
+	}
+
+	std::size_t rows() const noexcept { return this->planes.rows(); }
+	std::size_t columns() const noexcept { return this->planes.columns(); }
+	const quaternion<T>& axis() const noexcept { return this->mu; }
+
+	// out may be the same span as in
+	void forward(std::span<const quaternion<T>> in, std::span<quaternion<T>> out, thread_pool& pool = thread_pool::shared()) const {
+		this->execute<false>(in, out, pool);
+	}
+	void inverse(std::span<const quaternion<T>> in, std::span<quaternion<T>> out, thread_pool& pool = thread_pool::shared()) const {
+		this->execute<true>(in, out, pool);
+	}
+};
+
+// out holds the rows x columns (convolution_size::same) or the
+// (rows + kernel_rows - 1) x (columns + kernel_columns - 1) outputs, row
+// by row. out must not overlap kernel or image.
+template <typename T>
+void convolve(std::span<const quaternion<T>> kernel, std::size_t kernel_rows, std::size_t kernel_columns,
+	std::span<const quaternion<T>> image, std::size_t rows, std::size_t columns,
+	std::span<quaternion<T>> out, convolution_size size = convolution_size::same, thread_pool& pool = thread_pool::shared()) {
+	static_assert(std::is_floating_point<T>::value);
+	assert((kernel_rows > 0) && (kernel_columns > 0));
+	assert((kernel.size() == kernel_rows * kernel_columns) && (image.size() == rows * columns));
+	std::size_t full_rows = rows + kernel_rows - 1, full_columns = columns + kernel_columns - 1;
+	std::size_t out_rows = (size == convolution_size::full) ? full_rows : rows;
+	std::size_t out_columns = (size == convolution_size::full) ? full_columns : columns;
+	assert(out.size() == out_rows * out_columns);
+	if (out.empty()) {
+		return;
+	}
+
+	// Padded far enough that the circular convolution does not wrap
+	fft2_plan<T> plan(fft_fast_size(full_rows), fft_fast_size(full_columns));
+	std::size_t padded_columns = plan.columns();
+	scratch_scope scratch;
+	std::span<complex<T>> h1 = scratch.allocate<complex<T>>(plan.size()), h2 = scratch.allocate<complex<T>>(plan.size());
+	std::span<complex<T>> f1 = scratch.allocate<complex<T>>(plan.size()), f2 = scratch.allocate<complex<T>>(plan.size());
+	for (std::size_t r = 0; r < kernel_rows; ++r) {
+		std::size_t offset = r * padded_columns;
+		detail::quaternion_planes(kernel.subspan(r * kernel_columns, kernel_columns), h1.data() + offset, h2.data() + offset);
+	}
+	for (std::size_t r = 0; r < rows; ++r) {
+		std::size_t offset = r * padded_columns;
+		detail::quaternion_planes(image.subspan(r * columns, columns), f1.data() + offset, f2.data() + offset);
+	}
+	for (std::span<complex<T>>* plane : { &h1, &h2, &f1, &f2 }) {
+		plan.forward(*plane, pool);
+	}
+
+	// The transform of conj(f) at u is conj(F) at -u. h1 and h2 are only
+	// read at the u being written, so the products can replace them.
+	std::size_t padded_rows = plan.rows();
+	std::size_t group = std::max<std::size_t>(1, parallel_block_size / padded_columns);
+	pool.run((padded_rows + group - 1) / group, [&](std::size_t task) {
+		std::size_t last = std::min(padded_rows, (task + 1) * group);
+		for (std::size_t r = task * group; r < last; ++r) {
+			std::size_t mirror_row = (padded_rows - r) % padded_rows;
+			for (std::size_t c = 0; c < padded_columns; ++c) {
+				std::size_t n = (r * padded_columns) + c;
+				std::size_t mirror = (mirror_row * padded_columns) + ((padded_columns - c) % padded_columns);
+				complex<T> a = h1[n], b = h2[n];
+				h1[n] = (a * f1[n]) - (b * f2[mirror].conjugate());
+				h2[n] = (a * f2[n]) + (b * f1[mirror].conjugate());
+			}
+		}
+	});
+	plan.inverse(h1, pool);
+	plan.inverse(h2, pool);
+
+	std::size_t first_row = (size == convolution_size::full) ? 0 : kernel_rows / 2;
+	std::size_t first_column = (size == convolution_size::full) ? 0 : kernel_columns / 2;
+	for (std::size_t r = 0; r < out_rows; ++r) {
+		for (std::size_t c = 0; c < out_columns; ++c) {
+			std::size_t n = ((r + first_row) * padded_columns) + c + first_column;
+			out[(r * out_columns) + c] = quaternion<T>(h1[n].Re(), h1[n].Im(), h2[n].Re(), h2[n].Im());
+		}
+	}
+}
+
+}
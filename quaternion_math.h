@@ -0,0 +1,102 @@
+/*
+Copyright (c) 2022, Dean Stephan
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of {{ project }} nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Provide the quaternion exponential and logarithm
+// For q = w + v, with w the real part and v the vector part,
+//      exp(q) = e^w (cos|v| + (v / |v|) sin|v|)
+//      log(q) = log|q| + (v / |v|) atan2(|v|, w)
+// so exp maps a rotation vector (angle * axis / 2) to the unit quaternion
+// of that rotation and log maps it back, which is what Lie-group
+// integrators use to step orientations. log(exp(q)) == q while |v| < pi.
+// A negative real q has v = 0 and no axis of its own; its logarithm takes
+// the angle pi on the first imaginary axis, as sqrt in cayley_dickson.h
+// puts the root of a negative real there, so that exp(log(q)) == q.
+//
+// As in complex_math.h, the single-value forms use <cmath> and the batch
+// forms over quaternion_soa<T> run the branch-free lane functions of
+// simd_math.h on every SIMD target; their components are within
+// 2.5 eps of the norm of the result. out may be the same container as in and is
+// resized to match.
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <numbers>
+#include <type_traits>
+
+#include "quaternion_soa.h"
+#include "quaternions.h"
+#include "simd.h"
+#include "simd_math.h"
+
+#define STEPHAN_SIMD_KERNELS "quaternion_math_kernels.h"
+#include "simd_foreach.h"
+
+namespace Stephan {
+
+template <typename T>
+quaternion<T> exp(const quaternion<T>& q) {
+	static_assert(std::is_floating_point<T>::value);
+	T angle = std::sqrt((q.Im1() * q.Im1()) + (q.Im2() * q.Im2()) + (q.Im3() * q.Im3()));
+	T scale = std::exp(q.Re());
+	T vector_scale = (angle == T(0)) ? scale : (scale * std::sin(angle)) / angle;
+	return quaternion<T>(scale * std::cos(angle), q.Im1() * vector_scale, q.Im2() * vector_scale, q.Im3() * vector_scale);
+}
+
+template <typename T>
+quaternion<T> log(const quaternion<T>& q) {
+	static_assert(std::is_floating_point<T>::value);
+	T angle = std::sqrt((q.Im1() * q.Im1()) + (q.Im2() * q.Im2()) + (q.Im3() * q.Im3()));
+	T vector_scale = (angle == T(0)) ? T(0) : std::atan2(angle, q.Re()) / angle;
+	T i = ((angle == T(0)) && (q.Re() < T(0))) ? std::numbers::pi_v<T> : q.Im1() * vector_scale;
+	return quaternion<T>(std::log(q.norm()), i, q.Im2() * vector_scale, q.Im3() * vector_scale);
+}
+
+// out[n] = exp(in[n])
+template <typename T>
+void exp(const quaternion_soa<T>& in, quaternion_soa<T>& out) {
+	static_assert(std::is_floating_point<T>::value);
+	std::size_t count = in.size();
+	detail::quaternion_lanes<T> source(in);
+	detail::quaternion_output_lanes<T> result(out, count);
+	STEPHAN_SIMD_DISPATCH(quaternion_exp<T>(count, source.in, result.out));
+}
+
+// out[n] = log(in[n])
+template <typename T>
+void log(const quaternion_soa<T>& in, quaternion_soa<T>& out) {
+	static_assert(std::is_floating_point<T>::value);
+	std::size_t count = in.size();
+	detail::quaternion_lanes<T> source(in);
+	detail::quaternion_output_lanes<T> result(out, count);
+	STEPHAN_SIMD_DISPATCH(quaternion_log<T>(count, source.in, result.out));
+}
+
+}
@@ -0,0 +1,70 @@
+/*
+Copyright (c) 2022, Dean Stephan
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of {{ project }} nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Provide the batch kernels behind quaternion_math.h
+// This file is included once per SIMD target through simd_foreach.h and
+// must not be included directly. Quaternions are structure-of-arrays lanes
+// (real, i, j, k), as in quaternion_soa_kernels.h.
+
+// exp(w + v) = e^w (cos|v| + v sin|v| / |v|)
+template <typename T>
+void quaternion_exp(std::size_t n, const T* const (&in)[4], T* const (&out)[4]) {
+	for_each_block(n, in, out, [](const T* const* x, T* const* r, std::size_t offset) {
+		vec<T> w = load(x[0] + offset), v1 = load(x[1] + offset), v2 = load(x[2] + offset), v3 = load(x[3] + offset);
+		vec<T> angle = sqrt((v1 * v1) + (v2 * v2) + (v3 * v3));
+		vec<T> s, c;
+		sincos_lanes<T>(angle, s, c);
+		vec<T> scale = exp_lanes<T>(w);
+		vec<T> vector_scale = (angle == broadcast(T(0))) ? scale : (scale * s) / angle;
+		store(r[0] + offset, scale * c);
+		store(r[1] + offset, v1 * vector_scale);
+		store(r[2] + offset, v2 * vector_scale);
+		store(r[3] + offset, v3 * vector_scale);
+	});
+}
+
+// log(w + v) = log|q| + v atan2(|v|, w) / |v|, and log|q| + pi i for a
+// negative real
+template <typename T>
+void quaternion_log(std::size_t n, const T* const (&in)[4], T* const (&out)[4]) {
+	for_each_block(n, in, out, [](const T* const* x, T* const* r, std::size_t offset) {
+		vec<T> w = load(x[0] + offset), v1 = load(x[1] + offset), v2 = load(x[2] + offset), v3 = load(x[3] + offset);
+		vec<T> vector_norm2 = (v1 * v1) + (v2 * v2) + (v3 * v3);
+		vec<T> angle = sqrt(vector_norm2);
+		vec<T> zero = broadcast(T(0));
+		vec<T> vector_scale = (angle == zero) ? zero : atan2_lanes<T>(angle, w) / angle;
+		// A negative real takes pi on the first imaginary axis
+		vec<T> i = (angle == zero) ? ((w < zero) ? broadcast(std::numbers::pi_v<T>) : zero) : v1 * vector_scale;
+		store(r[0] + offset, log_lanes<T>((w * w) + vector_norm2) * broadcast(T(0.5)));
+		store(r[1] + offset, i);
+		store(r[2] + offset, v2 * vector_scale);
+		store(r[3] + offset, v3 * vector_scale);
+	});
+}
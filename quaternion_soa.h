@@ -0,0 +1,206 @@
+/*
+Copyright (c) 2022, Dean Stephan
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of {{ project }} nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Provide a structure-of-arrays container for batches of quaternions
+// A std::vector<quaternion<T>> interleaves the four components, which makes
+// every batch operation shuffle data around before it can use the vector
+// units. quaternion_soa<T> keeps one contiguous lane per component
+//      real[0..n)  i[0..n)  j[0..n)  k[0..n)
+// so that the batch kernels below process lanes<T> quaternions per
+// instruction. The kernels are compiled for each SIMD target and the best
+// one for the processor is picked at run time (see simd.h).
+// Every lane starts on a cache line and comes from the memory_resource
+// given to the constructor, by default the default resource; an
+// aligned_arena (see arena.h) makes request-scoped batches cost no
+// allocations.
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <memory_resource>
+#include <span>
+#include <type_traits>
+
+#include "arena.h"
+#include "quaternions.h"
+#include "simd.h"
+
+#define STEPHAN_SIMD_KERNELS "quaternion_soa_kernels.h"
+#include "simd_foreach.h"
+
+namespace Stephan {
+
+template <typename Node>
+class expression;
+
+template <typename T>
+class quaternion_soa {
+private:
+	aligned_vector<T>	real_part;
+	aligned_vector<T>	i_part;
+	aligned_vector<T>	j_part;
+	aligned_vector<T>	k_part;
+
+public:
+	explicit quaternion_soa(std::size_t count = 0, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+		: real_part(count, resource)
+		, i_part(count, resource)
+		, j_part(count, resource)
+		, k_part(count, resource)
+	{}
+	explicit quaternion_soa(std::span<const quaternion<T>> values, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+		: quaternion_soa(values.size(), resource)
+	{
+		for (std::size_t n = 0; n < values.size(); ++n) {
+			this->set(n, values[n]);
+		}
+	}
+
+	// Evaluate a lazy expression over containers in one pass (see expression.h)
+	template <typename Node>
+	quaternion_soa& operator=(const expression<Node>& value);
+
+	std::pmr::memory_resource* resource() const { return real_part.get_allocator().resource; }
+	std::size_t size() const { return real_part.size(); }
+	bool empty() const { return real_part.empty(); }
+	void resize(std::size_t count) {
+		real_part.resize(count);
+		i_part.resize(count);
+		j_part.resize(count);
+		k_part.resize(count);
+	}
+	void reserve(std::size_t count) {
+		real_part.reserve(count);
+		i_part.reserve(count);
+		j_part.reserve(count);
+		k_part.reserve(count);
+	}
+	void clear() { this->resize(0); }
+
+	// Element access, converting to and from the interleaved quaternion<T>
+	quaternion<T> get(std::size_t n) const {
+		return quaternion<T>(real_part[n], i_part[n], j_part[n], k_part[n]);
+	}
+	void set(std::size_t n, const quaternion<T>& value) {
+		real_part[n] = value.Re();
+		i_part[n] = value.Im1();
+		j_part[n] = value.Im2();
+		k_part[n] = value.Im3();
+	}
+	void push_back(const quaternion<T>& value) {
+		real_part.push_back(value.Re());
+		i_part.push_back(value.Im1());
+		j_part.push_back(value.Im2());
+		k_part.push_back(value.Im3());
+	}
+	void copy_to(std::span<quaternion<T>> values) const {
+		assert(values.size() == this->size());
+		for (std::size_t n = 0; n < values.size(); ++n) {
+			values[n] = this->get(n);
+		}
+	}
+
+	// Provide real-part and imaginary-part lanes
+	std::span<T> Re() { return real_part; }
+	std::span<T> Im1() { return i_part; }
+	std::span<T> Im2() { return j_part; }
+	std::span<T> Im3() { return k_part; }
+	std::span<const T> Re() const { return real_part; }
+	std::span<const T> Im1() const { return i_part; }
+	std::span<const T> Im2() const { return j_part; }
+	std::span<const T> Im3() const { return k_part; }
+};
+
+namespace detail {
+template <typename T>
+struct quaternion_lanes {
+	const T* in[4];
+	explicit quaternion_lanes(const quaternion_soa<T>& values)
+		: in{ values.Re().data(), values.Im1().data(), values.Im2().data(), values.Im3().data() }
+	{}
+};
+template <typename T>
+struct quaternion_output_lanes {
+	T* out[4];
+	quaternion_output_lanes(quaternion_soa<T>& values, std::size_t count)
+	{
+		values.resize(count);
+		out[0] = values.Re().data();
+		out[1] = values.Im1().data();
+		out[2] = values.Im2().data();
+		out[3] = values.Im3().data();
+	}
+};
+}
+
+// Batch kernels
+// out may be the same container as an input. out is resized to match.
+
+// out[n] = a[n] * b[n]
+template <typename T>
+void multiply(const quaternion_soa<T>& a, const quaternion_soa<T>& b, quaternion_soa<T>& out) {
+	static_assert(std::is_floating_point<T>::value);
+	assert(a.size() == b.size());
+	std::size_t count = a.size();
+	detail::quaternion_lanes<T> lhs(a), rhs(b);
+	detail::quaternion_output_lanes<T> result(out, count);
+	STEPHAN_SIMD_DISPATCH(quaternion_soa_multiply<T>(count, lhs.in, rhs.in, result.out));
+}
+
+// out[n] = in[n].conjugate()
+template <typename T>
+void conjugate(const quaternion_soa<T>& in, quaternion_soa<T>& out) {
+	static_assert(std::is_floating_point<T>::value);
+	std::size_t count = in.size();
+	detail::quaternion_lanes<T> source(in);
+	detail::quaternion_output_lanes<T> result(out, count);
+	STEPHAN_SIMD_DISPATCH(quaternion_soa_conjugate<T>(count, source.in, result.out));
+}
+
+// out[n] = in[n] / in[n].norm()
+template <typename T>
+void normalize(const quaternion_soa<T>& in, quaternion_soa<T>& out) {
+	static_assert(std::is_floating_point<T>::value);
+	std::size_t count = in.size();
+	detail::quaternion_lanes<T> source(in);
+	detail::quaternion_output_lanes<T> result(out, count);
+	STEPHAN_SIMD_DISPATCH(quaternion_soa_normalize<T>(count, source.in, result.out));
+}
+
+// out[n] = in[n].norm(), out must hold in.size() values
+template <typename T>
+void norm(const quaternion_soa<T>& in, std::span<std::type_identity_t<T>> out) {
+	static_assert(std::is_floating_point<T>::value);
+	assert(out.size() == in.size());
+	detail::quaternion_lanes<T> source(in);
+	STEPHAN_SIMD_DISPATCH(quaternion_soa_norm<T>(in.size(), source.in, out.data()));
+}
+
+}
@@ -0,0 +1,79 @@
+/*
+Copyright (c) 2022, Dean Stephan
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of {{ project }} nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Provide the batch kernels behind quaternion_soa.h
+// This file is included once per SIMD target through simd_foreach.h and
+// must not be included directly. Each kernel works on the four component
+// lanes (real, i, j, k) of structure-of-arrays quaternion storage.
+
+template <typename T>
+void quaternion_soa_multiply(std::size_t n, const T* const (&a)[4], const T* const (&b)[4], T* const (&out)[4]) {
+	const T* const in[8] = { a[0], a[1], a[2], a[3], b[0], b[1], b[2], b[3] };
+	for_each_block(n, in, out, [](const T* const* x, T* const* result, std::size_t offset) {
+		vec<T> a[4] = { load(x[0] + offset), load(x[1] + offset), load(x[2] + offset), load(x[3] + offset) };
+		vec<T> b[4] = { load(x[4] + offset), load(x[5] + offset), load(x[6] + offset), load(x[7] + offset) };
+		vec<T> c[4];
+		product_lanes<T, 4>(a, b, c);
+		for (int k = 0; k < 4; ++k) {
+			store(result[k] + offset, c[k]);
+		}
+	});
+}
+
+template <typename T>
+void quaternion_soa_conjugate(std::size_t n, const T* const (&in)[4], T* const (&out)[4]) {
+	for_each_block(n, in, out, [](const T* const* x, T* const* result, std::size_t offset) {
+		store(result[0] + offset, load(x[0] + offset));
+		store(result[1] + offset, -load(x[1] + offset));
+		store(result[2] + offset, -load(x[2] + offset));
+		store(result[3] + offset, -load(x[3] + offset));
+	});
+}
+
+template <typename T>
+void quaternion_soa_norm(std::size_t n, const T* const (&in)[4], T* out) {
+	T* const norms[1] = { out };
+	for_each_block(n, in, norms, [](const T* const* x, T* const* result, std::size_t offset) {
+		vec<T> q0 = load(x[0] + offset), q1 = load(x[1] + offset), q2 = load(x[2] + offset), q3 = load(x[3] + offset);
+		store(result[0] + offset, sqrt((q0 * q0) + (q1 * q1) + (q2 * q2) + (q3 * q3)));
+	});
+}
+
+template <typename T>
+void quaternion_soa_normalize(std::size_t n, const T* const (&in)[4], T* const (&out)[4]) {
+	for_each_block(n, in, out, [](const T* const* x, T* const* result, std::size_t offset) {
+		vec<T> q0 = load(x[0] + offset), q1 = load(x[1] + offset), q2 = load(x[2] + offset), q3 = load(x[3] + offset);
+		vec<T> scale = broadcast(T(1)) / sqrt((q0 * q0) + (q1 * q1) + (q2 * q2) + (q3 * q3));
+		store(result[0] + offset, q0 * scale);
+		store(result[1] + offset, q1 * scale);
+		store(result[2] + offset, q2 * scale);
+		store(result[3] + offset, q3 * scale);
+	});
+}
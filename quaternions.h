@@ -40,6 +40,9 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #pragma once
 
 #include "complex.h"
+#include "config.h"
+#include "instrumentation.h"
+#include "vec3.h"
 
 namespace Stephan {
 
@@ -52,81 +55,232 @@ private:
     T   k_part;
 
 public:
-	quaternion(T _real_part = 0, T i = 0, T j = 0, T k = 0)
+	STEPHAN_HOST_DEVICE constexpr quaternion(T _real_part = 0, T i = 0, T j = 0, T k = 0) noexcept
 		: real_part(_real_part)
 		, i_part(i)
         , j_part(j)
         , k_part(k)
 	{}
-	quaternion()
-		: quaternion(0,0,0,0)
+	// Between precisions, e.g. quaternion<float>(quaternion<double>)
+	template <typename U>
+	STEPHAN_HOST_DEVICE explicit constexpr quaternion(const quaternion<U>& other) noexcept
+		: real_part(T(other.Re()))
+		, i_part(T(other.Im1()))
+		, j_part(T(other.Im2()))
+		, k_part(T(other.Im3()))
 	{}
 
 	// Provide real-part and imaginary-part routines
-	T Re() { return real_part; }
-	T Im1() { return i_part; }
-	T Im2() { return j_part; }
-	T Im3() { return k_part; }
+	STEPHAN_HOST_DEVICE constexpr T Re() const noexcept { return real_part; }
+	STEPHAN_HOST_DEVICE constexpr T Im1() const noexcept { return i_part; }
+	STEPHAN_HOST_DEVICE constexpr T Im2() const noexcept { return j_part; }
+	STEPHAN_HOST_DEVICE constexpr T Im3() const noexcept { return k_part; }
 
 	// Boolean relationships
 	// Note that only equality is defined. There is no ordering, so the concept
 	// of greater than and less than has no meaning.
-	bool operator==(const quaternion<T>& rhs) {
-		return (this->real_part == rhs.real_part) && (this->i == rhs.i_part)
+	STEPHAN_HOST_DEVICE constexpr bool operator==(const quaternion<T>& rhs) const noexcept {
+		return (this->real_part == rhs.real_part) && (this->i_part == rhs.i_part)
             && (this->j_part == rhs.j_part) && (this->k_part == rhs.k_part);
 	}
+	STEPHAN_HOST_DEVICE constexpr bool operator!=(const quaternion<T>& rhs) const noexcept {
+		return !(*this == rhs);
+	}
 
 	// Conjugate operation.
 	// For a quaternion number a+bi, the conjugate is a-bi
-	quaternion<T> conjugate() { return quaternion(this->real_part, -(this->i_part), -(this->j_part), -(this->k_part)); }
+	STEPHAN_HOST_DEVICE constexpr quaternion<T> conjugate() const noexcept { return quaternion(this->real_part, -(this->i_part), -(this->j_part), -(this->k_part)); }
+	STEPHAN_HOST_DEVICE constexpr quaternion<T> operator-() const noexcept { return quaternion(-(this->real_part), -(this->i_part), -(this->j_part), -(this->k_part)); }
 
 	// Addition + Subtraction
-	quaternion<T> operator+(const quaternion<T>& rhs) {
+	STEPHAN_HOST_DEVICE constexpr quaternion<T> operator+(const quaternion<T>& rhs) const noexcept {
 		return quaternion(this->real_part + rhs.real_part, this->i_part + rhs.i_part,
-            this->j_part + rhs.j_part, this->k_part + rhs.j_part);
+            this->j_part + rhs.j_part, this->k_part + rhs.k_part);
 	}
-	quaternion<T> operator+(const T& value) {
+	STEPHAN_HOST_DEVICE constexpr quaternion<T> operator+(const T& value) const noexcept {
 		return quaternion(this->real_part + value, this->i_part, this->j_part, this->k_part);
 	}
-	quaternion<T> operator-(const quaternion<T>& rhs) {
+	STEPHAN_HOST_DEVICE constexpr quaternion<T> operator-(const quaternion<T>& rhs) const noexcept {
 		return quaternion(this->real_part - rhs.real_part, this->i_part - rhs.i_part,
             this->j_part - rhs.j_part, this->k_part - rhs.k_part);
 	}
-	quaternion<T> operator-(const T& value) {
+	STEPHAN_HOST_DEVICE constexpr quaternion<T> operator-(const T& value) const noexcept {
 		return quaternion(this->real_part - value, this->i_part, this->j_part, this->k_part);
 	}
 
 	// Multiplication
-	quaternion<T> operator*(const quaternion<T>& rhs) {
+	STEPHAN_HOST_DEVICE constexpr quaternion<T> operator*(const quaternion<T>& rhs) const noexcept {
 		return quaternion(
             (this->real_part * rhs.real_part) - (this->i_part * rhs.i_part) - (this->j_part * rhs.j_part) - (this->k_part * rhs.k_part),
             (this->real_part * rhs.i_part) + (this->i_part * rhs.real_part) + (this->j_part * rhs.k_part) - (this->k_part * rhs.j_part),
             (this->real_part * rhs.j_part) + (this->j_part * rhs.real_part) + (this->k_part * rhs.i_part) - (this->i_part * rhs.k_part),
             (this->real_part * rhs.k_part) + (this->k_part * rhs.real_part) + (this->i_part * rhs.j_part) - (this->j_part * rhs.i_part));
 	}
-	quaternion<T> operator*(const T& value) {
+	STEPHAN_HOST_DEVICE constexpr quaternion<T> operator*(const T& value) const noexcept {
 		return quaternion(this->real_part * value, this->i_part * value,
             this->j_part * value, this->k_part * value);
 	}
 
 	// Division
     // NOTE: Given two quaternions p and q. The result of the division can lead to two possible
-    // solutions (q^-1) * p or p * (q^-1).
-    T norm() {
-        return std::sqrt((this->real_part*this->real_part) + (this->i_part*this->i_part) + (this->j_part*this->j_part) + (this->k_part*this->k_part));
+    // solutions (q^-1) * p or p * (q^-1). operator/ computes p * (q^-1); the free functions
+    // multiply_inverse and inverse_multiply below provide both orders.
+    // The reciprocal is q.conjugate() / norm2(), so no square root is needed, and the one
+    // reciprocal of norm2() is computed by the given policy (see reciprocal.h).
+    STEPHAN_HOST_DEVICE constexpr compute_type_t<T> norm2() const noexcept {
+        return (this->real_part*this->real_part) + (this->i_part*this->i_part) + (this->j_part*this->j_part) + (this->k_part*this->k_part);
+    }
+    STEPHAN_HOST_DEVICE T norm() const noexcept {
+        T result = std::sqrt(this->norm2());
+        STEPHAN_INSTRUMENT(quaternion<T>, norm, result);
+        return result;
     }
-    quaternion<T> reciprocal() {
-        T base = this->norm();
-        base *= base;
-        return (*this) / base;
+    template <typename Policy = exact_reciprocal>
+    STEPHAN_HOST_DEVICE constexpr quaternion<T> reciprocal() const noexcept {
+        static_assert(std::is_floating_point<compute_type_t<T>>::value);
+        compute_type_t<T> scale = Policy::apply(this->norm2());
+        quaternion result(this->real_part * scale, -(this->i_part * scale), -(this->j_part * scale), -(this->k_part * scale));
+        STEPHAN_INSTRUMENT(quaternion<T>, reciprocal, result);
+        return result;
     }
-	quaternion<T> operator/(const quaternion<T>& rhs) {
-		return (*this) * rhs->reciprocal();
+    template <typename Policy = exact_reciprocal>
+    STEPHAN_HOST_DEVICE constexpr quaternion<T> divide(const quaternion<T>& rhs) const noexcept {
+        static_assert(std::is_floating_point<compute_type_t<T>>::value);
+        typedef compute_type_t<T> A;
+        quaternion result((quaternion<A>(*this) * quaternion<A>(rhs).conjugate()) * Policy::apply(rhs.norm2()));
+        STEPHAN_INSTRUMENT(quaternion<T>, divide, result);
+        return result;
+    }
+	STEPHAN_HOST_DEVICE constexpr quaternion<T> operator/(const quaternion<T>& rhs) const noexcept {
+		return this->divide(rhs);
+	}
+	STEPHAN_HOST_DEVICE constexpr quaternion<T> operator/(const T& value) const noexcept {
+		compute_type_t<T> scale = compute_type_t<T>(1) / value;
+		quaternion result(this->real_part * scale, this->i_part * scale, this->j_part * scale, this->k_part * scale);
+		STEPHAN_INSTRUMENT(quaternion<T>, divide, result);
+		return result;
+	}
+
+	// Compound assignment, in place. q *= p is q = q * p.
+	STEPHAN_HOST_DEVICE constexpr quaternion<T>& operator+=(const quaternion<T>& rhs) noexcept {
+		this->real_part += rhs.real_part;
+		this->i_part += rhs.i_part;
+		this->j_part += rhs.j_part;
+		this->k_part += rhs.k_part;
+		return *this;
+	}
+	STEPHAN_HOST_DEVICE constexpr quaternion<T>& operator+=(const T& value) noexcept {
+		this->real_part += value;
+		return *this;
 	}
-	quaternion<T> operator/(const T& value) {
-		return quaternion(this->real_part / value, this->i_part / value,
-            this->j_part / value, this->k_part / value);
+	STEPHAN_HOST_DEVICE constexpr quaternion<T>& operator-=(const quaternion<T>& rhs) noexcept {
+		this->real_part -= rhs.real_part;
+		this->i_part -= rhs.i_part;
+		this->j_part -= rhs.j_part;
+		this->k_part -= rhs.k_part;
+		return *this;
+	}
+	STEPHAN_HOST_DEVICE constexpr quaternion<T>& operator-=(const T& value) noexcept {
+		this->real_part -= value;
+		return *this;
+	}
+	STEPHAN_HOST_DEVICE constexpr quaternion<T>& operator*=(const quaternion<T>& rhs) noexcept {
+		return (*this) = (*this) * rhs;
+	}
+	STEPHAN_HOST_DEVICE constexpr quaternion<T>& operator*=(const T& value) noexcept {
+		this->real_part *= value;
+		this->i_part *= value;
+		this->j_part *= value;
+		this->k_part *= value;
+		return *this;
+	}
+	STEPHAN_HOST_DEVICE constexpr quaternion<T>& operator/=(const quaternion<T>& rhs) noexcept {
+		return (*this) = this->divide(rhs);
+	}
+	STEPHAN_HOST_DEVICE constexpr quaternion<T>& operator/=(const T& value) noexcept {
+		return (*this) = (*this) / value;
+	}
+
+	// Rotation
+	// For a unit quaternion q, rotating v is q * (0, v) * q.conjugate(). With
+	// u the vector part, that product expands to
+	//      t = 2 (u x v)
+	//      v' = v + w t + u x t
+	// which is 18 multiplies and 12 additions instead of two full products.
+	// To rotate many points by one quaternion use rotate() in rotation.h.
+	STEPHAN_HOST_DEVICE constexpr vec3<T> rotate(const vec3<T>& v) const noexcept {
+		vec3<T> u{ this->i_part, this->j_part, this->k_part };
+		vec3<T> t = cross(u, v) * T(2);
+		return v + (t * this->real_part) + cross(u, t);
 	}
 };
 
-}
\ No newline at end of file
+// Four-dimensional dot product; for unit quaternions this is the cosine of
+// half the angle between the rotations they represent.
+template <typename T>
+STEPHAN_HOST_DEVICE constexpr T dot(const quaternion<T>& lhs, const quaternion<T>& rhs) noexcept {
+	return (lhs.Re() * rhs.Re()) + (lhs.Im1() * rhs.Im1()) + (lhs.Im2() * rhs.Im2()) + (lhs.Im3() * rhs.Im3());
+}
+
+// Free-function forms of the reciprocal: inverse(q) is q^-1,
+// multiply_inverse(p, q) is p * q^-1 and inverse_multiply(q, p) is q^-1 * p,
+// each computed as a single fused division.
+template <typename Policy = exact_reciprocal, typename T>
+STEPHAN_HOST_DEVICE constexpr quaternion<T> inverse(const quaternion<T>& value) noexcept {
+	return value.template reciprocal<Policy>();
+}
+template <typename Policy = exact_reciprocal, typename T>
+STEPHAN_HOST_DEVICE constexpr quaternion<T> multiply_inverse(const quaternion<T>& lhs, const quaternion<T>& rhs) noexcept {
+	return lhs.template divide<Policy>(rhs);
+}
+template <typename Policy = exact_reciprocal, typename T>
+STEPHAN_HOST_DEVICE constexpr quaternion<T> inverse_multiply(const quaternion<T>& lhs, const quaternion<T>& rhs) noexcept {
+	static_assert(std::is_floating_point<compute_type_t<T>>::value);
+	typedef compute_type_t<T> A;
+	quaternion<T> result((quaternion<A>(lhs).conjugate() * quaternion<A>(rhs)) * Policy::apply(lhs.norm2()));
+	STEPHAN_INSTRUMENT(quaternion<T>, divide, result);
+	return result;
+}
+
+// Scalar on the left-hand side
+template <typename T>
+STEPHAN_HOST_DEVICE constexpr quaternion<T> operator+(const T& value, const quaternion<T>& rhs) noexcept {
+	return rhs + value;
+}
+template <typename T>
+STEPHAN_HOST_DEVICE constexpr quaternion<T> operator-(const T& value, const quaternion<T>& rhs) noexcept {
+	return (-rhs) + value;
+}
+template <typename T>
+STEPHAN_HOST_DEVICE constexpr quaternion<T> operator*(const T& value, const quaternion<T>& rhs) noexcept {
+	return rhs * value;
+}
+
+// The basis units as compile-time constants, e.g.
+//      constexpr auto q = 1.0 + 2.0 * Stephan::quaternion_basis::k<double>;
+namespace quaternion_basis {
+template <typename T>
+inline constexpr quaternion<T> i = quaternion<T>(0, 1, 0, 0);
+template <typename T>
+inline constexpr quaternion<T> j = quaternion<T>(0, 0, 1, 0);
+template <typename T>
+inline constexpr quaternion<T> k = quaternion<T>(0, 0, 0, 1);
+}
+
+// Hamilton's relations, checked by the compiler
+static_assert(quaternion_basis::i<int> * quaternion_basis::j<int> == quaternion_basis::k<int>);
+static_assert(quaternion_basis::j<int> * quaternion_basis::k<int> == quaternion_basis::i<int>);
+static_assert(quaternion_basis::k<int> * quaternion_basis::i<int> == quaternion_basis::j<int>);
+static_assert(quaternion_basis::i<int> * quaternion_basis::j<int> * quaternion_basis::k<int> == quaternion<int>(-1));
+
+// Layout guarantees.
+// quaternion<T> must stay four densely packed T values (real part first) so
+// that arrays of it can be reinterpreted as plain T[4] records.
+static_assert(std::is_trivially_copyable<quaternion<float>>::value);
+static_assert(std::is_trivially_copyable<quaternion<double>>::value);
+static_assert(std::is_standard_layout<quaternion<float>>::value);
+static_assert(std::is_standard_layout<quaternion<double>>::value);
+static_assert(sizeof(quaternion<float>) == 4 * sizeof(float));
+static_assert(sizeof(quaternion<double>) == 4 * sizeof(double));
+
+}
@@ -0,0 +1,79 @@
+/*
+Copyright (c) 2022, Dean Stephan
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of {{ project }} nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Provide reciprocal policies for division
+// Division in complex<T> and quaternion<T> reduces every divide to a
+// single reciprocal of a squared norm followed by multiplies. The policy
+// decides how that one reciprocal is computed:
+//      exact_reciprocal    1 / x, correctly rounded
+//      fast_reciprocal     hardware estimate refined by a Newton step,
+//                          for float about 2 ulp of error (the same kind of
+//                          trade -ffast-math makes); for other types it is
+//                          the exact reciprocal, as an estimate is no faster
+//                          there
+// Policies are passed as a template argument, e.g.
+//      p.divide<Stephan::fast_reciprocal>(q)
+#pragma once
+
+#include "config.h"
+
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace Stephan {
+
+struct exact_reciprocal {
+	template <typename T>
+	static STEPHAN_HOST_DEVICE constexpr T apply(const T& value) noexcept { return T(1) / value; }
+};
+
+struct fast_reciprocal {
+	template <typename T>
+	static STEPHAN_HOST_DEVICE constexpr T apply(const T& value) noexcept { return T(1) / value; }
+
+	static STEPHAN_HOST_DEVICE float apply(float value) noexcept {
+#if defined(__CUDA_ARCH__) || defined(__HIP_DEVICE_COMPILE__)
+		return __frcp_rn(value);
+#elif defined(__SSE__) || defined(_M_X64)
+		float estimate = _mm_cvtss_f32(_mm_rcp_ss(_mm_set_ss(value)));
+		return estimate * (2.0f - (value * estimate));
+#elif defined(__ARM_NEON)
+		float estimate = vrecpes_f32(value);
+		return estimate * vrecpss_f32(value, estimate);
+#else
+		return 1.0f / value;
+#endif
+	}
+};
+
+}
@@ -0,0 +1,87 @@
+/*
+Copyright (c) 2022, Dean Stephan
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of {{ project }} nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Provide batch rotation of 3-D points by a quaternion
+// Rotating with q * (0, p) * q.conjugate() costs two quaternion products per
+// point. When many points share one rotation it is much cheaper to convert
+// the quaternion into its 3x3 rotation matrix once, and then apply the
+// matrix (9 multiplies, 6 additions) to every point with the SIMD kernels.
+// For a single point, quaternion<T>::rotate() is the better choice.
+//
+// As with quaternion<T>::rotate(), the quaternion must have unit norm.
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <span>
+#include <type_traits>
+
+#include "quaternions.h"
+#include "rotation_matrix.h"
+#include "simd.h"
+#include "vec3.h"
+
+#define STEPHAN_SIMD_KERNELS "rotation_kernels.h"
+#include "simd_foreach.h"
+
+namespace Stephan {
+
+// Rotate every point in place
+template <typename T>
+void rotate(const quaternion<T>& q, std::span<vec3<T>> points) {
+	static_assert(std::is_floating_point<T>::value);
+	rotation_matrix<T> matrix(q);
+	T* data = reinterpret_cast<T*>(points.data());
+	STEPHAN_SIMD_DISPATCH(rotate_points<T>(points.size(), matrix.data(), data, data));
+}
+
+// out[n] = q.rotate(in[n])
+template <typename T>
+void rotate(const quaternion<T>& q, std::span<const vec3<T>> in, std::span<vec3<T>> out) {
+	static_assert(std::is_floating_point<T>::value);
+	assert(in.size() == out.size());
+	rotation_matrix<T> matrix(q);
+	const T* source = reinterpret_cast<const T*>(in.data());
+	T* destination = reinterpret_cast<T*>(out.data());
+	STEPHAN_SIMD_DISPATCH(rotate_points<T>(in.size(), matrix.data(), source, destination));
+}
+
+// Rotate points held as separate x, y and z lanes, in place
+template <typename T>
+void rotate(const quaternion<T>& q, std::span<T> x, std::span<T> y, std::span<T> z) {
+	static_assert(std::is_floating_point<T>::value);
+	assert((x.size() == y.size()) && (x.size() == z.size()));
+	rotation_matrix<T> matrix(q);
+	const T* const in[3] = { x.data(), y.data(), z.data() };
+	T* const out[3] = { x.data(), y.data(), z.data() };
+	STEPHAN_SIMD_DISPATCH(rotate_lanes<T>(x.size(), matrix.data(), in, out));
+}
+
+}
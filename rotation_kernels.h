@@ -0,0 +1,78 @@
+/*
+Copyright (c) 2022, Dean Stephan
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of {{ project }} nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Provide the batch kernels behind rotation.h
+// This file is included once per SIMD target through simd_foreach.h and
+// must not be included directly. matrix is a row-major 3x3 rotation.
+
+// Interleaved x, y, z points. in and out may be the same buffer.
+template <typename T>
+void rotate_points(std::size_t n, const T* matrix, const T* in, T* out) {
+	constexpr std::size_t width = lanes<T>;
+	vec<T> m[9];
+	for (int e = 0; e < 9; ++e) {
+		m[e] = broadcast(matrix[e]);
+	}
+	auto apply = [&m](const T* source, T* destination) {
+		vec<T> p[3];
+		load_interleaved<3>(source, p);
+		vec<T> r[3] = {
+			(m[0] * p[0]) + (m[1] * p[1]) + (m[2] * p[2]),
+			(m[3] * p[0]) + (m[4] * p[1]) + (m[5] * p[2]),
+			(m[6] * p[0]) + (m[7] * p[1]) + (m[8] * p[2]) };
+		store_interleaved<3>(destination, r);
+	};
+	std::size_t offset = 0;
+	for (; offset + width <= n; offset += width) {
+		apply(in + (3 * offset), out + (3 * offset));
+	}
+	std::size_t remaining = n - offset;
+	if (remaining != 0) {
+		T tail[3 * width] = {};
+		std::memcpy(tail, in + (3 * offset), 3 * remaining * sizeof(T));
+		apply(tail, tail);
+		std::memcpy(out + (3 * offset), tail, 3 * remaining * sizeof(T));
+	}
+}
+
+// Separate x, y and z lanes. in and out may be the same lanes.
+template <typename T>
+void rotate_lanes(std::size_t n, const T* matrix, const T* const (&in)[3], T* const (&out)[3]) {
+	vec<T> m[9];
+	for (int e = 0; e < 9; ++e) {
+		m[e] = broadcast(matrix[e]);
+	}
+	for_each_block(n, in, out, [&m](const T* const* p, T* const* result, std::size_t offset) {
+		vec<T> x = load(p[0] + offset), y = load(p[1] + offset), z = load(p[2] + offset);
+		store(result[0] + offset, (m[0] * x) + (m[1] * y) + (m[2] * z));
+		store(result[1] + offset, (m[3] * x) + (m[4] * y) + (m[5] * z));
+		store(result[2] + offset, (m[6] * x) + (m[7] * y) + (m[8] * z));
+	});
+}
@@ -0,0 +1,194 @@
+/*
+Copyright (c) 2022, Dean Stephan
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of {{ project }} nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Provide SIMD target selection for the batch kernels
+// The batch kernels (quaternion_soa.h and friends) are written once against
+// a small set of per-target operations and compiled once per instruction
+// set by simd_foreach.h. At run time the best instruction set supported by
+// the processor is picked, so a single binary runs everywhere and still
+// uses AVX-512 where it is available.
+//
+// Supported targets:
+//      scalar          - plain C++, always available
+//      sse2            - x86-64 baseline, 128-bit vectors
+//      avx2            - AVX2 + FMA + F16C, 256-bit vectors
+//      avx512          - AVX-512F (+ AVX2, FMA, F16C), 512-bit vectors
+//      neon            - AArch64 Advanced SIMD, 128-bit vectors
+//
+// Vector code relies on the GCC/Clang vector extensions. With other
+// compilers only the scalar target is built.
+#pragma once
+
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <initializer_list>
+#include <utility>
+
+#include "config.h"
+#include "instrumentation.h"
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(_M_X64))
+#define STEPHAN_SIMD_X86 1
+#include <immintrin.h>
+#else
+#define STEPHAN_SIMD_X86 0
+#endif
+
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__aarch64__)
+#define STEPHAN_SIMD_NEON 1
+#include <arm_neon.h>
+#else
+#define STEPHAN_SIMD_NEON 0
+#endif
+
+namespace Stephan {
+namespace simd {
+
+enum class isa {
+	scalar,
+	sse2,
+	avx2,
+	avx512,
+	neon
+};
+
+inline const char* name(isa target) {
+	switch (target) {
+	case isa::sse2: return "sse2";
+	case isa::avx2: return "avx2";
+	case isa::avx512: return "avx512";
+	case isa::neon: return "neon";
+	default: return "scalar";
+	}
+}
+
+// Is the given target both compiled in and supported by this processor?
+inline bool supported(isa target) {
+	switch (target) {
+	case isa::scalar:
+		return true;
+#if STEPHAN_SIMD_X86
+	case isa::sse2:
+		return true;
+	case isa::avx2:
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") && __builtin_cpu_supports("f16c");
+	case isa::avx512:
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("f16c");
+#endif
+#if STEPHAN_SIMD_NEON
+	case isa::neon:
+		return true;
+#endif
+	default:
+		return false;
+	}
+}
+
+// The widest supported target
+inline isa detect() {
+	for (isa target : { isa::avx512, isa::avx2, isa::sse2, isa::neon }) {
+		if (supported(target)) {
+			return target;
+		}
+	}
+	return isa::scalar;
+}
+
+namespace detail {
+inline std::atomic<isa>& selected_isa() {
+	static std::atomic<isa> target(detect());
+	return target;
+}
+}
+
+// The target used by the batch kernels. It defaults to detect() and can be
+// lowered, e.g. to compare against the scalar code in benchmarks.
+inline isa active_isa() {
+	return detail::selected_isa().load(std::memory_order_relaxed);
+}
+// Returns false (and leaves the selection alone) if the target is not supported.
+inline bool set_isa(isa target) {
+	if (!supported(target)) {
+		return false;
+	}
+	detail::selected_isa().store(target, std::memory_order_relaxed);
+	return true;
+}
+
+#if defined(__GNUC__) || defined(__clang__)
+// Fixed-size vector of T, using the compiler's vector extensions
+template <typename T, std::size_t Bytes>
+struct vector_type {
+	typedef T type __attribute__((vector_size(Bytes)));
+};
+#endif
+
+}
+}
+
+// Call a kernel from simd_foreach.h on the active target, e.g.
+//      STEPHAN_SIMD_DISPATCH(quaternion_soa_multiply<T>(n, a, b, out));
+// With STEPHAN_INSTRUMENTATION every call is timed (see instrumentation.h);
+// STEPHAN_SIMD_SELECT is the same call, never timed.
+#if STEPHAN_SIMD_X86
+#define STEPHAN_SIMD_SELECT(...) \
+	switch (::Stephan::simd::active_isa()) { \
+	case ::Stephan::simd::isa::avx512: ::Stephan::simd::avx512::__VA_ARGS__; break; \
+	case ::Stephan::simd::isa::avx2: ::Stephan::simd::avx2::__VA_ARGS__; break; \
+	case ::Stephan::simd::isa::sse2: ::Stephan::simd::sse2::__VA_ARGS__; break; \
+	default: ::Stephan::simd::scalar::__VA_ARGS__; break; \
+	}
+#elif STEPHAN_SIMD_NEON
+#define STEPHAN_SIMD_SELECT(...) \
+	switch (::Stephan::simd::active_isa()) { \
+	case ::Stephan::simd::isa::neon: ::Stephan::simd::neon::__VA_ARGS__; break; \
+	default: ::Stephan::simd::scalar::__VA_ARGS__; break; \
+	}
+#else
+#define STEPHAN_SIMD_SELECT(...) ::Stephan::simd::scalar::__VA_ARGS__
+#endif
+
+#if defined(STEPHAN_INSTRUMENTATION)
+#define STEPHAN_SIMD_DISPATCH(...) \
+	do { \
+		STEPHAN_INSTRUMENT_KERNEL(#__VA_ARGS__); \
+		STEPHAN_SIMD_SELECT(__VA_ARGS__); \
+	} while (0)
+#else
+#define STEPHAN_SIMD_DISPATCH(...) STEPHAN_SIMD_SELECT(__VA_ARGS__)
+#endif
+
+// Per-target primitive operations used by every kernel
+#define STEPHAN_SIMD_KERNELS "simd_ops.h"
+#include "simd_foreach.h"
@@ -0,0 +1,103 @@
+/*
+Copyright (c) 2022, Dean Stephan
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of {{ project }} nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Compile a set of batch kernels once per SIMD target
+// Usage:
+//      #define STEPHAN_SIMD_KERNELS "my_kernels.h"
+//      #include "simd_foreach.h"
+// The kernel file is included once inside each of the namespaces
+// Stephan::simd::scalar, ::sse2, ::avx2, ::avx512 and ::neon (as far as
+// they apply to the platform), with every function in it compiled for
+// that instruction set. Inside the kernel file, lanes<T> and vec<T> give
+// the native vector width and type, and STEPHAN_SIMD_TARGET_<NAME> tells
+// which target is being compiled.
+//
+// There is deliberately no include guard.
+#ifndef STEPHAN_SIMD_KERNELS
+#error "Define STEPHAN_SIMD_KERNELS to the kernel file before including simd_foreach.h"
+#endif
+
+#define STEPHAN_SIMD_TARGET_SCALAR 1
+namespace Stephan { namespace simd { namespace scalar {
+#include STEPHAN_SIMD_KERNELS
+} } }
+#undef STEPHAN_SIMD_TARGET_SCALAR
+
+#if STEPHAN_SIMD_X86
+#define STEPHAN_SIMD_TARGET_SSE2 1
+namespace Stephan { namespace simd { namespace sse2 {
+#include STEPHAN_SIMD_KERNELS
+} } }
+#undef STEPHAN_SIMD_TARGET_SSE2
+
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx2,fma,f16c"))), apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx2,fma,f16c")
+#endif
+#define STEPHAN_SIMD_TARGET_AVX2 1
+namespace Stephan { namespace simd { namespace avx2 {
+#include STEPHAN_SIMD_KERNELS
+} } }
+#undef STEPHAN_SIMD_TARGET_AVX2
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx512f,avx2,fma,f16c"))), apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx512f,avx2,fma,f16c")
+#endif
+#define STEPHAN_SIMD_TARGET_AVX512 1
+namespace Stephan { namespace simd { namespace avx512 {
+#include STEPHAN_SIMD_KERNELS
+} } }
+#undef STEPHAN_SIMD_TARGET_AVX512
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+#endif
+
+#if STEPHAN_SIMD_NEON
+#define STEPHAN_SIMD_TARGET_NEON 1
+namespace Stephan { namespace simd { namespace neon {
+#include STEPHAN_SIMD_KERNELS
+} } }
+#undef STEPHAN_SIMD_TARGET_NEON
+#endif
+
+#undef STEPHAN_SIMD_KERNELS
@@ -0,0 +1,159 @@
+/*
+Copyright (c) 2022, Dean Stephan
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of {{ project }} nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Provide the per-target elementary functions of simd_math.h
+// This file is included once per target through simd_foreach.h and must
+// not be included directly.
+
+// Integer vector with the lane layout of vec<T>, for bit manipulation.
+// __builtin_bit_cast rather than std::bit_cast: the latter is an ordinary
+// function compiled for the default target, and passing vectors to it
+// would cross the ABI boundary the kernels are built to avoid.
+#if defined(STEPHAN_SIMD_TARGET_SCALAR)
+template <typename T>
+using bits_vec = typename ::Stephan::simd::detail::float_format<T>::bits;
+#else
+template <typename T>
+using bits_vec = typename vector_type<typename ::Stephan::simd::detail::float_format<T>::bits, vector_bytes>::type;
+#endif
+
+template <typename T>
+STEPHAN_FORCE_INLINE bits_vec<T> as_bits(const vec<T>& value) { return __builtin_bit_cast(bits_vec<T>, value); }
+template <typename T>
+STEPHAN_FORCE_INLINE vec<T> from_bits(const bits_vec<T>& value) { return __builtin_bit_cast(vec<T>, value); }
+template <typename T>
+STEPHAN_FORCE_INLINE bits_vec<T> broadcast_bits(typename ::Stephan::simd::detail::float_format<T>::bits value) { return bits_vec<T>{} + value; }
+
+template <typename T>
+STEPHAN_FORCE_INLINE vec<T> abs_lanes(const vec<T>& value) {
+	return from_bits<T>(as_bits<T>(value) & ~broadcast_bits<T>(std::numeric_limits<typename ::Stephan::simd::detail::float_format<T>::bits>::min()));
+}
+// |magnitude| with the sign of sign
+template <typename T>
+STEPHAN_FORCE_INLINE vec<T> copysign_lanes(const vec<T>& magnitude, const vec<T>& sign) {
+	bits_vec<T> sign_bit = broadcast_bits<T>(std::numeric_limits<typename ::Stephan::simd::detail::float_format<T>::bits>::min());
+	return from_bits<T>((as_bits<T>(magnitude) & ~sign_bit) | (as_bits<T>(sign) & sign_bit));
+}
+
+// c[0] + c[1] x + c[2] x^2 + ...
+template <typename T, int Terms>
+STEPHAN_FORCE_INLINE vec<T> horner(const vec<T>& x, const ::Stephan::simd::detail::series<T, Terms>& series) {
+	vec<T> sum = broadcast(series.c[Terms - 1]);
+	for (int k = Terms - 2; k >= 0; --k) {
+		sum = (sum * x) + broadcast(series.c[k]);
+	}
+	return sum;
+}
+
+template <typename T>
+STEPHAN_FORCE_INLINE vec<T> exp_lanes(const vec<T>& x) {
+	typedef ::Stephan::simd::detail::float_format<T> format;
+	vec<T> magic = broadcast(format::round_magic);
+	vec<T> clamped = (x < broadcast(format::exp_min)) ? broadcast(format::exp_min) : x;
+	clamped = (clamped > broadcast(format::exp_max)) ? broadcast(format::exp_max) : clamped;
+	vec<T> shifted = (clamped * broadcast(T(1.4426950408889634))) + magic;
+	vec<T> k = shifted - magic;
+	bits_vec<T> exponent = as_bits<T>(shifted) - as_bits<T>(magic);
+	vec<T> r = (clamped - (k * broadcast(format::ln2_hi))) - (k * broadcast(format::ln2_lo));
+	vec<T> p = horner<T>(r, format::exp_terms);
+	// 2^k in two halves, so that neither factor leaves the normal range
+	bits_vec<T> half = exponent >> 1;
+	bits_vec<T> bias = broadcast_bits<T>(format::exponent_bias);
+	vec<T> scale_lo = from_bits<T>((half + bias) << format::mantissa_bits);
+	vec<T> scale_hi = from_bits<T>(((exponent - half) + bias) << format::mantissa_bits);
+	return (p * scale_lo) * scale_hi;
+}
+
+template <typename T>
+STEPHAN_FORCE_INLINE vec<T> log_lanes(const vec<T>& x) {
+	typedef ::Stephan::simd::detail::float_format<T> format;
+	typedef typename format::bits bits;
+	// Bring subnormals into the normal range first
+	auto subnormal = x < broadcast(format::min_normal);
+	vec<T> value = subnormal ? x * broadcast(T(bits(1) << format::mantissa_bits)) : x;
+	bits_vec<T> raw = as_bits<T>(value);
+	bits_vec<T> exponent = ((raw >> format::mantissa_bits) & broadcast_bits<T>(format::exponent_mask)) - broadcast_bits<T>(format::exponent_bias);
+	exponent = subnormal ? exponent - broadcast_bits<T>(format::mantissa_bits) : exponent;
+	bits_vec<T> mantissa_mask = broadcast_bits<T>((bits(1) << format::mantissa_bits) - 1);
+	vec<T> m = from_bits<T>((raw & mantissa_mask) | broadcast_bits<T>(format::exponent_bias << format::mantissa_bits));
+	auto high = m > broadcast(T(1.4142135623730951));
+	m = high ? m * broadcast(T(0.5)) : m;
+	exponent = high ? exponent + broadcast_bits<T>(1) : exponent;
+	vec<T> s = (m - broadcast(T(1))) / (m + broadcast(T(1)));
+	vec<T> log_m = (s + s) * horner<T>(s * s, format::log_terms);
+	vec<T> magic = broadcast(format::round_magic);
+	vec<T> e = from_bits<T>(exponent + as_bits<T>(magic)) - magic;
+	vec<T> result = (e * broadcast(format::ln2_hi)) + ((e * broadcast(format::ln2_lo)) + log_m);
+	result = (x == broadcast(std::numeric_limits<T>::infinity())) ? x : result;
+	result = (x == broadcast(T(0))) ? broadcast(-std::numeric_limits<T>::infinity()) : result;
+	result = (x < broadcast(T(0))) ? broadcast(std::numeric_limits<T>::quiet_NaN()) : result;
+	// A NaN splits into a finite exponent and mantissa like any other bits
+	return (x != x) ? x : result;
+}
+
+template <typename T>
+STEPHAN_FORCE_INLINE void sincos_lanes(const vec<T>& x, vec<T>& sine, vec<T>& cosine) {
+	typedef ::Stephan::simd::detail::float_format<T> format;
+	vec<T> magic = broadcast(format::round_magic);
+	vec<T> shifted = (x * broadcast(T(0.63661977236758138))) + magic;
+	vec<T> k = shifted - magic;
+	bits_vec<T> quadrant = as_bits<T>(shifted) - as_bits<T>(magic);
+	vec<T> r = ((x - (k * broadcast(format::pi_2_hi))) - (k * broadcast(format::pi_2_mid))) - (k * broadcast(format::pi_2_lo));
+	vec<T> z = r * r;
+	vec<T> s = r * horner<T>(z, format::sin_terms);
+	vec<T> c = horner<T>(z, format::cos_terms);
+	auto swap = (quadrant & broadcast_bits<T>(1)) != broadcast_bits<T>(0);
+	sine = swap ? c : s;
+	cosine = swap ? s : c;
+	sine = ((quadrant & broadcast_bits<T>(2)) != broadcast_bits<T>(0)) ? -sine : sine;
+	cosine = (((quadrant + broadcast_bits<T>(1)) & broadcast_bits<T>(2)) != broadcast_bits<T>(0)) ? -cosine : cosine;
+}
+
+template <typename T>
+STEPHAN_FORCE_INLINE vec<T> atan2_lanes(const vec<T>& y, const vec<T>& x) {
+	typedef ::Stephan::simd::detail::float_format<T> format;
+	vec<T> ax = abs_lanes<T>(x), ay = abs_lanes<T>(y);
+	auto swap = ay > ax;
+	vec<T> numerator = swap ? ax : ay;
+	vec<T> denominator = swap ? ay : ax;
+	vec<T> a = (denominator == broadcast(T(0))) ? broadcast(T(0)) : numerator / denominator;
+	// atan(a) = pi/6 + atan((a sqrt(3) - 1) / (a + sqrt(3)))
+	auto shift = a > broadcast(T(0.26794919243112270));
+	vec<T> sqrt3 = broadcast(T(1.7320508075688772));
+	a = shift ? ((a * sqrt3) - broadcast(T(1))) / (a + sqrt3) : a;
+	vec<T> angle = a * horner<T>(a * a, format::atan_terms);
+	// Constants are added as hi + lo pairs to keep the last bits
+	angle = shift ? broadcast(format::sixth_pi_hi) + (angle + broadcast(format::sixth_pi_lo)) : angle;
+	angle = swap ? broadcast(format::half_pi_hi) - (angle - broadcast(format::half_pi_lo)) : angle;
+	angle = (as_bits<T>(x) < broadcast_bits<T>(0)) ? broadcast(format::pi_hi) - (angle - broadcast(format::pi_lo)) : angle;
+	angle = copysign_lanes<T>(angle, y);
+	angle = (x != x) ? x : angle;
+	return (y != y) ? y : angle;
+}
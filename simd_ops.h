@@ -0,0 +1,277 @@
+/*
+Copyright (c) 2022, Dean Stephan
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of {{ project }} nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Provide the per-target primitive operations used by the batch kernels
+// This file is included once per target by simd.h through simd_foreach.h
+// and must not be included directly.
+//
+// Kernels are written against
+//      lanes<T>            number of T per native vector
+//      vec<T>              native vector of T (plain T for the scalar target)
+//      load / store        unaligned vector memory access
+//      broadcast           fill every lane with one value
+//      sqrt                lane-wise square root
+//      for_each_block      run a kernel body over whole vectors, tail included
+//      reduce_add          horizontal sum
+//      product_lanes       complex or Hamilton product of 2- or 4-register values
+//      load_interleaved    split 2-, 3-, 4- or 8-component records into registers
+//      store_interleaved   and merge them back
+// together with the ordinary arithmetic operators, which the vector
+// extensions provide lane-wise.
+
+#if defined(STEPHAN_SIMD_TARGET_SCALAR)
+template <typename T>
+inline constexpr std::size_t lanes = 1;
+template <typename T>
+using vec = T;
+#else
+#if defined(STEPHAN_SIMD_TARGET_AVX512)
+inline constexpr std::size_t vector_bytes = 64;
+#elif defined(STEPHAN_SIMD_TARGET_AVX2)
+inline constexpr std::size_t vector_bytes = 32;
+#else
+inline constexpr std::size_t vector_bytes = 16;
+#endif
+template <typename T>
+inline constexpr std::size_t lanes = vector_bytes / sizeof(T);
+template <typename T>
+using vec = typename vector_type<T, vector_bytes>::type;
+#endif
+
+template <typename T>
+STEPHAN_FORCE_INLINE vec<T> load(const T* source) {
+	vec<T> value;
+	std::memcpy(&value, source, sizeof(value));
+	return value;
+}
+template <typename T>
+STEPHAN_FORCE_INLINE void store(T* destination, const vec<T>& value) {
+	std::memcpy(destination, &value, sizeof(value));
+}
+template <typename T>
+STEPHAN_FORCE_INLINE vec<T> broadcast(T value) {
+	return vec<T>{} + value;
+}
+
+#if defined(STEPHAN_SIMD_TARGET_SCALAR)
+STEPHAN_FORCE_INLINE float sqrt(float value) { return std::sqrt(value); }
+STEPHAN_FORCE_INLINE double sqrt(double value) { return std::sqrt(value); }
+#elif defined(STEPHAN_SIMD_TARGET_SSE2)
+STEPHAN_FORCE_INLINE vec<float> sqrt(vec<float> value) { return (vec<float>)_mm_sqrt_ps((__m128)value); }
+STEPHAN_FORCE_INLINE vec<double> sqrt(vec<double> value) { return (vec<double>)_mm_sqrt_pd((__m128d)value); }
+#elif defined(STEPHAN_SIMD_TARGET_AVX2)
+STEPHAN_FORCE_INLINE vec<float> sqrt(vec<float> value) { return (vec<float>)_mm256_sqrt_ps((__m256)value); }
+STEPHAN_FORCE_INLINE vec<double> sqrt(vec<double> value) { return (vec<double>)_mm256_sqrt_pd((__m256d)value); }
+#elif defined(STEPHAN_SIMD_TARGET_AVX512)
+// The masked forms avoid a spurious -Wmaybe-uninitialized from some GCC versions
+STEPHAN_FORCE_INLINE vec<float> sqrt(vec<float> value) { return (vec<float>)_mm512_maskz_sqrt_ps(0xFFFF, (__m512)value); }
+STEPHAN_FORCE_INLINE vec<double> sqrt(vec<double> value) { return (vec<double>)_mm512_maskz_sqrt_pd(0xFF, (__m512d)value); }
+#elif defined(STEPHAN_SIMD_TARGET_NEON)
+STEPHAN_FORCE_INLINE vec<float> sqrt(vec<float> value) { return (vec<float>)vsqrtq_f32((float32x4_t)value); }
+STEPHAN_FORCE_INLINE vec<double> sqrt(vec<double> value) { return (vec<double>)vsqrtq_f64((float64x2_t)value); }
+#endif
+
+// Run body(in, out, offset) over n elements, lanes<T> at a time. in and
+// out hold one pointer per input and output array, and the body works on
+// elements [offset, offset + lanes<T>), each element being InStride
+// (respectively OutStride) consecutive T. The last, partial block is staged
+// through zero-padded buffers (with offset 0), so the body only ever sees
+// whole vectors. Outputs may alias inputs.
+template <std::size_t InStride = 1, std::size_t OutStride = 1, typename T, std::size_t Inputs, std::size_t Outputs, typename Body>
+STEPHAN_FORCE_INLINE void for_each_block(std::size_t n, const T* const (&in)[Inputs], T* const (&out)[Outputs], Body&& body) {
+	constexpr std::size_t width = lanes<T>;
+	std::size_t offset = 0;
+	for (; offset + width <= n; offset += width) {
+		body(in, out, offset);
+	}
+	std::size_t remaining = n - offset;
+	if (remaining == 0) {
+		return;
+	}
+	T tail_in[Inputs][width * InStride] = {};
+	T tail_out[Outputs][width * OutStride] = {};
+	const T* tail_in_lanes[Inputs];
+	T* tail_out_lanes[Outputs];
+	for (std::size_t k = 0; k < Inputs; ++k) {
+		std::memcpy(tail_in[k], in[k] + (offset * InStride), remaining * InStride * sizeof(T));
+		tail_in_lanes[k] = tail_in[k];
+	}
+	for (std::size_t k = 0; k < Outputs; ++k) {
+		tail_out_lanes[k] = tail_out[k];
+	}
+	body(tail_in_lanes, tail_out_lanes, 0);
+	for (std::size_t k = 0; k < Outputs; ++k) {
+		std::memcpy(out[k] + (offset * OutStride), tail_out[k], remaining * OutStride * sizeof(T));
+	}
+}
+
+// Sum of all lanes
+template <typename T>
+STEPHAN_FORCE_INLINE T reduce_add(const vec<T>& value) {
+	if constexpr (lanes<T> == 1) {
+		return value;
+	}
+	else {
+		T total = 0;
+		for (std::size_t lane = 0; lane < lanes<T>; ++lane) {
+			total += value[lane];
+		}
+		return total;
+	}
+}
+
+// c = a * b, lane by lane, for complex (N = 2) or quaternion (N = 4)
+// components held one per register
+template <typename T, std::size_t N>
+STEPHAN_FORCE_INLINE void product_lanes(const vec<T> (&a)[N], const vec<T> (&b)[N], vec<T> (&c)[N]) {
+	if constexpr (N == 2) {
+		c[0] = (a[0] * b[0]) - (a[1] * b[1]);
+		c[1] = (a[0] * b[1]) + (a[1] * b[0]);
+	}
+	else {
+		static_assert(N == 4);
+		c[0] = (a[0] * b[0]) - (a[1] * b[1]) - (a[2] * b[2]) - (a[3] * b[3]);
+		c[1] = (a[0] * b[1]) + (a[1] * b[0]) + (a[2] * b[3]) - (a[3] * b[2]);
+		c[2] = (a[0] * b[2]) + (a[2] * b[0]) + (a[3] * b[1]) - (a[1] * b[3]);
+		c[3] = (a[0] * b[3]) + (a[3] * b[0]) + (a[1] * b[2]) - (a[2] * b[1]);
+	}
+}
+
+#if defined(__GNUC__) || defined(__clang__)
+// Lane selection across N registers: result lane l is lane (Map::source(l) % lanes)
+// of register (Map::source(l) / lanes), i.e. an index into the concatenation of
+// the inputs. The compiler turns each step into the target's permute
+// instructions; two (or three, for four inputs) steps cover any selection.
+template <typename Map, typename V, int... Lane>
+STEPHAN_FORCE_INLINE V select_lanes(V a, V b, std::integer_sequence<int, Lane...>) {
+	return __builtin_shufflevector(a, b, Map::source(Lane)...);
+}
+template <typename Map, typename V, int... Lane>
+STEPHAN_FORCE_INLINE V select_lanes(V a, V b, V c, std::integer_sequence<int, Lane...>) {
+	constexpr int width = int(sizeof...(Lane));
+	V low = __builtin_shufflevector(a, b, (Map::source(Lane) < 2 * width ? Map::source(Lane) : 0)...);
+	return __builtin_shufflevector(low, c, (Map::source(Lane) < 2 * width ? Lane : Map::source(Lane) - width)...);
+}
+template <typename Map, typename V, int... Lane>
+STEPHAN_FORCE_INLINE V select_lanes(V a, V b, V c, V d, std::integer_sequence<int, Lane...>) {
+	constexpr int width = int(sizeof...(Lane));
+	V low = __builtin_shufflevector(a, b, (Map::source(Lane) < 2 * width ? Map::source(Lane) : 0)...);
+	V high = __builtin_shufflevector(c, d, (Map::source(Lane) < 2 * width ? 0 : Map::source(Lane) - 2 * width)...);
+	return __builtin_shufflevector(low, high, (Map::source(Lane) < 2 * width ? Lane : Lane + width)...);
+}
+
+// Component C of N-element records, e.g. the y of xyz points
+template <int N, int C>
+struct deinterleave_map {
+	static constexpr int source(int lane) { return (N * lane) + C; }
+};
+// Output register R when writing N component registers back as records
+template <int N, int R, int Width>
+struct interleave_map {
+	static constexpr int source(int lane) {
+		return (((R * Width) + lane) % N) * Width + (((R * Width) + lane) / N);
+	}
+};
+
+// Load lanes<T> records of N components each (N = 2, 3, 4 or 8) from
+// interleaved storage into one register per component, and back.
+template <int N, typename T>
+STEPHAN_FORCE_INLINE void load_interleaved(const T* source, vec<T> (&components)[N]) {
+	if constexpr (lanes<T> == 1) {
+		for (int c = 0; c < N; ++c) {
+			components[c] = source[c];
+		}
+	}
+	else if constexpr (N == 8) {
+		// As twice as many 4-component records, alternately the lower and
+		// the upper half of each 8-component one, which are then paired up
+		using sequence = std::make_integer_sequence<int, int(lanes<T>)>;
+		vec<T> first[4], second[4];
+		load_interleaved<4>(source, first);
+		load_interleaved<4>(source + 4 * lanes<T>, second);
+		for (int c = 0; c < 4; ++c) {
+			components[c] = select_lanes<deinterleave_map<2, 0>>(first[c], second[c], sequence());
+			components[c + 4] = select_lanes<deinterleave_map<2, 1>>(first[c], second[c], sequence());
+		}
+	}
+	else {
+		using sequence = std::make_integer_sequence<int, int(lanes<T>)>;
+		vec<T> registers[N];
+		for (int r = 0; r < N; ++r) {
+			registers[r] = load(source + r * lanes<T>);
+		}
+		[&]<int... C>(std::integer_sequence<int, C...>) {
+			if constexpr (N == 2) {
+				((components[C] = select_lanes<deinterleave_map<N, C>>(registers[0], registers[1], sequence())), ...);
+			}
+			else if constexpr (N == 3) {
+				((components[C] = select_lanes<deinterleave_map<N, C>>(registers[0], registers[1], registers[2], sequence())), ...);
+			}
+			else {
+				((components[C] = select_lanes<deinterleave_map<N, C>>(registers[0], registers[1], registers[2], registers[3], sequence())), ...);
+			}
+		}(std::make_integer_sequence<int, N>());
+	}
+}
+template <int N, typename T>
+STEPHAN_FORCE_INLINE void store_interleaved(T* destination, const vec<T> (&components)[N]) {
+	if constexpr (lanes<T> == 1) {
+		for (int c = 0; c < N; ++c) {
+			destination[c] = components[c];
+		}
+	}
+	else if constexpr (N == 8) {
+		constexpr int width = int(lanes<T>);
+		using sequence = std::make_integer_sequence<int, width>;
+		vec<T> first[4], second[4];
+		for (int c = 0; c < 4; ++c) {
+			first[c] = select_lanes<interleave_map<2, 0, width>>(components[c], components[c + 4], sequence());
+			second[c] = select_lanes<interleave_map<2, 1, width>>(components[c], components[c + 4], sequence());
+		}
+		store_interleaved<4>(destination, first);
+		store_interleaved<4>(destination + 4 * width, second);
+	}
+	else {
+		constexpr int width = int(lanes<T>);
+		using sequence = std::make_integer_sequence<int, width>;
+		[&]<int... R>(std::integer_sequence<int, R...>) {
+			if constexpr (N == 2) {
+				(store(destination + R * width, select_lanes<interleave_map<N, R, width>>(components[0], components[1], sequence())), ...);
+			}
+			else if constexpr (N == 3) {
+				(store(destination + R * width, select_lanes<interleave_map<N, R, width>>(components[0], components[1], components[2], sequence())), ...);
+			}
+			else {
+				(store(destination + R * width, select_lanes<interleave_map<N, R, width>>(components[0], components[1], components[2], components[3], sequence())), ...);
+			}
+		}(std::make_integer_sequence<int, N>());
+	}
+}
+#endif
@@ -0,0 +1,112 @@
+/*
+Copyright (c) 2022, Dean Stephan
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of {{ project }} nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Provide batch dual quaternion skinning
+// Each vertex of a mesh follows a few bones of a skeleton, with a weight
+// per bone, and is moved by the dual quaternion linear blend (see
+// dual_quaternions.h) of their transforms:
+//      skin(bones, positions, indices, weights, out)
+//          out[v] = dlb(bones[indices[v][k]], weights[v][k]).transform(positions[v])
+// over k < influences, with influences = weights.size() / positions.size()
+// and the vertex's influences laid out one after the other,
+//      indices[(v * influences) + k], weights[(v * influences) + k]
+// The weights of a vertex need not sum to 1. Unused influences take weight
+// 0 (and any valid index). skin_normals() does the same for directions,
+// with the rotation of the blend only.
+//
+// The blend is the one of Kavan et al., "Geometric Skinning with
+// Approximate Dual Quaternion Blending": the bones are flipped to the
+// hemisphere of the first influence, summed, and the point transformed by
+// the sum (r, d) divided through by |r|. The translation is
+// 2 (d r*) / |r|^2, whose vector part does not depend on the component of
+// d along r, so no orthogonalization is needed.
+//
+// Positions and normals are interleaved vec3<T> records and out may be the
+// same span as positions. Vertices are processed lanes<T> at a time, the
+// bones of each lane gathered into vector registers, and blocks of
+// parallel_block_size vertices are shared out over a thread_pool.
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <type_traits>
+
+#include "dual_quaternions.h"
+#include "parallel.h"
+#include "simd.h"
+#include "vec3.h"
+
+#define STEPHAN_SIMD_KERNELS "skinning_kernels.h"
+#include "simd_foreach.h"
+
+namespace Stephan {
+
+namespace detail {
+
+template <bool Translate, typename T>
+void skin_vertices(std::span<const dual_quaternion<T>> bones, std::span<const vec3<T>> in, std::span<const std::uint32_t> indices,
+	std::span<const T> weights, std::span<vec3<T>> out, thread_pool& pool) {
+	static_assert(std::is_floating_point<T>::value);
+	assert((indices.size() == weights.size()) && (in.size() == out.size()));
+	assert(in.empty() ? weights.empty() : (weights.size() % in.size()) == 0);
+	if (in.empty()) {
+		return;
+	}
+	std::size_t influences = weights.size() / in.size();
+	assert(influences > 0);
+	const T* palette = reinterpret_cast<const T*>(bones.data());
+	pool.run(parallel_blocks(in.size()), [&](std::size_t block) {
+		std::size_t first = block * parallel_block_size;
+		std::size_t count = std::min(parallel_block_size, in.size() - first);
+		const T* source = reinterpret_cast<const T*>(in.data() + first);
+		T* destination = reinterpret_cast<T*>(out.data() + first);
+		STEPHAN_SIMD_DISPATCH(skin_vertices<Translate, T>(count, influences, palette,
+			indices.data() + (first * influences), weights.data() + (first * influences), source, destination));
+	});
+}
+
+}
+
+template <typename T>
+void skin(std::span<const dual_quaternion<T>> bones, std::span<const vec3<T>> positions, std::span<const std::uint32_t> indices,
+	std::span<const std::type_identity_t<T>> weights, std::span<vec3<T>> out, thread_pool& pool = thread_pool::shared()) {
+	detail::skin_vertices<true>(bones, positions, indices, weights, out, pool);
+}
+
+template <typename T>
+void skin_normals(std::span<const dual_quaternion<T>> bones, std::span<const vec3<T>> normals, std::span<const std::uint32_t> indices,
+	std::span<const std::type_identity_t<T>> weights, std::span<vec3<T>> out, thread_pool& pool = thread_pool::shared()) {
+	detail::skin_vertices<false>(bones, normals, indices, weights, out, pool);
+}
+
+}
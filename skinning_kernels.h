@@ -0,0 +1,131 @@
+/*
+Copyright (c) 2022, Dean Stephan
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of {{ project }} nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Provide the batch kernels behind skinning.h
+// This file is included once per SIMD target through simd_foreach.h and
+// must not be included directly. bones holds the palette as T[8] records
+// (real part, then dual part), points are interleaved x, y, z.
+
+// Blend the bones of lanes<T> vertices and move their points. Translate
+// is false for directions, which only rotate.
+template <bool Translate, bool Tail, typename T>
+STEPHAN_FORCE_INLINE void skin_block(std::size_t influences, const T* bones, const std::uint32_t* indices, const T* weights, const T* source, T* destination, std::size_t count) {
+	constexpr std::size_t width = lanes<T>;
+	static constexpr T identity[8] = { T(1) };
+	if constexpr (!Tail) {
+		count = width;
+	}
+	vec<T> sum[8] = {};
+	vec<T> first[4] = {};
+	for (std::size_t k = 0; k < influences; ++k) {
+		// Lanes past count blend the identity, which keeps them finite
+		vec<T> q[8];
+		T weight[width];
+		const T* bone[width];
+		for (std::size_t lane = 0; lane < width; ++lane) {
+			bool used = (lane < count);
+			weight[lane] = used ? weights[(lane * influences) + k] : T(1);
+			bone[lane] = used ? bones + (8 * std::size_t(indices[(lane * influences) + k])) : identity;
+		}
+#if defined(STEPHAN_SIMD_TARGET_AVX512)
+		// Copy the k-th bone of every lane next to each other and transpose
+		// them into one register per component, which two-source permutes
+		// make cheap here
+		T records[8 * width];
+		for (std::size_t lane = 0; lane < width; ++lane) {
+			std::memcpy(records + (8 * lane), bone[lane], 8 * sizeof(T));
+		}
+		load_interleaved<8>(records, q);
+#else
+		// Gather the k-th bone of every lane component by component
+		T gathered[8][width];
+		for (std::size_t lane = 0; lane < width; ++lane) {
+			for (std::size_t c = 0; c < 8; ++c) {
+				gathered[c][lane] = bone[lane][c];
+			}
+		}
+		for (std::size_t c = 0; c < 8; ++c) {
+			q[c] = load(gathered[c]);
+		}
+#endif
+		vec<T> w = load(weight);
+		if (k == 0) {
+			for (std::size_t c = 0; c < 4; ++c) {
+				first[c] = q[c];
+			}
+		}
+		else {
+			vec<T> side = (first[0] * q[0]) + (first[1] * q[1]) + (first[2] * q[2]) + (first[3] * q[3]);
+			w = (side < broadcast(T(0))) ? -w : w;
+		}
+		for (std::size_t c = 0; c < 8; ++c) {
+			sum[c] = sum[c] + (w * q[c]);
+		}
+	}
+
+	// Rotation by r / |r|, as in quaternion<T>::rotate()
+	vec<T> scale = broadcast(T(1)) / ((sum[0] * sum[0]) + (sum[1] * sum[1]) + (sum[2] * sum[2]) + (sum[3] * sum[3]));
+	vec<T> p[3];
+	load_interleaved<3>(source, p);
+	vec<T> w = sum[0], x = sum[1], y = sum[2], z = sum[3];
+	vec<T> tx = ((y * p[2]) - (z * p[1])) * broadcast(T(2));
+	vec<T> ty = ((z * p[0]) - (x * p[2])) * broadcast(T(2));
+	vec<T> tz = ((x * p[1]) - (y * p[0])) * broadcast(T(2));
+	vec<T> r[3] = {
+		p[0] + (((w * tx) + (y * tz) - (z * ty)) * scale),
+		p[1] + (((w * ty) + (z * tx) - (x * tz)) * scale),
+		p[2] + (((w * tz) + (x * ty) - (y * tx)) * scale) };
+	if constexpr (Translate) {
+		// Vector part of 2 d r*, over |r|^2
+		vec<T> dw = sum[4], dx = sum[5], dy = sum[6], dz = sum[7];
+		vec<T> twice = scale * broadcast(T(2));
+		r[0] = r[0] + (((w * dx) - (dw * x) + (y * dz) - (z * dy)) * twice);
+		r[1] = r[1] + (((w * dy) - (dw * y) + (z * dx) - (x * dz)) * twice);
+		r[2] = r[2] + (((w * dz) - (dw * z) + (x * dy) - (y * dx)) * twice);
+	}
+	store_interleaved<3>(destination, r);
+}
+
+template <bool Translate, typename T>
+void skin_vertices(std::size_t n, std::size_t influences, const T* bones, const std::uint32_t* indices, const T* weights, const T* in, T* out) {
+	constexpr std::size_t width = lanes<T>;
+	std::size_t offset = 0;
+	for (; offset + width <= n; offset += width) {
+		skin_block<Translate, false, T>(influences, bones, indices + (offset * influences), weights + (offset * influences),
+			in + (3 * offset), out + (3 * offset), width);
+	}
+	std::size_t remaining = n - offset;
+	if (remaining != 0) {
+		T tail[3 * width] = {};
+		std::memcpy(tail, in + (3 * offset), 3 * remaining * sizeof(T));
+		skin_block<Translate, true, T>(influences, bones, indices + (offset * influences), weights + (offset * influences), tail, tail, remaining);
+		std::memcpy(out + (3 * offset), tail, 3 * remaining * sizeof(T));
+	}
+}
@@ -0,0 +1,163 @@
+/*
+Copyright (c) 2022, Dean Stephan
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of {{ project }} nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Provide spherical and normalized linear interpolation of quaternions
+//      slerp(q0, q1, t)            constant angular velocity, exact (trigonometric)
+//      nlerp(q0, q1, t)            lerp followed by normalize, cheaper but the
+//                                  angular velocity is not constant
+//      slerp_n(q0, q1, t, out)     out[n] = slerp(q0, q1, t[n]), batched
+//      slerp_n(a, b, t, out)       out[n] = slerp(a[n], b[n], t[n]) over
+//                                  quaternion_soa<T> keyframes
+// The inputs must be unit quaternions. Interpolation always takes the
+// shorter of the two arcs, so q1 and -q1 (the same rotation) give the same
+// result, and t is expected in [0, 1].
+//
+// The batch forms make no trigonometric calls. They use the series of
+// D. Eberly, "A Fast and Accurate Algorithm for Computing SLERP":
+// with x = cos(theta),
+//      sin(t theta) / sin(theta) = t (1 + b1 (1 + b2 (1 + ... (1 + bN))))
+//      b_i = (t^2 / (i (2i + 1)) - i / (2i + 1)) (x - 1)
+// where the last term is scaled by (1 + mu) to absorb the truncated tail.
+// Before the series is applied the arc is halved: the normalized midpoint
+// m of q0 and q1 is formed with one square root, and the interpolation runs
+// from q0 to m or from m to q1. This keeps theta within [0, pi/4], where the
+// series converges quickly. The truncation error of the weights is then
+// below 1e-8 with 6 terms (float) and below 8e-17 with 15 terms (double),
+// under the rounding error of the type.
+#pragma once
+
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <span>
+#include <type_traits>
+
+#include "quaternion_soa.h"
+#include "quaternions.h"
+#include "simd.h"
+
+namespace Stephan {
+namespace detail {
+
+// Coefficients of the slerp series, 1 / (i (2i + 1)) and i / (2i + 1)
+// for i = 1 .. Terms, with the last pair scaled by (1 + mu)
+template <typename T, int Terms>
+struct slerp_coefficients {
+	T	u[Terms];
+	T	v[Terms];
+
+	constexpr explicit slerp_coefficients(T mu)
+		: u{}
+		, v{}
+	{
+		for (int i = 1; i <= Terms; ++i) {
+			T scale = (i == Terms) ? T(1) + mu : T(1);
+			u[i - 1] = scale / T(i * ((2 * i) + 1));
+			v[i - 1] = (scale * T(i)) / T((2 * i) + 1);
+		}
+	}
+};
+
+// Number of terms and tail correction, fitted for minimax error over
+// theta in [0, pi/4] and t in [0, 1]
+template <typename T>
+struct slerp_series;
+template <>
+struct slerp_series<float> {
+	static constexpr int terms = 6;
+	static constexpr slerp_coefficients<float, terms> coefficients{ 0.1502024f };
+};
+template <>
+struct slerp_series<double> {
+	static constexpr int terms = 15;
+	static constexpr slerp_coefficients<double, terms> coefficients{ 0.162 };
+};
+
+}
+}
+
+#define STEPHAN_SIMD_KERNELS "slerp_kernels.h"
+#include "simd_foreach.h"
+
+namespace Stephan {
+
+template <typename T>
+quaternion<T> nlerp(const quaternion<T>& q0, const quaternion<T>& q1, T t) {
+	static_assert(std::is_floating_point<T>::value);
+	T sign = (dot(q0, q1) < T(0)) ? T(-1) : T(1);
+	quaternion<T> result = (q0 * (T(1) - t)) + (q1 * (sign * t));
+	return result * (T(1) / result.norm());
+}
+
+// theta is taken as 2 atan2(|q1 - q0|, |q1 + q0|) rather than acos(q0 . q1),
+// which stays accurate when the two rotations are almost the same.
+template <typename T>
+quaternion<T> slerp(const quaternion<T>& q0, const quaternion<T>& q1, T t) {
+	static_assert(std::is_floating_point<T>::value);
+	quaternion<T> target = (dot(q0, q1) < T(0)) ? q1 * T(-1) : q1;
+	T theta = T(2) * std::atan2((target - q0).norm(), (target + q0).norm());
+	T sine = std::sin(theta);
+	if (sine == T(0)) {
+		return q0;
+	}
+	T scale = T(1) / sine;
+	return (q0 * (std::sin((T(1) - t) * theta) * scale)) + (target * (std::sin(t * theta) * scale));
+}
+
+// out[n] = slerp(q0, q1, t[n]), out must hold t.size() values
+template <typename T>
+void slerp_n(const quaternion<T>& q0, const quaternion<T>& q1, std::span<const std::type_identity_t<T>> t, std::span<quaternion<T>> out) {
+	static_assert(std::is_floating_point<T>::value);
+	assert(out.size() == t.size());
+	T x = dot(q0, q1);
+	quaternion<T> target = (x < T(0)) ? q1 * T(-1) : q1;
+	T half_cosine = std::sqrt((T(1) + std::abs(x)) * T(0.5));
+	quaternion<T> middle = (q0 + target) * (T(0.5) / half_cosine);
+	const T ends[12] = {
+		q0.Re(), q0.Im1(), q0.Im2(), q0.Im3(),
+		middle.Re(), middle.Im1(), middle.Im2(), middle.Im3(),
+		target.Re(), target.Im1(), target.Im2(), target.Im3() };
+	T* destination = reinterpret_cast<T*>(out.data());
+	STEPHAN_SIMD_DISPATCH(slerp_shared<T>(t.size(), ends, half_cosine - T(1), t.data(), destination));
+}
+
+// out[n] = slerp(a[n], b[n], t[n]). out may be the same container as an
+// input and is resized to match.
+template <typename T>
+void slerp_n(const quaternion_soa<T>& a, const quaternion_soa<T>& b, std::span<const std::type_identity_t<T>> t, quaternion_soa<T>& out) {
+	static_assert(std::is_floating_point<T>::value);
+	assert((a.size() == b.size()) && (a.size() == t.size()));
+	std::size_t count = a.size();
+	detail::quaternion_lanes<T> from(a), to(b);
+	detail::quaternion_output_lanes<T> result(out, count);
+	STEPHAN_SIMD_DISPATCH(slerp_pairs<T>(count, from.in, to.in, t.data(), result.out));
+}
+
+}
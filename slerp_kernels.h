@@ -0,0 +1,117 @@
+/*
+Copyright (c) 2022, Dean Stephan
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of {{ project }} nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Provide the batch kernels behind slerp.h
+// This file is included once per SIMD target through simd_foreach.h and
+// must not be included directly. See slerp.h for the series used.
+
+// sin(t theta) / sin(theta) for x - 1 = cos(theta) - 1
+template <typename T, int Terms>
+STEPHAN_FORCE_INLINE vec<T> slerp_weight(const vec<T>& t, const vec<T>& xm1, const vec<T> (&u)[Terms], const vec<T> (&v)[Terms]) {
+	vec<T> one = broadcast(T(1));
+	vec<T> tt = t * t;
+	vec<T> f = one;
+	for (int i = Terms - 1; i >= 0; --i) {
+		f = one + (((u[i] * tt) - v[i]) * xm1) * f;
+	}
+	return t * f;
+}
+
+// Interpolate along one half of the arc: from ends[0..4) to ends[4..8)
+// for t <= 1/2 and from ends[4..8) to ends[8..12) above, with
+// xm1 = cos(theta / 2) - 1. out holds interleaved quaternions.
+template <typename T>
+void slerp_shared(std::size_t n, const T (&ends)[12], T xm1, const T* t, T* out) {
+	constexpr int terms = ::Stephan::detail::slerp_series<T>::terms;
+	constexpr auto& series = ::Stephan::detail::slerp_series<T>::coefficients;
+	vec<T> u[terms], v[terms];
+	for (int i = 0; i < terms; ++i) {
+		u[i] = broadcast(series.u[i]);
+		v[i] = broadcast(series.v[i]);
+	}
+	vec<T> q[12];
+	for (int e = 0; e < 12; ++e) {
+		q[e] = broadcast(ends[e]);
+	}
+	vec<T> cosine = broadcast(xm1);
+	const T* const in[1] = { t };
+	T* const result[1] = { out };
+	for_each_block<1, 4>(n, in, result, [&](const T* const* x, T* const* r, std::size_t offset) {
+		vec<T> time = load(x[0] + offset);
+		auto lower = time <= broadcast(T(0.5));
+		vec<T> s = (time + time) - (lower ? broadcast(T(0)) : broadcast(T(1)));
+		vec<T> to_weight = slerp_weight<T>(s, cosine, u, v);
+		vec<T> from_weight = slerp_weight<T>(broadcast(T(1)) - s, cosine, u, v);
+		vec<T> components[4];
+		for (int c = 0; c < 4; ++c) {
+			vec<T> from = lower ? q[c] : q[4 + c];
+			vec<T> to = lower ? q[4 + c] : q[8 + c];
+			components[c] = (from * from_weight) + (to * to_weight);
+		}
+		store_interleaved<4>(r[0] + (4 * offset), components);
+	});
+}
+
+// out = slerp(a, b, t) per element, on structure-of-arrays lanes
+template <typename T>
+void slerp_pairs(std::size_t n, const T* const (&a)[4], const T* const (&b)[4], const T* t, T* const (&out)[4]) {
+	constexpr int terms = ::Stephan::detail::slerp_series<T>::terms;
+	constexpr auto& series = ::Stephan::detail::slerp_series<T>::coefficients;
+	vec<T> u[terms], v[terms];
+	for (int i = 0; i < terms; ++i) {
+		u[i] = broadcast(series.u[i]);
+		v[i] = broadcast(series.v[i]);
+	}
+	const T* const in[9] = { a[0], a[1], a[2], a[3], b[0], b[1], b[2], b[3], t };
+	for_each_block(n, in, out, [&](const T* const* x, T* const* r, std::size_t offset) {
+		vec<T> p[4], q[4];
+		for (int c = 0; c < 4; ++c) {
+			p[c] = load(x[c] + offset);
+			q[c] = load(x[4 + c] + offset);
+		}
+		vec<T> cosine = (p[0] * q[0]) + (p[1] * q[1]) + (p[2] * q[2]) + (p[3] * q[3]);
+		vec<T> sign = (cosine < broadcast(T(0))) ? broadcast(T(-1)) : broadcast(T(1));
+		vec<T> half_cosine = sqrt((broadcast(T(1)) + (cosine * sign)) * broadcast(T(0.5)));
+		vec<T> middle_scale = broadcast(T(0.5)) / half_cosine;
+		vec<T> time = load(x[8] + offset);
+		auto lower = time <= broadcast(T(0.5));
+		vec<T> s = (time + time) - (lower ? broadcast(T(0)) : broadcast(T(1)));
+		vec<T> xm1 = half_cosine - broadcast(T(1));
+		vec<T> to_weight = slerp_weight<T>(s, xm1, u, v);
+		vec<T> from_weight = slerp_weight<T>(broadcast(T(1)) - s, xm1, u, v);
+		for (int c = 0; c < 4; ++c) {
+			vec<T> target = q[c] * sign;
+			vec<T> middle = (p[c] + target) * middle_scale;
+			vec<T> from = lower ? p[c] : middle;
+			vec<T> to = lower ? middle : target;
+			store(r[c] + offset, (from * from_weight) + (to * to_weight));
+		}
+	});
+}
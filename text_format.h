@@ -0,0 +1,378 @@
+/*
+Copyright (c) 2022, Dean Stephan
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of {{ project }} nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Provide locale-independent text formatting and parsing of complex numbers and quaternions
+// Built on std::to_chars and std::from_chars, so nothing allocates, nothing
+// depends on the locale, and by default every component is written in the
+// fewest digits that read back to exactly the same value:
+//      to_chars(first, last, z)        a+bi, or a+bj with imaginary_unit::j
+//      to_chars(first, last, q)        a+bi+cj+dk
+//      from_chars(first, last, z)
+//      from_chars(first, last, q)
+// These follow the std functions: they write into or read from the
+// caller's [first, last) and return the end of what they wrote or read,
+// with std::errc::value_too_large when the buffer is too short and
+// std::errc::invalid_argument or result_out_of_range for text that does
+// not parse. The output matches the stream output of complex_io.h apart
+// from the digits chosen.
+//
+// from_chars reads any sum of terms, each a number optionally followed by
+// a unit, i or j for complex numbers and i, j or k for quaternions, with
+// every unit at most once and in any order: "3", "-2.5i", "1-1e-3j",
+// "0.5k+2". Like std::from_chars it stops at the first character that
+// cannot continue the value, so "1+2i,3" reads 1+2i and points at the
+// comma; a term that repeats a unit already read, as the "-2" in "1-2",
+// ends the value instead of being added to it.
+//
+// For arrays, format_values writes the values separated by a single
+// character, and parse_values reads exactly values.size() of them, also
+// accepting "\r\n" when the separator is '\n' and one trailing separator.
+// Both cut large arrays into blocks of parallel_block_size values on a
+// thread_pool: format_values formats each block on its own and copies the
+// blocks into the buffer in order, parse_values finds the start of every
+// block with a memchr pass over the separators before parsing the blocks.
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <span>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+#include "complex.h"
+#include "parallel.h"
+#include "quaternions.h"
+
+namespace Stephan {
+
+enum class imaginary_unit : char {
+	i = 'i',
+	j = 'j'	// electrical engineering
+};
+
+struct text_format {
+	// precision < 0 is the shortest round trip text in format, where
+	// general stands for the shorter of fixed and scientific
+	std::chars_format	format = std::chars_format::general;
+	int			precision = -1;
+	// For complex numbers only
+	imaginary_unit		unit = imaginary_unit::i;
+};
+
+namespace detail {
+
+template <typename T>
+std::to_chars_result text_component(char* first, char* last, T value, const text_format& format) noexcept {
+	if (format.precision >= 0) {
+		return std::to_chars(first, last, value, format.format, format.precision);
+	}
+	if (format.format == std::chars_format::general) {
+		return std::to_chars(first, last, value);
+	}
+	return std::to_chars(first, last, value, format.format);
+}
+
+// A signed coefficient and its unit, as written by text_component
+template <typename T>
+std::to_chars_result text_term(char* first, char* last, T value, char unit, const text_format& format) noexcept {
+	if (!std::signbit(value)) {
+		if (first == last) {
+			return { last, std::errc::value_too_large };
+		}
+		*first++ = '+';
+	}
+	std::to_chars_result result = text_component(first, last, value, format);
+	if (result.ec != std::errc()) {
+		return result;
+	}
+	if (result.ptr == last) {
+		return { last, std::errc::value_too_large };
+	}
+	*result.ptr++ = unit;
+	return result;
+}
+
+// One term of a sum, a number and at most one of units after it. Only the
+// first term may go without a sign. Sets unit to 0 for a real term.
+template <typename T>
+std::from_chars_result text_parse_term(const char* first, const char* last, bool leading, const char* units, T& value, char& unit) noexcept {
+	const char* p = first;
+	if ((p != last) && (*p == '+')) {
+		++p;
+		if ((p != last) && (*p == '-')) {
+			return { first, std::errc::invalid_argument };
+		}
+	}
+	else if (!leading && ((p == last) || (*p != '-'))) {
+		return { first, std::errc::invalid_argument };
+	}
+	std::from_chars_result result = std::from_chars(p, last, value);
+	if (result.ec != std::errc()) {
+		return { first, result.ec };
+	}
+	unit = 0;
+	if ((result.ptr != last) && (*result.ptr != 0) && (std::strchr(units, *result.ptr) != nullptr)) {
+		unit = *result.ptr++;
+	}
+	return result;
+}
+
+// Reads a sum of terms into components. The unit units[n] adds to
+// components[slots[n]]; the real part is components[0].
+template <typename T, std::size_t N>
+std::from_chars_result text_parse_sum(const char* first, const char* last, const char* units, const std::size_t* slots, T (&components)[N]) noexcept {
+	bool seen[N] = {};
+	const char* p = first;
+	for (bool leading = true; ; leading = false) {
+		T value;
+		char unit;
+		std::from_chars_result term = text_parse_term(p, last, leading, units, value, unit);
+		if (term.ec != std::errc()) {
+			if (leading) {
+				return term;
+			}
+			break;
+		}
+		std::size_t n = (unit == 0) ? 0 : slots[std::strchr(units, unit) - units];
+		if (seen[n]) {
+			break;
+		}
+		seen[n] = true;
+		components[n] = value;
+		p = term.ptr;
+	}
+	for (std::size_t n = 0; n < N; ++n) {
+		if (!seen[n]) {
+			components[n] = T(0);
+		}
+	}
+	return { p, std::errc() };
+}
+
+// The longest text of one component in format, with its sign and unit
+template <typename T>
+std::size_t text_bound(const text_format& format) noexcept {
+	constexpr std::size_t digits = std::numeric_limits<T>::max_digits10;
+	constexpr std::size_t integer = std::numeric_limits<T>::max_exponent10 + 1;
+	constexpr std::size_t fraction = 1 - std::numeric_limits<T>::min_exponent10 + digits;
+	std::size_t precision = static_cast<std::size_t>(std::max(format.precision, 0));
+	if (format.format == std::chars_format::fixed) {
+		return integer + ((format.precision < 0) ? fraction : precision) + 4;
+	}
+	return ((format.precision < 0) ? digits : precision) + 12;
+}
+
+// values, each after a separator but for the first of all
+template <typename V>
+std::to_chars_result text_format_range(char* first, char* last, std::span<const V> values, bool leading, char separator, const text_format& format) noexcept {
+	std::to_chars_result result = { first, std::errc() };
+	for (std::size_t n = 0; n < values.size(); ++n) {
+		if ((n > 0) || !leading) {
+			if (result.ptr == last) {
+				return { last, std::errc::value_too_large };
+			}
+			*result.ptr++ = separator;
+		}
+		result = to_chars(result.ptr, last, values[n], format);
+		if (result.ec != std::errc()) {
+			return result;
+		}
+	}
+	return result;
+}
+
+template <typename T, typename V>
+std::to_chars_result text_format_values(char* first, char* last, std::span<const V> values, char separator, const text_format& format, thread_pool& pool) {
+	std::size_t blocks = parallel_blocks(values.size());
+	if ((blocks <= 1) || (pool.size() == 1)) {
+		return text_format_range(first, last, values, true, separator, format);
+	}
+	std::size_t bound = ((sizeof(V) / sizeof(T)) * text_bound<T>(format)) + 1;
+	std::vector<std::string> text(blocks);
+	pool.run(blocks, [&](std::size_t block) {
+		std::span<const V> range = parallel_block(values, block);
+		std::string& out = text[block];
+		out.resize(range.size() * bound);
+		std::to_chars_result result = text_format_range(out.data(), out.data() + out.size(), range, block == 0, separator, format);
+		out.resize(static_cast<std::size_t>(result.ptr - out.data()));
+	});
+	char* p = first;
+	for (const std::string& part : text) {
+		if (static_cast<std::size_t>(last - p) < part.size()) {
+			return { last, std::errc::value_too_large };
+		}
+		std::memcpy(p, part.data(), part.size());
+		p += part.size();
+	}
+	return { p, std::errc() };
+}
+
+// values, each followed by a separator but for the last of all, which may
+// be followed by one
+template <typename V>
+std::from_chars_result text_parse_range(const char* first, const char* last, std::span<V> values, bool final, char separator) noexcept {
+	const char* p = first;
+	for (std::size_t n = 0; n < values.size(); ++n) {
+		std::from_chars_result result = from_chars(p, last, values[n]);
+		if (result.ec != std::errc()) {
+			return result;
+		}
+		p = result.ptr;
+		const char* q = p;
+		if ((separator == '\n') && (q != last) && (*q == '\r')) {
+			++q;
+		}
+		if ((q != last) && (*q == separator)) {
+			p = q + 1;
+		}
+		else if (!final || (n + 1 < values.size())) {
+			return { p, std::errc::invalid_argument };
+		}
+	}
+	return { p, std::errc() };
+}
+
+template <typename V>
+std::from_chars_result text_parse_values(const char* first, const char* last, std::span<V> values, char separator, thread_pool& pool) {
+	std::size_t blocks = parallel_blocks(values.size());
+	if ((blocks <= 1) || (pool.size() == 1)) {
+		return text_parse_range(first, last, values, true, separator);
+	}
+	// Values never contain the separator, so block b starts after the
+	// (b parallel_block_size)th one
+	std::vector<const char*> starts(blocks + 1);
+	starts[0] = first;
+	const char* p = first;
+	for (std::size_t block = 1; block < blocks; ++block) {
+		for (std::size_t n = 0; n < parallel_block_size; ++n) {
+			const void* found = std::memchr(p, separator, static_cast<std::size_t>(last - p));
+			if (found == nullptr) {
+				return { last, std::errc::invalid_argument };
+			}
+			p = static_cast<const char*>(found) + 1;
+		}
+		starts[block] = p;
+	}
+	std::vector<std::from_chars_result> results(blocks);
+	pool.run(blocks, [&](std::size_t block) {
+		results[block] = text_parse_range(starts[block], last, parallel_block(values, block), block + 1 == blocks, separator);
+	});
+	for (std::size_t block = 0; block + 1 < blocks; ++block) {
+		if (results[block].ec != std::errc()) {
+			return results[block];
+		}
+		if (results[block].ptr != starts[block + 1]) {
+			return { results[block].ptr, std::errc::invalid_argument };
+		}
+	}
+	return results.back();
+}
+
+}
+
+template <typename T>
+std::to_chars_result to_chars(char* first, char* last, const complex<T>& value, const text_format& format = {}) noexcept {
+	static_assert(std::is_floating_point<T>::value);
+	std::to_chars_result result = detail::text_component(first, last, value.Re(), format);
+	if (result.ec != std::errc()) {
+		return result;
+	}
+	return detail::text_term(result.ptr, last, value.Im(), static_cast<char>(format.unit), format);
+}
+
+template <typename T>
+std::to_chars_result to_chars(char* first, char* last, const quaternion<T>& value, const text_format& format = {}) noexcept {
+	static_assert(std::is_floating_point<T>::value);
+	std::to_chars_result result = detail::text_component(first, last, value.Re(), format);
+	const T parts[3] = { value.Im1(), value.Im2(), value.Im3() };
+	for (int n = 0; (n < 3) && (result.ec == std::errc()); ++n) {
+		result = detail::text_term(result.ptr, last, parts[n], "ijk"[n], format);
+	}
+	return result;
+}
+
+// value is left alone if nothing parses. i and j are the same unit, so
+// only one of them may appear.
+template <typename T>
+std::from_chars_result from_chars(const char* first, const char* last, complex<T>& value) noexcept {
+	static_assert(std::is_floating_point<T>::value);
+	static constexpr std::size_t slots[] = { 1, 1 };
+	T components[2];
+	std::from_chars_result result = detail::text_parse_sum(first, last, "ij", slots, components);
+	if (result.ec == std::errc()) {
+		value = complex<T>(components[0], components[1]);
+	}
+	return result;
+}
+
+template <typename T>
+std::from_chars_result from_chars(const char* first, const char* last, quaternion<T>& value) noexcept {
+	static_assert(std::is_floating_point<T>::value);
+	static constexpr std::size_t slots[] = { 1, 2, 3 };
+	T components[4];
+	std::from_chars_result result = detail::text_parse_sum(first, last, "ijk", slots, components);
+	if (result.ec == std::errc()) {
+		value = quaternion<T>(components[0], components[1], components[2], components[3]);
+	}
+	return result;
+}
+
+// On value_too_large, [first, last) holds an unspecified part of the text
+template <typename T>
+std::to_chars_result format_values(char* first, char* last, std::span<const complex<T>> values, char separator = '\n',
+	const text_format& format = {}, thread_pool& pool = thread_pool::shared()) {
+	return detail::text_format_values<T>(first, last, values, separator, format, pool);
+}
+template <typename T>
+std::to_chars_result format_values(char* first, char* last, std::span<const quaternion<T>> values, char separator = '\n',
+	const text_format& format = {}, thread_pool& pool = thread_pool::shared()) {
+	return detail::text_format_values<T>(first, last, values, separator, format, pool);
+}
+
+// Returns the end of the last value and of its separator, if it has one.
+// On error, values holds an unspecified mix of parsed and old values.
+template <typename T>
+std::from_chars_result parse_values(const char* first, const char* last, std::span<complex<T>> values, char separator = '\n',
+	thread_pool& pool = thread_pool::shared()) {
+	return detail::text_parse_values(first, last, values, separator, pool);
+}
+template <typename T>
+std::from_chars_result parse_values(const char* first, const char* last, std::span<quaternion<T>> values, char separator = '\n',
+	thread_pool& pool = thread_pool::shared()) {
+	return detail::text_parse_values(first, last, values, separator, pool);
+}
+
+}
@@ -0,0 +1,219 @@
+/*
+Copyright (c) 2022, Dean Stephan
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of {{ project }} nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Provide a unit quaternion type for rotations
+// A rotation quaternion always has norm 1, so its inverse is just its
+// conjugate and division is multiplication by the conjugate: no norm, no
+// reciprocal and no square root. unit_quaternion<T> carries that guarantee
+// in the type. It holds nothing but the quaternion, so it has the layout of
+// quaternion<T>, four T, and arrays of it can be handed to the batch
+// kernels, quaternion_soa and binary.h as they are.
+//
+// Rounding makes the norm of a long product chain drift away from 1. Instead
+// of a full normalize after every step, renormalize() applies one Newton
+// step of 1/sqrt(x) around x = 1
+//      q *= (3 - |q|^2) / 2
+// which squares the remaining error (1e-4 becomes about 1e-8) for the price
+// of a dot product and a scale. unit_accumulator<T, RenormalizeEvery> keeps
+// a running product, counts the products it has been through and applies
+// the step every RenormalizeEvery of them; the count lives in the
+// accumulator, not in the values. Set RenormalizeEvery to 0 to turn it off
+// and call renormalize() by hand.
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <type_traits>
+
+#include "quaternions.h"
+#include "vec3.h"
+
+namespace Stephan {
+
+template <typename T>
+class unit_quaternion {
+	static_assert(std::is_floating_point<T>::value);
+
+private:
+	quaternion<T>	value_part;
+
+	struct trusted {};
+	STEPHAN_HOST_DEVICE constexpr unit_quaternion(const quaternion<T>& value, trusted) noexcept
+		: value_part(value)
+	{}
+
+public:
+	// The identity rotation
+	STEPHAN_HOST_DEVICE constexpr unit_quaternion() noexcept
+		: value_part(1, 0, 0, 0)
+	{}
+	// Normalizes the given quaternion once, exactly
+	STEPHAN_HOST_DEVICE explicit unit_quaternion(const quaternion<T>& value) noexcept
+		: value_part(value * (T(1) / value.norm()))
+	{
+		STEPHAN_INSTRUMENT(unit_quaternion, normalize, this->value_part);
+	}
+
+	// Wrap a quaternion that is already known to have unit norm, without
+	// normalizing it
+	static STEPHAN_HOST_DEVICE constexpr unit_quaternion<T> from_normalized(const quaternion<T>& value) noexcept {
+		return unit_quaternion(value, trusted{});
+	}
+	// Rotation by angle (in radians) about the given unit axis
+	static STEPHAN_HOST_DEVICE unit_quaternion<T> from_axis_angle(const vec3<T>& axis, T angle) noexcept {
+		T s = std::sin(angle / T(2));
+		return from_normalized(quaternion<T>(std::cos(angle / T(2)), axis.x * s, axis.y * s, axis.z * s));
+	}
+
+	// Provide real-part and imaginary-part routines
+	STEPHAN_HOST_DEVICE constexpr T Re() const noexcept { return value_part.Re(); }
+	STEPHAN_HOST_DEVICE constexpr T Im1() const noexcept { return value_part.Im1(); }
+	STEPHAN_HOST_DEVICE constexpr T Im2() const noexcept { return value_part.Im2(); }
+	STEPHAN_HOST_DEVICE constexpr T Im3() const noexcept { return value_part.Im3(); }
+	STEPHAN_HOST_DEVICE constexpr const quaternion<T>& value() const noexcept { return value_part; }
+	STEPHAN_HOST_DEVICE constexpr operator const quaternion<T>&() const noexcept { return value_part; }
+
+	STEPHAN_HOST_DEVICE constexpr bool operator==(const unit_quaternion<T>& rhs) const noexcept {
+		return (this->Re() == rhs.Re()) && (this->Im1() == rhs.Im1())
+			&& (this->Im2() == rhs.Im2()) && (this->Im3() == rhs.Im3());
+	}
+
+	// One Newton step towards unit norm; see the note at the top
+	STEPHAN_HOST_DEVICE constexpr void renormalize() noexcept {
+		T scale = (T(3) - this->value_part.norm2()) * T(0.5);
+		this->value_part = this->value_part * scale;
+		STEPHAN_INSTRUMENT(unit_quaternion, normalize, this->value_part);
+	}
+
+	// Inverse and conjugate are the same thing for a unit quaternion
+	STEPHAN_HOST_DEVICE constexpr unit_quaternion<T> conjugate() const noexcept {
+		return unit_quaternion(this->value_part.conjugate(), trusted{});
+	}
+	STEPHAN_HOST_DEVICE constexpr unit_quaternion<T> reciprocal() const noexcept {
+		return this->conjugate();
+	}
+
+	// Products of unit quaternions stay unit quaternions, up to the drift
+	// that unit_accumulator or renormalize() takes care of
+	STEPHAN_HOST_DEVICE constexpr unit_quaternion<T> operator*(const unit_quaternion<T>& rhs) const noexcept {
+		return unit_quaternion(this->value_part * rhs.value_part, trusted{});
+	}
+	STEPHAN_HOST_DEVICE constexpr unit_quaternion<T> operator/(const unit_quaternion<T>& rhs) const noexcept {
+		return (*this) * rhs.conjugate();
+	}
+	STEPHAN_HOST_DEVICE constexpr unit_quaternion<T>& operator*=(const unit_quaternion<T>& rhs) noexcept {
+		return (*this) = (*this) * rhs;
+	}
+	STEPHAN_HOST_DEVICE constexpr unit_quaternion<T>& operator/=(const unit_quaternion<T>& rhs) noexcept {
+		return (*this) = (*this) / rhs;
+	}
+
+	// Mixing with a general quaternion gives a general quaternion
+	STEPHAN_HOST_DEVICE constexpr quaternion<T> operator*(const quaternion<T>& rhs) const noexcept {
+		return this->value_part * rhs;
+	}
+	STEPHAN_HOST_DEVICE constexpr quaternion<T> operator/(const quaternion<T>& rhs) const noexcept {
+		return this->value_part / rhs;
+	}
+
+	STEPHAN_HOST_DEVICE constexpr vec3<T> rotate(const vec3<T>& v) const noexcept {
+		return this->value_part.rotate(v);
+	}
+};
+
+// Layout guarantees, as for quaternion<T>
+static_assert(std::is_trivially_copyable<unit_quaternion<float>>::value);
+static_assert(std::is_standard_layout<unit_quaternion<double>>::value);
+static_assert(sizeof(unit_quaternion<float>) == 4 * sizeof(float));
+static_assert(sizeof(unit_quaternion<double>) == 4 * sizeof(double));
+
+template <typename T>
+STEPHAN_HOST_DEVICE constexpr quaternion<T> operator*(const quaternion<T>& lhs, const unit_quaternion<T>& rhs) noexcept {
+	return lhs * rhs.value();
+}
+// p / u is p * u.conjugate()
+template <typename T>
+STEPHAN_HOST_DEVICE constexpr quaternion<T> operator/(const quaternion<T>& lhs, const unit_quaternion<T>& rhs) noexcept {
+	return lhs * rhs.value().conjugate();
+}
+
+template <typename T>
+STEPHAN_HOST_DEVICE constexpr unit_quaternion<T> inverse(const unit_quaternion<T>& value) noexcept {
+	return value.conjugate();
+}
+
+// A running product of unit quaternions, renormalized every
+// RenormalizeEvery products. a *= q multiplies on the right, a.premultiply(q)
+// on the left.
+template <typename T, unsigned RenormalizeEvery = 32>
+class unit_accumulator {
+private:
+	unit_quaternion<T>	value_part;
+	std::uint32_t		operation_count = 0;
+
+	// Account for one more product and renormalize when it is due
+	STEPHAN_HOST_DEVICE constexpr unit_accumulator<T, RenormalizeEvery>& step() noexcept {
+		if (RenormalizeEvery != 0 && ++(this->operation_count) >= RenormalizeEvery) {
+			this->renormalize();
+		}
+		return *this;
+	}
+
+public:
+	// Starts from the identity rotation, or from the given one
+	STEPHAN_HOST_DEVICE constexpr unit_accumulator() noexcept = default;
+	STEPHAN_HOST_DEVICE constexpr explicit unit_accumulator(const unit_quaternion<T>& start) noexcept
+		: value_part(start)
+	{}
+
+	STEPHAN_HOST_DEVICE constexpr const unit_quaternion<T>& value() const noexcept { return value_part; }
+	STEPHAN_HOST_DEVICE constexpr operator const unit_quaternion<T>&() const noexcept { return value_part; }
+	STEPHAN_HOST_DEVICE constexpr std::uint32_t count() const noexcept { return operation_count; }
+
+	STEPHAN_HOST_DEVICE constexpr void renormalize() noexcept {
+		this->value_part.renormalize();
+		this->operation_count = 0;
+	}
+
+	STEPHAN_HOST_DEVICE constexpr unit_accumulator<T, RenormalizeEvery>& operator*=(const unit_quaternion<T>& rhs) noexcept {
+		this->value_part *= rhs;
+		return this->step();
+	}
+	STEPHAN_HOST_DEVICE constexpr unit_accumulator<T, RenormalizeEvery>& operator/=(const unit_quaternion<T>& rhs) noexcept {
+		this->value_part /= rhs;
+		return this->step();
+	}
+	STEPHAN_HOST_DEVICE constexpr unit_accumulator<T, RenormalizeEvery>& premultiply(const unit_quaternion<T>& lhs) noexcept {
+		this->value_part = lhs * this->value_part;
+		return this->step();
+	}
+};
+
+}
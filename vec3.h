@@ -0,0 +1,73 @@
+/*
+Copyright (c) 2022, Dean Stephan
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of {{ project }} nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Provide a minimal three-dimensional vector
+// This is only what the rotation routines need: a dense x, y, z triple
+// with the usual vector algebra. Arrays of vec3<T> are laid out as plain
+// interleaved T[3] records, as point clouds usually are.
+#pragma once
+
+#include <type_traits>
+
+#include "config.h"
+
+namespace Stephan {
+
+template <typename T>
+struct vec3 {
+	T	x;
+	T	y;
+	T	z;
+
+	STEPHAN_HOST_DEVICE constexpr vec3<T> operator+(const vec3<T>& rhs) const noexcept { return vec3<T>{ x + rhs.x, y + rhs.y, z + rhs.z }; }
+	STEPHAN_HOST_DEVICE constexpr vec3<T> operator-(const vec3<T>& rhs) const noexcept { return vec3<T>{ x - rhs.x, y - rhs.y, z - rhs.z }; }
+	STEPHAN_HOST_DEVICE constexpr vec3<T> operator*(const T& value) const noexcept { return vec3<T>{ x * value, y * value, z * value }; }
+	STEPHAN_HOST_DEVICE constexpr bool operator==(const vec3<T>& rhs) const noexcept { return (x == rhs.x) && (y == rhs.y) && (z == rhs.z); }
+};
+
+template <typename T>
+STEPHAN_HOST_DEVICE constexpr T dot(const vec3<T>& lhs, const vec3<T>& rhs) noexcept {
+	return (lhs.x * rhs.x) + (lhs.y * rhs.y) + (lhs.z * rhs.z);
+}
+template <typename T>
+STEPHAN_HOST_DEVICE constexpr vec3<T> cross(const vec3<T>& lhs, const vec3<T>& rhs) noexcept {
+	return vec3<T>{
+		(lhs.y * rhs.z) - (lhs.z * rhs.y),
+		(lhs.z * rhs.x) - (lhs.x * rhs.z),
+		(lhs.x * rhs.y) - (lhs.y * rhs.x) };
+}
+
+// Layout guarantees.
+static_assert(std::is_trivially_copyable<vec3<float>>::value);
+static_assert(std::is_standard_layout<vec3<float>>::value);
+static_assert(sizeof(vec3<float>) == 3 * sizeof(float));
+static_assert(sizeof(vec3<double>) == 3 * sizeof(double));
+
+}